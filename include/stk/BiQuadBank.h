@@ -0,0 +1,225 @@
+#ifndef STK_BIQUADBANK_H
+#define STK_BIQUADBANK_H
+
+#include "Filter.h"
+
+namespace stk {
+
+/***************************************************/
+/*! \class BiQuadBank
+    \brief STK bank of independent biquad filters.
+
+    This class implements a number of independent two-pole, two-zero
+    digital filters, each computed exactly as by the BiQuad class.
+    The coefficients and states of all filters are held in separate
+    arrays, one value per filter, so that each sample is computed for
+    all filters in one loop that the compiler can vectorize.
+
+    The bank can be used in two ways.  Given one input sample, all
+    filters are run in parallel on it and the sum of their outputs is
+    returned, as for a bank of resonators or the bands of an
+    equalizer.  Given StkFrames, each filter processes its own
+    channel, as for a multichannel filter.  The outputs of the
+    individual filters are available from lastFrame().
+
+    Each filter has its own gain, applied at its input, in addition
+    to the \e gain parameter of the bank, which is applied first.
+    Both default to 1.0.
+*/
+/***************************************************/
+
+class BiQuadBank : public Filter
+{
+public:
+
+  //! Default constructor creates a bank of second-order pass-through filters.
+  /*!
+    An StkError will be thrown if \e nFilters is zero.
+  */
+  BiQuadBank( unsigned int nFilters = 1 );
+
+  //! Class destructor.
+  ~BiQuadBank();
+
+  //! A function to enable/disable the automatic updating of class data when the STK sample rate changes.
+  void ignoreSampleRateChange( bool ignore = true ) { ignoreSampleRateChange_ = ignore; };
+
+  //! Set the number of filters, which are all reset to pass-through.
+  /*!
+    An StkError will be thrown if \e nFilters is zero.
+  */
+  void setFilters( unsigned int nFilters );
+
+  //! Return the number of filters.
+  unsigned int getFilters( void ) const { return nFilters_; };
+
+  //! Clears all internal states of the filters.
+  void clear( void );
+
+  //! Set all coefficients of the specified filter.
+  /*!
+    The \c filter argument must be less than the number of filters.
+    However, range checking is only performed if _STK_DEBUG_ is
+    defined during compilation, in which case an out-of-range value
+    will trigger an StkError exception.
+  */
+  void setCoefficients( unsigned int filter, StkFloat b0, StkFloat b1, StkFloat b2, StkFloat a1, StkFloat a2, bool clearState = false );
+
+  //! Set the input gain of the specified filter.
+  void setFilterGain( unsigned int filter, StkFloat gain );
+
+  //! Return the input gain of the specified filter.
+  StkFloat getFilterGain( unsigned int filter ) const { return filterGains_[filter]; };
+
+  //! Set the coefficients of the specified filter for a resonance at \e frequency (in Hz).
+  /*!
+    The coefficients are computed as by BiQuad::setResonance().
+  */
+  void setResonance( unsigned int filter, StkFloat frequency, StkFloat radius, bool normalize = false );
+
+  //! Set the coefficients of the specified filter for a notch at \e frequency (in Hz).
+  /*!
+    The coefficients are computed as by BiQuad::setNotch().
+  */
+  void setNotch( unsigned int filter, StkFloat frequency, StkFloat radius );
+
+  //! Set the zeroes of the specified filter for equal resonance gain.
+  /*!
+    The coefficients are computed as by BiQuad::setEqualGainZeroes().
+  */
+  void setEqualGainZeroes( unsigned int filter );
+
+  //! Return the last output of the specified filter.
+  StkFloat lastOut( unsigned int filter = 0 ) const { return lastFrame_[filter]; };
+
+  //! Input one sample to all of the filters and return the sum of their outputs.
+  StkFloat tick( StkFloat input );
+
+  //! Take consecutive channels of the StkFrames object as inputs to the filters and replace with corresponding outputs.
+  /*!
+    Filter i processes channel ( \c channel + i ).  The StkFrames
+    argument reference is returned.  The \c channel argument plus the
+    number of filters must be less than or equal to the number of
+    channels in the StkFrames argument (the first channel is
+    specified by 0).  However, range checking is only performed if
+    _STK_DEBUG_ is defined during compilation, in which case an
+    out-of-range value will trigger an StkError exception.
+  */
+  StkFrames& tick( StkFrames& frames, unsigned int channel = 0 );
+
+  //! Take consecutive channels of the \c iFrames object as inputs to the filters and write outputs to the \c oFrames object.
+  /*!
+    Filter i reads channel ( \c iChannel + i ) and writes channel ( \c
+    oChannel + i ).  The \c iFrames object reference is returned.
+    Each channel argument plus the number of filters must be less than
+    or equal to the number of channels in the corresponding StkFrames
+    argument (the first channel is specified by 0).  However, range
+    checking is only performed if _STK_DEBUG_ is defined during
+    compilation, in which case an out-of-range value will trigger an
+    StkError exception.
+  */
+  StkFrames& tick( StkFrames& iFrames, StkFrames &oFrames, unsigned int iChannel = 0, unsigned int oChannel = 0 );
+
+ protected:
+
+  virtual void sampleRateChanged( StkFloat newRate, StkFloat oldRate );
+
+  // Compute one sample of every filter from the inputs in x0_.
+  void compute( void );
+
+  // Filter a block of frames, with the inputs and outputs of
+  // successive filters in successive elements of a frame.
+  void filterBlock( const StkFloat *iSamples, unsigned int iHop,
+                    StkFloat *oSamples, unsigned int oHop, unsigned int nFrames );
+
+  // One value per filter in each array.
+  unsigned int nFilters_;
+  std::vector<StkFloat> filterGains_;
+  std::vector<StkFloat> b0_;
+  std::vector<StkFloat> b1_;
+  std::vector<StkFloat> b2_;
+  std::vector<StkFloat> a1_;
+  std::vector<StkFloat> a2_;
+  std::vector<StkFloat> x0_;
+  std::vector<StkFloat> x1_;
+  std::vector<StkFloat> x2_;
+  std::vector<StkFloat> y1_;
+  std::vector<StkFloat> y2_;
+};
+
+inline void BiQuadBank :: compute( void )
+{
+  // The arrays are independent, which lets the loop be vectorized.
+  StkFloat * __restrict x0 = &x0_[0];
+  StkFloat * __restrict x1 = &x1_[0];
+  StkFloat * __restrict x2 = &x2_[0];
+  StkFloat * __restrict y1 = &y1_[0];
+  StkFloat * __restrict y2 = &y2_[0];
+  const StkFloat * __restrict b0 = &b0_[0];
+  const StkFloat * __restrict b1 = &b1_[0];
+  const StkFloat * __restrict b2 = &b2_[0];
+  const StkFloat * __restrict a1 = &a1_[0];
+  const StkFloat * __restrict a2 = &a2_[0];
+  unsigned int n = nFilters_;
+  for ( unsigned int i=0; i<n; i++ ) {
+    StkFloat y = b0[i] * x0[i] + b1[i] * x1[i] + b2[i] * x2[i];
+    y -= a2[i] * y2[i] + a1[i] * y1[i];
+    x2[i] = x1[i];
+    x1[i] = x0[i];
+    y2[i] = y1[i];
+    y1[i] = y;
+  }
+}
+
+inline StkFloat BiQuadBank :: tick( StkFloat input )
+{
+  unsigned int i;
+  StkFloat x = gain_ * input;
+  for ( i=0; i<nFilters_; i++ )
+    x0_[i] = filterGains_[i] * x;
+  this->compute();
+
+  // The outputs are summed in order, outside the vectorized loop.
+  StkFloat sum = 0.0;
+  for ( i=0; i<nFilters_; i++ ) {
+    lastFrame_[i] = y1_[i];
+    sum += y1_[i];
+  }
+
+  return sum;
+}
+
+inline StkFrames& BiQuadBank :: tick( StkFrames& frames, unsigned int channel )
+{
+#if defined(_STK_DEBUG_)
+  if ( channel + nFilters_ > frames.channels() ) {
+    oStream_ << "BiQuadBank::tick(): channel and StkFrames arguments are incompatible!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  if ( frames.frames() == 0 ) return frames;
+  StkFloat *samples = &frames[channel];
+  unsigned int hop = frames.channels();
+  this->filterBlock( samples, hop, samples, hop, frames.frames() );
+  return frames;
+}
+
+inline StkFrames& BiQuadBank :: tick( StkFrames& iFrames, StkFrames& oFrames, unsigned int iChannel, unsigned int oChannel )
+{
+#if defined(_STK_DEBUG_)
+  if ( iChannel + nFilters_ > iFrames.channels() || oChannel + nFilters_ > oFrames.channels() ) {
+    oStream_ << "BiQuadBank::tick(): channel and StkFrames arguments are incompatible!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  if ( iFrames.frames() == 0 ) return iFrames;
+  this->filterBlock( &iFrames[iChannel], iFrames.channels(),
+                     &oFrames[oChannel], oFrames.channels(), iFrames.frames() );
+  return iFrames;
+}
+
+} // stk namespace
+
+#endif
@@ -0,0 +1,287 @@
+#ifndef STK_CONVREV_H
+#define STK_CONVREV_H
+
+#include "Effect.h"
+#include "Convolver.h"
+#include "FileRead.h"
+#include <atomic>
+
+#if defined(__STK_REALTIME__)
+  #include "Thread.h"
+#endif
+
+namespace stk {
+
+/***************************************************/
+/*! \class ConvRev
+    \brief STK convolution reverberator class.
+
+    This class takes a monophonic input signal and convolves it with a
+    measured or designed impulse response, typically loaded from an
+    audio file with the FileRead class.  Each channel of the impulse
+    response produces one output channel, so a stereo file gives a
+    stereo reverberator.  Responses of several seconds can be run in
+    real time.
+
+    The response is split into segments that are convolved with
+    partitions of increasing size.  The first 2 * \e tailSize samples
+    (the head) are convolved on the calling thread by a Convolver,
+    with small partitions and no latency.  The rest (the tail) is
+    convolved in partitions of \e tailSize samples, growing by a
+    factor of four per segment up to 16384 samples.  Each segment
+    starts at least two of its partitions into the response, so its
+    output for a partition of input is not needed until one partition
+    after that input is complete.
+
+    In realtime builds, the tail is computed by a background thread
+    from that lookahead, so the cost of the large partitions never
+    falls on the audio callback.  The \e tailSize should then be at
+    least twice the audio buffer size.  If the tail of an output
+    sample has not been computed by the time it is needed, the sample
+    is output without it and the event is counted (see
+    getUnderruns()).  Otherwise, or if the background thread is
+    disabled with setBackgroundTail(), the tail is computed on the
+    calling thread once per \e tailSize samples and the output does
+    not depend on timing.
+
+    The impulse response is used at its own sample rate.
+*/
+/***************************************************/
+
+class ConvRev : public Effect
+{
+ public:
+  //! Default constructor creates a pass-through reverberator with a unit impulse response.
+  ConvRev( void );
+
+  //! Overloaded constructor that loads an impulse response file.
+  /*!
+    An StkError will be thrown if the file is not found, its format
+    is unknown, a read error occurs, or \e tailSize is not a power of
+    two.
+  */
+  ConvRev( std::string fileName, bool raw = false, unsigned int tailSize = 1024 );
+
+  //! Class destructor.
+  ~ConvRev( void );
+
+  //! Load an impulse response from an audio file.
+  /*!
+    Integer sample formats are scaled to the range +-1.0.  An
+    StkError will be thrown if the file is not found, its format is
+    unknown, or a read error occurs.
+  */
+  void openFile( std::string fileName, bool raw = false );
+
+  //! Set the impulse response, with one channel per output channel.
+  /*!
+    The internal state is cleared.  An StkError will be thrown if the
+    response is empty.
+  */
+  void setImpulseResponse( const StkFrames& response );
+
+  //! Set the size of the smallest tail partition, which must be a power of two.
+  /*!
+    This is also the lookahead given to the background thread, in
+    samples.  Larger values reduce the chance of underruns and the
+    total cost, and raise the cost on the calling thread.  The
+    default is 1024.  The internal state is cleared.  An StkError can
+    be thrown if the size is not a power of two.
+  */
+  void setTailSize( unsigned int size );
+
+  //! Return the size of the smallest tail partition.
+  unsigned int getTailSize( void ) const { return tailSize_; };
+
+  //! Enable or disable computation of the tail by a background thread (realtime builds only).
+  /*!
+    The background thread is enabled by default.  It should be
+    disabled when ticks are not computed in real time, as when
+    rendering to a file, where the calling thread would otherwise
+    outrun it.
+  */
+  void setBackgroundTail( bool enabled );
+
+  //! Return the number of output samples whose tail was not ready in time.
+  /*!
+    This value is reset when the impulse response is set or the
+    state is cleared.  It is always zero unless the background thread
+    is in use.
+  */
+  unsigned long getUnderruns( void ) const { return underruns_.load( std::memory_order_relaxed ); };
+
+  //! Reset and clear all internal state.
+  void clear( void );
+
+  //! Return the specified channel value of the last computed frame.
+  /*!
+    Use the lastFrame() function to get all values of the last
+    computed frame.  The \c channel argument must be less than
+    channelsOut().  However, range checking is only performed if
+    _STK_DEBUG_ is defined during compilation, in which case an
+    out-of-range value will trigger an StkError exception.
+  */
+  StkFloat lastOut( unsigned int channel = 0 );
+
+  //! Input one sample to the effect and return the specified \c channel value of the computed frame.
+  /*!
+    Use the lastFrame() function to get all values of the computed
+    output frame.  The \c channel argument must be less than
+    channelsOut().  However, range checking is only performed if
+    _STK_DEBUG_ is defined during compilation, in which case an
+    out-of-range value will trigger an StkError exception.
+  */
+  StkFloat tick( StkFloat input, unsigned int channel = 0 );
+
+  //! Take a channel of the StkFrames object as inputs to the effect and replace with the computed outputs.
+  /*!
+    The StkFrames argument reference is returned.  The channelsOut()
+    outputs are written to the StkFrames argument starting at the
+    specified \c channel.  Therefore, the \c channel argument must be
+    less than or equal to ( channels() - channelsOut() ) of the
+    StkFrames argument (the first channel is specified by 0).
+    However, range checking is only performed if _STK_DEBUG_ is
+    defined during compilation, in which case an out-of-range value
+    will trigger an StkError exception.
+  */
+  StkFrames& tick( StkFrames& frames, unsigned int channel = 0 );
+
+  //! Take a channel of the \c iFrames object as inputs to the effect and write outputs to the \c oFrames object.
+  /*!
+    The \c iFrames object reference is returned.  The \c iChannel
+    argument must be less than the number of channels in the \c
+    iFrames argument (the first channel is specified by 0).  The \c
+    oChannel argument must be less than or equal to ( channels() -
+    channelsOut() ) of the \c oFrames argument.  However, range
+    checking is only performed if _STK_DEBUG_ is defined during
+    compilation, in which case an out-of-range value will trigger an
+    StkError exception.
+  */
+  StkFrames& tick( StkFrames& iFrames, StkFrames &oFrames, unsigned int iChannel = 0, unsigned int oChannel = 0 );
+
+  // Called by the thread routine to compute the tail as input
+  // arrives.  This is not intended for general use but must be public
+  // for access from the thread.
+  void computeTail( void );
+
+ protected:
+
+  // The largest tail partition size.
+  static const unsigned int MAX_PARTITION = 16384;
+
+  // One segment of the tail, convolved with uniform partitions of
+  // size samples by overlap-save.  The spectra of the partitions of
+  // coefficients are stored by channel, and the delay line holds one
+  // input spectrum per partition, the newest at index newest.
+  struct TailStage {
+    Fft fft;
+    unsigned int size;
+    unsigned int nPartitions;
+    unsigned int newest;
+    unsigned long offset;
+    std::vector<StkFloat> spectraReal;
+    std::vector<StkFloat> spectraImag;
+    std::vector<StkFloat> historyReal;
+    std::vector<StkFloat> historyImag;
+  };
+
+  // Lay out the head and tail segments for the current response.
+  void build( void );
+
+  // Called once per tailSize_ inputs to pass them to the tail.
+  void endBlock( void );
+
+  // Compute the tail for the next tailSize_ inputs and publish the
+  // tailSize_ output samples it completes.
+  void computeBlock( void );
+
+  // Add the output of one tail segment for the partition of inputs ending at time.
+  void computeStage( TailStage& stage, unsigned long time );
+
+  // Drop the tail state and restart it at the given input time.
+  void skipTail( unsigned long time );
+
+  // Check for newly published tail output, counting an underrun if there is none.
+  bool tailReady( void );
+
+  void startTail( void );
+  void stopTail( void );
+
+#if defined(__STK_REALTIME__)
+  Thread thread_;
+#endif
+  std::atomic<bool> running_;
+  bool background_;
+
+  StkFrames response_;
+  std::vector<Convolver> heads_;
+  std::vector<TailStage> stages_;
+  unsigned int tailSize_;
+
+  // The input and output rings are shared with the tail thread.
+  // Inputs before written_ and tail outputs before ready_ (both
+  // absolute sample times) may be read by the other side.  The
+  // accumulator is private to the tail computation.
+  std::vector<StkFloat> tailInputs_;
+  std::vector<StkFloat> tailOutputs_;
+  std::vector<StkFloat> accumulator_;
+  unsigned long inputMask_;
+  unsigned long outputMask_;
+  unsigned long accumulatorMask_;
+  std::atomic<unsigned long> written_;
+  std::atomic<unsigned long> ready_;
+  std::atomic<unsigned long> underruns_;
+
+  // Sample times of the calling thread and of the tail computation.
+  unsigned long time_;
+  unsigned long readyTime_;
+  unsigned long tailTime_;
+
+  std::vector<StkFloat> sumReal_;
+  std::vector<StkFloat> sumImag_;
+  std::vector<StkFloat> work_;
+};
+
+inline StkFloat ConvRev :: lastOut( unsigned int channel )
+{
+#if defined(_STK_DEBUG_)
+  if ( channel >= lastFrame_.channels() ) {
+    oStream_ << "ConvRev::lastOut(): channel argument is invalid!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  return lastFrame_[channel];
+}
+
+inline StkFloat ConvRev :: tick( StkFloat input, unsigned int channel )
+{
+#if defined(_STK_DEBUG_)
+  if ( channel >= lastFrame_.channels() ) {
+    oStream_ << "ConvRev::tick(): channel argument is invalid!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  // Times are compared by difference so that they can wrap around.
+  const StkFloat *tail = 0;
+  unsigned int i, nChannels = lastFrame_.channels();
+  if ( stages_.size() ) {
+    tailInputs_[time_ & inputMask_] = input;
+    if ( (long) ( readyTime_ - time_ ) > 0 || this->tailReady() )
+      tail = &tailOutputs_[( time_ & outputMask_ ) * nChannels];
+  }
+
+  for ( i=0; i<nChannels; i++ ) {
+    StkFloat wet = heads_[i].tick( input );
+    if ( tail ) wet += tail[i];
+    lastFrame_[i] = effectMix_ * wet + ( 1.0 - effectMix_ ) * input;
+  }
+
+  if ( ( ++time_ & ( tailSize_ - 1 ) ) == 0 ) this->endBlock();
+  return lastFrame_[channel];
+}
+
+} // stk namespace
+
+#endif
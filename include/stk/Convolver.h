@@ -0,0 +1,180 @@
+#ifndef STK_CONVOLVER_H
+#define STK_CONVOLVER_H
+
+#include "Filter.h"
+#include "Fft.h"
+
+namespace stk {
+
+/***************************************************/
+/*! \class Convolver
+    \brief STK partitioned FFT convolution filter class.
+
+    This class implements the same finite impulse response filter as
+    the Fir class, y[n] = b[0]*x[n] + ... + b[nb]*x[n-nb], with a cost
+    per sample that grows much more slowly with the filter length, so
+    that impulse responses of thousands of taps can be run in real
+    time.  The Fir class uses it automatically for long filters.
+
+    The coefficients are split into partitions of equal size.  The
+    first partition is computed in direct form, sample by sample, so
+    the filter has no latency.  The remaining partitions are applied
+    in the frequency domain by overlap-save: once per partition of
+    input samples, the last two partitions of input are transformed
+    into a delay line of spectra, each spectrum is multiplied by the
+    spectrum of the matching partition of coefficients, and the sum
+    is transformed back to give the contribution of all but the first
+    partition to the next partition of output samples.
+
+    The \e gain parameter is applied at the filter input and does not
+    affect the coefficient values.  The default gain value is 1.0.
+*/
+/***************************************************/
+
+class Convolver : public Filter
+{
+public:
+  //! Default constructor creates a zero-order pass-through "filter".
+  Convolver( void );
+
+  //! Overloaded constructor which takes filter coefficients and an optional partition size.
+  /*!
+    A partition size of zero selects a size suited to the filter
+    length.  An StkError can be thrown if the coefficient vector size
+    is zero or the partition size is not a power of two.
+  */
+  Convolver( std::vector<StkFloat> &coefficients, unsigned int partitionSize = 0 );
+
+  //! Class destructor.
+  ~Convolver( void );
+
+  //! Clears all internal states of the filter.
+  void clear( void );
+
+  //! Set filter coefficients.
+  /*!
+    An StkError can be thrown if the coefficient vector size is
+    zero.  The internal state of the filter is not cleared unless the
+    \e clearState flag is \c true or the partitioning changes.
+  */
+  void setCoefficients( std::vector<StkFloat> &coefficients, bool clearState = false );
+
+  //! Set the partition size, which must be a power of two, or zero to select one automatically.
+  /*!
+    Larger partitions lower the cost of the frequency-domain part of
+    long filters and raise the cost of the direct-form part.  The
+    internal state of the filter is cleared if the partitioning
+    changes.  An StkError can be thrown if the size is not a power of
+    two.
+  */
+  void setPartitionSize( unsigned int size );
+
+  //! Return the partition size in use.
+  unsigned int getPartitionSize( void ) const { return partitionSize_; };
+
+  //! Return the last computed output value.
+  StkFloat lastOut( void ) const { return lastFrame_[0]; };
+
+  //! Input one sample to the filter and return one output.
+  StkFloat tick( StkFloat input );
+
+  //! Take a channel of the StkFrames object as inputs to the filter and replace with corresponding outputs.
+  /*!
+    The StkFrames argument reference is returned.  The \c channel
+    argument must be less than the number of channels in the
+    StkFrames argument (the first channel is specified by 0).
+    However, range checking is only performed if _STK_DEBUG_ is
+    defined during compilation, in which case an out-of-range value
+    will trigger an StkError exception.
+  */
+  StkFrames& tick( StkFrames& frames, unsigned int channel = 0 );
+
+  //! Take a channel of the \c iFrames object as inputs to the filter and write outputs to the \c oFrames object.
+  /*!
+    The \c iFrames object reference is returned.  Each channel
+    argument must be less than the number of channels in the
+    corresponding StkFrames argument (the first channel is specified
+    by 0).  However, range checking is only performed if _STK_DEBUG_
+    is defined during compilation, in which case an out-of-range value
+    will trigger an StkError exception.
+  */
+  StkFrames& tick( StkFrames& iFrames, StkFrames &oFrames, unsigned int iChannel = 0, unsigned int oChannel = 0 );
+
+protected:
+
+  // Filter a block of samples, which may be in place.
+  void filterBlock( const StkFloat *iSamples, unsigned int iHop,
+                    StkFloat *oSamples, unsigned int oHop, unsigned int nFrames );
+
+  // Compute the frequency-domain output for the next partition of
+  // samples, once a partition of inputs is complete.
+  void nextPartition( void );
+
+  // The inputs_ hold the last two partitions of input and the
+  // outputs_ the frequency-domain output of the current partition.
+  // The delay line holds one input spectrum per frequency-domain
+  // partition, the newest at index newest_.
+  Fft fft_;
+  unsigned int requestedSize_;
+  unsigned int partitionSize_;
+  unsigned int nPartitions_;
+  unsigned int position_;
+  unsigned int newest_;
+  std::vector<StkFloat> head_;
+  std::vector<StkFloat> spectraReal_;
+  std::vector<StkFloat> spectraImag_;
+  std::vector<StkFloat> historyReal_;
+  std::vector<StkFloat> historyImag_;
+  std::vector<StkFloat> sumReal_;
+  std::vector<StkFloat> sumImag_;
+  std::vector<StkFloat> work_;
+};
+
+inline StkFloat Convolver :: tick( StkFloat input )
+{
+  unsigned int n = partitionSize_;
+  input *= gain_;
+  inputs_[n + position_] = input;
+
+  // The last n inputs are found in order from position_ + 1.
+  lastFrame_[0] = dot( &head_[0], &inputs_[position_ + 1], n - 1 ) + head_[n-1] * input;
+  lastFrame_[0] += outputs_[position_];
+  if ( ++position_ == n ) this->nextPartition();
+
+  return lastFrame_[0];
+}
+
+inline StkFrames& Convolver :: tick( StkFrames& frames, unsigned int channel )
+{
+#if defined(_STK_DEBUG_)
+  if ( channel >= frames.channels() ) {
+    oStream_ << "Convolver::tick(): channel and StkFrames arguments are incompatible!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  if ( frames.frames() == 0 ) return frames;
+  StkFloat *samples = &frames[channel];
+  unsigned int hop = frames.channels();
+  this->filterBlock( samples, hop, samples, hop, frames.frames() );
+  return frames;
+}
+
+inline StkFrames& Convolver :: tick( StkFrames& iFrames, StkFrames& oFrames, unsigned int iChannel, unsigned int oChannel )
+{
+#if defined(_STK_DEBUG_)
+  if ( iChannel >= iFrames.channels() || oChannel >= oFrames.channels() ) {
+    oStream_ << "Convolver::tick(): channel and StkFrames arguments are incompatible!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  if ( iFrames.frames() == 0 ) return iFrames;
+  this->filterBlock( &iFrames[iChannel], iFrames.channels(),
+                     &oFrames[oChannel], oFrames.channels(), iFrames.frames() );
+  return iFrames;
+}
+
+} // stk namespace
+
+#endif
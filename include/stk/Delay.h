@@ -17,6 +17,10 @@ namespace stk {
     A non-interpolating delay line is typically used in fixed
     delay-length applications, such as for reverberation.
 
+    The delay-line length is rounded up to a power of two, so that its
+    indices wrap with a mask rather than a test, and blocks of samples
+    are moved in contiguous spans.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -116,24 +120,26 @@ public:
 
 protected:
 
+  // Filter a block of samples.  The inputs are written to the
+  // delay line in spans that are not read back within the span, so
+  // that the processing can be in place.
+  void filterBlock( const StkFloat *iSamples, unsigned int iHop,
+                    StkFloat *oSamples, unsigned int oHop, unsigned long nFrames );
+
   unsigned long inPoint_;
   unsigned long outPoint_;
   unsigned long delay_;
+  unsigned long mask_;
 };
 
 inline StkFloat Delay :: tick( StkFloat input )
 {
-  inputs_[inPoint_++] = input * gain_;
-
-  // Check for end condition
-  if ( inPoint_ == inputs_.size() )
-    inPoint_ = 0;
+  inputs_[inPoint_] = input * gain_;
+  inPoint_ = ( inPoint_ + 1 ) & mask_;
 
   // Read out next value
-  lastFrame_[0] = inputs_[outPoint_++];
-
-  if ( outPoint_ == inputs_.size() )
-    outPoint_ = 0;
+  lastFrame_[0] = inputs_[outPoint_];
+  outPoint_ = ( outPoint_ + 1 ) & mask_;
 
   return lastFrame_[0];
 }
@@ -147,16 +153,10 @@ inline StkFrames& Delay :: tick( StkFrames& frames, unsigned int channel )
   }
 #endif
 
+  if ( frames.frames() == 0 ) return frames;
   StkFloat *samples = &frames[channel];
   unsigned int hop = frames.channels();
-  for ( unsigned int i=0; i<frames.frames(); i++, samples += hop ) {
-    inputs_[inPoint_++] = *samples * gain_;
-    if ( inPoint_ == inputs_.size() ) inPoint_ = 0;
-    *samples = inputs_[outPoint_++];
-    if ( outPoint_ == inputs_.size() ) outPoint_ = 0;
-  }
-
-  lastFrame_[0] = *(samples-hop);
+  this->filterBlock( samples, hop, samples, hop, frames.frames() );
   return frames;
 }
 
@@ -169,17 +169,9 @@ inline StkFrames& Delay :: tick( StkFrames& iFrames, StkFrames& oFrames, unsigne
   }
 #endif
 
-  StkFloat *iSamples = &iFrames[iChannel];
-  StkFloat *oSamples = &oFrames[oChannel];
-  unsigned int iHop = iFrames.channels(), oHop = oFrames.channels();
-  for ( unsigned int i=0; i<iFrames.frames(); i++, iSamples += iHop, oSamples += oHop ) {
-    inputs_[inPoint_++] = *iSamples * gain_;
-    if ( inPoint_ == inputs_.size() ) inPoint_ = 0;
-    *oSamples = inputs_[outPoint_++];
-    if ( outPoint_ == inputs_.size() ) outPoint_ = 0;
-  }
-
-  lastFrame_[0] = *(oSamples-oHop);
+  if ( iFrames.frames() == 0 ) return iFrames;
+  this->filterBlock( &iFrames[iChannel], iFrames.channels(),
+                     &oFrames[oChannel], oFrames.channels(), iFrames.frames() );
   return iFrames;
 }
 
@@ -21,6 +21,10 @@ namespace stk {
     minimum delay possible in this implementation is limited to a
     value of 0.5.
 
+    The delay-line length is rounded up to a power of two, so that its
+    indices wrap with a mask rather than a test, and blocks of samples
+    are read in contiguous spans.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -112,8 +116,15 @@ public:
 
 protected:  
 
+  // Filter a block of samples.  The inputs are written to the
+  // delay line in spans that are not read back within the span, so
+  // that the processing can be in place.
+  void filterBlock( const StkFloat *iSamples, unsigned int iHop,
+                    StkFloat *oSamples, unsigned int oHop, unsigned long nFrames );
+
   unsigned long inPoint_;
   unsigned long outPoint_;
+  unsigned long mask_;
   StkFloat delay_;
   StkFloat alpha_;
   StkFloat coeff_;
@@ -136,19 +147,17 @@ inline StkFloat DelayA :: nextOut( void )
 
 inline StkFloat DelayA :: tick( StkFloat input )
 {
-  inputs_[inPoint_++] = input * gain_;
+  inputs_[inPoint_] = input * gain_;
 
   // Increment input pointer modulo length.
-  if ( inPoint_ == inputs_.size() )
-    inPoint_ = 0;
+  inPoint_ = ( inPoint_ + 1 ) & mask_;
 
   lastFrame_[0] = nextOut();
   doNextOut_ = true;
 
   // Save the allpass input and increment modulo length.
-  apInput_ = inputs_[outPoint_++];
-  if ( outPoint_ == inputs_.size() )
-    outPoint_ = 0;
+  apInput_ = inputs_[outPoint_];
+  outPoint_ = ( outPoint_ + 1 ) & mask_;
 
   return lastFrame_[0];
 }
@@ -162,18 +171,10 @@ inline StkFrames& DelayA :: tick( StkFrames& frames, unsigned int channel )
   }
 #endif
 
+  if ( frames.frames() == 0 ) return frames;
   StkFloat *samples = &frames[channel];
   unsigned int hop = frames.channels();
-  for ( unsigned int i=0; i<frames.frames(); i++, samples += hop ) {
-    inputs_[inPoint_++] = *samples * gain_;
-    if ( inPoint_ == inputs_.size() ) inPoint_ = 0;
-    *samples = nextOut();
-    lastFrame_[0] = *samples;
-    doNextOut_ = true;
-    apInput_ = inputs_[outPoint_++];
-    if ( outPoint_ == inputs_.size() ) outPoint_ = 0;
-  }
-
+  this->filterBlock( samples, hop, samples, hop, frames.frames() );
   return frames;
 }
 
@@ -186,19 +187,9 @@ inline StkFrames& DelayA :: tick( StkFrames& iFrames, StkFrames& oFrames, unsign
   }
 #endif
 
-  StkFloat *iSamples = &iFrames[iChannel];
-  StkFloat *oSamples = &oFrames[oChannel];
-  unsigned int iHop = iFrames.channels(), oHop = oFrames.channels();
-  for ( unsigned int i=0; i<iFrames.frames(); i++, iSamples += iHop, oSamples += oHop ) {
-    inputs_[inPoint_++] = *iSamples * gain_;
-    if ( inPoint_ == inputs_.size() ) inPoint_ = 0;
-    *oSamples = nextOut();
-    lastFrame_[0] = *oSamples;
-    doNextOut_ = true;
-    apInput_ = inputs_[outPoint_++];
-    if ( outPoint_ == inputs_.size() ) outPoint_ = 0;
-  }
-
+  if ( iFrames.frames() == 0 ) return iFrames;
+  this->filterBlock( &iFrames[iChannel], iFrames.channels(),
+                     &oFrames[oChannel], oFrames.channels(), iFrames.frames() );
   return iFrames;
 }
 
@@ -20,6 +20,10 @@ namespace stk {
     delay setting.  The use of higher order Lagrange interpolators can
     typically improve (minimize) this attenuation characteristic.
 
+    The delay-line length is rounded up to a power of two, so that its
+    indices wrap with a mask rather than a test, and blocks of samples
+    are interpolated in contiguous spans.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -108,8 +112,15 @@ public:
 
  protected:
 
+  // Filter a block of samples.  The inputs are written to the
+  // delay line in spans that are not read back within the span, so
+  // that the processing can be in place.
+  void filterBlock( const StkFloat *iSamples, unsigned int iHop,
+                    StkFloat *oSamples, unsigned int oHop, unsigned long nFrames );
+
   unsigned long inPoint_;
   unsigned long outPoint_;
+  unsigned long mask_;
   StkFloat delay_;
   StkFloat alpha_;
   StkFloat omAlpha_;
@@ -123,10 +134,7 @@ inline StkFloat DelayL :: nextOut( void )
     // First 1/2 of interpolation
     nextOutput_ = inputs_[outPoint_] * omAlpha_;
     // Second 1/2 of interpolation
-    if (outPoint_+1 < inputs_.size())
-      nextOutput_ += inputs_[outPoint_+1] * alpha_;
-    else
-      nextOutput_ += inputs_[0] * alpha_;
+    nextOutput_ += inputs_[( outPoint_ + 1 ) & mask_] * alpha_;
     doNextOut_ = false;
   }
 
@@ -135,18 +143,16 @@ inline StkFloat DelayL :: nextOut( void )
 
 inline StkFloat DelayL :: tick( StkFloat input )
 {
-  inputs_[inPoint_++] = input * gain_;
+  inputs_[inPoint_] = input * gain_;
 
   // Increment input pointer modulo length.
-  if ( inPoint_ == inputs_.size() )
-    inPoint_ = 0;
+  inPoint_ = ( inPoint_ + 1 ) & mask_;
 
   lastFrame_[0] = nextOut();
   doNextOut_ = true;
 
   // Increment output pointer modulo length.
-  if ( ++outPoint_ == inputs_.size() )
-    outPoint_ = 0;
+  outPoint_ = ( outPoint_ + 1 ) & mask_;
 
   return lastFrame_[0];
 }
@@ -160,17 +166,10 @@ inline StkFrames& DelayL :: tick( StkFrames& frames, unsigned int channel )
   }
 #endif
 
+  if ( frames.frames() == 0 ) return frames;
   StkFloat *samples = &frames[channel];
   unsigned int hop = frames.channels();
-  for ( unsigned int i=0; i<frames.frames(); i++, samples += hop ) {
-    inputs_[inPoint_++] = *samples * gain_;
-    if ( inPoint_ == inputs_.size() ) inPoint_ = 0;
-    *samples = nextOut();
-    doNextOut_ = true;
-    if ( ++outPoint_ == inputs_.size() ) outPoint_ = 0;
-  }
-
-  lastFrame_[0] = *(samples-hop);
+  this->filterBlock( samples, hop, samples, hop, frames.frames() );
   return frames;
 }
 
@@ -183,18 +182,9 @@ inline StkFrames& DelayL :: tick( StkFrames& iFrames, StkFrames& oFrames, unsign
   }
 #endif
 
-  StkFloat *iSamples = &iFrames[iChannel];
-  StkFloat *oSamples = &oFrames[oChannel];
-  unsigned int iHop = iFrames.channels(), oHop = oFrames.channels();
-  for ( unsigned int i=0; i<iFrames.frames(); i++, iSamples += iHop, oSamples += oHop ) {
-    inputs_[inPoint_++] = *iSamples * gain_;
-    if ( inPoint_ == inputs_.size() ) inPoint_ = 0;
-    *oSamples = nextOut();
-    doNextOut_ = true;
-    if ( ++outPoint_ == inputs_.size() ) outPoint_ = 0;
-  }
-
-  lastFrame_[0] = *(oSamples-oHop);
+  if ( iFrames.frames() == 0 ) return iFrames;
+  this->filterBlock( &iFrames[iChannel], iFrames.channels(),
+                     &oFrames[oChannel], oFrames.channels(), iFrames.frames() );
   return iFrames;
 }
 
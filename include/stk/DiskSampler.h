@@ -0,0 +1,256 @@
+#ifndef STK_DISKSAMPLER_H
+#define STK_DISKSAMPLER_H
+
+#include "Instrmnt.h"
+#include "ADSR.h"
+#include "FileRead.h"
+#include <atomic>
+#include <vector>
+
+#if defined(__STK_REALTIME__)
+  #include "Thread.h"
+  #include "Mutex.h"
+#endif
+
+namespace stk {
+
+/***************************************************/
+/*! \class DiskSampler
+    \brief STK disk-streaming multisample instrument.
+
+    This class plays a set of sample zones, each mapped to a range
+    of MIDI key numbers, without holding whole files in memory.  Only
+    the attack "head" of each zone is loaded when the zone is added.
+    The remainder of each file is read from disk in fixed-size blocks
+    by a pool of background threads shared by all zones and voices.
+
+    Tail blocks live in a common, reference-counted cache.  Voices
+    playing the same region of a zone share a single copy, and
+    recently used blocks stay cached until their slot is needed
+    again.  Each voice requests the blocks ahead of its read position
+    as soon as it starts, so the disk threads have the length of the
+    head in which to respond.  If a block has not arrived by the time
+    it is needed, the voice outputs silence and the missed block is
+    counted once (see getUnderruns()).  Without realtime support,
+    blocks are read synchronously when requested.
+
+    Multi-channel files are mixed to mono as they are read.  Voices
+    are pitch-shifted with linear interpolation relative to the base
+    frequency of their zone.  When all voices are busy, the oldest
+    one is stolen.
+
+    Zones should be added before playback starts.  The addZone()
+    function is not safe to call while tick() is running in another
+    thread.
+*/
+/***************************************************/
+
+class DiskSampler : public Instrmnt
+{
+ public:
+  //! Class constructor.
+  /*!
+    The first \e headFrames sample frames of each zone are held in
+    memory, and the rest is streamed in blocks of \e blockFrames
+    frames by \e nThreads disk threads.  An StkError will be thrown
+    if a disk thread cannot be started.
+  */
+  DiskSampler( unsigned int nVoices = 16, unsigned long headFrames = 32768,
+               unsigned long blockFrames = 8192, unsigned int nThreads = 2 );
+
+  //! Class destructor.
+  ~DiskSampler( void );
+
+  //! Open a sample file and add it as a zone for the given range of MIDI key numbers.
+  /*!
+    The \e baseFrequency argument is the pitch of the recorded
+    sample.  The return value is the index of the new zone.  An
+    StkError will be thrown if the file is not found, its format is
+    unknown, or a read error occurs.
+  */
+  unsigned int addZone( std::string fileName, StkFloat baseFrequency,
+                        int loKey = 0, int hiKey = 127, bool raw = false );
+
+  //! Stop all voices and release their cached blocks.
+  void clear( void );
+
+  //! Set the release time of the voice envelopes in seconds.
+  void setReleaseTime( StkFloat time );
+
+  //! Start a note with the given frequency and amplitude.
+  /*!
+    The zone whose key range contains the frequency is played,
+    or the zone nearest in pitch if none does.
+  */
+  void noteOn( StkFloat frequency, StkFloat amplitude );
+
+  //! Release all sounding voices.
+  void noteOff( StkFloat amplitude );
+
+  //! Release the voices started with the given frequency.
+  void noteOff( StkFloat frequency, StkFloat amplitude );
+
+  //! Return the number of tail blocks that were not loaded in time, counted once per voice and block.
+  unsigned long getUnderruns( void ) const { return underruns_.load( std::memory_order_relaxed ); };
+
+  //! Compute and return one output sample.
+  StkFloat tick( unsigned int channel = 0 );
+
+  //! Fill a channel of the StkFrames object with computed outputs.
+  /*!
+    The \c channel argument must be less than the number of
+    channels in the StkFrames argument (the first channel is specified
+    by 0).  However, range checking is only performed if _STK_DEBUG_
+    is defined during compilation, in which case an out-of-range value
+    will trigger an StkError exception.
+  */
+  StkFrames& tick( StkFrames& frames, unsigned int channel = 0 );
+
+  // Called by the thread routines to load requested blocks from disk.
+  // This is not intended for general use but must be public for access
+  // from the threads.
+  void readBlocks( void );
+
+ protected:
+
+  // Block states, used to pass ownership between the audio and disk threads.
+  enum { BLOCK_FREE, BLOCK_REQUESTED, BLOCK_LOADING, BLOCK_READY };
+
+  // The number of consecutive blocks each voice holds, starting with the one it is reading.
+  enum { VOICE_BLOCKS = 3 };
+
+  struct Zone {
+    FileRead file;
+    StkFrames head;
+    unsigned long headFrames;
+    unsigned long size;
+    StkFloat fileRate;
+    StkFloat baseFrequency;
+    int loKey;
+    int hiKey;
+#if defined(__STK_REALTIME__)
+    Mutex mutex;
+#endif
+  };
+
+  struct Block {
+    StkFrames data;
+    Zone *zone;
+    long index;
+    int refs;
+    unsigned long lastUse;
+    std::atomic<int> state;
+  };
+
+  struct Voice {
+    ADSR envelope;
+    Zone *zone;
+    StkFloat key;
+    StkFloat time;
+    StkFloat rate;
+    StkFloat gain;
+    unsigned long order;
+    long block;
+    long missedBlock;
+    int slots[VOICE_BLOCKS];
+  };
+
+  StkFloat tickVoice( Voice& voice );
+  void stopVoice( Voice& voice );
+
+  // Hold the blocks from \e index onwards, releasing those no longer needed.
+  void advanceVoice( Voice& voice, long index );
+
+  // Return the cache slot for a zone block, queueing a disk read if
+  // necessary, or -1 if no slot is available.
+  int acquireBlock( Zone *zone, long index );
+  void releaseBlock( int slot );
+
+  void loadBlock( Block& block, StkFrames& buffer );
+
+  // Stop and join the disk threads.
+  void stopThreads( void );
+
+  std::vector<Zone *> zones_;
+  Voice *voices_;
+  unsigned int nVoices_;
+  Block *blocks_;
+  unsigned int nBlocks_;
+  unsigned long headFrames_;
+  unsigned long blockFrames_;
+  unsigned long voiceCounter_;
+  unsigned long useCounter_;
+  std::atomic<unsigned long> underruns_;
+
+#if defined(__STK_REALTIME__)
+  std::vector<Thread *> threads_;
+  std::atomic<bool> running_;
+#endif
+};
+
+inline StkFloat DiskSampler :: tickVoice( Voice& voice )
+{
+  Zone *zone = voice.zone;
+  if ( voice.time >= zone->size - 1.0 || voice.envelope.getState() == ADSR::IDLE ) {
+    this->stopVoice( voice );
+    return 0.0;
+  }
+
+  unsigned long i = (unsigned long) voice.time;
+  StkFloat alpha = voice.time - (StkFloat) i;
+  StkFloat a = 0.0, b = 0.0;
+  if ( i < zone->headFrames ) {
+    a = zone->head[i];
+    b = zone->head[i+1];
+  }
+  else {
+    long index = (long) ( ( i - zone->headFrames ) / blockFrames_ );
+    if ( index != voice.block || voice.slots[0] < 0 )
+      this->advanceVoice( voice, index );
+
+    int slot = voice.slots[0];
+    if ( slot >= 0 && blocks_[slot].state.load( std::memory_order_acquire ) == BLOCK_READY ) {
+      unsigned long offset = i - zone->headFrames - index * blockFrames_;
+      a = blocks_[slot].data[offset];
+      b = blocks_[slot].data[offset+1];
+    }
+    else if ( index != voice.missedBlock ) {
+      // Count each block that is missed once, not each silent frame.
+      underruns_.fetch_add( 1, std::memory_order_relaxed );
+      voice.missedBlock = index;
+    }
+  }
+
+  voice.time += voice.rate;
+  return ( a + alpha * ( b - a ) ) * voice.gain * voice.envelope.tick();
+}
+
+inline StkFloat DiskSampler :: tick( unsigned int )
+{
+  lastFrame_[0] = 0.0;
+  for ( unsigned int i=0; i<nVoices_; i++ )
+    if ( voices_[i].zone ) lastFrame_[0] += this->tickVoice( voices_[i] );
+
+  return lastFrame_[0];
+}
+
+inline StkFrames& DiskSampler :: tick( StkFrames& frames, unsigned int channel )
+{
+#if defined(_STK_DEBUG_)
+  if ( channel >= frames.channels() ) {
+    oStream_ << "DiskSampler::tick(): channel and StkFrames arguments are incompatible!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  StkFloat *samples = &frames[channel];
+  unsigned int hop = frames.channels();
+  for ( unsigned int i=0; i<frames.frames(); i++, samples += hop )
+    *samples = this->tick();
+
+  return frames;
+}
+
+} // stk namespace
+
+#endif
@@ -41,6 +41,25 @@ class Effect : public Stk
   // Returns true if argument value is prime.
   bool isPrime( unsigned int number );
 
+  // The delay lines of the reverberators are power-of-two rings,
+  // indexed by a running sample time.  These size a ring to hold at
+  // least the given number of samples, return how many of n samples
+  // from the given time precede the end of a ring, and copy n samples
+  // between a ring, from the given time, and a strided array.
+  static void setLine( std::vector<StkFloat> &line, unsigned long length );
+  static unsigned int lineSpan( const std::vector<StkFloat> &line, unsigned long time, unsigned int n );
+  static void readLine( const std::vector<StkFloat> &line, unsigned long time,
+                        StkFloat *samples, unsigned int hop, unsigned int n );
+  static void writeLine( std::vector<StkFloat> &line, unsigned long time,
+                         const StkFloat *samples, unsigned int hop, unsigned int n );
+
+  // Run an allpass filter in place over n samples, with its delay
+  // line written to a ring from the given time.  The filter feeds
+  // back the delay output of the previous sample, as in the JCRev,
+  // NRev and PRCRev classes, so n must not exceed the delay plus one.
+  static void allpassBlock( std::vector<StkFloat> &line, unsigned long time, unsigned long delay,
+                            StkFloat coefficient, StkFloat *samples, unsigned int n );
+
   StkFrames lastFrame_;
   StkFloat effectMix_;
 
@@ -73,6 +92,71 @@ inline bool Effect :: isPrime( unsigned int number )
   else return false; // even
 }
 
+inline void Effect :: setLine( std::vector<StkFloat> &line, unsigned long length )
+{
+  unsigned long size = 1;
+  while ( size < length ) size <<= 1;
+  line.assign( size, 0.0 );
+}
+
+inline unsigned int Effect :: lineSpan( const std::vector<StkFloat> &line, unsigned long time, unsigned int n )
+{
+  unsigned long count = line.size() - ( time & ( line.size() - 1 ) );
+  return ( count < n ) ? (unsigned int) count : n;
+}
+
+inline void Effect :: readLine( const std::vector<StkFloat> &line, unsigned long time,
+                                StkFloat *samples, unsigned int hop, unsigned int n )
+{
+  unsigned long mask = line.size() - 1;
+  for ( unsigned int done=0, count; done<n; done+=count ) {
+    unsigned long position = ( time + done ) & mask;
+    count = n - done;
+    if ( count > line.size() - position ) count = line.size() - position;
+    const StkFloat *in = &line[position];
+    StkFloat *out = samples + done * hop;
+    for ( unsigned int i=0; i<count; i++ )
+      out[i * hop] = in[i];
+  }
+}
+
+inline void Effect :: writeLine( std::vector<StkFloat> &line, unsigned long time,
+                                 const StkFloat *samples, unsigned int hop, unsigned int n )
+{
+  unsigned long mask = line.size() - 1;
+  for ( unsigned int done=0, count; done<n; done+=count ) {
+    unsigned long position = ( time + done ) & mask;
+    count = n - done;
+    if ( count > line.size() - position ) count = line.size() - position;
+    StkFloat *out = &line[position];
+    const StkFloat *in = samples + done * hop;
+    for ( unsigned int i=0; i<count; i++ )
+      out[i] = in[i * hop];
+  }
+}
+
+inline void Effect :: allpassBlock( std::vector<StkFloat> &line, unsigned long time, unsigned long delay,
+                                    StkFloat coefficient, StkFloat *samples, unsigned int n )
+{
+  // The delayed values of the block are all written before the block,
+  // so each span between the ends of the ring is one independent loop.
+  unsigned long mask = line.size() - 1;
+  for ( unsigned int done=0, count; done<n; done+=count ) {
+    count = lineSpan( line, time - delay - 1 + done, n - done );
+    count = lineSpan( line, time + done, count );
+    const StkFloat *delayed = &line[( time - delay - 1 + done ) & mask];
+    StkFloat *in = &line[( time + done ) & mask];
+    StkFloat *x = samples + done;
+    for ( unsigned int i=0; i<count; i++ ) {
+      StkFloat temp = delayed[i];
+      StkFloat temp1 = coefficient * temp;
+      temp1 += x[i];
+      in[i] = temp1;
+      x[i] = -( coefficient * temp1 ) + temp;
+    }
+  }
+}
+
 } // stk namespace
 
 #endif
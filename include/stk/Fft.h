@@ -0,0 +1,81 @@
+#ifndef STK_FFT_H
+#define STK_FFT_H
+
+#include "Stk.h"
+#include <vector>
+
+namespace stk {
+
+/***************************************************/
+/*! \class Fft
+    \brief STK real fast Fourier transform class.
+
+    This class computes the discrete Fourier transform of a block of
+    real values, and its inverse, for block sizes that are powers of
+    two.  It needs no external library.  A real transform of size N
+    is computed as a complex transform of size N/2, using an
+    iterative radix-2 algorithm with precomputed twiddle factors and
+    bit-reversal indices.
+
+    A spectrum is given by its N/2 + 1 non-negative frequency bins,
+    with the real and imaginary parts in separate arrays.  The
+    forward transform is not scaled and the inverse transform is
+    scaled by 1/N, so that one undoes the other.
+*/
+/***************************************************/
+
+class Fft : public Stk
+{
+ public:
+  //! Default constructor, which takes the transform size.
+  /*!
+    An StkError will be thrown if the size is not a power of two
+    greater than 1.
+  */
+  Fft( unsigned int size = 2 );
+
+  //! Class destructor.
+  ~Fft( void );
+
+  //! Set the transform size.
+  /*!
+    An StkError will be thrown if the size is not a power of two
+    greater than 1.
+  */
+  void setSize( unsigned int size );
+
+  //! Return the transform size.
+  unsigned int getSize( void ) const { return size_; };
+
+  //! Compute the spectrum of \e size real values.
+  /*!
+    The \e size/2 + 1 bins are written to the \c real and \c imag
+    arrays.  The input is not changed.
+  */
+  void forward( const StkFloat *input, StkFloat *real, StkFloat *imag );
+
+  //! Compute \e size real values from a spectrum of \e size/2 + 1 bins.
+  /*!
+    The imaginary parts of the first and last bins are ignored.  The
+    spectrum is not changed.
+  */
+  void inverse( const StkFloat *real, const StkFloat *imag, StkFloat *output );
+
+ protected:
+
+  // Compute a complex transform of size_/2 points in place.
+  void transform( StkFloat *real, StkFloat *imag, bool inverse );
+
+  unsigned int size_;
+  std::vector<unsigned int> bitReverse_;
+  std::vector<StkFloat> cosine_;
+  std::vector<StkFloat> sine_;
+  std::vector<StkFloat> twiddleCos_;
+  std::vector<StkFloat> twiddleSin_;
+  std::vector<StkFloat> workReal_;
+  std::vector<StkFloat> workImag_;
+};
+
+} // stk namespace
+
+#endif
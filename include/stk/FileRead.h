@@ -16,6 +16,10 @@ namespace stk {
     passed to the read() function.  This class
     does not store its own copy of the file data,
     rather the data is read directly from disk.
+    Where the operating system supports it, the
+    file is memory-mapped when opened and read()
+    converts samples straight from the mapped
+    pages, without a system call per read.
 
     FileRead currently supports uncompressed WAV,
     AIFF/AIFC, SND (AU), MAT-file (Matlab), and
@@ -105,6 +109,18 @@ public:
    */
   void read( StkFrames& buffer, unsigned long startFrame = 0, bool doNormalize = true );
 
+  //! Return a pointer to the sample data of a memory-mapped file, or NULL if the file is not mapped.
+  /*!
+    The data holds fileSize() frames of interleaved samples of
+    channels() channels, stored in the file's format() and byte order
+    (see isByteSwapped()).  The pointer is valid until the file is
+    closed.
+  */
+  const void *data( void ) const;
+
+  //! Returns \e true if the file data byte order is opposite to that of the host.
+  bool isByteSwapped( void ) const { return byteswap_; };
+
 protected:
 
   // Get STK RAW file information.
@@ -126,7 +142,18 @@ protected:
   // Helper function for MAT-file parsing.
   bool findNextMatArray( SINT32 *chunkSize, SINT32 *rows, SINT32 *columns, SINT32 *nametype );
 
+  // Map the open file into memory, if possible.
+  void mapFile( void );
+
+  // Release the file mapping, if any.
+  void unmapFile( void );
+
+  // Convert samples from the file mapping into the StkFrames object.
+  bool readMapped( StkFrames& buffer, unsigned long offset, long nSamples, bool doNormalize );
+
   FILE *fd_;
+  unsigned char *map_;
+  size_t mapLength_;
   bool byteswap_;
   bool wavFile_;
   unsigned long fileSize_;
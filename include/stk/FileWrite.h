@@ -73,8 +73,23 @@ class FileWrite : public Stk
    */
   void write( StkFrames& buffer );
 
+  //! Turn triangular (TPDF) dither on or off for fixed-point data formats.
+  /*!
+    When enabled, noise with a triangular distribution spanning +-1
+    least significant bit is added to each sample, which is then
+    rounded to the output resolution.  Dither is off by default and
+    has no effect on floating-point data formats.
+  */
+  void setDither( bool doDither ) { dither_ = doDither; };
+
  protected:
 
+  // Convert a block of samples into the staging buffer and write it to the file.
+  bool writeBlock( const StkFloat *samples, unsigned long nSamples );
+
+  // Scale samples to the fixed-point range, adding dither if enabled.
+  void scaleBlock( const StkFloat *samples, unsigned long nSamples, StkFloat gain, StkFloat offset );
+
   // Write STK RAW file header.
   bool setRawFile( std::string fileName );
 
@@ -108,6 +123,10 @@ class FileWrite : public Stk
   unsigned int channels_;
   unsigned long frameCounter_;
   bool byteswap_;
+  bool dither_;
+  unsigned long ditherSeed_;
+  std::vector<StkFloat> scaled_;
+  std::vector<unsigned char> staging_;
 
 };
 
@@ -3,6 +3,11 @@
 
 #include "WvIn.h"
 #include "FileRead.h"
+#include <atomic>
+
+#if defined(__STK_REALTIME__)
+  #include "Thread.h"
+#endif
 
 namespace stk {
 
@@ -27,7 +32,11 @@ namespace stk {
     This behavior is controlled by the optional constructor arguments
     \e chunkThreshold and \e chunkSize.  File sizes greater than \e
     chunkThreshold (in sample frames) will be read incrementally in
-    chunks of \e chunkSize each (also in sample frames).
+    chunks of \e chunkSize each (also in sample frames).  In realtime
+    builds, chunks are read ahead of the playhead by a background disk
+    thread so that tick() never waits on file access.  If a chunk has
+    not arrived by the time it is needed, silence is output and the
+    event is counted (see getUnderruns()).
 
     When the file end is reached, subsequent calls to the tick()
     functions return zeros and isFinished() returns \e true.
@@ -117,6 +126,15 @@ public:
    */
   virtual void addTime( StkFloat time );
 
+  //! Return the number of chunk underruns since the file was opened.
+  /*!
+    An underrun occurs when the read pointer enters a chunk that the
+    disk thread has not yet loaded, in which case zeros are output
+    until the data arrives.  This value is always zero when the file
+    data is held in memory.
+  */
+  unsigned long getUnderruns( void ) const { return underruns_.load( std::memory_order_relaxed ); };
+
   //! Turn linear interpolation on/off.
   /*!
     Interpolation is automatically off when the read rate is
@@ -161,10 +179,45 @@ public:
   */
   virtual StkFrames& tick( StkFrames& frames );
 
+  // Called by the thread routine to load requested chunks from disk.
+  // This is not intended for general use but must be public for access
+  // from the thread.
+  void readAhead( void );
+
 protected:
 
   void sampleRateChanged( StkFloat newRate, StkFloat oldRate );
 
+  // Return the chunk pointer adjacent to \e pointer in the given direction.
+  long nextChunk( long pointer, bool forward ) const;
+
+#if defined(__STK_REALTIME__)
+  // Chunk states, used to pass ownership between the audio and disk threads.
+  enum { CHUNK_FREE, CHUNK_REQUESTED, CHUNK_READY };
+
+  // The number of read-ahead chunks kept in flight while streaming.
+  enum { STREAM_CHUNKS = 4 };
+
+  struct StreamChunk {
+    StkFrames data;
+    long start;
+    std::atomic<int> state;
+  };
+
+  void startStream( void );
+  void stopStream( void );
+
+  // Make the loaded chunk containing the read pointer current, returning false if none is ready.
+  bool swapChunk( long pointer );
+
+  // Queue disk reads for the chunk at \e pointer and those following it.
+  void requestChunks( long pointer );
+
+  Thread thread_;
+  std::atomic<bool> streaming_;
+  StreamChunk chunks_[STREAM_CHUNKS];
+#endif
+
   FileRead file_;
   bool finished_;
   bool interpolate_;
@@ -175,6 +228,8 @@ protected:
   unsigned long chunkThreshold_;
   unsigned long chunkSize_;
   long chunkPointer_;
+  long missedChunk_;
+  std::atomic<unsigned long> underruns_;
 
 };
 
@@ -68,6 +68,9 @@ public:
 
 protected:
 
+  // Return the dot product of n coefficients and inputs.
+  static StkFloat dot( const StkFloat *coefficients, const StkFloat *inputs, size_t n );
+
   StkFloat gain_;
   unsigned int channelsIn_;
   StkFrames lastFrame_;
@@ -90,6 +93,23 @@ inline void Filter :: clear( void )
     lastFrame_[i] = 0.0;  
 }
 
+inline StkFloat Filter :: dot( const StkFloat *coefficients, const StkFloat *inputs, size_t n )
+{
+  // Four independent sums can be computed in vector registers.
+  size_t i = 0, blocks = n & ~(size_t) 3;
+  StkFloat sum0 = 0.0, sum1 = 0.0, sum2 = 0.0, sum3 = 0.0;
+  for ( ; i<blocks; i+=4 ) {
+    sum0 += coefficients[i] * inputs[i];
+    sum1 += coefficients[i+1] * inputs[i+1];
+    sum2 += coefficients[i+2] * inputs[i+2];
+    sum3 += coefficients[i+3] * inputs[i+3];
+  }
+  for ( ; i<n; i++ )
+    sum0 += coefficients[i] * inputs[i];
+
+  return ( sum0 + sum1 ) + ( sum2 + sum3 );
+}
+
 inline StkFloat Filter :: phaseDelay( StkFloat frequency )
 {
   if ( frequency <= 0.0 || frequency > 0.5 * Stk::sampleRate() ) {
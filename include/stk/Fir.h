@@ -2,6 +2,7 @@
 #define STK_FIR_H
 
 #include "Filter.h"
+#include "Convolver.h"
 
 namespace stk {
 
@@ -23,6 +24,14 @@ namespace stk {
     This structure results in one extra multiply per computed sample,
     but allows easy control of the overall filter gain.
 
+    The input history is kept twice over in a circular buffer, so
+    that each output is a dot product over contiguous memory without
+    shifting the history, and the StkFrames tick() functions filter
+    a whole block at a time.  Filters with more than
+    PARTITION_THRESHOLD coefficients are computed by the Convolver
+    class with partitioned FFT convolution, which gives the same
+    output, up to rounding, at a much lower cost.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -30,6 +39,9 @@ namespace stk {
 class Fir : public Filter
 {
 public:
+  //! Filters with more coefficients than this use partitioned FFT convolution.
+  static const unsigned int PARTITION_THRESHOLD = 192;
+
   //! Default constructor creates a zero-order pass-through "filter".
   Fir( void );
 
@@ -43,11 +55,15 @@ public:
   //! Class destructor.
   ~Fir( void );
 
+  //! Clears all internal states of the filter.
+  void clear( void );
+
   //! Set filter coefficients.
   /*!
     An StkError can be thrown if the coefficient vector size is
     zero.  The internal state of the filter is not cleared unless the
-    \e clearState flag is \c true.
+    \e clearState flag is \c true or the filter switches between
+    direct form and partitioned convolution (see PARTITION_THRESHOLD).
   */
   void setCoefficients( std::vector<StkFloat> &coefficients, bool clearState = false );
 
@@ -81,19 +97,36 @@ public:
 
 protected:
 
+  // Filter a block of samples, which may be in place.
+  void filterBlock( const StkFloat *iSamples, unsigned int iHop,
+                    StkFloat *oSamples, unsigned int oHop, unsigned int nFrames );
+
+  // The inputs_ history holds 2N values for N coefficients, each
+  // input stored at index_ and index_ + N, so the last N inputs are
+  // always found in order at index_ + 1 to index_ + N.
+  std::vector<StkFloat> taps_;
+  std::vector<StkFloat> block_;
+  unsigned int index_;
+  Convolver convolver_;
+  bool partitioned_;
 };
 
 inline StkFloat Fir :: tick( StkFloat input )
 {
-  lastFrame_[0] = 0.0;
-  inputs_[0] = gain_ * input;
-
-  for ( unsigned int i=b_.size()-1; i>0; i-- ) {
-    lastFrame_[0] += b_[i] * inputs_[i];
-    inputs_[i] = inputs_[i-1];
+  if ( partitioned_ ) {
+    convolver_.setGain( gain_ );
+    lastFrame_[0] = convolver_.tick( input );
+    return lastFrame_[0];
   }
-  lastFrame_[0] += b_[0] * inputs_[0];
 
+  unsigned int n = taps_.size();
+  if ( ++index_ == n ) index_ = 0;
+  input *= gain_;
+  inputs_[index_] = inputs_[index_ + n] = input;
+
+  // The newest input is taken from the register rather than reloaded
+  // from the history just written.
+  lastFrame_[0] = dot( &taps_[0], &inputs_[index_ + 1], n - 1 ) + taps_[n-1] * input;
   return lastFrame_[0];
 }
 
@@ -106,20 +139,17 @@ inline StkFrames& Fir :: tick( StkFrames& frames, unsigned int channel )
   }
 #endif
 
-  StkFloat *samples = &frames[channel];
-  unsigned int i, hop = frames.channels();
-  for ( unsigned int j=0; j<frames.frames(); j++, samples += hop ) {
-    inputs_[0] = gain_ * *samples;
-    *samples = 0.0;
-
-    for ( i=b_.size()-1; i>0; i-- ) {
-      *samples += b_[i] * inputs_[i];
-      inputs_[i] = inputs_[i-1];
-    }
-    *samples += b_[0] * inputs_[0];
+  if ( frames.frames() == 0 ) return frames;
+  if ( partitioned_ ) {
+    convolver_.setGain( gain_ );
+    convolver_.tick( frames, channel );
+    lastFrame_[0] = convolver_.lastOut();
+    return frames;
   }
 
-  lastFrame_[0] = *(samples-hop);
+  StkFloat *samples = &frames[channel];
+  unsigned int hop = frames.channels();
+  this->filterBlock( samples, hop, samples, hop, frames.frames() );
   return frames;
 }
 
@@ -132,21 +162,16 @@ inline StkFrames& Fir :: tick( StkFrames& iFrames, StkFrames& oFrames, unsigned
   }
 #endif
 
-  StkFloat *iSamples = &iFrames[iChannel];
-  StkFloat *oSamples = &oFrames[oChannel];
-  unsigned int i, iHop = iFrames.channels(), oHop = oFrames.channels();
-  for ( unsigned int j=0; j<iFrames.frames(); j++, iSamples += iHop, oSamples += oHop ) {
-    inputs_[0] = gain_ * *iSamples;
-    *oSamples = 0.0;
-
-    for ( i=b_.size()-1; i>0; i-- ) {
-      *oSamples += b_[i] * inputs_[i];
-      inputs_[i] = inputs_[i-1];
-    }
-    *oSamples += b_[0] * inputs_[0];
+  if ( iFrames.frames() == 0 ) return iFrames;
+  if ( partitioned_ ) {
+    convolver_.setGain( gain_ );
+    convolver_.tick( iFrames, oFrames, iChannel, oChannel );
+    lastFrame_[0] = convolver_.lastOut();
+    return iFrames;
   }
 
-  lastFrame_[0] = *(oSamples-oHop);
+  this->filterBlock( &iFrames[iChannel], iFrames.channels(),
+                     &oFrames[oChannel], oFrames.channels(), iFrames.frames() );
   return iFrames;
 }
 
@@ -2,8 +2,8 @@
 #define STK_FREEVERB_H
 
 #include "Effect.h"
-#include "Delay.h"
-#include "OnePole.h"
+#include <vector>
+#include <cmath>
 
 namespace stk {
 
@@ -19,6 +19,14 @@ namespace stk {
     stereo, and the output signal is stereo.  The delay lengths are
     optimized for a sample rate of 44100 Hz.
 
+    The 16 comb filters of the two channels are independent, so they
+    are computed together, one sample of all of them per loop pass,
+    from arrays that the compiler can vectorize.  The StkFrames tick()
+    functions run each comb and allpass filter over blocks of samples
+    no longer than the shortest delay line.  Values in the feedback
+    loops that decay below 1e-30 are flushed to zero, so that the
+    reverb tail never reaches the slow denormal range.
+
     Ported to STK by Gregory Burlet, 2012.
 */
 /***********************************************************************/
@@ -120,16 +128,23 @@ class FreeVerb : public Effect
   //! Update interdependent parameters.
   void update( void );
 
-  // Clamp very small floats to zero, version from
-  // http://music.columbia.edu/pipermail/linux-audio-user/2004-July/013489.html .
-  // However, this is for 32-bit floats only.
-  //static inline StkFloat undenormalize( volatile StkFloat s ) { 
-  //  s += 9.8607615E-32f; 
-  //  return s - 9.8607615E-32f; 
-  //}
-    
+  // Compute a block of samples, with the inputs and wet outputs in
+  // the input and wet arrays.
+  void computeBlock( unsigned int nFrames );
+
+  // Run the lowpass feedback of all combs over a block of frames of
+  // interleaved lanes, given one row of states per frame.
+  static void filterCombs( StkFloat *lanes, StkFloat *states, const StkFloat *inputs, unsigned int nFrames,
+                           StkFloat b0, StkFloat a1, StkFloat roomSize );
+
+  // Values in the feedback loops smaller in magnitude than this are
+  // flushed to zero.
+  static StkFloat flush( StkFloat value ) { return ( std::fabs( value ) < (StkFloat) 1e-30 ) ? (StkFloat) 0.0 : value; };
+
   static const int nCombs = 8;
   static const int nAllpasses = 4;
+  static const int nLanes = 2 * nCombs;
+  static const int maxBlockSize = 128;
   static const int stereoSpread = 23;
   static const StkFloat fixedGain;
   static const StkFloat scaleWet;
@@ -139,8 +154,8 @@ class FreeVerb : public Effect
   static const StkFloat offsetRoom;
 
   // Delay line lengths for 44100Hz sampling rate.
-  static int cDelayLengths[nCombs];
-  static int aDelayLengths[nAllpasses];
+  static const int cDelayLengths[nCombs];
+  static const int aDelayLengths[nAllpasses];
 
   StkFloat g_;        // allpass coefficient
   StkFloat gain_;
@@ -151,15 +166,30 @@ class FreeVerb : public Effect
   StkFloat width_;
   bool frozenMode_;
 
+  // The delay lines of both channels, left channel first.  Each line
+  // is a power-of-two ring indexed by the sample count, written at
+  // time_ and read at time_ minus the line delay.
+  unsigned long time_;
+  unsigned int blockSize_;
+
   // LBFC: Lowpass Feedback Comb Filters
-  Delay combDelayL_[nCombs];
-  Delay combDelayR_[nCombs];
-  OnePole combLPL_[nCombs];
-  OnePole combLPR_[nCombs];
-        
+  std::vector<StkFloat> combLines_[nLanes];
+  unsigned long combDelays_[nLanes];
+
+  // Lowpass filter states, one row of lanes per frame of a block with
+  // the current states in the first row.
+  std::vector<StkFloat> combStates_;
+
   // AP: Allpass Filters
-  Delay allPassDelayL_[nAllpasses];
-  Delay allPassDelayR_[nAllpasses];
+  std::vector<StkFloat> allPassLines_[2 * nAllpasses];
+  unsigned long allPassDelays_[2 * nAllpasses];
+
+  // Block buffers: interleaved comb lanes, inputs and wet outputs.
+  std::vector<StkFloat> lanes_;
+  std::vector<StkFloat> inputL_;
+  std::vector<StkFloat> inputR_;
+  std::vector<StkFloat> wetL_;
+  std::vector<StkFloat> wetR_;
 };
 
 inline StkFloat FreeVerb :: lastOut( unsigned int channel )
@@ -191,41 +221,31 @@ inline StkFloat FreeVerb::tick( StkFloat inputL, StkFloat inputR, unsigned int c
   StkFloat outL = 0.0;
   StkFloat outR = 0.0;
 
-  // Parallel LBCF filters
-  for ( int i = 0; i < nCombs; i++ ) {
-    // Left channel
-    //StkFloat yn = fInput + (roomSize_ * FreeVerb::undenormalize(combLPL_[i].tick(FreeVerb::undenormalize(combDelayL_[i].nextOut()))));
-    StkFloat yn = fInput + (roomSize_ * combLPL_[i].tick( combDelayL_[i].nextOut() ) );
-    combDelayL_[i].tick(yn);
-    outL += yn;
-
-    // Right channel
-    //yn = fInput + (roomSize_ * FreeVerb::undenormalize(combLPR_[i].tick(FreeVerb::undenormalize(combDelayR_[i].nextOut()))));
-    yn = fInput + (roomSize_ * combLPR_[i].tick( combDelayR_[i].nextOut() ) );
-    combDelayR_[i].tick(yn);
-    outR += yn;
+  // Parallel LBCF filters, left channel in the first nCombs lanes
+  StkFloat b0 = 1.0 - damp_, a1 = -damp_;
+  for ( int i = 0; i < nLanes; i++ ) {
+    std::vector<StkFloat> &line = combLines_[i];
+    unsigned long mask = line.size() - 1;
+    combStates_[i] = flush( b0 * line[( time_ - combDelays_[i] ) & mask] - a1 * combStates_[i] );
+    StkFloat yn = fInput + (roomSize_ * combStates_[i]);
+    line[time_ & mask] = yn;
+    if ( i < nCombs ) outL += yn;
+    else outR += yn;
   }
 
   // Series allpass filters
-  for ( int i = 0; i < nAllpasses; i++ ) {
-    // Left channel
-    //StkFloat vn_m = FreeVerb::undenormalize(allPassDelayL_[i].nextOut());
-    StkFloat vn_m = allPassDelayL_[i].nextOut();
-    StkFloat vn = outL + (g_ * vn_m);
-    allPassDelayL_[i].tick(vn);
-        
-    // calculate output
-    outL = -vn + (1.0 + g_)*vn_m;
-
-    // Right channel
-    //vn_m = FreeVerb::undenormalize(allPassDelayR_[i].nextOut());
-    vn_m = allPassDelayR_[i].nextOut();
-    vn = outR + (g_ * vn_m);
-    allPassDelayR_[i].tick(vn);
+  for ( int i = 0; i < 2 * nAllpasses; i++ ) {
+    std::vector<StkFloat> &line = allPassLines_[i];
+    unsigned long mask = line.size() - 1;
+    StkFloat &out = ( i < nAllpasses ) ? outL : outR;
+    StkFloat vn_m = line[( time_ - allPassDelays_[i] ) & mask];
+    StkFloat vn = flush( out + (g_ * vn_m) );
+    line[time_ & mask] = vn;
 
     // calculate output
-    outR = -vn + (1.0 + g_)*vn_m;
+    out = -vn + (1.0 + g_)*vn_m;
   }
+  time_++;
 
   // Mix output
   lastFrame_[0] = outL*wet1_ + outR*wet2_ + inputL*dry_;
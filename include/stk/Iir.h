@@ -27,6 +27,16 @@ namespace stk {
     This structure results in one extra multiply per computed sample,
     but allows easy control of the overall filter gain.
 
+    Filters of order greater than two are factored into a cascade of
+    second-order sections, which are computed in transposed direct
+    form II.  This is faster than the direct form and less sensitive
+    to rounding.  If the roots of the coefficients cannot be found,
+    the direct form is used.  The poles of a high-order filter with
+    poles close together, such as a low crossover at a high sample
+    rate, can already be moved outside the unit circle by rounding
+    its coefficients, so such designs should be set in second-order
+    sections with setSections().
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -79,6 +89,26 @@ public:
   */
   void setDenominator( std::vector<StkFloat> &aCoefficients, bool clearState = false );
 
+  //! Set the filter as a cascade of second-order sections.
+  /*!
+    Each section is given by six coefficients, b[0], b[1], b[2], a[0],
+    a[1] and a[2], in the order used by most filter design packages.
+    Each section is normalized by its a[0].  The numerator and
+    denominator coefficients are set to the product of the sections.
+    An StkError can be thrown if the coefficient vector size is not a
+    positive multiple of six or if the a[0] coefficient of a section
+    is equal to zero.  The internal state of the filter is not cleared
+    unless the \e clearState flag is \c true or the number of sections
+    changes.
+  */
+  void setSections( std::vector<StkFloat> &sections, bool clearState = false );
+
+  //! Return the number of second-order sections in use, or zero if the direct form is used.
+  unsigned int getSections( void ) const { return nSections_; };
+
+  //! Clears all internal states of the filter.
+  void clear( void );
+
   //! Return the last computed output value.
   StkFloat lastOut( void ) const { return lastFrame_[0]; };
 
@@ -109,12 +139,39 @@ public:
 
 protected:
 
+  // Factor the coefficients into second-order sections if the order
+  // is greater than two, or select the direct form.
+  void factor( void );
+
+  // Filter a block of samples through the sections, which may be in place.
+  void filterSections( const StkFloat *iSamples, unsigned int iHop,
+                       StkFloat *oSamples, unsigned int oHop, unsigned int nFrames );
+
+  // Each section holds b[0], b[1], b[2], a[1] and a[2], and its two
+  // states.
+  unsigned int nSections_;
+  std::vector<StkFloat> sections_;
+  std::vector<StkFloat> states_;
 };
 
 inline StkFloat Iir :: tick( StkFloat input )
 {
   unsigned int i;
 
+  if ( nSections_ ) {
+    StkFloat x, y = gain_ * input;
+    const StkFloat *c = &sections_[0];
+    StkFloat *s = &states_[0];
+    for ( i=0; i<nSections_; i++, c+=5, s+=2 ) {
+      x = y;
+      y = c[0] * x + s[0];
+      s[0] = c[1] * x - c[3] * y + s[1];
+      s[1] = c[2] * x - c[4] * y;
+    }
+    lastFrame_[0] = y;
+    return y;
+  }
+
   outputs_[0] = 0.0;
   inputs_[0] = gain_ * input;
   for ( i=b_.size()-1; i>0; i-- ) {
@@ -141,8 +198,14 @@ inline StkFrames& Iir :: tick( StkFrames& frames, unsigned int channel )
   }
 #endif
 
+  if ( frames.frames() == 0 ) return frames;
   StkFloat *samples = &frames[channel];
   unsigned int i, hop = frames.channels();
+  if ( nSections_ ) {
+    this->filterSections( samples, hop, samples, hop, frames.frames() );
+    return frames;
+  }
+
   for ( unsigned int j=0; j<frames.frames(); j++, samples += hop ) {
     outputs_[0] = 0.0;
     inputs_[0] = gain_ * *samples;
@@ -173,9 +236,15 @@ inline StkFrames& Iir :: tick( StkFrames& iFrames, StkFrames& oFrames, unsigned
   }
 #endif
 
+  if ( iFrames.frames() == 0 ) return iFrames;
   StkFloat *iSamples = &iFrames[iChannel];
   StkFloat *oSamples = &oFrames[oChannel];
   unsigned int i, iHop = iFrames.channels(), oHop = oFrames.channels();
+  if ( nSections_ ) {
+    this->filterSections( iSamples, iHop, oSamples, oHop, iFrames.frames() );
+    return iFrames;
+  }
+
   for ( unsigned int j=0; j<iFrames.frames(); j++, iSamples += iHop, oSamples += oHop ) {
     outputs_[0] = 0.0;
     inputs_[0] = gain_ * *iSamples;
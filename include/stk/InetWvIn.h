@@ -5,7 +5,8 @@
 #include "TcpServer.h"
 #include "UdpSocket.h"
 #include "Thread.h"
-#include "Mutex.h"
+#include "JitterBuffer.h"
+#include <atomic>
 
 namespace stk {
 
@@ -31,12 +32,22 @@ namespace stk {
     data type for the incoming stream is signed 16-bit integers,
     though any of the defined StkFormats are permissible.
 
+    Incoming data is received by a separate thread (using epoll and,
+    for UDP, batched recvmmsg calls under Linux) and passed to the
+    computing thread through a lock-free JitterBuffer.  The tick()
+    functions never block: until enough data has arrived to cover
+    the target latency, and whenever the stream falls behind, they
+    return zeros.  UDP packets that begin with the header described
+    by Socket::PACKET_MAGIC are checked for loss and order (see
+    getLostPackets() and getLatePackets()).  Packets without the
+    header are queued as they arrive.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
 
 typedef struct {
-  bool finished;
+  std::atomic<bool> finished;
   void *object;
 } ThreadInfo;
 
@@ -71,6 +82,27 @@ public:
   */
   bool isConnected( void );
 
+  //! Set the minimum delay, in sample frames, between data arrival and output (default = 0).
+  /*!
+    The delay is raised automatically when data arrives late and
+    lowered again, down to this value, while the stream keeps up.
+    It is limited to half of the total buffer size given to the
+    constructor.
+  */
+  void setLatency( unsigned long frames );
+
+  //! Return the current delay, in sample frames, between data arrival and output.
+  unsigned long getLatency( void ) const { return jitter_.getLatency(); };
+
+  //! Return the number of UDP packets dropped because they arrived out of order.
+  unsigned long getLatePackets( void ) const { return jitter_.getLatePackets(); };
+
+  //! Return the number of UDP packets that were missing or dropped because the buffer was full.
+  unsigned long getLostPackets( void ) const { return jitter_.getLostPackets(); };
+
+  //! Return the number of times the stream fell behind and zeros were output.
+  unsigned long getUnderruns( void ) const { return jitter_.getUnderruns(); };
+
   //! Return the specified channel value of the last computed frame.
   /*!
     For multi-channel files, use the lastFrame() function to get
@@ -115,25 +147,28 @@ public:
 
 protected:
 
-  // Read buffered socket data into the data buffer ... will block if none available.
+  // Convert buffered socket data into the data buffer ... never blocks.
   int readData( void );
 
+  // Start and stop the input thread.
+  void startReceiving( void );
+  void stopReceiving( void );
+
   Socket *soket_;
   Thread thread_;
-  Mutex mutex_;
-  char *buffer_;
+  JitterBuffer jitter_;
+  unsigned char *packets_;
   unsigned long bufferFrames_;
-  unsigned long bufferBytes_;
-  unsigned long bytesFilled_;
   unsigned int nBuffers_;
-  unsigned long writePoint_;
-  unsigned long readPoint_;
   long bufferCounter_;
-  int dataBytes_;
-  bool connected_;
+  long bufferIndex_;
+  std::atomic<bool> connected_;
+  bool receiving_;
   int fd_;
+  int epoll_;
+  int wakeup_;
   ThreadInfo threadInfo_;
-  Stk::StkFormat dataType_;
+  Socket::ProtocolType protocol_;
 
 };
 
@@ -147,7 +182,7 @@ inline StkFloat InetWvIn :: lastOut( unsigned int channel )
 #endif
 
   // If no connection and we've output all samples in the queue, return.
-  if ( !connected_ && bytesFilled_ == 0 && bufferCounter_ == 0 ) return 0.0;
+  if ( !connected_ && jitter_.getFillLevel() == 0 && bufferCounter_ == 0 ) return 0.0;
 
   return lastFrame_[channel];
 }
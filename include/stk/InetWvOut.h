@@ -3,6 +3,7 @@
 
 #include "WvOut.h"
 #include "Socket.h"
+#include <atomic>
 
 namespace stk {
 
@@ -25,6 +26,14 @@ namespace stk {
     data type is signed 16-bit integers but any of the defined
     StkFormats are permissible.
 
+    Samples are converted in blocks, directly into a ring of packet
+    buffers.  All InetWvOut instances share a single I/O thread that
+    sends the queued packets in batches under Linux (a sendmmsg()
+    call for UDP, a single gathered write for TCP), so the calling
+    thread never writes to a socket.  If the ring is full, the tick()
+    functions wait for the I/O thread.  Socket errors are detected by
+    the I/O thread and reported by the next tick() call.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -76,14 +85,32 @@ class InetWvOut : public WvOut
   */
   void tick( const StkFrames& frames );
 
+  //! Enable or disable the sequenced packet header on UDP packets (default = false).
+  /*!
+    When enabled, each UDP packet starts with the header described
+    by Socket::PACKET_MAGIC, which allows InetWvIn to detect lost and
+    late packets.  Receivers that do not expect the header will treat
+    it as audio data.
+  */
+  void setPacketHeader( bool enable ) { packetHeader_ = enable; };
+
+  // Called by the I/O thread routine to send queued packets.  Returns
+  // true if any data was sent.  This is not intended for general use
+  // but must be public for access from the thread.
+  bool sendPackets( void );
+
  protected:
 
   void incrementFrame( void );
 
-  // Write a buffer of length frames via the socket connection.
+  // Convert a buffer of length frames into the next packet and queue it for sending.
   void writeData( unsigned long frames );
 
-  char *buffer_;
+  // Release sent packets to the calling thread.
+  void releasePackets( unsigned int count );
+
+  unsigned char *packets_;
+  unsigned long *packetLengths_;
   Socket *soket_;
   unsigned long bufferFrames_;
   unsigned long bufferBytes_;
@@ -91,6 +118,14 @@ class InetWvOut : public WvOut
   unsigned long iData_;
   unsigned int dataBytes_;
   Stk::StkFormat dataType_;
+  Socket::ProtocolType protocol_;
+  bool packetHeader_;
+  UINT32 sequence_;
+  unsigned int writePacket_;
+  unsigned int readPacket_;
+  unsigned long sendOffset_;
+  std::atomic<unsigned int> packetsFilled_;
+  std::atomic<bool> failed_;
 };
 
 } // stk namespace
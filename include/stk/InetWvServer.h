@@ -0,0 +1,275 @@
+#ifndef STK_INETWVSERVER_H
+#define STK_INETWVSERVER_H
+
+#include "WvIn.h"
+#include "Socket.h"
+#include "Thread.h"
+#include "JitterBuffer.h"
+#include <atomic>
+
+#if defined(__OS_WINDOWS__)
+  #include <winsock.h>
+#else
+  #include <netinet/in.h>
+#endif
+
+namespace stk {
+
+/***************************************************/
+/*! \class InetWvServer
+    \brief STK multi-client internet streaming input class.
+
+    This WvIn subclass receives streamed audio data from many remote
+    senders at once, such as several InetWvOut instances, on a single
+    TCP or UDP port, and mixes them into one stream.  The data is
+    assumed in big-endian, or network, byte order, and all senders
+    must use the channel count and format given to listen().
+
+    With the TCP protocol, each accepted connection is a client.
+    With the UDP protocol, each sending address is a client, which
+    is dropped after it has been silent for a few seconds.  A single
+    thread (using epoll under Linux) accepts connections and receives
+    the data of all clients into a lock-free JitterBuffer per client.
+    Connections beyond the number of client slots given to the
+    constructor are refused.
+
+    The sample clock of each sender differs slightly from that of
+    the computing thread, so a client's queue would slowly fill up or
+    run dry.  Each client is therefore resampled by linear
+    interpolation at a rate adjusted, by up to 0.5 percent, to hold
+    its queue at the target latency.  The rate follows the average
+    queue level with a proportional-integral controller, so a
+    constant drift is corrected without a standing offset.  The
+    queues do not skip ahead on their own, so the controller is the
+    only correction applied to the queue level.
+
+    The tick() functions return the sum of all clients and never
+    block.  The frame of a single client that went into the last
+    computed frame is available from clientOut(), so the clients can
+    also be used as separate inputs.
+
+    InetWvServer supports multi-channel data.  It is important to
+    distinguish the tick() method that computes a single frame (and
+    returns only the specified sample of a multi-channel frame) from
+    the overloaded one that takes an StkFrames object for
+    multi-channel and/or multi-frame data.
+*/
+/***************************************************/
+
+class InetWvServer : public WvIn
+{
+public:
+  //! Default constructor.
+  /*!
+    Up to \e maxClients clients are served at once, each with a
+    queue of \e nBuffers buffers of \e bufferFrames frames.  An
+    StkError will be thrown if an error occurs while initializing
+    the input thread.
+  */
+  InetWvServer( unsigned int maxClients = 8, unsigned long bufferFrames = 1024, unsigned int nBuffers = 8 );
+
+  //! Class destructor.
+  ~InetWvServer();
+
+  //! Start accepting clients with the specified protocol, port, data channels and format.
+  /*!
+    Any existing clients are disconnected.  This function does not
+    wait for a client.  An StkError will be thrown if a socket error
+    occurs or an invalid function argument is provided.
+  */
+  void listen( int port = 2006, unsigned int nChannels = 1,
+               Stk::StkFormat format = STK_SINT16,
+               Socket::ProtocolType protocol = Socket::PROTO_TCP );
+
+  //! Return the number of client slots given to the constructor.
+  unsigned int getMaxClients( void ) const { return maxClients_; };
+
+  //! Return the number of clients currently connected or with input data remaining.
+  /*!
+    Client slots are numbered from 0 to getMaxClients() - 1.  The
+    per-client functions below return 0 for a slot that is out of
+    range or not in use.
+  */
+  unsigned int getClientCount( void ) const;
+
+  //! Return true if the given client slot is connected or has input data remaining.
+  bool isClientConnected( unsigned int client ) const;
+
+  //! Set the minimum delay, in sample frames, between data arrival and output for all clients (default = 0).
+  /*!
+    The delay of each client is raised automatically when its data
+    arrives late and lowered again, down to this value, while it
+    keeps up.  It is limited to half of the client buffer size given
+    to the constructor.
+  */
+  void setLatency( unsigned long frames );
+
+  //! Return the current delay, in sample frames, of the given client.
+  unsigned long getLatency( unsigned int client ) const;
+
+  //! Return the number of UDP packets of the given client dropped because they arrived out of order.
+  unsigned long getLatePackets( unsigned int client ) const;
+
+  //! Return the number of UDP packets of the given client that were missing or dropped.
+  unsigned long getLostPackets( unsigned int client ) const;
+
+  //! Return the number of times the given client fell behind and zeros were output.
+  unsigned long getUnderruns( unsigned int client ) const;
+
+  //! Return the current resampling rate correction of the given client (0.0 when none).
+  /*!
+    A positive value means the client is sending faster than its
+    data is read.  For example, a value of 0.001 means the client's
+    data is read 0.1 percent faster than real time.
+  */
+  StkFloat getDrift( unsigned int client ) const;
+
+  //! Return the specified channel value of the last computed frame.
+  /*!
+    For multi-channel streams, use the lastFrame() function to get
+    all values from the last computed frame.  The \c channel argument
+    must be less than the number of channels in the data stream (the
+    first channel is specified by 0).  However, range checking is
+    only performed if _STK_DEBUG_ is defined during compilation, in
+    which case an out-of-range value will trigger an StkError
+    exception.
+  */
+  StkFloat lastOut( unsigned int channel = 0 );
+
+  //! Return the specified channel value of the given client in the last computed frame.
+  /*!
+    The returned value is 0.0 if the client slot is not in use.  The
+    \c client and \c channel arguments are only checked if
+    _STK_DEBUG_ is defined during compilation, in which case an
+    out-of-range value will trigger an StkError exception.
+  */
+  StkFloat clientOut( unsigned int client, unsigned int channel = 0 );
+
+  //! Compute a sample frame and return the specified \c channel value.
+  /*!
+    The computed frame is the sum of all clients, or zeros if there
+    are none.  For multi-channel streams, use the lastFrame()
+    function to get all values from the computed frame.  The \c
+    channel argument must be less than the number of channels in the
+    data stream (the first channel is specified by 0).  However,
+    range checking is only performed if _STK_DEBUG_ is defined during
+    compilation, in which case an out-of-range value will trigger an
+    StkError exception.
+  */
+  StkFloat tick( unsigned int channel = 0 );
+
+  //! Fill the StkFrames argument with computed frames and return the same reference.
+  /*!
+    The number of channels in the StkFrames argument must equal the
+    number of channels specified in the listen() function.  However,
+    this is only checked if _STK_DEBUG_ is defined during
+    compilation, in which case an incompatibility will trigger an
+    StkError exception.
+  */
+  StkFrames& tick( StkFrames& frames );
+
+  // Called by the thread routine to accept clients and receive their
+  // data.  This is not intended for general use but must be public for
+  // access from the thread.
+  void receive( void );
+
+  // Called by the thread routine to check whether it should stop.
+  bool isFinished( void ) const { return finished_.load( std::memory_order_acquire ); };
+
+protected:
+
+  // Client slot states, used to pass ownership between the threads.
+  // A free slot belongs to the input thread.  Once it is active, the
+  // computing thread reads it until it is closed and drained.
+  enum { CLIENT_FREE, CLIENT_ACTIVE, CLIENT_CLOSED };
+
+  struct Client {
+    JitterBuffer buffer;
+    std::atomic<int> state;
+
+    // Input thread state.
+    int fd;
+    struct sockaddr_in address;
+    long long lastReceived;
+
+    // Computing thread state.  The two most recent input frames are
+    // kept in history for interpolation across buffers.
+    bool playing;
+    StkFrames input;
+    StkFrames output;
+    StkFrames history;
+    StkFloat phase;
+    StkFloat rate;
+    StkFloat fill;
+    StkFloat drift;
+    unsigned long settle;
+  };
+
+  // Compute the next buffer of client and mixed frames.
+  void computeFrames( void );
+
+  // Adjust the resampling rate of a client to hold its queue at the target latency.
+  void updateRate( Client& client );
+
+  // Resample the next buffer of a client into its output frames.
+  void resampleClient( Client& client, bool drain );
+
+  // Start and stop the input thread.
+  void startReceiving( void );
+  void stopReceiving( void );
+
+  // Input thread handlers.
+  void acceptClients( void );
+  void receiveDatagrams( void );
+  bool receiveStream( unsigned int index );
+  void closeClient( unsigned int index );
+  int findClient( const struct sockaddr_in& address );
+  int openClient( void );
+  void checkIdleClients( void );
+
+  Socket *soket_;
+  Thread thread_;
+  Client *clients_;
+  unsigned int maxClients_;
+  unsigned char *packets_;
+  unsigned long bufferFrames_;
+  unsigned int nBuffers_;
+  long bufferCounter_;
+  long bufferIndex_;
+  std::atomic<bool> finished_;
+  bool receiving_;
+  int fd_;
+  int epoll_;
+  int wakeup_;
+  Socket::ProtocolType protocol_;
+
+};
+
+inline StkFloat InetWvServer :: lastOut( unsigned int channel )
+{
+#if defined(_STK_DEBUG_)
+  if ( channel >= lastFrame_.channels() ) {
+    oStream_ << "InetWvServer::lastOut(): channel argument and data stream are incompatible!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  return lastFrame_[channel];
+}
+
+inline StkFloat InetWvServer :: clientOut( unsigned int client, unsigned int channel )
+{
+#if defined(_STK_DEBUG_)
+  if ( client >= maxClients_ || channel >= lastFrame_.channels() ) {
+    oStream_ << "InetWvServer::clientOut(): client or channel argument is out of range!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  if ( !clients_[client].playing || bufferIndex_ == 0 ) return 0.0;
+  return clients_[client].output( bufferIndex_ - 1, channel );
+}
+
+} // stk namespace
+
+#endif
@@ -2,8 +2,6 @@
 #define STK_JCREV_H
 
 #include "Effect.h"
-#include "Delay.h"
-#include "OnePole.h"
 
 namespace stk {
 
@@ -24,6 +22,12 @@ namespace stk {
     one-pole lowpass filters have been added inside
     the feedback comb filters.
 
+    The StkFrames tick() functions run each allpass
+    and comb filter over blocks of samples no longer
+    than its delay, with the four combs computed
+    together, and give the same output as the
+    single-sample tick() function.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -87,14 +91,38 @@ class JCRev : public Effect
 
  protected:
 
-  Delay allpassDelays_[3];
-  Delay combDelays_[4];
-  OnePole combFilters_[4];
-  Delay outLeftDelay_;
-  Delay outRightDelay_;
+  // Compute a block of samples from the inputs in inputs_, writing
+  // the output frames to samples with the given hop.  The left
+  // channel is scaled as in tick( StkFrames& ).
+  void computeBlock( unsigned int nFrames, StkFloat *samples, unsigned int hop );
+
+  static const int nCombs = 4;
+  static const int maxBlockSize = 128;
+
+  // The delay lines are power-of-two rings indexed by the sample
+  // count, written at time_ and read at time_ minus the delay.  The
+  // allpass and comb filters feed back the delay output of the
+  // previous sample, which is read one sample further back.
+  unsigned long time_;
+  unsigned int blockSize_;
+  std::vector<StkFloat> allpassLines_[3];
+  unsigned long allpassDelays_[3];
+  std::vector<StkFloat> combLines_[nCombs];
+  unsigned long combDelays_[nCombs];
+  std::vector<StkFloat> outLines_[2];
+  unsigned long outDelays_[2];
+
+  // The comb lowpass filters, as computed by OnePole with a pole at 0.2.
+  StkFloat combFilterB0_;
+  StkFloat combFilterA1_;
+  StkFloat combStates_[nCombs];
+
   StkFloat allpassCoefficient_;
-  StkFloat combCoefficient_[4];
+  StkFloat combCoefficient_[nCombs];
 
+  // Scratch buffers for block processing.
+  std::vector<StkFloat> inputs_;
+  std::vector<StkFloat> work_;
 };
 
 inline StkFloat JCRev :: lastOut( unsigned int channel )
@@ -118,45 +146,42 @@ inline StkFloat JCRev :: tick( StkFloat input, unsigned int channel )
   }
 #endif
 
-  StkFloat temp, temp0, temp1, temp2, temp3, temp4, temp5, temp6;
-  StkFloat filtout;
-
-  temp = allpassDelays_[0].lastOut();
-  temp0 = allpassCoefficient_ * temp;
-  temp0 += input;
-  allpassDelays_[0].tick(temp0);
-  temp0 = -(allpassCoefficient_ * temp0) + temp;
-    
-  temp = allpassDelays_[1].lastOut();
-  temp1 = allpassCoefficient_ * temp;
-  temp1 += temp0;
-  allpassDelays_[1].tick(temp1);
-  temp1 = -(allpassCoefficient_ * temp1) + temp;
-    
-  temp = allpassDelays_[2].lastOut();
-  temp2 = allpassCoefficient_ * temp;
-  temp2 += temp1;
-  allpassDelays_[2].tick(temp2);
-  temp2 = -(allpassCoefficient_ * temp2) + temp;
-    
-  temp3 = temp2 + ( combFilters_[0].tick( combCoefficient_[0] * combDelays_[0].lastOut() ) );
-  temp4 = temp2 + ( combFilters_[1].tick( combCoefficient_[1] * combDelays_[1].lastOut() ) );
-  temp5 = temp2 + ( combFilters_[2].tick( combCoefficient_[2] * combDelays_[2].lastOut() ) );
-  temp6 = temp2 + ( combFilters_[3].tick( combCoefficient_[3] * combDelays_[3].lastOut() ) );
-
-  combDelays_[0].tick(temp3);
-  combDelays_[1].tick(temp4);
-  combDelays_[2].tick(temp5);
-  combDelays_[3].tick(temp6);
-
-  filtout = temp3 + temp4 + temp5 + temp6;
-
-  lastFrame_[0] = effectMix_ * (outLeftDelay_.tick(filtout));
-  lastFrame_[1] = effectMix_ * (outRightDelay_.tick(filtout));
+  StkFloat temp, temp0, temp1, filtout = 0.0;
+  int i;
+
+  temp0 = input;
+  for ( i=0; i<3; i++ ) {
+    std::vector<StkFloat> &line = allpassLines_[i];
+    unsigned long mask = line.size() - 1;
+    temp = line[( time_ - allpassDelays_[i] - 1 ) & mask];
+    temp1 = allpassCoefficient_ * temp;
+    temp1 += temp0;
+    line[time_ & mask] = temp1;
+    temp0 = -(allpassCoefficient_ * temp1) + temp;
+  }
+
+  for ( i=0; i<nCombs; i++ ) {
+    std::vector<StkFloat> &line = combLines_[i];
+    unsigned long mask = line.size() - 1;
+    temp = combCoefficient_[i] * line[( time_ - combDelays_[i] - 1 ) & mask];
+    combStates_[i] = combFilterB0_ * temp - combFilterA1_ * combStates_[i];
+    temp1 = temp0 + combStates_[i];
+    line[time_ & mask] = temp1;
+    filtout = ( i == 0 ) ? temp1 : filtout + temp1;
+  }
+
+  for ( i=0; i<2; i++ ) {
+    std::vector<StkFloat> &line = outLines_[i];
+    unsigned long mask = line.size() - 1;
+    line[time_ & mask] = filtout;
+    lastFrame_[i] = effectMix_ * line[( time_ - outDelays_[i] ) & mask];
+  }
+  time_++;
+
   temp = (1.0 - effectMix_) * input;
   lastFrame_[0] += temp;
   lastFrame_[1] += temp;
-    
+
   return 0.7 * lastFrame_[channel];
 }
 
@@ -0,0 +1,174 @@
+#ifndef STK_JITTERBUFFER_H
+#define STK_JITTERBUFFER_H
+
+#include "Stk.h"
+#include <atomic>
+
+namespace stk {
+
+/***************************************************/
+/*! \class JitterBuffer
+    \brief STK network audio jitter buffer class.
+
+    This class queues streamed audio data between a network receive
+    thread and the thread that computes audio.  Incoming data is
+    stored as received, in big-endian (network) byte order, and is
+    converted to floating-point values as it is read.  One thread
+    may write and another may read at the same time without locks.
+    Neither side ever blocks.
+
+    Reading does not start until the queue holds the target latency
+    in frames.  If the queue then runs dry, the missing frames are
+    read as zeros, the event is counted as an underrun, and the
+    target latency is raised by the size of the read.  After each
+    second without underruns, the target is lowered by the same
+    step, down to the latency set with setLatency().  Any delay
+    above the target that builds up during that time is skipped,
+    unless skipping has been disabled with setSkipping() so that the
+    owner can correct the delay more smoothly, for example by
+    resampling.
+
+    Packets written with a sequence number are checked for order.
+    Missing packets are replaced by silence of the same size and
+    counted as lost.  Packets that arrive after a later one has been
+    written are dropped and counted as late.  Packets that do not
+    fit in the queue are dropped and also counted as lost.
+*/
+/***************************************************/
+
+class JitterBuffer : public Stk
+{
+ public:
+  //! Default constructor.
+  JitterBuffer( void );
+
+  //! Class destructor.
+  ~JitterBuffer( void );
+
+  //! Set the data format and queue size and empty the queue.
+  /*!
+    The queue holds \e bufferFrames frames of \e nChannels channels
+    of \e format data.  This function is not safe to call while
+    another thread writes or reads.  An StkError will be thrown if
+    the format is unknown or an argument is zero.
+  */
+  void setFormat( unsigned int nChannels, Stk::StkFormat format, unsigned long bufferFrames );
+
+  //! Empty the queue and reset the counters and sequence state.
+  /*!
+    This function is not safe to call while another thread writes
+    or reads.
+  */
+  void reset( void );
+
+  //! Set the minimum target latency in frames (default = 0).
+  /*!
+    The value is limited to half of the queue size.  It takes effect
+    with the next read.
+  */
+  void setLatency( unsigned long frames );
+
+  //! Enable or disable skipping of delay that builds up above the target (default = enabled).
+  /*!
+    When skipping is disabled, the queue level is left to the owner
+    to correct.  The target latency is still adapted to underruns.
+  */
+  void setSkipping( bool enabled ) { skipping_ = enabled; };
+
+  //! Return the current target latency in frames.
+  unsigned long getLatency( void ) const { return target_.load( std::memory_order_relaxed ); };
+
+  //! Return the number of frames currently queued.
+  unsigned long getFillLevel( void ) const;
+
+  //! Return the number of sequenced packets dropped because they arrived out of order.
+  unsigned long getLatePackets( void ) const { return latePackets_.load( std::memory_order_relaxed ); };
+
+  //! Return the number of packets missing from the sequence or dropped because the queue was full.
+  unsigned long getLostPackets( void ) const { return lostPackets_.load( std::memory_order_relaxed ); };
+
+  //! Return the number of reads that found fewer frames queued than requested.
+  unsigned long getUnderruns( void ) const { return underruns_.load( std::memory_order_relaxed ); };
+
+  //! Queue a packet of stream data with the given sequence number.
+  /*!
+    Only the low 32 bits of the sequence number are used.  The first
+    packet after a reset starts the sequence.
+  */
+  void writePacket( unsigned long sequence, const void *data, unsigned long bytes );
+
+  //! Queue a UDP packet, checking its order if it begins with a sequence header.
+  /*!
+    Packets that begin with the header described by
+    Socket::PACKET_MAGIC are queued with writePacket() and others
+    with write().
+  */
+  void writeDatagram( const unsigned char *packet, unsigned long bytes );
+
+  //! Queue stream data without sequence checking, dropping whatever does not fit.
+  void write( const void *data, unsigned long bytes );
+
+  //! Return a pointer to the contiguous free space at the write position and its size in bytes.
+  /*!
+    This allows a socket to receive data directly into the queue.
+    The received data is queued by a subsequent call to commit().
+  */
+  char *writeSpace( unsigned long *bytes );
+
+  //! Queue the given number of bytes written at the pointer returned by writeSpace().
+  void commit( unsigned long bytes );
+
+  //! Fill the StkFrames argument with queued data and return the number of frames read.
+  /*!
+    Frames that cannot be read are set to zero.  If \e drain is
+    true, the target latency is ignored and whatever is queued is
+    read, which is useful after the stream has ended.  The number of
+    channels in the StkFrames argument must equal that of the stream.
+    However, this is only checked if _STK_DEBUG_ is defined during
+    compilation, in which case an incompatibility will trigger an
+    StkError exception.
+  */
+  unsigned long read( StkFrames& frames, bool drain = false );
+
+ protected:
+
+  // Queue the given number of zero bytes, up to the available space.
+  void writeZeros( unsigned long bytes );
+
+  // Convert frames of stream data at the read position.
+  void convert( StkFloat *samples, unsigned long nFrames );
+
+  // Discard frames at the read position.
+  void skip( unsigned long nFrames );
+
+  unsigned char *buffer_;
+  unsigned long bufferBytes_;
+  unsigned long frameBytes_;
+  unsigned int dataBytes_;
+  unsigned int nChannels_;
+  Stk::StkFormat format_;
+  std::atomic<unsigned long> bytesFilled_;
+
+  // Writer state.
+  unsigned long writePoint_;
+  bool sequenced_;
+  unsigned long nextSequence_;
+
+  // Reader state.
+  unsigned long readPoint_;
+  bool primed_;
+  std::atomic<unsigned long> latency_;
+  std::atomic<unsigned long> target_;
+  unsigned long windowFrames_;
+  unsigned long minFill_;
+  bool windowUnderrun_;
+  bool skipping_;
+
+  std::atomic<unsigned long> latePackets_;
+  std::atomic<unsigned long> lostPackets_;
+  std::atomic<unsigned long> underruns_;
+};
+
+} // stk namespace
+
+#endif
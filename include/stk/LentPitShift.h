@@ -2,7 +2,8 @@
 #define STK_LENTPITSHIFT_H
 
 #include "Effect.h"
-#include "Delay.h"
+#include "Fft.h"
+#include <vector>
 
 namespace stk {
 
@@ -13,6 +14,10 @@ namespace stk {
     This class implements a pitch shifter using pitch 
     tracking and sample windowing and shifting.
 
+    The difference function of the pitch tracker is computed from
+    the autocorrelation of the input, by FFT, so that each frame of
+    tMax samples costs O(tMax log tMax) operations.
+
     by Francois Germain, 2009.
 */
 /***************************************************/
@@ -24,10 +29,10 @@ class LentPitShift : public Effect
   LentPitShift( StkFloat periodRatio = 1.0, int tMax = RT_BUFFER_SIZE );
 
   ~LentPitShift( void ) {
-    delete window;
-    delete dt;
-    delete dpt;
-    delete cumDt;
+    delete [] window;
+    delete [] dt;
+    delete [] dpt;
+    delete [] cumDt;
   }
 
   //! Reset and clear all internal state.
@@ -75,12 +80,13 @@ class LentPitShift : public Effect
   StkFrames outputFrames;
   int ptrFrames;          // writing pointer
 
-  // Input delay line
-  Delay inputLine_;
+  // Input history, the last 3 * tMax_ input samples with the newest last
+  std::vector<StkFloat> inputLine_;
   int inputPtr;
 
-  // Output delay line
-  Delay outputLine_;
+  // Output accumulator, the next 3 * tMax_ output samples with the
+  // next one to be output first
+  std::vector<StkFloat> outputLine_;
   double outputPtr;
 
   // Pitch tracker variables
@@ -94,11 +100,20 @@ class LentPitShift : public Effect
   StkFloat* cumDt;     // Array containing the cumulative sum of the coefficients in dt
   StkFloat* dpt;       // Array containing the pitch tracking function coefficients
 
+  // Transform of twice the frame size for the autocorrelation
+  Fft fft_;
+  std::vector<StkFloat> fftInput_;
+  std::vector<StkFloat> frameReal_;
+  std::vector<StkFloat> frameImag_;
+  std::vector<StkFloat> historyReal_;
+  std::vector<StkFloat> historyImag_;
+
   // Pitch shifter variables
   StkFloat env[2];     // Coefficients for the linear interpolation when modifying the output samples
   StkFloat* window;    // Hamming window used for the input portion extraction
+  unsigned long windowPeriod_; // Period for which the window was computed
+  std::vector<StkFloat> grain_; // Windowed input portion
   double periodRatio_; // Ratio of modification of the signal period
-  StkFrames zeroFrame; // Frame of tMax_ zero samples
 
 
   // Coefficient delay line that could be used for a dynamic calculation of the pitch
@@ -106,103 +121,6 @@ class LentPitShift : public Effect
 
 };
 
-inline void LentPitShift::process()
-{
-  StkFloat x_t;    // input coefficient
-  StkFloat x_t_T;  // previous input coefficient at T samples
-  StkFloat coeff;  // new coefficient for the difference function
-
-  int alternativePitch = tMax_;  // Global minimum storage
-  lastPeriod_ = tMax_+1;         // Storage of the lowest local minimum under the threshold
-
-  // Loop variables
-  unsigned long delay_;
-  unsigned int n;
-
-  // Initialization of the dt coefficients.  Since the
-  // frames are of tMax_ length, there is no overlapping
-  // between the successive windows where pitch tracking
-  // is performed.
-  for ( delay_=1; delay_<=tMax_; delay_++ )
-    dt[delay_] = 0.;
-
-  // Calculation of the dt coefficients and update of the input delay line.
-  for ( n=0; n<inputFrames.size(); n++ ) {
-    x_t = inputLine_.tick( inputFrames[ n ] );
-    for ( delay_=1; delay_<= tMax_; delay_++ ) {
-      x_t_T = inputLine_.tapOut( delay_ );
-      coeff = x_t - x_t_T;
-      dt[delay_] += coeff * coeff;
-    }
-  }
-
-  // Calculation of the pitch tracking function and test for the minima.
-  for ( delay_=1; delay_<=tMax_; delay_++ ) {
-    cumDt[delay_] = dt[delay_] + cumDt[delay_-1];
-    dpt[delay_] = dt[delay_] * delay_ / cumDt[delay_];
-
-    // Look for a minimum
-    if ( dpt[delay_-1]-dpt[delay_-2] < 0 && dpt[delay_]-dpt[delay_-1] > 0 ) {
-      // Check if the minimum is under the threshold
-      if ( dpt[delay_-1] < threshold_ ){
-        lastPeriod_ = delay_-1;
-        // If a minimum is found, we can stop the loop
-        break;
-      }
-      else if ( dpt[alternativePitch] > dpt[delay_-1] )
-        // Otherwise we store it if it is the current global minimum
-        alternativePitch = delay_-1;
-    }
-  }
-
-  // Test for the last period length.
-  if ( dpt[delay_]-dpt[delay_-1] < 0 ) {
-    if ( dpt[delay_] < threshold_ )
-      lastPeriod_ = delay_;
-    else if ( dpt[alternativePitch] > dpt[delay_] )
-      alternativePitch = delay_;
-  }
-
-  if ( lastPeriod_ == tMax_+1 )
-    // No period has been under the threshold so we used the global minimum
-    lastPeriod_ = alternativePitch;
-
-  // We put the new zero output coefficients in the output delay line and 
-  // we get the previous calculated coefficients
-  outputLine_.tick( zeroFrame, outputFrames );
-
-  // Initialization of the Hamming window used in the algorithm
-  for ( int n=-(int)lastPeriod_; n<(int)lastPeriod_; n++ )
-    window[n+lastPeriod_] = (1 + cos(PI*n/lastPeriod_)) / 2	;
-
-  int M;  // Index of reading in the input delay line
-  int N;  // Index of writing in the output delay line
-  double sample;  // Temporary storage for the new coefficient
-
-  // We loop for all the frames of length lastPeriod_ presents between inputPtr and tMax_
-  for ( ; inputPtr<(int)(tMax_-lastPeriod_); inputPtr+=lastPeriod_ ) {
-    // Test for the decision of compression/expansion
-    while ( outputPtr < inputPtr ) {
-      // Coefficients for the linear interpolation
-      env[1] = fmod( outputPtr + tMax_, 1.0 );
-      env[0] = 1.0 - env[1];
-      M = tMax_ - inputPtr + lastPeriod_ - 1; // New reading pointer
-      N = 2*tMax_ - (unsigned long)floor(outputPtr + tMax_) + lastPeriod_ - 1; // New writing pointer
-      for ( unsigned int j=0; j<2*lastPeriod_; j++,M--,N-- ) {
-        sample = inputLine_.tapOut(M) * window[j] / 2.;
-        // Linear interpolation
-        outputLine_.addTo(env[0] * sample, N);
-        outputLine_.addTo(env[1] * sample, N-1);
-      }
-      outputPtr = outputPtr + lastPeriod_ * periodRatio_; // new output pointer
-    }
-  }
-  // Shifting of the pointers waiting for the new frame of length tMax_.
-  outputPtr -= tMax_;
-  inputPtr  -= tMax_;
-}
-
-
 inline StkFloat LentPitShift :: tick( StkFloat input )
 {
   StkFloat sample;
@@ -3,7 +3,7 @@
 
 #include "Stk.h"
 #include "Skini.h"
-#include <queue>
+#include <atomic>
 
 #if defined(__STK_REALTIME__)
 
@@ -11,6 +11,8 @@
 #include "Thread.h"
 #include "TcpServer.h"
 #include "RtMidi.h"
+#include <mutex>
+#include <condition_variable>
 
 #endif // __STK_REALTIME__
 
@@ -32,10 +34,15 @@ namespace stk {
     socket, or stdin) take place asynchronously, filling the message
     queue.  A call to popMessage() will pop the next available control
     message from the queue and return it via the referenced Message
-    structure.  When a \e non-realtime scorefile is set, it is not
-    possible to start reading realtime input messages (from MIDI,
-    socket, or stdin).  Likewise, it is not possible to read from a
-    scorefile when a realtime input mechanism is running.
+    structure.  The queue is a bounded, lock-free ring of preallocated
+    messages that any thread may push to and one thread pops from.
+    When it is full, the stdin and socket threads wait to be woken by
+    popMessage(), while MIDI messages and those pushed with
+    pushMessage() are dropped and counted (see getDroppedMessages()).
+    When a \e non-realtime scorefile is set, it is not possible to
+    start reading realtime input messages (from MIDI, socket, or
+    stdin).  Likewise, it is not possible to read from a scorefile
+    when a realtime input mechanism is running.
 
     When MIDI input is started, input is also automatically read from
     stdin.  This allows for program termination via the terminal
@@ -60,12 +67,31 @@ class Messager : public Stk
   // messager threads.  It must be public.
   struct MessagerData {
     Skini skini;
-    std::queue<Skini::Message> queue;
     unsigned int queueLimit;
     int sources;
 
+    // The message queue is a ring of preallocated slots, each with a
+    // sequence number that tells whether it is ready to be written or
+    // read, and the time at which it was written.
+    struct Slot {
+      std::atomic<unsigned long> sequence;
+      double stamp;
+      Skini::Message message;
+    };
+    Slot *slots;
+    unsigned long queueMask;
+    std::atomic<unsigned long> writeIndex;
+    unsigned long readIndex;
+    std::atomic<unsigned long> dropped;
+    std::atomic<unsigned long> overflows;
+    std::atomic<int> waiters;
+    std::atomic<bool> closing;
+    double delay;
+
 #if defined(__STK_REALTIME__)
     Mutex mutex;
+    std::mutex waitMutex;
+    std::condition_variable spaceCondition;
     RtMidiIn *midi;
     TcpServer *socket;
     std::vector<int> fd;
@@ -74,7 +100,8 @@ class Messager : public Stk
 
     // Default constructor.
     MessagerData()
-      :queueLimit(0), sources(0) {}
+      :queueLimit(0), sources(0), slots(0), queueMask(0), writeIndex(0), readIndex(0),
+       dropped(0), overflows(0), waiters(0), closing(false), delay(0.0) {}
   };
 
   //! Default constructor.
@@ -93,7 +120,20 @@ class Messager : public Stk
   void popMessage( Skini::Message& message );
 
   //! Push the referenced message onto the message stack.
-  void pushMessage( Skini::Message& message );
+  /*!
+    This function never blocks.  If the queue is full, the message
+    is dropped and \c false is returned.
+  */
+  bool pushMessage( Skini::Message& message );
+
+  //! Return the number of messages dropped because the queue was full.
+  unsigned long getDroppedMessages( void ) const { return data_.dropped.load( std::memory_order_relaxed ); };
+
+  //! Return the number of times an input thread found the queue full and had to wait.
+  unsigned long getQueueOverflows( void ) const { return data_.overflows.load( std::memory_order_relaxed ); };
+
+  //! Return the time in seconds that the last popped realtime message spent in the queue.
+  StkFloat getMessageDelay( void ) const { return data_.delay; };
 
   //! Specify a SKINI formatted scorefile from which messages should be read.
   /*!
@@ -22,6 +22,13 @@ namespace stk {
     Tempo changes are internally tracked by the class and reflected in
     the values returned by the function getTickSeconds().
 
+    The file is read into memory and decoded in a single pass when it
+    is opened.  Each track is stored as an array of events with
+    absolute tick and second times, so no file access or parsing
+    occurs while events are read.  The function getNextMergedEvent()
+    returns the events of all tracks in time order, and seekMerged()
+    jumps directly to any time in the file.
+
     by Gary P. Scavone, 2003 - 2010.
 */
 /**********************************************************************/
@@ -31,7 +38,7 @@ class MidiFileIn : public Stk
  public:
   //! Default constructor.
   /*!
-      If an error occurs while opening or parsing the file header, an
+      If an error occurs while opening or parsing the file, an
       StkError exception will be thrown.
   */
   MidiFileIn( std::string fileName );
@@ -98,36 +105,76 @@ class MidiFileIn : public Stk
   */
   unsigned long getNextMidiEvent( std::vector<unsigned char> *midiEvent, unsigned int track = 0 );
 
+  //! Fill the user-provided vector with the next event from any track and return its time in seconds.
+  /*!
+      Events from all tracks are returned in order of time, with
+      events at the same time returned in track order.  If the \e
+      track argument is not NULL, the number of the track containing
+      the event is written to it.  When all events have been read, no
+      bytes will be written and the event vector size will be zero.
+      This reader is independent of the per-track readers used by
+      getNextEvent().
+  */
+  double getNextMergedEvent( std::vector<unsigned char> *event, unsigned int *track = NULL );
+
+  //! Move the merged event reader to the first event at or after the given time in seconds.
+  void seekMerged( double seconds = 0.0 );
+
+  //! Return the time in seconds of the last event in the file.
+  double getDuration( void ) const;
+
  protected:
 
   // This protected class function is used for reading variable-length
-  // MIDI file values. It is assumed that this function is called with
-  // the file read pointer positioned at the start of a
-  // variable-length value.  The function returns true if the value is
-  // successfully parsed.  Otherwise, it returns false.
-  bool readVariableLength( unsigned long *value );
+  // MIDI file values from the file data, starting at \e position.
+  // The position is advanced past the value.  The function returns
+  // true if the value is successfully parsed.  Otherwise, it returns
+  // false.
+  bool readVariableLength( const std::vector<unsigned char>& data, unsigned long& position,
+                           unsigned long end, unsigned long *value );
+
+  // Decode the events of one track chunk into tracks_[track].
+  bool decodeTrack( const std::vector<unsigned char>& data, unsigned long offset,
+                    unsigned long length, unsigned int track );
+
+  // Compute the time in seconds of every event from the tempo map(s).
+  void computeSeconds( void );
 
-  std::ifstream file_;
   unsigned int nTracks_;
   int format_;
   int division_;
   bool usingTimeCode_;
   std::vector<double> tickSeconds_;
-  std::vector<long> trackPointers_;
-  std::vector<long> trackOffsets_;
-  std::vector<long> trackLengths_;
-  std::vector<char> trackStatus_;
-
-  // This structure and the following variables are used to save and
-  // keep track of a format 1 tempo map (and the initial tickSeconds
-  // parameter for formats 0 and 2).
+
+  // A decoded event.  Its bytes are stored in eventBytes_, and
+  // tickSeconds is the tick duration in effect after the event.
+  struct Event {
+    unsigned long tick;
+    unsigned long offset;
+    unsigned long size;
+    double seconds;
+    double tickSeconds;
+  };
+  std::vector< std::vector<Event> > tracks_;
+  std::vector<unsigned char> eventBytes_;
+  std::vector<unsigned long> trackIndex_;
+
+  // All events in time order, for the merged reader.
+  struct EventRef {
+    unsigned int track;
+    unsigned long index;
+  };
+  std::vector<EventRef> merged_;
+  unsigned long mergedIndex_;
+
+  // This structure and the following variable are used to save the
+  // tempo map (and the initial tickSeconds parameter).  For format 1
+  // files, tempo changes in any track apply to all tracks.
   struct TempoChange { 
     unsigned long count;
     double tickSeconds;
   };
   std::vector<TempoChange> tempoEvents_;
-  std::vector<unsigned long> trackCounters_;
-  std::vector<unsigned int> trackTempoIndex_;
 };
 
 } // stk namespace
@@ -5,7 +5,7 @@
 #include "Envelope.h"
 #include "FileLoop.h"
 #include "SineWave.h"
-#include "BiQuad.h"
+#include "BiQuadBank.h"
 #include "OnePole.h"
 
 namespace stk {
@@ -16,7 +16,7 @@ namespace stk {
 
     This class contains an excitation wavetable,
     an envelope, an oscillator, and N resonances
-    (non-sweeping BiQuad filters), where N is set
+    (a bank of non-sweeping biquad filters), where N is set
     during instantiation.
 
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
@@ -85,7 +85,7 @@ protected:
 
   Envelope envelope_; 
   FileWvIn *wave_;
-  BiQuad **filters_;
+  BiQuadBank filters_;
   OnePole  onepole_;
   SineWave vibrato_;
 
@@ -105,9 +105,7 @@ inline StkFloat Modal :: tick( unsigned int )
 {
   StkFloat temp = masterGain_ * onepole_.tick( wave_->tick() * envelope_.tick() );
 
-  StkFloat temp2 = 0.0;
-  for ( unsigned int i=0; i<nModes_; i++ )
-    temp2 += filters_[i]->tick(temp);
+  StkFloat temp2 = filters_.tick( temp );
 
   temp2  -= temp2 * directGain_;
   temp2 += directGain_ * temp;
@@ -2,7 +2,6 @@
 #define STK_NREV_H
 
 #include "Effect.h"
-#include "Delay.h"
 
 namespace stk {
 
@@ -18,6 +17,10 @@ namespace stk {
     another allpass in series, followed by two allpass filters in
     parallel with corresponding right and left outputs.
 
+    The StkFrames tick() functions run each filter over blocks of
+    samples no longer than its delay and give the same output as the
+    single-sample tick() function.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -81,12 +84,36 @@ class NRev : public Effect
 
  protected:
 
-  Delay allpassDelays_[8];
-  Delay combDelays_[6];
+  // Input one sample to the specified allpass filter and return its output.
+  StkFloat allpassTick( int i, StkFloat input );
+
+  // Compute a block of samples from the inputs in inputs_, writing
+  // the output frames to samples with the given hop.
+  void computeBlock( unsigned int nFrames, StkFloat *samples, unsigned int hop );
+
+  static const int nCombs = 6;
+  static const int nAllpasses = 6;
+  static const int maxBlockSize = 128;
+
+  // The delay lines are power-of-two rings indexed by the sample
+  // count, written at time_ and read at time_ minus the delay.  The
+  // filters feed back the delay output of the previous sample, which
+  // is read one sample further back.
+  unsigned long time_;
+  unsigned int blockSize_;
+  std::vector<StkFloat> allpassLines_[nAllpasses];
+  unsigned long allpassDelays_[nAllpasses];
+  std::vector<StkFloat> combLines_[nCombs];
+  unsigned long combDelays_[nCombs];
   StkFloat allpassCoefficient_;
-  StkFloat combCoefficient_[6];
-	StkFloat lowpassState_;
-
+  StkFloat combCoefficient_[nCombs];
+  StkFloat lowpassState_;
+
+  // Scratch buffers for block processing.
+  std::vector<StkFloat> inputs_;
+  std::vector<StkFloat> work_;
+  std::vector<StkFloat> outLeft_;
+  std::vector<StkFloat> outRight_;
 };
 
 inline StkFloat NRev :: lastOut( unsigned int channel )
@@ -101,6 +128,17 @@ inline StkFloat NRev :: lastOut( unsigned int channel )
   return lastFrame_[channel];
 }
 
+inline StkFloat NRev :: allpassTick( int i, StkFloat input )
+{
+  std::vector<StkFloat> &line = allpassLines_[i];
+  unsigned long mask = line.size() - 1;
+  StkFloat temp = line[( time_ - allpassDelays_[i] - 1 ) & mask];
+  StkFloat temp1 = allpassCoefficient_ * temp;
+  temp1 += input;
+  line[time_ & mask] = temp1;
+  return -( allpassCoefficient_ * temp1 ) + temp;
+}
+
 inline StkFloat NRev :: tick( StkFloat input, unsigned int channel )
 {
 #if defined(_STK_DEBUG_)
@@ -110,47 +148,32 @@ inline StkFloat NRev :: tick( StkFloat input, unsigned int channel )
   }
 #endif
 
-  StkFloat temp, temp0, temp1, temp2, temp3;
+  StkFloat temp, temp0, temp1;
   int i;
 
   temp0 = 0.0;
-  for ( i=0; i<6; i++ ) {
-    temp = input + (combCoefficient_[i] * combDelays_[i].lastOut());
-    temp0 += combDelays_[i].tick(temp);
+  for ( i=0; i<nCombs; i++ ) {
+    std::vector<StkFloat> &line = combLines_[i];
+    unsigned long mask = line.size() - 1;
+    temp = input + (combCoefficient_[i] * line[( time_ - combDelays_[i] - 1 ) & mask]);
+    line[time_ & mask] = temp;
+    temp0 += line[( time_ - combDelays_[i] ) & mask];
   }
 
-  for ( i=0; i<3; i++ )	{
-    temp = allpassDelays_[i].lastOut();
-    temp1 = allpassCoefficient_ * temp;
-    temp1 += temp0;
-    allpassDelays_[i].tick(temp1);
-    temp0 = -(allpassCoefficient_ * temp1) + temp;
-  }
+  for ( i=0; i<3; i++ )
+    temp0 = this->allpassTick( i, temp0 );
 
-	// One-pole lowpass filter.
+  // One-pole lowpass filter.
   lowpassState_ = 0.7 * lowpassState_ + 0.3 * temp0;
-  temp = allpassDelays_[3].lastOut();
-  temp1 = allpassCoefficient_ * temp;
-  temp1 += lowpassState_;
-  allpassDelays_[3].tick( temp1 );
-  temp1 = -( allpassCoefficient_ * temp1 ) + temp;
-    
-  temp = allpassDelays_[4].lastOut();
-  temp2 = allpassCoefficient_ * temp;
-  temp2 += temp1;
-  allpassDelays_[4].tick( temp2 );
-  lastFrame_[0] = effectMix_*( -( allpassCoefficient_ * temp2 ) + temp );
-    
-  temp = allpassDelays_[5].lastOut();
-  temp3 = allpassCoefficient_ * temp;
-  temp3 += temp1;
-  allpassDelays_[5].tick( temp3 );
-  lastFrame_[1] = effectMix_*( - ( allpassCoefficient_ * temp3 ) + temp );
+  temp1 = this->allpassTick( 3, lowpassState_ );
+  lastFrame_[0] = effectMix_ * this->allpassTick( 4, temp1 );
+  lastFrame_[1] = effectMix_ * this->allpassTick( 5, temp1 );
+  time_++;
 
   temp = ( 1.0 - effectMix_ ) * input;
   lastFrame_[0] += temp;
   lastFrame_[1] += temp;
-    
+
   return lastFrame_[channel];
 }
 
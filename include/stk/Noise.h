@@ -2,7 +2,7 @@
 #define STK_NOISE_H
 
 #include "Generator.h"
-#include <stdlib.h>
+#include <cstring>
 
 namespace stk {
 
@@ -10,9 +10,19 @@ namespace stk {
 /*! \class Noise
     \brief STK noise generator.
 
-    Generic random number generation using the
-    C rand() function.  The quality of the rand()
-    function varies from one OS to another.
+    Generic random number generation with a
+    generator owned by each instance, so that
+    instances are independent of each other and of
+    the C rand() function.  A seeded instance
+    always produces the same sequence, and
+    instances can be ticked from separate threads.
+
+    The generator is SplitMix64: each output is a
+    mix of the bits of a counter that is advanced
+    by a fixed odd constant.  The outputs for a
+    block of frames can therefore be computed
+    independently, which lets the compiler
+    vectorize the StkFrames tick() function.
 
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
@@ -25,14 +35,16 @@ public:
   //! Default constructor that can also take a specific seed value.
   /*!
     If the seed value is zero (the default value), the random number generator is
-    seeded with the system time.
+    seeded with the system time and a count of the instances.
   */
   Noise( unsigned int seed = 0 );
 
   //! Seed the random number generator with a specific seed value.
   /*!
     If no seed is provided or the seed value is zero, the random
-    number generator is seeded with the current system time.
+    number generator is seeded with the current system time and a
+    count of the instances, so that instances seeded together
+    produce different sequences.
   */
   void setSeed( unsigned int seed = 0 );
 
@@ -54,11 +66,33 @@ public:
 
 protected:
 
+  // Return the output in [-1.0, 1.0) for a value of the counter.
+  static StkFloat sample( unsigned long long state );
+
+  // The counter increment of the generator.
+  static const unsigned long long GAMMA = 0x9E3779B97F4A7C15ULL;
+
+  unsigned long long state_;
 };
 
+inline StkFloat Noise :: sample( unsigned long long state )
+{
+  state = ( state ^ ( state >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+  state = ( state ^ ( state >> 27 ) ) * 0x94D049BB133111EBULL;
+  state ^= state >> 31;
+
+  // The top 52 bits are used as the mantissa of a double in [1.0,
+  // 2.0), which is then mapped exactly onto [-1.0, 1.0).
+  unsigned long long bits = 0x3FF0000000000000ULL | ( state >> 12 );
+  double value;
+  std::memcpy( &value, &bits, sizeof( value ) );
+  return (StkFloat) ( 2.0 * value - 3.0 );
+}
+
 inline StkFloat Noise :: tick( void )
 {
-  return lastFrame_[0] = (StkFloat) ( 2.0 * rand() / (RAND_MAX + 1.0) - 1.0 );
+  state_ += GAMMA;
+  return lastFrame_[0] = sample( state_ );
 }
 
 inline StkFrames& Noise :: tick( StkFrames& frames, unsigned int channel )
@@ -70,12 +104,23 @@ inline StkFrames& Noise :: tick( StkFrames& frames, unsigned int channel )
   }
 #endif
 
+  // Each output depends only on its own counter value, so the
+  // samples are computed independently of each other.
   StkFloat *samples = &frames[channel];
   unsigned int hop = frames.channels();
-  for ( unsigned int i=0; i<frames.frames(); i++, samples += hop )
-    *samples = (StkFloat) ( 2.0 * rand() / (RAND_MAX + 1.0) - 1.0 );
+  unsigned int nFrames = frames.frames();
+  unsigned long long state = state_;
+  if ( hop == 1 ) {
+    for ( unsigned int i=0; i<nFrames; i++ )
+      samples[i] = sample( state + ( i + 1 ) * GAMMA );
+  }
+  else {
+    for ( unsigned int i=0; i<nFrames; i++ )
+      samples[i * hop] = sample( state + ( i + 1 ) * GAMMA );
+  }
 
-  lastFrame_[0] = *(samples-hop);
+  state_ += nFrames * GAMMA;
+  if ( nFrames ) lastFrame_[0] = samples[( nFrames - 1 ) * hop];
   return frames;
 }
 
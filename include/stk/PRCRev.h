@@ -2,7 +2,6 @@
 #define STK_PRCREV_H
 
 #include "Effect.h"
-#include "Delay.h"
 
 namespace stk {
 
@@ -17,6 +16,10 @@ namespace stk {
     allpass and comb delay filters.  This class implements two series
     allpass units and two parallel comb filters.
 
+    The StkFrames tick() functions run each filter over blocks of
+    samples no longer than its delay and give the same output as the
+    single-sample tick() function.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -80,11 +83,28 @@ public:
 
 protected:
 
-  Delay    allpassDelays_[2];
-  Delay    combDelays_[2];
+  // Compute a block of samples from the inputs in inputs_, writing
+  // the output frames to samples with the given hop.
+  void computeBlock( unsigned int nFrames, StkFloat *samples, unsigned int hop );
+
+  static const int maxBlockSize = 128;
+
+  // The delay lines are power-of-two rings indexed by the sample
+  // count, written at time_ and read at time_ minus the delay.  The
+  // filters feed back the delay output of the previous sample, which
+  // is read one sample further back.
+  unsigned long time_;
+  unsigned int blockSize_;
+  std::vector<StkFloat> allpassLines_[2];
+  unsigned long allpassDelays_[2];
+  std::vector<StkFloat> combLines_[2];
+  unsigned long combDelays_[2];
   StkFloat allpassCoefficient_;
   StkFloat combCoefficient_[2];
 
+  // Scratch buffers for block processing.
+  std::vector<StkFloat> inputs_;
+  std::vector<StkFloat> work_;
 };
 
 inline StkFloat PRCRev :: lastOut( unsigned int channel )
@@ -99,7 +119,7 @@ inline StkFloat PRCRev :: lastOut( unsigned int channel )
   return lastFrame_[channel];
 }
 
- inline StkFloat PRCRev :: tick( StkFloat input, unsigned int channel )
+inline StkFloat PRCRev :: tick( StkFloat input, unsigned int channel )
 {
 #if defined(_STK_DEBUG_)
   if ( channel > 1 ) {
@@ -108,25 +128,28 @@ inline StkFloat PRCRev :: lastOut( unsigned int channel )
   }
 #endif
 
-  StkFloat temp, temp0, temp1, temp2, temp3;
-
-  temp = allpassDelays_[0].lastOut();
-  temp0 = allpassCoefficient_ * temp;
-  temp0 += input;
-  allpassDelays_[0].tick(temp0);
-  temp0 = -(allpassCoefficient_ * temp0) + temp;
-    
-  temp = allpassDelays_[1].lastOut();
-  temp1 = allpassCoefficient_ * temp;
-  temp1 += temp0;
-  allpassDelays_[1].tick(temp1);
-  temp1 = -(allpassCoefficient_ * temp1) + temp;
-    
-  temp2 = temp1 + ( combCoefficient_[0] * combDelays_[0].lastOut() );
-  temp3 = temp1 + ( combCoefficient_[1] * combDelays_[1].lastOut() );
-
-  lastFrame_[0] = effectMix_ * (combDelays_[0].tick(temp2));
-  lastFrame_[1] = effectMix_ * (combDelays_[1].tick(temp3));
+  StkFloat temp, temp0, temp1;
+  int i;
+
+  temp0 = input;
+  for ( i=0; i<2; i++ ) {
+    std::vector<StkFloat> &line = allpassLines_[i];
+    unsigned long mask = line.size() - 1;
+    temp = line[( time_ - allpassDelays_[i] - 1 ) & mask];
+    temp1 = allpassCoefficient_ * temp;
+    temp1 += temp0;
+    line[time_ & mask] = temp1;
+    temp0 = -(allpassCoefficient_ * temp1) + temp;
+  }
+
+  for ( i=0; i<2; i++ ) {
+    std::vector<StkFloat> &line = combLines_[i];
+    unsigned long mask = line.size() - 1;
+    line[time_ & mask] = temp0 + ( combCoefficient_[i] * line[( time_ - combDelays_[i] - 1 ) & mask] );
+    lastFrame_[i] = effectMix_ * line[( time_ - combDelays_[i] ) & mask];
+  }
+  time_++;
+
   temp = (1.0 - effectMix_) * input;
   lastFrame_[0] += temp;
   lastFrame_[1] += temp;
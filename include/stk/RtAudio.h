@@ -87,6 +87,7 @@ static const RtAudioFormat RTAUDIO_FLOAT64 = 0x20; // Normalized between plus/mi
     - \e RTAUDIO_MINIMIZE_LATENCY: Attempt to set stream parameters for lowest possible latency.
     - \e RTAUDIO_HOG_DEVICE:       Attempt grab device for exclusive use.
     - \e RTAUDIO_ALSA_USE_DEFAULT: Use the "default" PCM device (ALSA only).
+    - \e RTAUDIO_ALSA_USE_MMAP:    Transfer data through the memory-mapped device buffer (ALSA only).
 
     By default, RtAudio streams pass and receive audio data from the
     client in an interleaved format.  By passing the
@@ -118,6 +119,12 @@ static const RtAudioFormat RTAUDIO_FLOAT64 = 0x20; // Normalized between plus/mi
     If the RTAUDIO_ALSA_USE_DEFAULT flag is set, RtAudio will attempt to
     open the "default" PCM device when using the ALSA API. Note that this
     will override any specified input or output device id.
+
+    If the RTAUDIO_ALSA_USE_MMAP flag is set, RtAudio will attempt to
+    use memory-mapped access with the ALSA API, reading and writing
+    the device ring buffer in place with any format conversion done
+    on the way.  This saves a copy per buffer.  Devices that do not
+    support memory-mapped access fall back to the default transfers.
 */
 typedef unsigned int RtAudioStreamFlags;
 static const RtAudioStreamFlags RTAUDIO_NONINTERLEAVED = 0x1;    // Use non-interleaved buffers (default = interleaved).
@@ -125,6 +132,7 @@ static const RtAudioStreamFlags RTAUDIO_MINIMIZE_LATENCY = 0x2;  // Attempt to s
 static const RtAudioStreamFlags RTAUDIO_HOG_DEVICE = 0x4;        // Attempt grab device and prevent use by others.
 static const RtAudioStreamFlags RTAUDIO_SCHEDULE_REALTIME = 0x8; // Try to select realtime scheduling for callback thread.
 static const RtAudioStreamFlags RTAUDIO_ALSA_USE_DEFAULT = 0x10; // Use the "default" PCM device (ALSA only).
+static const RtAudioStreamFlags RTAUDIO_ALSA_USE_MMAP = 0x20;    // Use memory-mapped device access (ALSA only).
 
 /*! \typedef typedef unsigned long RtAudioStreamStatus;
     \brief RtAudio stream status (over- or underflow) flags.
@@ -258,6 +266,7 @@ class RtAudio
     - \e RTAUDIO_HOG_DEVICE:        Attempt grab device for exclusive use.
     - \e RTAUDIO_SCHEDULE_REALTIME: Attempt to select realtime scheduling for callback thread.
     - \e RTAUDIO_ALSA_USE_DEFAULT:  Use the "default" PCM device (ALSA only).
+    - \e RTAUDIO_ALSA_USE_MMAP:     Transfer data through the memory-mapped device buffer (ALSA only).
 
     By default, RtAudio streams pass and receive audio data from the
     client in an interleaved format.  By passing the
@@ -292,6 +301,12 @@ class RtAudio
     open the "default" PCM device when using the ALSA API. Note that this
     will override any specified input or output device id.
 
+    If the RTAUDIO_ALSA_USE_MMAP flag is set, RtAudio will attempt to
+    use memory-mapped access with the ALSA API, reading and writing
+    the device ring buffer in place with any format conversion done
+    on the way.  This saves a copy per buffer.  Devices that do not
+    support memory-mapped access fall back to the default transfers.
+
     The \c numberOfBuffers parameter can be used to control stream
     latency in the Windows DirectSound, Linux OSS, and Linux Alsa APIs
     only.  A value of two is usually the smallest allowed.  Larger
@@ -306,7 +321,7 @@ class RtAudio
     RtAudio with Jack, each instance must have a unique client name.
   */
   struct StreamOptions {
-    RtAudioStreamFlags flags;      /*!< A bit-mask of stream flags (RTAUDIO_NONINTERLEAVED, RTAUDIO_MINIMIZE_LATENCY, RTAUDIO_HOG_DEVICE, RTAUDIO_ALSA_USE_DEFAULT). */
+    RtAudioStreamFlags flags;      /*!< A bit-mask of stream flags (RTAUDIO_NONINTERLEAVED, RTAUDIO_MINIMIZE_LATENCY, RTAUDIO_HOG_DEVICE, RTAUDIO_ALSA_USE_DEFAULT, RTAUDIO_ALSA_USE_MMAP). */
     unsigned int numberOfBuffers;  /*!< Number of stream buffers. */
     std::string streamName;        /*!< A stream name (currently used only in Jack). */
     int priority;                  /*!< Scheduling priority of callback thread (only used with flag RTAUDIO_SCHEDULE_REALTIME). */
@@ -612,13 +627,22 @@ protected:
     UNINITIALIZED = -75
   };
 
-  // A protected structure used for buffer conversion.
+  // A conversion kernel for one format pair, which converts nSamples
+  // samples read and written with the given strides (in samples).
+  typedef void (*ConvertKernel)( char *outBuffer, const char *inBuffer, unsigned int nSamples,
+                                 int inJump, int outJump );
+
+  // A protected structure used for buffer conversion.  The kernel and
+  // the flat flag, which marks channel layouts that can be converted
+  // as one contiguous run, are chosen when the stream is opened.
   struct ConvertInfo {
     int channels;
     int inJump, outJump;
     RtAudioFormat inFormat, outFormat;
     std::vector<int> inOffset;
     std::vector<int> outOffset;
+    ConvertKernel kernel;
+    bool flat;
   };
 
   // A protected structure for audio streams.
@@ -706,6 +730,9 @@ protected:
 
   //! Protected common method that sets up the parameters for buffer conversion.
   void setConvertInfo( StreamMode mode, unsigned int firstChannel );
+
+  //! Protected common method that returns the conversion kernel for a format pair, or NULL if there is none.
+  static ConvertKernel getConvertKernel( RtAudioFormat inFormat, RtAudioFormat outFormat );
 };
 
 // **************************************************************** //
@@ -905,6 +932,7 @@ public:
 
   std::vector<RtAudio::DeviceInfo> devices_;
   void saveDeviceInfo( void );
+  int mmapTransfer( StreamMode mode );
   bool probeDeviceOpen( unsigned int device, StreamMode mode, unsigned int channels, 
                         unsigned int firstChannel, unsigned int sampleRate,
                         RtAudioFormat format, unsigned int *bufferSize,
@@ -48,6 +48,7 @@
 #include "RtError.h"
 #include <string>
 #include <vector>
+#include <atomic>
 
 class RtMidi
 {
@@ -144,7 +145,10 @@ class RtMidiIn : public RtMidi
     error occurs.  The queue size defines the maximum number of
     messages that can be held in the MIDI queue (when not using a
     callback function).  If the queue size limit is reached,
-    incoming messages will be ignored.
+    incoming messages will be ignored.  The queue is lock-free and
+    does not allocate memory once it is created.  Sysex messages are
+    stored in a separate pool of 64 kilobytes, and those that do not
+    fit are also ignored.
 
     If no API argument is specified and multiple API support has been
     compiled, the default order of use is JACK, ALSA (Linux) and CORE,
@@ -353,16 +357,38 @@ class MidiInApi
   :bytes(0), timeStamp(0.0) {}
   };
 
+  // A lock-free queue for one writing (input) thread and one reading
+  // thread.  Messages of up to three bytes, which include all channel
+  // messages, are stored in the ring entries.  Longer (sysex) messages
+  // are copied to a byte pool that is released in the same order.
+  // Neither side allocates memory or blocks.
   struct MidiQueue {
-    unsigned int front;
-    unsigned int back;
-    unsigned int size;
+    enum { INLINE_BYTES = 3, SYSEX_POOL_BYTES = 65536 };
+
+    struct Entry {
+      double timeStamp;
+      unsigned long sysexStart;
+      unsigned int size;
+      unsigned char bytes[INLINE_BYTES];
+    };
+
+    std::atomic<unsigned int> front;
+    std::atomic<unsigned int> back;
     unsigned int ringSize;
-    MidiMessage *ring;
+    Entry *ring;
+    std::atomic<unsigned long> sysexFront;
+    unsigned long sysexBack;
+    unsigned char *sysex;
 
     // Default constructor.
   MidiQueue()
-  :front(0), back(0), size(0), ringSize(0) {}
+  :front(0), back(0), ringSize(0), ring(0), sysexFront(0), sysexBack(0), sysex(0) {}
+
+    // Called by the input thread.  Returns false if the message does not fit.
+    bool push( const unsigned char *bytes, unsigned int size, double timeStamp );
+
+    // Called by the reading thread.  Returns false if the queue is empty.
+    bool pop( std::vector<unsigned char> *message, double *timeStamp );
   };
 
   // The RtMidiInData structure is used to pass private class data to
@@ -3,7 +3,10 @@
 
 #include "WvIn.h"
 #include "RtAudio.h"
-#include "Mutex.h"
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 namespace stk {
 
@@ -17,6 +20,13 @@ namespace stk {
     from which data is read.  This class should not be used when
     low-latency is desired.
 
+    The ring-buffer is shared without locks between the audio
+    callback and the reading thread.  When the buffer is empty, the
+    tick() functions sleep on a condition variable that the callback
+    signals after each write.  If the buffer is too full to take all
+    of the input when the callback runs, the frames that do not fit
+    are discarded and the event is counted (see getOverruns()).
+
     RtWvIn supports multi-channel data in both interleaved and
     non-interleaved formats.  It is important to distinguish the
     tick() method that computes a single frame (and returns only the
@@ -93,18 +103,34 @@ public:
   */
   StkFrames& tick( StkFrames& frames );
 
+  //! Return the number of frames currently waiting in the ring-buffer.
+  unsigned int getFillLevel( void ) const { return framesFilled_.load( std::memory_order_relaxed ); };
+
+  //! Return the number of audio callbacks whose input did not fit in the ring-buffer.
+  unsigned long getOverruns( void ) const { return overruns_.load( std::memory_order_relaxed ); };
+
+  //! Return the number of input overflows reported by the audio device.
+  unsigned long getDeviceOverflows( void ) const { return deviceOverflows_.load( std::memory_order_relaxed ); };
+
   // This function is not intended for general use but must be
   // public for access from the audio callback function.
-  void fillBuffer( void *buffer, unsigned int nFrames );
+  void fillBuffer( void *buffer, unsigned int nFrames, RtAudioStreamStatus status = 0 );
 
 protected:
 
+  // Block until the ring-buffer holds at least one frame.
+  void waitForData( void );
+
 	RtAudio adc_;
-  Mutex mutex_;
   bool stopped_;
   unsigned int readIndex_;
   unsigned int writeIndex_;
-  unsigned int framesFilled_;
+  std::atomic<unsigned int> framesFilled_;
+  std::atomic<unsigned long> overruns_;
+  std::atomic<unsigned long> deviceOverflows_;
+  std::mutex waitMutex_;
+  std::condition_variable dataAvailable_;
+  std::chrono::microseconds waitTime_;
 
 };
 
@@ -3,7 +3,10 @@
 
 #include "WvOut.h"
 #include "RtAudio.h"
-#include "Mutex.h"
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 namespace stk {
 
@@ -17,6 +20,13 @@ namespace stk {
     into which data is written.  This class should not be used when
     low-latency is desired.
 
+    The ring-buffer is shared without locks between the writing
+    thread and the audio callback.  When the buffer is full, the
+    tick() functions sleep on a condition variable that the callback
+    signals after each read.  If the buffer holds too few frames when
+    the callback runs, the missing frames are output as silence and
+    the event is counted (see getUnderruns()).
+
     RtWvOut supports multi-channel data in interleaved format.  It is
     important to distinguish the tick() method that outputs a single
     sample to all channels in a sample frame from the overloaded one
@@ -75,19 +85,35 @@ class RtWvOut : public WvOut
   */
   void tick( const StkFrames& frames );
 
+  //! Return the number of frames currently queued in the ring-buffer.
+  long getFillLevel( void ) const { return framesFilled_.load( std::memory_order_relaxed ); };
+
+  //! Return the number of audio callbacks which found fewer frames in the ring-buffer than needed.
+  unsigned long getUnderruns( void ) const { return underruns_.load( std::memory_order_relaxed ); };
+
+  //! Return the number of output underflows reported by the audio device.
+  unsigned long getDeviceUnderflows( void ) const { return deviceUnderflows_.load( std::memory_order_relaxed ); };
+
   // This function is not intended for general use but must be
   // public for access from the audio callback function.
-  int readBuffer( void *buffer, unsigned int frameCount );
+  int readBuffer( void *buffer, unsigned int frameCount, RtAudioStreamStatus status = 0 );
 
  protected:
 
+  // Block until the ring-buffer has room for at least one frame.
+  void waitForSpace( void );
+
   RtAudio dac_;
-  Mutex mutex_;
   bool stopped_;
   unsigned int readIndex_;
   unsigned int writeIndex_;
-  long framesFilled_;
-  unsigned int status_; // running = 0, emptying buffer = 1, finished = 2
+  std::atomic<long> framesFilled_;
+  std::atomic<unsigned int> status_; // running = 0, emptying buffer = 1, finished = 2
+  std::atomic<unsigned long> underruns_;
+  std::atomic<unsigned long> deviceUnderflows_;
+  std::mutex waitMutex_;
+  std::condition_variable spaceAvailable_;
+  std::chrono::microseconds waitTime_;
 
 };
 
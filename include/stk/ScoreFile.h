@@ -0,0 +1,218 @@
+#ifndef STK_SCOREFILE_H
+#define STK_SCOREFILE_H
+
+#include "Stk.h"
+#include "Skini.h"
+#include "Voicer.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+
+namespace stk {
+
+/***************************************************/
+/*! \class ScoreFile
+    \brief STK compiled binary score file class.
+
+    This class reads and writes scores in a compact binary format
+    that holds pre-parsed, time-sorted control events with absolute
+    time stamps in sample frames.  Scores are compiled once from
+    SKINI or standard MIDI files with convertSkini() and
+    convertMidi().  Where the operating system supports it, an
+    opened score is memory-mapped and its events are read straight
+    from the mapped pages, so playing a score involves no text
+    parsing, no file access and no memory allocation.
+
+    A score file holds a 48-byte header, the events and a table of
+    the string fields of SKINI messages, all in little-endian byte
+    order:
+
+    \code
+    offset  size  header field
+         0     4  "STKS"
+         4     4  format version (1)
+         8     4  header size in bytes
+        12     4  event size in bytes
+        16     8  sample rate of the time stamps (FLOAT64)
+        24     8  number of events
+        32     8  string table size in bytes
+        40     8  reserved (0)
+
+    offset  size  event field
+         0     8  time in sample frames
+         8     4  message type, as defined in SKINI.msg
+        12     2  channel (signed)
+        14     2  flags (1 = string in the string table)
+        16    16  two message values (FLOAT64)
+    \endcode
+
+    An event with a string field holds the byte offset of the
+    NUL-terminated string in its second value.  Readers skip any
+    header or event bytes beyond the sizes known to them, so later
+    versions of the format may only append fields.
+
+    Events can be sent to a Voicer as their time comes up with
+    dispatch(), or read as Skini::Message structures, with delta
+    times in seconds, with nextMessage().
+*/
+/***************************************************/
+
+class ScoreFile : public Stk
+{
+ public:
+
+  //! A score event as stored in the file.
+  struct Event {
+    unsigned long long time; /*!< The event time in sample frames at the file rate. */
+    SINT32 type;             /*!< The message type, as defined in SKINI.msg. */
+    SINT16 channel;          /*!< The message channel. */
+    UINT16 flags;            /*!< STRING_EVENT if the event has a string field. */
+    FLOAT64 values[2];       /*!< The message values (type-specific). */
+  };
+
+  //! Event flag set when values[1] holds a string table offset.
+  static const UINT16 STRING_EVENT = 1;
+
+  //! Default constructor.
+  ScoreFile( void );
+
+  //! Overloaded constructor that opens the specified score file.
+  /*!
+    An StkError will be thrown if the file is not found or its
+    format is invalid.
+  */
+  ScoreFile( std::string fileName );
+
+  //! Class destructor.
+  ~ScoreFile( void );
+
+  //! Open the specified score file, closing any that is open.
+  /*!
+    An StkError will be thrown if the file is not found or its
+    format is invalid.
+  */
+  void openFile( std::string fileName );
+
+  //! Close the score file, if one is open.
+  void closeFile( void );
+
+  //! Return true if a score file is open.
+  bool isOpen( void ) const { return events_ != 0; };
+
+  //! Compile a SKINI file into a score file with time stamps at the given sample rate.
+  /*!
+    Message times are accumulated from the SKINI delta times, or
+    taken as absolute where given with a leading "=", and the
+    events are sorted by time.  Lines that cannot be parsed are
+    reported and skipped, as with Skini::nextMessage().  The open
+    score, if any, is not affected.  An StkError will be thrown if
+    a file cannot be opened or written.
+  */
+  void convertSkini( std::string skiniFile, std::string scoreFile,
+                     StkFloat rate = Stk::sampleRate() );
+
+  //! Compile a standard MIDI file into a score file with time stamps at the given sample rate.
+  /*!
+    The channel messages of all tracks are stored with the types,
+    channels and values delivered by Messager for MIDI input, except
+    that pitch bend values are scaled to the range 0.0 - 128.0 of
+    SKINI pitch bends.  The open score, if any, is not affected.  An
+    StkError will be thrown if a file cannot be opened or written.
+  */
+  void convertMidi( std::string midiFile, std::string scoreFile,
+                    StkFloat rate = Stk::sampleRate() );
+
+  //! Return the sample rate of the event time stamps.
+  StkFloat getFileRate( void ) const { return fileRate_; };
+
+  //! Return the number of events in the score.
+  unsigned long getNumberOfEvents( void ) const { return nEvents_; };
+
+  //! Return the time of the last event in sample frames.
+  unsigned long long getDuration( void ) const;
+
+  //! Return a pointer to the score events, or NULL if no file is open.
+  /*!
+    The events are in time order.  With a memory-mapped file, the
+    pointer refers directly to the mapped file data and is valid
+    until the file is closed.
+  */
+  const Event *getEvents( void ) const { return events_; };
+
+  //! Return the string of the given event, or an empty string if it has none.
+  const char *getString( const Event& event ) const;
+
+  //! Move the event reader to the beginning of the score.
+  void rewind( void ) { index_ = 0; };
+
+  //! Move the event reader to the first event at or after the given time in sample frames.
+  void seek( unsigned long long time );
+
+  //! Return the index of the next event to be read.
+  unsigned long getEventIndex( void ) const { return index_; };
+
+  //! Return the time of the next event in sample frames, or the largest possible value at the end of the score.
+  unsigned long long getNextTime( void ) const;
+
+  //! Fill the message structure with the next event and return its type, or 0 at the end of the score.
+  /*!
+    The message time is the delta time in seconds since the
+    previous event read, as with SKINI files.  The integer values
+    are the float values truncated, and the string field, if any,
+    is copied to the message remainder.
+  */
+  long nextMessage( Skini::Message& message );
+
+  //! Send the events at or before the given time in sample frames to a Voicer and return the number sent.
+  /*!
+    Note on and off, control change, pitch bend, pitch change and
+    aftertouch events are sent.  Note on events with zero velocity
+    are sent as note offs and aftertouch is sent as control change
+    128.  Other events are skipped.  If \e channelGroups is true,
+    the event channel is used as the Voicer group; otherwise all
+    events go to group 0.  Calling this function once per computed
+    frame, with a running frame count, plays the score with sample
+    accuracy.
+  */
+  unsigned long dispatch( Voicer *voicer, unsigned long long time, bool channelGroups = false );
+
+ protected:
+
+  // Sort the events by time and write them to a score file.
+  void writeFile( std::string fileName, std::vector<Event>& events,
+                  std::string& strings, StkFloat rate );
+
+  // Map the open file, if possible, or read and decode its events.
+  void loadFile( FILE *fd, unsigned long long length, unsigned long headerBytes,
+                 unsigned long eventBytes );
+
+  // Send the events that are due to a Voicer.
+  unsigned long sendEvents( Voicer *voicer, unsigned long long time, bool channelGroups );
+
+  unsigned char *map_;
+  size_t mapLength_;
+  std::vector<unsigned long long> data_;
+  const Event *events_;
+  unsigned long nEvents_;
+  const char *strings_;
+  unsigned long long stringBytes_;
+  StkFloat fileRate_;
+  unsigned long index_;
+};
+
+inline unsigned long long ScoreFile :: getNextTime( void ) const
+{
+  if ( index_ >= nEvents_ ) return ~0ULL;
+  return events_[index_].time;
+}
+
+inline unsigned long ScoreFile :: dispatch( Voicer *voicer, unsigned long long time, bool channelGroups )
+{
+  // Most calls find no event due, so only this check is inlined.
+  if ( index_ >= nEvents_ || events_[index_].time > time ) return 0;
+  return this->sendEvents( voicer, time, channelGroups );
+}
+
+} // stk namespace
+
+#endif
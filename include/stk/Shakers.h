@@ -2,8 +2,8 @@
 #define STK_SHAKERS_H
 
 #include "Instrmnt.h"
+#include "Noise.h"
 #include <cmath>
-#include <stdlib.h>
 
 namespace stk {
 
@@ -145,6 +145,9 @@ class Shakers : public Instrmnt
   std::vector< bool > doVaryFrequency_;
   std::vector< StkFloat > tempFrequencies_;
   StkFloat varyFactor_;
+
+  // Per-instance random number generator for the stochastic events.
+  Noise random_;
 };
 
 inline void Shakers :: setResonance( BiQuad &filter, StkFloat frequency, StkFloat radius )
@@ -180,17 +183,18 @@ inline StkFloat Shakers :: tickEqualize( StkFloat input )
 
 inline int Shakers :: randomInt( int max ) //  Return random integer between 0 and max-1
 {
-  return (int) ((float)max * rand() / (RAND_MAX + 1.0) );
+  // The uniform value in [0.0, 1.0) is exact, so the product is below max.
+  return (int) ( max * ( 0.5 * random_.tick() + 0.5 ) );
 }
 
 inline StkFloat Shakers :: randomFloat( StkFloat max ) // Return random float between 0.0 and max
-{	
-  return (StkFloat) (max * rand() / (RAND_MAX + 1.0) );
+{
+  return (StkFloat) ( max * ( 0.5 * random_.tick() + 0.5 ) );
 }
 
 inline StkFloat Shakers :: noise( void ) //  Return random StkFloat float between -1.0 and 1.0
 {
-  return ( (StkFloat) ( 2.0 * rand() / (RAND_MAX + 1.0) ) - 1.0 );
+  return random_.tick();
 }
 
 const StkFloat MIN_ENERGY = 0.001;
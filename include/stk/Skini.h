@@ -82,6 +82,16 @@ class Skini : public Stk
   */
   long parseString( std::string& line, Skini::Message& message );
 
+  //! Attempt to parse the given characters and return the message type.
+  /*!
+    The \e line argument need not be null-terminated.  It is parsed
+    in place, without copying or allocating memory, except that a
+    string field is copied into the message remainder.  A type value
+    equal to zero in the referenced message structure indicates an
+    invalid message.
+  */
+  long parseString( const char *line, size_t length, Skini::Message& message );
+
   //! Return the SKINI type string for the given type value.
   static std::string whatsThisType(long type);
 
@@ -90,9 +100,8 @@ class Skini : public Stk
 
  protected:
 
-  void tokenize( const std::string& str, std::vector<std::string>& tokens, const std::string& delimiters );
-
   std::ifstream file_;
+  std::string line_;
 };
 
 //! A static table of equal-tempered MIDI to frequency (Hz) values.
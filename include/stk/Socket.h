@@ -62,6 +62,16 @@ class Socket : public Stk
   //! Returns true if the socket descriptor is valid.
   static bool isValid( int socket ) { return socket != -1; };
 
+  //! The magic number that may start a streamed audio packet, followed by a 32-bit sequence number ("STKP").
+  /*!
+    UDP audio packets starting with this header, in network byte
+    order, are checked for loss and order by InetWvIn.
+  */
+  static const UINT32 PACKET_MAGIC = 0x53544B50;
+
+  //! The size in bytes of the streamed audio packet header.
+  static const unsigned int PACKET_HEADER_BYTES = 8;
+
   //! If enable = false, the socket is set to non-blocking mode.  When first created, sockets are by default in blocking mode.
   static void setBlocking( int socket, bool enable );
 
@@ -378,6 +378,13 @@ public:
   */
   void resize( size_t nFrames, unsigned int nChannels, StkFloat value );
 
+  //! Exchange the data, dimensions and data rate of self with those of another StkFrames object.
+  /*!
+    No samples are copied and no memory is allocated, so this can be
+    used on a realtime thread.
+  */
+  void swap( StkFrames& f );
+
   //! Return the number of channels represented by the data.
   unsigned int channels( void ) const { return nChannels_; };
 
@@ -46,6 +46,9 @@ class UdpSocket : public Socket
   */
   void setDestination( int port = 2006, std::string hostname = "localhost" );
 
+  //! Return the address set with the \e setDestination() function, or NULL if none has been specified.
+  const struct sockaddr_in *destination( void ) const { return validAddress_ ? &address_ : NULL; };
+
   //! Send a buffer to the address specified with the \e setDestination() function.  Returns the number of bytes written or -1 if an error occurs.
   /*!
     This function will fail if the default address (set with \e setDestination()) is invalid or has not been specified.
@@ -0,0 +1,218 @@
+/***************************************************/
+/*! \class BiQuadBank
+    \brief STK bank of independent biquad filters.
+
+    This class implements a number of independent two-pole, two-zero
+    digital filters, each computed exactly as by the BiQuad class.
+    The coefficients and states of all filters are held in separate
+    arrays, one value per filter, so that each sample is computed for
+    all filters in one loop that the compiler can vectorize.
+
+    The bank can be used in two ways.  Given one input sample, all
+    filters are run in parallel on it and the sum of their outputs is
+    returned, as for a bank of resonators or the bands of an
+    equalizer.  Given StkFrames, each filter processes its own
+    channel, as for a multichannel filter.  The outputs of the
+    individual filters are available from lastFrame().
+
+    Each filter has its own gain, applied at its input, in addition
+    to the \e gain parameter of the bank, which is applied first.
+    Both default to 1.0.
+*/
+/***************************************************/
+
+#include "BiQuadBank.h"
+#include <cmath>
+
+namespace stk {
+
+BiQuadBank :: BiQuadBank( unsigned int nFilters ) : Filter(), nFilters_( 0 )
+{
+  this->setFilters( nFilters );
+  Stk::addSampleRateAlert( this );
+}
+
+BiQuadBank :: ~BiQuadBank()
+{
+  Stk::removeSampleRateAlert( this );
+}
+
+void BiQuadBank :: setFilters( unsigned int nFilters )
+{
+  if ( nFilters == 0 ) {
+    oStream_ << "BiQuadBank::setFilters: number of filters must be greater than zero!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  nFilters_ = nFilters;
+  channelsIn_ = nFilters;
+  filterGains_.assign( nFilters, 1.0 );
+  b0_.assign( nFilters, 1.0 );
+  b1_.assign( nFilters, 0.0 );
+  b2_.assign( nFilters, 0.0 );
+  a1_.assign( nFilters, 0.0 );
+  a2_.assign( nFilters, 0.0 );
+  x0_.resize( nFilters );
+  x1_.resize( nFilters );
+  x2_.resize( nFilters );
+  y1_.resize( nFilters );
+  y2_.resize( nFilters );
+  lastFrame_.resize( 1, nFilters, 0.0 );
+  this->clear();
+}
+
+void BiQuadBank :: clear( void )
+{
+  for ( unsigned int i=0; i<nFilters_; i++ ) {
+    x0_[i] = 0.0;
+    x1_[i] = 0.0;
+    x2_[i] = 0.0;
+    y1_[i] = 0.0;
+    y2_[i] = 0.0;
+    lastFrame_[i] = 0.0;
+  }
+}
+
+void BiQuadBank :: setCoefficients( unsigned int filter, StkFloat b0, StkFloat b1, StkFloat b2, StkFloat a1, StkFloat a2, bool clearState )
+{
+#if defined(_STK_DEBUG_)
+  if ( filter >= nFilters_ ) {
+    oStream_ << "BiQuadBank::setCoefficients: filter argument (" << filter << ") is out of range!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  b0_[filter] = b0;
+  b1_[filter] = b1;
+  b2_[filter] = b2;
+  a1_[filter] = a1;
+  a2_[filter] = a2;
+
+  if ( clearState ) {
+    x1_[filter] = x2_[filter] = 0.0;
+    y1_[filter] = y2_[filter] = 0.0;
+    lastFrame_[filter] = 0.0;
+  }
+}
+
+void BiQuadBank :: setFilterGain( unsigned int filter, StkFloat gain )
+{
+#if defined(_STK_DEBUG_)
+  if ( filter >= nFilters_ ) {
+    oStream_ << "BiQuadBank::setFilterGain: filter argument (" << filter << ") is out of range!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  filterGains_[filter] = gain;
+}
+
+void BiQuadBank :: sampleRateChanged( StkFloat newRate, StkFloat oldRate )
+{
+  if ( !ignoreSampleRateChange_ ) {
+    oStream_ << "BiQuadBank::sampleRateChanged: you may need to recompute filter coefficients!";
+    handleError( StkError::WARNING );
+  }
+}
+
+void BiQuadBank :: setResonance( unsigned int filter, StkFloat frequency, StkFloat radius, bool normalize )
+{
+#if defined(_STK_DEBUG_)
+  if ( filter >= nFilters_ ) {
+    oStream_ << "BiQuadBank::setResonance: filter argument (" << filter << ") is out of range!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+  if ( frequency < 0.0 || frequency > 0.5 * Stk::sampleRate() ) {
+    oStream_ << "BiQuadBank::setResonance: frequency argument (" << frequency << ") is out of range!";
+    handleError( StkError::WARNING ); return;
+  }
+  if ( radius < 0.0 || radius >= 1.0 ) {
+    oStream_ << "BiQuadBank::setResonance: radius argument (" << radius << ") is out of range!";
+    handleError( StkError::WARNING ); return;
+  }
+#endif
+
+  a2_[filter] = radius * radius;
+  a1_[filter] = -2.0 * radius * cos( TWO_PI * frequency / Stk::sampleRate() );
+
+  if ( normalize ) {
+    // Use zeros at +- 1 and normalize the filter peak gain.
+    b0_[filter] = 0.5 - 0.5 * a2_[filter];
+    b1_[filter] = 0.0;
+    b2_[filter] = -b0_[filter];
+  }
+}
+
+void BiQuadBank :: setNotch( unsigned int filter, StkFloat frequency, StkFloat radius )
+{
+#if defined(_STK_DEBUG_)
+  if ( filter >= nFilters_ ) {
+    oStream_ << "BiQuadBank::setNotch: filter argument (" << filter << ") is out of range!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+  if ( frequency < 0.0 || frequency > 0.5 * Stk::sampleRate() ) {
+    oStream_ << "BiQuadBank::setNotch: frequency argument (" << frequency << ") is out of range!";
+    handleError( StkError::WARNING ); return;
+  }
+  if ( radius < 0.0 ) {
+    oStream_ << "BiQuadBank::setNotch: radius argument (" << radius << ") is negative!";
+    handleError( StkError::WARNING ); return;
+  }
+#endif
+
+  // This method does not attempt to normalize the filter gain.
+  b2_[filter] = radius * radius;
+  b1_[filter] = (StkFloat) -2.0 * radius * cos( TWO_PI * (double) frequency / Stk::sampleRate() );
+}
+
+void BiQuadBank :: setEqualGainZeroes( unsigned int filter )
+{
+#if defined(_STK_DEBUG_)
+  if ( filter >= nFilters_ ) {
+    oStream_ << "BiQuadBank::setEqualGainZeroes: filter argument (" << filter << ") is out of range!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  b0_[filter] = 1.0;
+  b1_[filter] = 0.0;
+  b2_[filter] = -1.0;
+}
+
+void BiQuadBank :: filterBlock( const StkFloat *iSamples, unsigned int iHop,
+                                StkFloat *oSamples, unsigned int oHop, unsigned int nFrames )
+{
+  StkFloat * __restrict x1 = &x1_[0];
+  StkFloat * __restrict x2 = &x2_[0];
+  StkFloat * __restrict y1 = &y1_[0];
+  StkFloat * __restrict y2 = &y2_[0];
+  const StkFloat * __restrict gains = &filterGains_[0];
+  const StkFloat * __restrict b0 = &b0_[0];
+  const StkFloat * __restrict b1 = &b1_[0];
+  const StkFloat * __restrict b2 = &b2_[0];
+  const StkFloat * __restrict a1 = &a1_[0];
+  const StkFloat * __restrict a2 = &a2_[0];
+  StkFloat gain = gain_;
+  unsigned int n = nFilters_;
+
+  // The filters of one frame are computed together.  The input of
+  // each filter is read before its output is written, so the
+  // processing can be in place.
+  for ( unsigned int j=0; j<nFrames; j++, iSamples += iHop, oSamples += oHop ) {
+    for ( unsigned int i=0; i<n; i++ ) {
+      StkFloat x = gains[i] * ( gain * iSamples[i] );
+      StkFloat y = b0[i] * x + b1[i] * x1[i] + b2[i] * x2[i];
+      y -= a2[i] * y2[i] + a1[i] * y1[i];
+      x2[i] = x1[i];
+      x1[i] = x;
+      y2[i] = y1[i];
+      y1[i] = y;
+      oSamples[i] = y;
+    }
+  }
+
+  for ( unsigned int i=0; i<nFilters_; i++ )
+    lastFrame_[i] = y1[i];
+}
+
+} // stk namespace
@@ -0,0 +1,452 @@
+/***************************************************/
+/*! \class ConvRev
+    \brief STK convolution reverberator class.
+
+    This class takes a monophonic input signal and convolves it with a
+    measured or designed impulse response, typically loaded from an
+    audio file with the FileRead class.  Each channel of the impulse
+    response produces one output channel, so a stereo file gives a
+    stereo reverberator.  Responses of several seconds can be run in
+    real time.
+
+    The response is split into segments that are convolved with
+    partitions of increasing size.  The first 2 * \e tailSize samples
+    (the head) are convolved on the calling thread by a Convolver,
+    with small partitions and no latency.  The rest (the tail) is
+    convolved in partitions of \e tailSize samples, growing by a
+    factor of four per segment up to 16384 samples.  Each segment
+    starts at least two of its partitions into the response, so its
+    output for a partition of input is not needed until one partition
+    after that input is complete.
+
+    In realtime builds, the tail is computed by a background thread
+    from that lookahead, so the cost of the large partitions never
+    falls on the audio callback.  The \e tailSize should then be at
+    least twice the audio buffer size.  If the tail of an output
+    sample has not been computed by the time it is needed, the sample
+    is output without it and the event is counted (see
+    getUnderruns()).  Otherwise, or if the background thread is
+    disabled with setBackgroundTail(), the tail is computed on the
+    calling thread once per \e tailSize samples and the output does
+    not depend on timing.
+
+    The impulse response is used at its own sample rate.
+*/
+/***************************************************/
+
+#include "ConvRev.h"
+
+namespace stk {
+
+#if defined(__STK_REALTIME__)
+
+extern "C" THREAD_RETURN THREAD_TYPE convRevTailThread( void * ptr )
+{
+  ((ConvRev *) ptr)->computeTail();
+  return 0;
+}
+
+#endif
+
+ConvRev :: ConvRev( void )
+  : background_( true ), tailSize_( 1024 )
+{
+  running_ = false;
+  effectMix_ = 0.3;
+
+  StkFrames impulse( 1.0, 1, 1 );
+  this->setImpulseResponse( impulse );
+}
+
+ConvRev :: ConvRev( std::string fileName, bool raw, unsigned int tailSize )
+  : background_( true ), tailSize_( 1024 )
+{
+  running_ = false;
+  effectMix_ = 0.3;
+
+  if ( tailSize == 0 || ( tailSize & ( tailSize - 1 ) ) ) {
+    oStream_ << "ConvRev: tail size (" << tailSize << ") must be a power of two!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  tailSize_ = tailSize;
+  this->openFile( fileName, raw );
+}
+
+ConvRev :: ~ConvRev( void )
+{
+  this->stopTail();
+}
+
+void ConvRev :: openFile( std::string fileName, bool raw )
+{
+  // An error might be thrown here.
+  FileRead file( fileName, raw );
+
+  StkFrames response( file.fileSize(), file.channels() );
+  file.read( response, 0, true );
+  if ( file.fileRate() != Stk::sampleRate() ) {
+    oStream_ << "ConvRev::openFile: impulse response sample rate (" << file.fileRate() << ") differs from the current sample rate!";
+    handleError( StkError::WARNING );
+  }
+
+  this->setImpulseResponse( response );
+}
+
+void ConvRev :: setImpulseResponse( const StkFrames& response )
+{
+  if ( response.frames() == 0 || response.channels() == 0 ) {
+    oStream_ << "ConvRev::setImpulseResponse: response must have at least one frame!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  this->stopTail();
+  response_.resize( response.frames(), response.channels() );
+  for ( unsigned int i=0; i<response.size(); i++ )
+    response_[i] = response[i];
+  this->build();
+}
+
+void ConvRev :: setTailSize( unsigned int size )
+{
+  if ( size == 0 || ( size & ( size - 1 ) ) ) {
+    oStream_ << "ConvRev::setTailSize: size (" << size << ") must be a power of two!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  this->stopTail();
+  tailSize_ = size;
+  this->build();
+}
+
+void ConvRev :: setBackgroundTail( bool enabled )
+{
+  if ( enabled == background_ ) return;
+
+  // The state is cleared so that no input is lost or computed twice.
+  background_ = enabled;
+  this->clear();
+}
+
+void ConvRev :: build( void )
+{
+  unsigned long i, length = response_.frames();
+  unsigned int channel, nChannels = response_.channels();
+  lastFrame_.resize( 1, nChannels, 0.0 );
+
+  // The head is convolved directly by one Convolver per channel.
+  unsigned long headLength = 2 * (unsigned long) tailSize_;
+  if ( headLength > length ) headLength = length;
+  std::vector<StkFloat> coefficients( headLength );
+  heads_.resize( nChannels );
+  for ( channel=0; channel<nChannels; channel++ ) {
+    for ( i=0; i<headLength; i++ )
+      coefficients[i] = response_( i, channel );
+    heads_[channel].setCoefficients( coefficients, true );
+  }
+
+  // Each tail segment ends where the next one, with four times the
+  // partition size, can start two partitions into the response.  The
+  // last segment takes the rest of the response.
+  stages_.clear();
+  unsigned int size = tailSize_, maxSize = tailSize_;
+  unsigned long offset = headLength;
+  while ( offset < length ) {
+    unsigned int next = ( size < MAX_PARTITION ) ? 4 * size : size;
+    if ( next > MAX_PARTITION && size < MAX_PARTITION ) next = MAX_PARTITION;
+    unsigned long end = ( next > size ) ? 2 * (unsigned long) next : length;
+    if ( end > length ) end = length;
+
+    TailStage stage;
+    stage.size = size;
+    stage.offset = offset;
+    stage.nPartitions = ( end - offset + size - 1 ) / size;
+    stage.newest = 0;
+    stages_.push_back( stage );
+
+    maxSize = size;
+    offset = end;
+    size = next;
+  }
+
+  unsigned int bins = maxSize + 1;
+  sumReal_.resize( bins );
+  sumImag_.resize( bins );
+  work_.resize( 2 * maxSize );
+
+  for ( unsigned int s=0; s<stages_.size(); s++ ) {
+    TailStage& stage = stages_[s];
+    unsigned int k, n = stage.nPartitions;
+    size = stage.size;
+    bins = size + 1;
+    stage.fft.setSize( 2 * size );
+    stage.spectraReal.resize( nChannels * n * bins );
+    stage.spectraImag.resize( nChannels * n * bins );
+    stage.historyReal.resize( n * bins );
+    stage.historyImag.resize( n * bins );
+
+    // Each partition is zero-padded to twice its size.
+    for ( channel=0; channel<nChannels; channel++ ) {
+      for ( k=0; k<n; k++ ) {
+        unsigned long start = stage.offset + (unsigned long) k * size;
+        for ( i=0; i<size; i++ ) {
+          work_[i] = ( start + i < length ) ? response_( start + i, channel ) : 0.0;
+          work_[size + i] = 0.0;
+        }
+        unsigned long index = ( channel * n + k ) * bins;
+        stage.fft.forward( &work_[0], &stage.spectraReal[index], &stage.spectraImag[index] );
+      }
+    }
+  }
+
+  // The ring sizes are powers of two.  The accumulator spans every
+  // output a segment can add to ahead of the published ones, and the
+  // output ring at least twice the lookahead of the first segment.
+  // The input ring leaves room for the tail thread to fall behind by
+  // several of the largest partitions before its inputs are
+  // overwritten.
+  unsigned long ringSize;
+  if ( stages_.size() ) {
+    const TailStage& last = stages_.back();
+    for ( ringSize=1; ringSize<8 * (unsigned long) maxSize; ringSize*=2 ) ;
+    tailInputs_.resize( ringSize );
+    inputMask_ = ringSize - 1;
+    for ( ringSize=1; ringSize<2 * stages_[0].offset; ringSize*=2 ) ;
+    tailOutputs_.resize( ringSize * nChannels );
+    outputMask_ = ringSize - 1;
+    for ( ringSize=1; ringSize<last.offset + last.size; ringSize*=2 ) ;
+    accumulator_.resize( ringSize * nChannels );
+    accumulatorMask_ = ringSize - 1;
+  }
+  else {
+    tailInputs_.clear();
+    tailOutputs_.clear();
+    accumulator_.clear();
+    inputMask_ = outputMask_ = accumulatorMask_ = 0;
+  }
+
+  this->clear();
+}
+
+void ConvRev :: clear( void )
+{
+  this->stopTail();
+
+  unsigned int i;
+  for ( i=0; i<heads_.size(); i++ ) heads_[i].clear();
+  for ( i=0; i<lastFrame_.size(); i++ ) lastFrame_[i] = 0.0;
+
+  for ( unsigned int s=0; s<stages_.size(); s++ ) {
+    stages_[s].historyReal.assign( stages_[s].historyReal.size(), 0.0 );
+    stages_[s].historyImag.assign( stages_[s].historyImag.size(), 0.0 );
+    stages_[s].newest = 0;
+  }
+  tailInputs_.assign( tailInputs_.size(), 0.0 );
+  tailOutputs_.assign( tailOutputs_.size(), 0.0 );
+  accumulator_.assign( accumulator_.size(), 0.0 );
+
+  // No segment has output before its offset, so the first segment's
+  // lookahead is ready from the start.
+  time_ = 0;
+  tailTime_ = 0;
+  readyTime_ = stages_.size() ? stages_[0].offset : 0;
+  written_ = 0;
+  ready_ = readyTime_;
+  underruns_ = 0;
+
+  this->startTail();
+}
+
+void ConvRev :: startTail( void )
+{
+#if defined(__STK_REALTIME__)
+  if ( !background_ || stages_.empty() ) return;
+
+  running_ = true;
+  if ( !thread_.start( &convRevTailThread, this ) ) {
+    running_ = false;
+    oStream_ << "ConvRev::startTail(): unable to start tail thread ... computing the tail synchronously!";
+    handleError( StkError::WARNING );
+  }
+#endif
+}
+
+void ConvRev :: stopTail( void )
+{
+#if defined(__STK_REALTIME__)
+  if ( !running_ ) return;
+
+  running_ = false;
+  thread_.wait();
+#endif
+}
+
+bool ConvRev :: tailReady( void )
+{
+  readyTime_ = ready_.load( std::memory_order_acquire );
+  if ( (long) ( readyTime_ - time_ ) > 0 ) return true;
+
+  underruns_.store( underruns_.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+  return false;
+}
+
+void ConvRev :: endBlock( void )
+{
+  if ( stages_.empty() ) return;
+
+  if ( running_.load( std::memory_order_relaxed ) )
+    written_.store( time_, std::memory_order_release );
+  else
+    this->computeBlock();
+}
+
+void ConvRev :: computeTail( void )
+{
+  // A segment needs the last two of its partitions of input, which
+  // must not have been overwritten in the ring.
+  unsigned long limit = tailInputs_.size() - 3 * (unsigned long) stages_.back().size;
+
+  while ( running_.load( std::memory_order_acquire ) ) {
+    unsigned long written = written_.load( std::memory_order_acquire );
+    if ( written - tailTime_ < tailSize_ ) {
+      Stk::sleep( 1 );
+      continue;
+    }
+
+    if ( written - tailTime_ > limit )
+      this->skipTail( written & ~( (unsigned long) stages_.back().size - 1 ) );
+    else
+      this->computeBlock();
+  }
+}
+
+void ConvRev :: computeBlock( void )
+{
+  unsigned int channel, nChannels = lastFrame_.channels();
+  unsigned long i, time = tailTime_ + tailSize_;
+  for ( unsigned int s=0; s<stages_.size(); s++ ) {
+    if ( ( time & ( stages_[s].size - 1 ) ) == 0 )
+      this->computeStage( stages_[s], time );
+  }
+  tailTime_ = time;
+
+  // Every segment starts at least two of its partitions into the
+  // response, so all of them have now added their output up to the
+  // first segment's offset past the inputs.
+  unsigned long start = time - tailSize_ + stages_[0].offset;
+  for ( i=start; i<start+tailSize_; i++ ) {
+    StkFloat *samples = &accumulator_[( i & accumulatorMask_ ) * nChannels];
+    StkFloat *outputs = &tailOutputs_[( i & outputMask_ ) * nChannels];
+    for ( channel=0; channel<nChannels; channel++ ) {
+      outputs[channel] = samples[channel];
+      samples[channel] = 0.0;
+    }
+  }
+  ready_.store( start + tailSize_, std::memory_order_release );
+}
+
+void ConvRev :: computeStage( TailStage& stage, unsigned long time )
+{
+  unsigned int i, size = stage.size, bins = size + 1;
+  unsigned int channel, nChannels = lastFrame_.channels();
+  unsigned int k, n = stage.nPartitions;
+
+  for ( i=0; i<2*size; i++ )
+    work_[i] = tailInputs_[( time - 2 * size + i ) & inputMask_];
+  stage.newest = ( stage.newest == 0 ) ? n - 1 : stage.newest - 1;
+  stage.fft.forward( &work_[0], &stage.historyReal[stage.newest * bins], &stage.historyImag[stage.newest * bins] );
+
+  StkFloat * __restrict sr = &sumReal_[0];
+  StkFloat * __restrict si = &sumImag_[0];
+  for ( channel=0; channel<nChannels; channel++ ) {
+    for ( i=0; i<bins; i++ ) {
+      sr[i] = 0.0;
+      si[i] = 0.0;
+    }
+    unsigned int slot = stage.newest;
+    for ( k=0; k<n; k++ ) {
+      const StkFloat * __restrict xr = &stage.historyReal[slot * bins];
+      const StkFloat * __restrict xi = &stage.historyImag[slot * bins];
+      const StkFloat * __restrict hr = &stage.spectraReal[( channel * n + k ) * bins];
+      const StkFloat * __restrict hi = &stage.spectraImag[( channel * n + k ) * bins];
+      for ( i=0; i<bins; i++ ) {
+        sr[i] += xr[i] * hr[i] - xi[i] * hi[i];
+        si[i] += xr[i] * hi[i] + xi[i] * hr[i];
+      }
+      if ( ++slot == n ) slot = 0;
+    }
+
+    // Overlap-save: the second half of the result is the segment's
+    // output for the last partition of inputs, delayed by its offset.
+    stage.fft.inverse( sr, si, &work_[0] );
+    unsigned long start = time - size + stage.offset;
+    for ( i=0; i<size; i++ )
+      accumulator_[( ( start + i ) & accumulatorMask_ ) * nChannels + channel] += work_[size + i];
+  }
+}
+
+void ConvRev :: skipTail( unsigned long time )
+{
+  // The segments restart from the inputs just before time, without
+  // the spectra of earlier ones.
+  for ( unsigned int s=0; s<stages_.size(); s++ ) {
+    stages_[s].historyReal.assign( stages_[s].historyReal.size(), 0.0 );
+    stages_[s].historyImag.assign( stages_[s].historyImag.size(), 0.0 );
+  }
+  accumulator_.assign( accumulator_.size(), 0.0 );
+
+  unsigned int channel, nChannels = lastFrame_.channels();
+  unsigned long i, end = time + stages_[0].offset;
+  for ( i=time; i<end; i++ ) {
+    for ( channel=0; channel<nChannels; channel++ )
+      tailOutputs_[( i & outputMask_ ) * nChannels + channel] = 0.0;
+  }
+
+  tailTime_ = time;
+  ready_.store( end, std::memory_order_release );
+}
+
+StkFrames& ConvRev :: tick( StkFrames& frames, unsigned int channel )
+{
+  unsigned int nChannels = lastFrame_.channels();
+#if defined(_STK_DEBUG_)
+  if ( channel + nChannels > frames.channels() ) {
+    oStream_ << "ConvRev::tick(): channel and StkFrames arguments are incompatible!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  StkFloat *samples = &frames[channel];
+  unsigned int j, hop = frames.channels();
+  for ( unsigned int i=0; i<frames.frames(); i++, samples += hop ) {
+    *samples = tick( *samples );
+    for ( j=1; j<nChannels; j++ )
+      *(samples+j) = lastFrame_[j];
+  }
+
+  return frames;
+}
+
+StkFrames& ConvRev :: tick( StkFrames& iFrames, StkFrames& oFrames, unsigned int iChannel, unsigned int oChannel )
+{
+  unsigned int nChannels = lastFrame_.channels();
+#if defined(_STK_DEBUG_)
+  if ( iChannel >= iFrames.channels() || oChannel + nChannels > oFrames.channels() ) {
+    oStream_ << "ConvRev::tick(): channel and StkFrames arguments are incompatible!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  StkFloat *iSamples = &iFrames[iChannel];
+  StkFloat *oSamples = &oFrames[oChannel];
+  unsigned int j, iHop = iFrames.channels(), oHop = oFrames.channels();
+  for ( unsigned int i=0; i<iFrames.frames(); i++, iSamples += iHop, oSamples += oHop ) {
+    *oSamples = tick( *iSamples );
+    for ( j=1; j<nChannels; j++ )
+      *(oSamples+j) = lastFrame_[j];
+  }
+
+  return iFrames;
+}
+
+} // stk namespace
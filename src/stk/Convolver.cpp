@@ -0,0 +1,198 @@
+/***************************************************/
+/*! \class Convolver
+    \brief STK partitioned FFT convolution filter class.
+
+    This class implements the same finite impulse response filter as
+    the Fir class, y[n] = b[0]*x[n] + ... + b[nb]*x[n-nb], with a cost
+    per sample that grows much more slowly with the filter length, so
+    that impulse responses of thousands of taps can be run in real
+    time.  The Fir class uses it automatically for long filters.
+
+    The coefficients are split into partitions of equal size.  The
+    first partition is computed in direct form, sample by sample, so
+    the filter has no latency.  The remaining partitions are applied
+    in the frequency domain by overlap-save: once per partition of
+    input samples, the last two partitions of input are transformed
+    into a delay line of spectra, each spectrum is multiplied by the
+    spectrum of the matching partition of coefficients, and the sum
+    is transformed back to give the contribution of all but the first
+    partition to the next partition of output samples.
+
+    The \e gain parameter is applied at the filter input and does not
+    affect the coefficient values.  The default gain value is 1.0.
+*/
+/***************************************************/
+
+#include "Convolver.h"
+
+namespace stk {
+
+Convolver :: Convolver( void )
+  : requestedSize_( 0 ), partitionSize_( 0 ), nPartitions_( 0 ), position_( 0 ), newest_( 0 )
+{
+  // The default constructor should setup for pass-through.
+  std::vector<StkFloat> coefficients( 1, 1.0 );
+  this->setCoefficients( coefficients, true );
+}
+
+Convolver :: Convolver( std::vector<StkFloat> &coefficients, unsigned int partitionSize )
+  : requestedSize_( 0 ), partitionSize_( 0 ), nPartitions_( 0 ), position_( 0 ), newest_( 0 )
+{
+  if ( partitionSize & ( partitionSize - 1 ) ) {
+    oStream_ << "Convolver: partition size (" << partitionSize << ") must be a power of two!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  requestedSize_ = partitionSize;
+  this->setCoefficients( coefficients, true );
+}
+
+Convolver :: ~Convolver( void )
+{
+}
+
+void Convolver :: clear( void )
+{
+  Filter::clear();
+  for ( unsigned int i=0; i<historyReal_.size(); i++ ) {
+    historyReal_[i] = 0.0;
+    historyImag_[i] = 0.0;
+  }
+  position_ = 0;
+}
+
+void Convolver :: setPartitionSize( unsigned int size )
+{
+  if ( size & ( size - 1 ) ) {
+    oStream_ << "Convolver::setPartitionSize: size (" << size << ") must be a power of two!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  requestedSize_ = size;
+  this->setCoefficients( b_ );
+}
+
+void Convolver :: setCoefficients( std::vector<StkFloat> &coefficients, bool clearState )
+{
+  // Check the argument.
+  if ( coefficients.size() == 0 ) {
+    oStream_ << "Convolver::setCoefficients: coefficient vector must have size > 0!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  b_ = coefficients;
+  unsigned long length = b_.size();
+
+  // By default, the partition size grows with the square root of the
+  // length, which balances the direct-form and frequency-domain costs,
+  // within limits that keep the direct-form part short.
+  unsigned int size = requestedSize_;
+  if ( size == 0 ) {
+    size = 32;
+    while ( size < 256 && (unsigned long) size * size < 2 * length ) size *= 2;
+  }
+  unsigned int nPartitions = ( length - 1 ) / size;
+
+  unsigned int i, bins = size + 1;
+  if ( size != partitionSize_ || nPartitions != nPartitions_ ) {
+    partitionSize_ = size;
+    nPartitions_ = nPartitions;
+    inputs_.resize( 2 * size, 1, 0.0 );
+    outputs_.resize( size, 1, 0.0 );
+    head_.resize( size );
+    work_.resize( 2 * size );
+    sumReal_.resize( bins );
+    sumImag_.resize( bins );
+    spectraReal_.resize( nPartitions * bins );
+    spectraImag_.resize( nPartitions * bins );
+    historyReal_.assign( nPartitions * bins, 0.0 );
+    historyImag_.assign( nPartitions * bins, 0.0 );
+    fft_.setSize( 2 * size );
+    newest_ = 0;
+    clearState = true;
+  }
+
+  // The direct-form coefficients are stored in reverse order.
+  for ( i=0; i<size; i++ )
+    head_[size-1-i] = ( i < length ) ? b_[i] : 0.0;
+
+  // Each frequency-domain partition is zero-padded to twice its size.
+  for ( unsigned int k=0; k<nPartitions; k++ ) {
+    unsigned long offset = (unsigned long) ( k + 1 ) * size;
+    for ( i=0; i<size; i++ ) {
+      work_[i] = ( offset + i < length ) ? b_[offset + i] : 0.0;
+      work_[size + i] = 0.0;
+    }
+    fft_.forward( &work_[0], &spectraReal_[k * bins], &spectraImag_[k * bins] );
+  }
+
+  if ( clearState ) this->clear();
+}
+
+void Convolver :: nextPartition( void )
+{
+  unsigned int i, size = partitionSize_;
+  position_ = 0;
+
+  if ( nPartitions_ > 0 ) {
+    unsigned int bins = size + 1;
+    newest_ = ( newest_ == 0 ) ? nPartitions_ - 1 : newest_ - 1;
+    fft_.forward( &inputs_[0], &historyReal_[newest_ * bins], &historyImag_[newest_ * bins] );
+
+    // The newest input spectrum is multiplied by the spectrum of the
+    // second partition of coefficients, the one before it by that of
+    // the third, and so on.
+    StkFloat * __restrict sr = &sumReal_[0];
+    StkFloat * __restrict si = &sumImag_[0];
+    for ( i=0; i<bins; i++ ) {
+      sr[i] = 0.0;
+      si[i] = 0.0;
+    }
+    unsigned int slot = newest_;
+    for ( unsigned int k=0; k<nPartitions_; k++ ) {
+      const StkFloat * __restrict xr = &historyReal_[slot * bins];
+      const StkFloat * __restrict xi = &historyImag_[slot * bins];
+      const StkFloat * __restrict hr = &spectraReal_[k * bins];
+      const StkFloat * __restrict hi = &spectraImag_[k * bins];
+      for ( i=0; i<bins; i++ ) {
+        sr[i] += xr[i] * hr[i] - xi[i] * hi[i];
+        si[i] += xr[i] * hi[i] + xi[i] * hr[i];
+      }
+      if ( ++slot == nPartitions_ ) slot = 0;
+    }
+
+    // Overlap-save: only the second half of the result is valid.
+    fft_.inverse( sr, si, &work_[0] );
+    for ( i=0; i<size; i++ )
+      outputs_[i] = work_[size + i];
+  }
+
+  for ( i=0; i<size; i++ )
+    inputs_[i] = inputs_[size + i];
+}
+
+void Convolver :: filterBlock( const StkFloat *iSamples, unsigned int iHop,
+                               StkFloat *oSamples, unsigned int oHop, unsigned int nFrames )
+{
+  unsigned int i, size = partitionSize_;
+  while ( nFrames > 0 ) {
+
+    // Process up to the end of the current partition.  All of its
+    // inputs are read before any output is written.
+    unsigned int n = size - position_;
+    if ( n > nFrames ) n = nFrames;
+    for ( i=0; i<n; i++ )
+      inputs_[size + position_ + i] = gain_ * iSamples[i * iHop];
+    for ( i=0; i<n; i++ )
+      oSamples[i * oHop] = dot( &head_[0], &inputs_[position_ + i + 1], size ) + outputs_[position_ + i];
+
+    lastFrame_[0] = oSamples[(n-1) * oHop];
+    iSamples += n * iHop;
+    oSamples += n * oHop;
+    nFrames -= n;
+    position_ += n;
+    if ( position_ == size ) this->nextPartition();
+  }
+}
+
+} // stk namespace
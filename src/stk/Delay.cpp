@@ -10,11 +10,16 @@
     A non-interpolating delay line is typically used in fixed
     delay-length applications, such as for reverberation.
 
+    The delay-line length is rounded up to a power of two, so that its
+    indices wrap with a mask rather than a test, and blocks of samples
+    are moved in contiguous spans.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
 
 #include "Delay.h"
+#include <cstring>
 
 namespace stk {
 
@@ -28,10 +33,9 @@ Delay :: Delay( unsigned long delay, unsigned long maxDelay )
     handleError( StkError::FUNCTION_ARGUMENT );
   }
 
-  if ( ( maxDelay + 1 ) > inputs_.size() )
-    inputs_.resize( maxDelay + 1, 1, 0.0 );
-
   inPoint_ = 0;
+  outPoint_ = 0;
+  this->setMaximumDelay( maxDelay );
   this->setDelay( delay );
 }
 
@@ -42,7 +46,13 @@ Delay :: ~Delay()
 void Delay :: setMaximumDelay( unsigned long delay )
 {
   if ( delay < inputs_.size() ) return;
-  inputs_.resize( delay + 1 );
+
+  unsigned long length = 1;
+  while ( length < delay + 1 ) length <<= 1;
+  inputs_.resize( length, 1, 0.0 );
+  mask_ = length - 1;
+  inPoint_ &= mask_;
+  outPoint_ &= mask_;
 }
 
 void Delay :: setDelay( unsigned long delay )
@@ -53,8 +63,7 @@ void Delay :: setDelay( unsigned long delay )
   }
 
   // read chases write
-  if ( inPoint_ >= delay ) outPoint_ = inPoint_ - delay;
-  else outPoint_ = inputs_.size() + inPoint_ - delay;
+  outPoint_ = ( inPoint_ - delay ) & mask_;
   delay_ = delay;
 }
 
@@ -82,29 +91,65 @@ StkFloat Delay :: energy( void ) const
 
 StkFloat Delay :: tapOut( unsigned long tapDelay )
 {
-  long tap = inPoint_ - tapDelay - 1;
-  while ( tap < 0 ) // Check for wraparound.
-    tap += inputs_.size();
-
+  unsigned long tap = ( inPoint_ - tapDelay - 1 ) & mask_;
   return inputs_[tap];
 }
 
 void Delay :: tapIn( StkFloat value, unsigned long tapDelay )
 {
-  long tap = inPoint_ - tapDelay - 1;
-  while ( tap < 0 ) // Check for wraparound.
-    tap += inputs_.size();
-
+  unsigned long tap = ( inPoint_ - tapDelay - 1 ) & mask_;
   inputs_[tap] = value;
 }
 
 StkFloat Delay :: addTo( StkFloat value, unsigned long tapDelay )
 {
-  long tap = inPoint_ - tapDelay - 1;
-  while ( tap < 0 ) // Check for wraparound.
-    tap += inputs_.size();
-
+  unsigned long tap = ( inPoint_ - tapDelay - 1 ) & mask_;
   return inputs_[tap]+= value;
 }
 
+void Delay :: filterBlock( const StkFloat *iSamples, unsigned int iHop,
+                           StkFloat *oSamples, unsigned int oHop, unsigned long nFrames )
+{
+  StkFloat *buffer = &inputs_[0];
+  unsigned long i, n, length = inputs_.size();
+
+  // The inputs of a span are all written before its outputs are
+  // read.  The outputs are the same as sample by sample as long as no
+  // output is read from a slot that a later input of the span has
+  // overwritten, which holds for spans up to the line length less the
+  // delay.
+  unsigned long span = length - ( ( inPoint_ - outPoint_ ) & mask_ );
+
+  while ( nFrames > 0 ) {
+    unsigned long count = ( nFrames < span ) ? nFrames : span;
+    nFrames -= count;
+
+    for ( unsigned long done=0; done<count; done+=n ) {
+      n = length - inPoint_;
+      if ( n > count - done ) n = count - done;
+      StkFloat *in = buffer + inPoint_;
+      for ( i=0; i<n; i++ )
+        in[i] = gain_ * iSamples[i * iHop];
+      iSamples += n * iHop;
+      inPoint_ = ( inPoint_ + n ) & mask_;
+    }
+
+    for ( unsigned long done=0; done<count; done+=n ) {
+      n = length - outPoint_;
+      if ( n > count - done ) n = count - done;
+      const StkFloat *out = buffer + outPoint_;
+      if ( oHop == 1 )
+        std::memcpy( oSamples, out, n * sizeof( StkFloat ) );
+      else {
+        for ( i=0; i<n; i++ )
+          oSamples[i * oHop] = out[i];
+      }
+      oSamples += n * oHop;
+      outPoint_ = ( outPoint_ + n ) & mask_;
+    }
+  }
+
+  lastFrame_[0] = *( oSamples - oHop );
+}
+
 } // stk namespace
@@ -14,6 +14,10 @@
     minimum delay possible in this implementation is limited to a
     value of 0.5.
 
+    The delay-line length is rounded up to a power of two, so that its
+    indices wrap with a mask rather than a test, and blocks of samples
+    are read in contiguous spans.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -35,10 +39,9 @@ DelayA :: DelayA( StkFloat delay, unsigned long maxDelay )
   }
 
   // Writing before reading allows delays from 0 to length-1. 
-  if ( maxDelay + 1 > inputs_.size() )
-    inputs_.resize( maxDelay + 1, 1, 0.0 );
-
   inPoint_ = 0;
+  outPoint_ = 0;
+  this->setMaximumDelay( maxDelay );
   this->setDelay( delay );
   apInput_ = 0.0;
   doNextOut_ = true;
@@ -59,7 +62,13 @@ void DelayA :: clear()
 void DelayA :: setMaximumDelay( unsigned long delay )
 {
   if ( delay < inputs_.size() ) return;
-  inputs_.resize( delay + 1 );
+
+  unsigned long length = 1;
+  while ( length < delay + 1 ) length <<= 1;
+  inputs_.resize( length, 1, 0.0 );
+  mask_ = length - 1;
+  inPoint_ &= mask_;
+  outPoint_ &= mask_;
 }
 
 void DelayA :: setDelay( StkFloat delay )
@@ -75,21 +84,19 @@ void DelayA :: setDelay( StkFloat delay )
     handleError( StkError::WARNING );
   }
 
-  StkFloat outPointer = inPoint_ - delay + 1.0;     // outPoint chases inpoint
+  // outPoint chases inpoint.  The read position is split into its
+  // parts before wrapping, so that their rounding does not depend on
+  // the delay-line length.
+  long integer = (long) delay;
   delay_ = delay;
 
-  while ( outPointer < 0 )
-    outPointer += length;  // modulo maximum length
-
-  outPoint_ = (long) outPointer;         // integer part
-  if ( outPoint_ == length ) outPoint_ = 0;
-  alpha_ = 1.0 + outPoint_ - outPointer; // fractional part
+  outPoint_ = ( inPoint_ - integer ) & mask_; // integer part
+  alpha_ = delay - integer;                   // fractional part
 
   if ( alpha_ < 0.5 ) {
     // The optimal range for alpha is about 0.5 - 1.5 in order to
     // achieve the flattest phase delay response.
-    outPoint_ += 1;
-    if ( outPoint_ >= length ) outPoint_ -= length;
+    outPoint_ = ( outPoint_ + 1 ) & mask_;
     alpha_ += (StkFloat) 1.0;
   }
 
@@ -98,20 +105,73 @@ void DelayA :: setDelay( StkFloat delay )
 
 StkFloat DelayA :: tapOut( unsigned long tapDelay )
 {
-  long tap = inPoint_ - tapDelay - 1;
-  while ( tap < 0 ) // Check for wraparound.
-    tap += inputs_.size();
-
+  unsigned long tap = ( inPoint_ - tapDelay - 1 ) & mask_;
   return inputs_[tap];
 }
 
 void DelayA :: tapIn( StkFloat value, unsigned long tapDelay )
 {
-  long tap = inPoint_ - tapDelay - 1;
-  while ( tap < 0 ) // Check for wraparound.
-    tap += inputs_.size();
-
+  unsigned long tap = ( inPoint_ - tapDelay - 1 ) & mask_;
   inputs_[tap] = value;
 }
 
+void DelayA :: filterBlock( const StkFloat *iSamples, unsigned int iHop,
+                            StkFloat *oSamples, unsigned int oHop, unsigned long nFrames )
+{
+  // A value returned by nextOut() before the next input is written
+  // must be output as it is.
+  if ( !doNextOut_ ) {
+    *oSamples = this->tick( *iSamples );
+    if ( --nFrames == 0 ) return;
+    iSamples += iHop;
+    oSamples += oHop;
+  }
+
+  StkFloat *buffer = &inputs_[0];
+  StkFloat coeff = coeff_, apInput = apInput_, output = lastFrame_[0];
+  unsigned long i, n, length = inputs_.size();
+
+  // The inputs of a span are all written before its outputs are
+  // read.  The outputs are the same as sample by sample as long as no
+  // output is read from a slot that a later input of the span has
+  // overwritten, which holds for spans up to the line length less the
+  // delay.
+  unsigned long span = length - ( ( inPoint_ - outPoint_ ) & mask_ );
+
+  while ( nFrames > 0 ) {
+    unsigned long count = ( nFrames < span ) ? nFrames : span;
+    nFrames -= count;
+
+    for ( unsigned long done=0; done<count; done+=n ) {
+      n = length - inPoint_;
+      if ( n > count - done ) n = count - done;
+      StkFloat *in = buffer + inPoint_;
+      for ( i=0; i<n; i++ )
+        in[i] = gain_ * iSamples[i * iHop];
+      iSamples += n * iHop;
+      inPoint_ = ( inPoint_ + n ) & mask_;
+    }
+
+    // The allpass interpolation is recursive, so only the wraparound
+    // tests are saved here.
+    for ( unsigned long done=0; done<count; done+=n ) {
+      n = length - outPoint_;
+      if ( n > count - done ) n = count - done;
+      const StkFloat *out = buffer + outPoint_;
+      for ( i=0; i<n; i++ ) {
+        output = -coeff * output;
+        output += apInput + ( coeff * out[i] );
+        apInput = out[i];
+        oSamples[i * oHop] = output;
+      }
+      oSamples += n * oHop;
+      outPoint_ = ( outPoint_ + n ) & mask_;
+    }
+  }
+
+  lastFrame_[0] = output;
+  apInput_ = apInput;
+  doNextOut_ = true;
+}
+
 } // stk namespace
@@ -13,6 +13,10 @@
     delay setting.  The use of higher order Lagrange interpolators can
     typically improve (minimize) this attenuation characteristic.
 
+    The delay-line length is rounded up to a power of two, so that its
+    indices wrap with a mask rather than a test, and blocks of samples
+    are interpolated in contiguous spans.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -34,10 +38,9 @@ DelayL :: DelayL( StkFloat delay, unsigned long maxDelay )
   }
 
   // Writing before reading allows delays from 0 to length-1. 
-  if ( maxDelay + 1 > inputs_.size() )
-    inputs_.resize( maxDelay + 1, 1, 0.0 );
-
   inPoint_ = 0;
+  outPoint_ = 0;
+  this->setMaximumDelay( maxDelay );
   this->setDelay( delay );
   doNextOut_ = true;
 }
@@ -49,7 +52,13 @@ DelayL :: ~DelayL()
 void DelayL :: setMaximumDelay( unsigned long delay )
 {
   if ( delay < inputs_.size() ) return;
-  inputs_.resize( delay + 1 );
+
+  unsigned long length = 1;
+  while ( length < delay + 1 ) length <<= 1;
+  inputs_.resize( length, 1, 0.0 );
+  mask_ = length - 1;
+  inPoint_ &= mask_;
+  outPoint_ &= mask_;
 }
 
 void DelayL :: setDelay( StkFloat delay )
@@ -64,34 +73,94 @@ void DelayL :: setDelay( StkFloat delay )
     handleError( StkError::WARNING ); return;
   }
 
-  StkFloat outPointer = inPoint_ - delay;  // read chases write
+  // Read chases write.  The read position is split into its parts
+  // before wrapping, so that their rounding does not depend on the
+  // delay-line length.
+  unsigned long integer = (unsigned long) delay;
+  StkFloat fraction = delay - integer;
   delay_ = delay;
 
-  while ( outPointer < 0 )
-    outPointer += inputs_.size(); // modulo maximum length
-
-  outPoint_ = (long) outPointer;   // integer part
-  if ( outPoint_ == inputs_.size() ) outPoint_ = 0;
-  alpha_ = outPointer - outPoint_; // fractional part
+  if ( fraction > 0.0 ) {
+    outPoint_ = ( inPoint_ - integer - 1 ) & mask_; // integer part
+    alpha_ = (StkFloat) 1.0 - fraction;             // fractional part
+  }
+  else {
+    outPoint_ = ( inPoint_ - integer ) & mask_;
+    alpha_ = 0.0;
+  }
   omAlpha_ = (StkFloat) 1.0 - alpha_;
 }
 
 StkFloat DelayL :: tapOut( unsigned long tapDelay )
 {
-  long tap = inPoint_ - tapDelay - 1;
-  while ( tap < 0 ) // Check for wraparound.
-    tap += inputs_.size();
-
+  unsigned long tap = ( inPoint_ - tapDelay - 1 ) & mask_;
   return inputs_[tap];
 }
 
 void DelayL :: tapIn( StkFloat value, unsigned long tapDelay )
 {
-  long tap = inPoint_ - tapDelay - 1;
-  while ( tap < 0 ) // Check for wraparound.
-    tap += inputs_.size();
-
+  unsigned long tap = ( inPoint_ - tapDelay - 1 ) & mask_;
   inputs_[tap] = value;
 }
 
+void DelayL :: filterBlock( const StkFloat *iSamples, unsigned int iHop,
+                            StkFloat *oSamples, unsigned int oHop, unsigned long nFrames )
+{
+  // A value returned by nextOut() before the next input is written
+  // must be output as it is.
+  if ( !doNextOut_ ) {
+    *oSamples = this->tick( *iSamples );
+    if ( --nFrames == 0 ) return;
+    iSamples += iHop;
+    oSamples += oHop;
+  }
+
+  StkFloat *buffer = &inputs_[0];
+  StkFloat alpha = alpha_, omAlpha = omAlpha_;
+  unsigned long i, n, length = inputs_.size();
+
+  // The inputs of a span are all written before its outputs are
+  // read.  The outputs are the same as sample by sample as long as no
+  // output is read from a slot that a later input of the span has
+  // overwritten.  With a delay of zero, the second slot read for each
+  // output is the next input.
+  unsigned long distance = ( inPoint_ - outPoint_ ) & mask_;
+  unsigned long span = ( distance > 0 ) ? length - distance : 1;
+
+  while ( nFrames > 0 ) {
+    unsigned long count = ( nFrames < span ) ? nFrames : span;
+    nFrames -= count;
+
+    for ( unsigned long done=0; done<count; done+=n ) {
+      n = length - inPoint_;
+      if ( n > count - done ) n = count - done;
+      StkFloat *in = buffer + inPoint_;
+      for ( i=0; i<n; i++ )
+        in[i] = gain_ * iSamples[i * iHop];
+      iSamples += n * iHop;
+      inPoint_ = ( inPoint_ + n ) & mask_;
+    }
+
+    for ( unsigned long done=0; done<count; done+=n ) {
+      const StkFloat *out = buffer + outPoint_;
+      n = length - 1 - outPoint_;
+      if ( n > count - done ) n = count - done;
+      if ( n == 0 ) {
+        // The last slot is interpolated with the first.
+        *oSamples = out[0] * omAlpha + buffer[0] * alpha;
+        n = 1;
+      }
+      else {
+        for ( i=0; i<n; i++ )
+          oSamples[i * oHop] = out[i] * omAlpha + out[i+1] * alpha;
+      }
+      oSamples += n * oHop;
+      outPoint_ = ( outPoint_ + n ) & mask_;
+    }
+  }
+
+  lastFrame_[0] = *( oSamples - oHop );
+  doNextOut_ = true;
+}
+
 } // stk namespace
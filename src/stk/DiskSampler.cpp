@@ -0,0 +1,396 @@
+/***************************************************/
+/*! \class DiskSampler
+    \brief STK disk-streaming multisample instrument.
+
+    This class plays a set of sample zones, each mapped to a range
+    of MIDI key numbers, without holding whole files in memory.  Only
+    the attack "head" of each zone is loaded when the zone is added.
+    The remainder of each file is read from disk in fixed-size blocks
+    by a pool of background threads shared by all zones and voices.
+
+    Tail blocks live in a common, reference-counted cache.  Voices
+    playing the same region of a zone share a single copy, and
+    recently used blocks stay cached until their slot is needed
+    again.  Each voice requests the blocks ahead of its read position
+    as soon as it starts, so the disk threads have the length of the
+    head in which to respond.  If a block has not arrived by the time
+    it is needed, the voice outputs silence and the missed block is
+    counted once (see getUnderruns()).  Without realtime support,
+    blocks are read synchronously when requested.
+
+    Multi-channel files are mixed to mono as they are read.  Voices
+    are pitch-shifted with linear interpolation relative to the base
+    frequency of their zone.  When all voices are busy, the oldest
+    one is stolen.
+
+    Zones should be added before playback starts.  The addZone()
+    function is not safe to call while tick() is running in another
+    thread.
+*/
+/***************************************************/
+
+#include "DiskSampler.h"
+#include <cmath>
+
+namespace stk {
+
+#if defined(__STK_REALTIME__)
+
+extern "C" THREAD_RETURN THREAD_TYPE diskSamplerThread( void * ptr )
+{
+  ((DiskSampler *) ptr)->readBlocks();
+  return 0;
+}
+
+#endif
+
+// Mix the interleaved frames of \e in down to the mono \e out.
+static void mixDown( const StkFrames& in, StkFrames& out )
+{
+  unsigned int nChannels = in.channels();
+  StkFloat scale = 1.0 / nChannels;
+  size_t counter = 0;
+  for ( unsigned int i=0; i<in.frames(); i++ ) {
+    StkFloat sum = 0.0;
+    for ( unsigned int j=0; j<nChannels; j++ ) sum += in[counter++];
+    out[i] = sum * scale;
+  }
+}
+
+DiskSampler :: DiskSampler( unsigned int nVoices, unsigned long headFrames,
+                            unsigned long blockFrames, unsigned int nThreads )
+  : nVoices_(nVoices), headFrames_(headFrames), blockFrames_(blockFrames),
+    voiceCounter_(0), useCounter_(0), underruns_(0)
+{
+  if ( nVoices_ == 0 ) nVoices_ = 1;
+  if ( blockFrames_ == 0 ) blockFrames_ = 1;
+  if ( nThreads == 0 ) nThreads = 1;
+
+  voices_ = new Voice[nVoices_];
+  for ( unsigned int i=0; i<nVoices_; i++ ) {
+    voices_[i].zone = 0;
+    voices_[i].block = -1;
+    voices_[i].missedBlock = -1;
+    for ( unsigned int j=0; j<VOICE_BLOCKS; j++ ) voices_[i].slots[j] = -1;
+    voices_[i].envelope.setAttackTime( 0.001 );
+    voices_[i].envelope.setSustainLevel( 1.0 );
+    voices_[i].envelope.setReleaseTime( 0.2 );
+  }
+
+  // Leave room for every voice to hold its blocks plus as many again
+  // for blocks that can be shared with voices started later.
+  nBlocks_ = 2 * nVoices_ * VOICE_BLOCKS;
+  blocks_ = new Block[nBlocks_];
+  for ( unsigned int i=0; i<nBlocks_; i++ ) {
+    blocks_[i].data.resize( blockFrames_ + 1, 1, 0.0 );
+    blocks_[i].zone = 0;
+    blocks_[i].index = -1;
+    blocks_[i].refs = 0;
+    blocks_[i].lastUse = 0;
+    blocks_[i].state = BLOCK_FREE;
+  }
+
+#if defined(__STK_REALTIME__)
+  running_ = true;
+  for ( unsigned int i=0; i<nThreads; i++ ) {
+    Thread *thread = new Thread;
+    if ( !thread->start( &diskSamplerThread, this ) ) {
+      delete thread;
+      // The destructor will not run, so stop the threads already
+      // started and release what was allocated here.
+      this->stopThreads();
+      delete [] voices_;
+      delete [] blocks_;
+      oStream_ << "DiskSampler::DiskSampler: unable to start disk thread!";
+      handleError( StkError::PROCESS_THREAD );
+    }
+    threads_.push_back( thread );
+  }
+#endif
+
+  lastFrame_.resize( 1, 1, 0.0 );
+}
+
+DiskSampler :: ~DiskSampler( void )
+{
+  this->stopThreads();
+  delete [] voices_;
+  delete [] blocks_;
+  for ( unsigned int i=0; i<zones_.size(); i++ ) delete zones_[i];
+}
+
+void DiskSampler :: stopThreads( void )
+{
+#if defined(__STK_REALTIME__)
+  running_ = false;
+  for ( unsigned int i=0; i<threads_.size(); i++ ) {
+    threads_[i]->wait();
+    delete threads_[i];
+  }
+  threads_.clear();
+#endif
+}
+
+unsigned int DiskSampler :: addZone( std::string fileName, StkFloat baseFrequency,
+                                     int loKey, int hiKey, bool raw )
+{
+  if ( baseFrequency <= 0.0 ) {
+    oStream_ << "DiskSampler::addZone: base frequency must be greater than zero!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  Zone *zone = new Zone;
+  try {
+    zone->file.open( fileName, raw );
+  }
+  catch ( StkError & ) {
+    delete zone;
+    throw;
+  }
+
+  zone->size = zone->file.fileSize();
+  zone->fileRate = zone->file.fileRate();
+  zone->baseFrequency = baseFrequency;
+  zone->loKey = loKey;
+  zone->hiKey = hiKey;
+
+  // Load the head plus one guard frame for interpolation into the tail.
+  zone->headFrames = headFrames_;
+  if ( zone->headFrames > zone->size ) zone->headFrames = zone->size;
+  unsigned long nFrames = zone->headFrames;
+  if ( nFrames < zone->size ) nFrames++;
+
+  StkFrames buffer( nFrames, zone->file.channels() );
+  try {
+    zone->file.read( buffer, 0, true );
+  }
+  catch ( StkError & ) {
+    delete zone;
+    throw;
+  }
+  zone->head.resize( nFrames, 1 );
+  mixDown( buffer, zone->head );
+
+  // The tail is read by the disk threads from here on.
+  zones_.push_back( zone );
+  return zones_.size() - 1;
+}
+
+void DiskSampler :: clear( void )
+{
+  for ( unsigned int i=0; i<nVoices_; i++ )
+    if ( voices_[i].zone ) this->stopVoice( voices_[i] );
+
+  lastFrame_[0] = 0.0;
+}
+
+void DiskSampler :: setReleaseTime( StkFloat time )
+{
+  for ( unsigned int i=0; i<nVoices_; i++ )
+    voices_[i].envelope.setReleaseTime( time );
+}
+
+void DiskSampler :: noteOn( StkFloat frequency, StkFloat amplitude )
+{
+  if ( zones_.empty() ) {
+    oStream_ << "DiskSampler::noteOn: no zones have been added!";
+    handleError( StkError::WARNING ); return;
+  }
+
+  if ( frequency <= 0.0 ) {
+    oStream_ << "DiskSampler::noteOn: frequency parameter is less than or equal to zero!";
+    handleError( StkError::WARNING ); return;
+  }
+
+  // Find the zone covering this key, else the one nearest in pitch.
+  StkFloat key = 12.0 * log( frequency / 220.0 ) / log( 2.0 ) + 57.0;
+  int noteNumber = (int) floor( key + 0.5 );
+  Zone *zone = 0;
+  StkFloat distance = 0.0;
+  for ( unsigned int i=0; i<zones_.size(); i++ ) {
+    if ( noteNumber >= zones_[i]->loKey && noteNumber <= zones_[i]->hiKey ) {
+      zone = zones_[i];
+      break;
+    }
+    StkFloat d = fabs( log( frequency / zones_[i]->baseFrequency ) );
+    if ( !zone || d < distance ) {
+      zone = zones_[i];
+      distance = d;
+    }
+  }
+
+  // Use an idle voice or steal the oldest.
+  Voice *voice = &voices_[0];
+  for ( unsigned int i=0; i<nVoices_; i++ ) {
+    if ( !voices_[i].zone ) {
+      voice = &voices_[i];
+      break;
+    }
+    if ( voices_[i].order < voice->order ) voice = &voices_[i];
+  }
+  if ( voice->zone ) this->stopVoice( *voice );
+
+  voice->zone = zone;
+  voice->key = key;
+  voice->time = 0.0;
+  voice->rate = ( frequency / zone->baseFrequency ) * ( zone->fileRate / Stk::sampleRate() );
+  voice->gain = amplitude;
+  voice->order = voiceCounter_++;
+  voice->envelope.setValue( 0.0 );
+  voice->envelope.setSustainLevel( 1.0 );
+  voice->envelope.keyOn();
+
+  // Start reading the tail while the head plays.
+  if ( zone->size > zone->headFrames ) this->advanceVoice( *voice, 0 );
+}
+
+void DiskSampler :: noteOff( StkFloat )
+{
+  for ( unsigned int i=0; i<nVoices_; i++ )
+    if ( voices_[i].zone ) voices_[i].envelope.keyOff();
+}
+
+void DiskSampler :: noteOff( StkFloat frequency, StkFloat )
+{
+  if ( frequency <= 0.0 ) return;
+
+  StkFloat key = 12.0 * log( frequency / 220.0 ) / log( 2.0 ) + 57.0;
+  for ( unsigned int i=0; i<nVoices_; i++ ) {
+    if ( voices_[i].zone && fabs( voices_[i].key - key ) < 0.01 )
+      voices_[i].envelope.keyOff();
+  }
+}
+
+void DiskSampler :: stopVoice( Voice& voice )
+{
+  for ( unsigned int j=0; j<VOICE_BLOCKS; j++ ) {
+    if ( voice.slots[j] >= 0 ) this->releaseBlock( voice.slots[j] );
+    voice.slots[j] = -1;
+  }
+  voice.block = -1;
+  voice.missedBlock = -1;
+  voice.zone = 0;
+}
+
+void DiskSampler :: advanceVoice( Voice& voice, long index )
+{
+  int slots[VOICE_BLOCKS];
+  unsigned int j;
+  for ( j=0; j<VOICE_BLOCKS; j++ ) slots[j] = -1;
+
+  // Keep the blocks still inside the new window and let go of the rest.
+  for ( j=0; j<VOICE_BLOCKS; j++ ) {
+    if ( voice.slots[j] < 0 ) continue;
+    long held = voice.block + j;
+    if ( held >= index && held < index + VOICE_BLOCKS )
+      slots[held - index] = voice.slots[j];
+    else
+      this->releaseBlock( voice.slots[j] );
+  }
+
+  for ( j=0; j<VOICE_BLOCKS; j++ ) {
+    if ( slots[j] < 0 ) slots[j] = this->acquireBlock( voice.zone, index + j );
+    voice.slots[j] = slots[j];
+  }
+  voice.block = index;
+}
+
+int DiskSampler :: acquireBlock( Zone *zone, long index )
+{
+  if ( zone->headFrames + index * blockFrames_ >= zone->size ) return -1;
+
+  // Share the block if it is already cached or on its way.
+  int spare = -1;
+  bool spareFree = false;
+  for ( unsigned int i=0; i<nBlocks_; i++ ) {
+    Block& block = blocks_[i];
+    int state = block.state.load( std::memory_order_acquire );
+    if ( state != BLOCK_FREE && block.zone == zone && block.index == index ) {
+      block.refs++;
+      block.lastUse = useCounter_++;
+      return i;
+    }
+
+    // Otherwise note a free slot, or the least recently used one we can reclaim.
+    if ( spareFree || block.refs > 0 || state == BLOCK_REQUESTED || state == BLOCK_LOADING ) continue;
+    if ( state == BLOCK_FREE ) {
+      spare = i;
+      spareFree = true;
+    }
+    else if ( spare < 0 || block.lastUse < blocks_[spare].lastUse )
+      spare = i;
+  }
+
+  if ( spare < 0 ) return -1;
+
+  Block& block = blocks_[spare];
+  block.zone = zone;
+  block.index = index;
+  block.refs = 1;
+  block.lastUse = useCounter_++;
+#if defined(__STK_REALTIME__)
+  block.state.store( BLOCK_REQUESTED, std::memory_order_release );
+#else
+  StkFrames buffer;
+  this->loadBlock( block, buffer );
+  block.state.store( BLOCK_READY, std::memory_order_release );
+#endif
+
+  return spare;
+}
+
+void DiskSampler :: releaseBlock( int slot )
+{
+  blocks_[slot].refs--;
+  blocks_[slot].lastUse = useCounter_++;
+}
+
+void DiskSampler :: loadBlock( Block& block, StkFrames& buffer )
+{
+  Zone *zone = block.zone;
+
+  // Read the block plus one guard frame, except at the end of the file.
+  unsigned long start = zone->headFrames + block.index * blockFrames_;
+  unsigned long nFrames = blockFrames_ + 1;
+  if ( start + nFrames > zone->size ) nFrames = zone->size - start;
+
+  buffer.resize( nFrames, zone->file.channels() );
+#if defined(__STK_REALTIME__)
+  zone->mutex.lock();
+#endif
+  try {
+    zone->file.read( buffer, start, true );
+  }
+  catch ( StkError & ) {
+    // There is no one to report to here ... play the block as silence.
+    for ( size_t i=0; i<buffer.size(); i++ ) buffer[i] = 0.0;
+  }
+#if defined(__STK_REALTIME__)
+  zone->mutex.unlock();
+#endif
+
+  block.data.resize( nFrames, 1 );
+  mixDown( buffer, block.data );
+}
+
+void DiskSampler :: readBlocks( void )
+{
+#if defined(__STK_REALTIME__)
+  StkFrames buffer;
+  while ( running_.load( std::memory_order_acquire ) ) {
+    bool loaded = false;
+    for ( unsigned int i=0; i<nBlocks_; i++ ) {
+      int state = BLOCK_REQUESTED;
+      if ( !blocks_[i].state.compare_exchange_strong( state, BLOCK_LOADING, std::memory_order_acq_rel ) )
+        continue;
+      this->loadBlock( blocks_[i], buffer );
+      blocks_[i].state.store( BLOCK_READY, std::memory_order_release );
+      loaded = true;
+    }
+
+    if ( !loaded ) Stk::sleep( 1 );
+  }
+#endif
+}
+
+} // stk namespace
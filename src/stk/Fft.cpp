@@ -0,0 +1,158 @@
+/***************************************************/
+/*! \class Fft
+    \brief STK real fast Fourier transform class.
+
+    This class computes the discrete Fourier transform of a block of
+    real values, and its inverse, for block sizes that are powers of
+    two.  It needs no external library.  A real transform of size N
+    is computed as a complex transform of size N/2, using an
+    iterative radix-2 algorithm with precomputed twiddle factors and
+    bit-reversal indices.
+
+    A spectrum is given by its N/2 + 1 non-negative frequency bins,
+    with the real and imaginary parts in separate arrays.  The
+    forward transform is not scaled and the inverse transform is
+    scaled by 1/N, so that one undoes the other.
+*/
+/***************************************************/
+
+#include "Fft.h"
+#include <cmath>
+
+namespace stk {
+
+Fft :: Fft( unsigned int size )
+  : size_( 0 )
+{
+  this->setSize( size );
+}
+
+Fft :: ~Fft( void )
+{
+}
+
+void Fft :: setSize( unsigned int size )
+{
+  if ( size < 2 || ( size & ( size - 1 ) ) ) {
+    oStream_ << "Fft::setSize: size (" << size << ") must be a power of two greater than 1!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  if ( size == size_ ) return;
+  size_ = size;
+
+  unsigned int i, half = size_ / 2, bits = 0;
+  while ( ( 1u << bits ) < half ) bits++;
+
+  bitReverse_.resize( half );
+  for ( i=0; i<half; i++ ) {
+    unsigned int reversed = 0;
+    for ( unsigned int b=0; b<bits; b++ )
+      if ( i & ( 1u << b ) ) reversed |= 1u << ( bits - 1 - b );
+    bitReverse_[i] = reversed;
+  }
+
+  // The twiddle factors of the stage combining transforms of m points
+  // are stored contiguously from index m - 1.
+  const double twoPi = 8.0 * std::atan( 1.0 );
+  cosine_.resize( half );
+  sine_.resize( half );
+  for ( unsigned int m=1; m<half; m*=2 ) {
+    for ( i=0; i<m; i++ ) {
+      cosine_[m-1+i] = std::cos( twoPi * i / ( 2 * m ) );
+      sine_[m-1+i] = std::sin( twoPi * i / ( 2 * m ) );
+    }
+  }
+
+  // Factors to split the half-size complex transform into the real one.
+  twiddleCos_.resize( half + 1 );
+  twiddleSin_.resize( half + 1 );
+  for ( i=0; i<=half; i++ ) {
+    twiddleCos_[i] = std::cos( twoPi * i / size_ );
+    twiddleSin_[i] = std::sin( twoPi * i / size_ );
+  }
+
+  workReal_.resize( half );
+  workImag_.resize( half );
+}
+
+void Fft :: transform( StkFloat *real, StkFloat *imag, bool inverse )
+{
+  unsigned int i, j, k, half = size_ / 2;
+  for ( i=0; i<half; i++ ) {
+    j = bitReverse_[i];
+    if ( j > i ) {
+      StkFloat temp = real[i]; real[i] = real[j]; real[j] = temp;
+      temp = imag[i]; imag[i] = imag[j]; imag[j] = temp;
+    }
+  }
+
+  StkFloat sign = inverse ? 1.0 : -1.0;
+  for ( unsigned int m=1; m<half; m*=2 ) {
+    const StkFloat *wr = &cosine_[m-1];
+    const StkFloat *wi = &sine_[m-1];
+    for ( i=0; i<half; i+=2*m ) {
+      StkFloat *ar = &real[i], *ai = &imag[i];
+      StkFloat *br = &real[i+m], *bi = &imag[i+m];
+      for ( k=0; k<m; k++ ) {
+        StkFloat tr = wr[k] * br[k] - sign * wi[k] * bi[k];
+        StkFloat ti = wr[k] * bi[k] + sign * wi[k] * br[k];
+        br[k] = ar[k] - tr;
+        bi[k] = ai[k] - ti;
+        ar[k] += tr;
+        ai[k] += ti;
+      }
+    }
+  }
+}
+
+void Fft :: forward( const StkFloat *input, StkFloat *real, StkFloat *imag )
+{
+  unsigned int k, half = size_ / 2;
+  StkFloat *zr = &workReal_[0], *zi = &workImag_[0];
+  for ( k=0; k<half; k++ ) {
+    zr[k] = input[2*k];
+    zi[k] = input[2*k+1];
+  }
+  this->transform( zr, zi, false );
+
+  // Separate the transforms of the even and odd inputs, Z = E + iO,
+  // and combine them as X[k] = E[k] + W^k O[k].
+  for ( k=0; k<=half; k++ ) {
+    unsigned int k1 = ( k == half ) ? 0 : k;
+    unsigned int k2 = ( k == 0 ) ? 0 : half - k;
+    StkFloat er = 0.5 * ( zr[k1] + zr[k2] );
+    StkFloat ei = 0.5 * ( zi[k1] - zi[k2] );
+    StkFloat or_ = 0.5 * ( zi[k1] + zi[k2] );
+    StkFloat oi = -0.5 * ( zr[k1] - zr[k2] );
+    real[k] = er + twiddleCos_[k] * or_ + twiddleSin_[k] * oi;
+    imag[k] = ei + twiddleCos_[k] * oi - twiddleSin_[k] * or_;
+  }
+}
+
+void Fft :: inverse( const StkFloat *real, const StkFloat *imag, StkFloat *output )
+{
+  unsigned int k, half = size_ / 2;
+  StkFloat *zr = &workReal_[0], *zi = &workImag_[0];
+
+  // Recover E[k] and O[k] from X[k] and X[N/2-k] and form Z = E + iO.
+  for ( k=0; k<half; k++ ) {
+    StkFloat xr = real[k], xi = ( k == 0 ) ? 0.0 : imag[k];
+    StkFloat yr = real[half-k], yi = ( k == 0 ) ? 0.0 : -imag[half-k];
+    StkFloat er = 0.5 * ( xr + yr ), ei = 0.5 * ( xi + yi );
+    StkFloat dr = 0.5 * ( xr - yr ), di = 0.5 * ( xi - yi );
+    StkFloat or_ = dr * twiddleCos_[k] - di * twiddleSin_[k];
+    StkFloat oi = dr * twiddleSin_[k] + di * twiddleCos_[k];
+    zr[k] = er - oi;
+    zi[k] = ei + or_;
+  }
+  this->transform( zr, zi, true );
+
+  StkFloat scale = 1.0 / half;
+  for ( k=0; k<half; k++ ) {
+    output[2*k] = zr[k] * scale;
+    output[2*k+1] = zi[k] * scale;
+  }
+}
+
+} // stk namespace
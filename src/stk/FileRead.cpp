@@ -9,6 +9,10 @@
     passed to the read() function.  This class
     does not store its own copy of the file data,
     rather the data is read directly from disk.
+    Where the operating system supports it, the
+    file is memory-mapped when opened and read()
+    converts samples straight from the mapped
+    pages, without a system call per read.
 
     FileRead currently supports uncompressed WAV,
     AIFF/AIFC, SND (AU), MAT-file (Matlab), and
@@ -38,28 +42,35 @@
 #include <cmath>
 #include <cstdio>
 
+#if !defined(__OS_WINDOWS__) && !defined(_WIN32)
+  #include <sys/mman.h>
+  #define __FILEREAD_MMAP__
+#endif
+
 namespace stk {
 
 FileRead :: FileRead()
-  : fd_(0), fileSize_(0), channels_(0), dataType_(0), fileRate_(0.0)
+  : fd_(0), map_(0), mapLength_(0), fileSize_(0), channels_(0), dataType_(0), fileRate_(0.0)
 {
 }
 
 FileRead :: FileRead( std::string fileName, bool typeRaw, unsigned int nChannels,
                       StkFormat format, StkFloat rate )
-  : fd_(0)
+  : fd_(0), map_(0), mapLength_(0)
 {
   open( fileName, typeRaw, nChannels, format, rate );
 }
 
 FileRead :: ~FileRead()
 {
+  unmapFile();
   if ( fd_ )
     fclose( fd_ );
 }
 
 void FileRead :: close( void )
 {
+  unmapFile();
   if ( fd_ ) fclose( fd_ );
   fd_ = 0;
   wavFile_ = false;
@@ -126,6 +137,7 @@ void FileRead :: open( std::string fileName, bool typeRaw, unsigned int nChannel
     handleError( StkError::FILE_ERROR );
   }
 
+  mapFile();
   return;
 
  error:
@@ -744,6 +756,12 @@ void FileRead :: read( StkFrames& buffer, unsigned long startFrame, bool doNorma
   long i, nSamples = (long) ( nFrames * channels_ );
   unsigned long offset = startFrame * channels_;
 
+  if ( map_ ) {
+    if ( !readMapped( buffer, offset, nSamples, doNormalize ) ) goto error;
+    buffer.setDataRate( fileRate_ );
+    return;
+  }
+
   // Read samples into StkFrames data buffer.
   if ( dataType_ == STK_SINT16 ) {
     SINT16 *buf = (SINT16 *) &buffer[0];
@@ -883,4 +901,184 @@ void FileRead :: read( StkFrames& buffer, unsigned long startFrame, bool doNorma
   handleError( StkError::FILE_ERROR);
 }
 
+void FileRead :: mapFile( void )
+{
+#if defined(__FILEREAD_MMAP__)
+  struct stat filestat;
+  if ( fstat( fileno( fd_ ), &filestat ) == -1 || filestat.st_size <= 0 ) return;
+
+  // If the file cannot be mapped, read() falls back to stdio.
+  void *map = mmap( 0, (size_t) filestat.st_size, PROT_READ, MAP_SHARED, fileno( fd_ ), 0 );
+  if ( map == MAP_FAILED ) return;
+
+  map_ = (unsigned char *) map;
+  mapLength_ = (size_t) filestat.st_size;
+#endif
+}
+
+void FileRead :: unmapFile( void )
+{
+#if defined(__FILEREAD_MMAP__)
+  if ( map_ ) munmap( map_, mapLength_ );
+#endif
+  map_ = 0;
+  mapLength_ = 0;
+}
+
+const void *FileRead :: data( void ) const
+{
+  if ( map_ == 0 ) return 0;
+  return map_ + dataOffset_;
+}
+
+// Sample conversion kernels for mapped file data.  The file byte
+// order is chosen once per call rather than per sample, and samples
+// are assembled from bytes so that the loops are branch-free and
+// unaffected by alignment, which lets the compiler vectorize them.
+
+static void convertSint16( const unsigned char *in, StkFloat *out, long n,
+                           bool bigEndian, StkFloat gain )
+{
+  long i;
+  if ( bigEndian ) {
+    for ( i=0; i<n; i++, in+=2 )
+      out[i] = (SINT16) ( ( in[0] << 8 ) | in[1] ) * gain;
+  }
+  else {
+    for ( i=0; i<n; i++, in+=2 )
+      out[i] = (SINT16) ( in[0] | ( in[1] << 8 ) ) * gain;
+  }
+}
+
+// 24-bit samples are placed in the top of a 32-bit word, so a gain of
+// 1 / 2^31 normalizes them and 1 / 2^8 returns the integer value.
+static void convertSint24( const unsigned char *in, StkFloat *out, long n,
+                           bool bigEndian, StkFloat gain )
+{
+  long i;
+  if ( bigEndian ) {
+    for ( i=0; i<n; i++, in+=3 )
+      out[i] = (SINT32) ( ( (unsigned long) in[0] << 24 ) | ( in[1] << 16 ) | ( in[2] << 8 ) ) * gain;
+  }
+  else {
+    for ( i=0; i<n; i++, in+=3 )
+      out[i] = (SINT32) ( ( (unsigned long) in[2] << 24 ) | ( in[1] << 16 ) | ( in[0] << 8 ) ) * gain;
+  }
+}
+
+static inline unsigned int loadWord32( const unsigned char *in, bool bigEndian )
+{
+  if ( bigEndian )
+    return ( (unsigned int) in[0] << 24 ) | ( in[1] << 16 ) | ( in[2] << 8 ) | in[3];
+  return ( (unsigned int) in[3] << 24 ) | ( in[2] << 16 ) | ( in[1] << 8 ) | in[0];
+}
+
+static void convertSint32( const unsigned char *in, StkFloat *out, long n,
+                           bool bigEndian, StkFloat gain )
+{
+  long i;
+  if ( bigEndian ) {
+    for ( i=0; i<n; i++, in+=4 )
+      out[i] = (SINT32) loadWord32( in, true ) * gain;
+  }
+  else {
+    for ( i=0; i<n; i++, in+=4 )
+      out[i] = (SINT32) loadWord32( in, false ) * gain;
+  }
+}
+
+static void convertFloat32( const unsigned char *in, StkFloat *out, long n, bool bigEndian )
+{
+  long i;
+  unsigned int word;
+  FLOAT32 value;
+  if ( bigEndian ) {
+    for ( i=0; i<n; i++, in+=4 ) {
+      word = loadWord32( in, true );
+      memcpy( &value, &word, 4 );
+      out[i] = value;
+    }
+  }
+  else {
+    for ( i=0; i<n; i++, in+=4 ) {
+      word = loadWord32( in, false );
+      memcpy( &value, &word, 4 );
+      out[i] = value;
+    }
+  }
+}
+
+static void convertFloat64( const unsigned char *in, StkFloat *out, long n, bool bigEndian )
+{
+#ifdef __LITTLE_ENDIAN__
+  bool swap = bigEndian;
+#else
+  bool swap = !bigEndian;
+#endif
+  unsigned char bytes[8];
+  FLOAT64 value;
+  long i;
+  if ( swap ) {
+    for ( i=0; i<n; i++, in+=8 ) {
+      for ( int j=0; j<8; j++ ) bytes[j] = in[7-j];
+      memcpy( &value, bytes, 8 );
+      out[i] = value;
+    }
+  }
+  else {
+    for ( i=0; i<n; i++, in+=8 ) {
+      memcpy( &value, in, 8 );
+      out[i] = value;
+    }
+  }
+}
+
+bool FileRead :: readMapped( StkFrames& buffer, unsigned long offset, long nSamples, bool doNormalize )
+{
+  unsigned int sampleBytes = 0;
+  if ( dataType_ == STK_SINT8 ) sampleBytes = 1;
+  else if ( dataType_ == STK_SINT16 ) sampleBytes = 2;
+  else if ( dataType_ == STK_SINT24 ) sampleBytes = 3;
+  else if ( dataType_ == STK_SINT32 || dataType_ == STK_FLOAT32 ) sampleBytes = 4;
+  else if ( dataType_ == STK_FLOAT64 ) sampleBytes = 8;
+
+  // Guard against headers that claim more data than the file holds.
+  if ( dataOffset_ + ( offset + nSamples ) * sampleBytes > mapLength_ ) return false;
+
+  const unsigned char *in = map_ + dataOffset_ + offset * sampleBytes;
+  StkFloat *out = &buffer[0];
+  long i;
+
+  // The byteswap_ flag is relative to the host, so recover the file byte order.
+#ifdef __LITTLE_ENDIAN__
+  bool bigEndian = byteswap_;
+#else
+  bool bigEndian = !byteswap_;
+#endif
+
+  if ( dataType_ == STK_SINT16 )
+    convertSint16( in, out, nSamples, bigEndian, doNormalize ? 1.0 / 32768.0 : 1.0 );
+  else if ( dataType_ == STK_SINT24 )
+    convertSint24( in, out, nSamples, bigEndian, doNormalize ? 1.0 / 2147483648.0 : 1.0 / 256.0 );
+  else if ( dataType_ == STK_SINT32 )
+    convertSint32( in, out, nSamples, bigEndian, doNormalize ? 1.0 / 2147483648.0 : 1.0 );
+  else if ( dataType_ == STK_FLOAT32 )
+    convertFloat32( in, out, nSamples, bigEndian );
+  else if ( dataType_ == STK_FLOAT64 )
+    convertFloat64( in, out, nSamples, bigEndian );
+  else if ( dataType_ == STK_SINT8 && wavFile_ ) { // 8-bit WAV data is unsigned!
+    StkFloat gain = doNormalize ? 1.0 / 128.0 : 1.0;
+    for ( i=0; i<nSamples; i++ )
+      out[i] = ( in[i] - 128 ) * gain;
+  }
+  else if ( dataType_ == STK_SINT8 ) {
+    StkFloat gain = doNormalize ? 1.0 / 128.0 : 1.0;
+    for ( i=0; i<nSamples; i++ )
+      out[i] = (signed char) in[i] * gain;
+  }
+  else return false;
+
+  return true;
+}
+
 } // stk namespace
@@ -100,14 +100,21 @@ struct MatHeader {
   // There's more, but it's of variable length
 };
 
+// Samples are converted and written in blocks of this size.
+const unsigned long STAGING_SAMPLES = 8192;
+
 FileWrite :: FileWrite()
-  : fd_( 0 )
+  : fd_( 0 ), dither_( false ), ditherSeed_( 22222 )
 {
+  scaled_.resize( STAGING_SAMPLES );
+  staging_.resize( STAGING_SAMPLES * 8 );
 }
 
 FileWrite::FileWrite( std::string fileName, unsigned int nChannels, FILE_TYPE type, Stk::StkFormat format )
-  : fd_( 0 )
+  : fd_( 0 ), dither_( false ), ditherSeed_( 22222 )
 {
+  scaled_.resize( STAGING_SAMPLES );
+  staging_.resize( STAGING_SAMPLES * 8 );
   this->open( fileName, nChannels, type, format );
 }
 
@@ -704,84 +711,235 @@ void FileWrite :: closeMatFile( void )
   fclose(fd_);
 }
 
-void FileWrite :: write( StkFrames& buffer )
+// Sample packing kernels.  Each clamps a block of scaled samples to
+// the output range and stores them in the file byte order, which is
+// chosen once per block, so the loops have no per-sample branches and
+// can be vectorized by the compiler.
+
+static void packSint8( const StkFloat *in, unsigned char *out, unsigned long n,
+                       StkFloat low, StkFloat high )
 {
-  if ( fd_ == 0 ) {
-    oStream_ << "FileWrite::write(): a file has not yet been opened!";
-    handleError( StkError::WARNING );
-    return;
+  for ( unsigned long i=0; i<n; i++ ) {
+    StkFloat value = in[i] < low ? low : ( in[i] > high ? high : in[i] );
+    out[i] = (unsigned char) (int) value;
   }
+}
 
-  if ( buffer.channels() != channels_ ) {
-    oStream_ << "FileWrite::write(): number of channels in the StkFrames argument does not match that specified to open() function!";
-    handleError( StkError::FUNCTION_ARGUMENT );
-    return;
+static void packSint16( const StkFloat *in, unsigned char *out, unsigned long n, bool bigEndian )
+{
+  unsigned long i;
+  if ( bigEndian ) {
+    for ( i=0; i<n; i++, out+=2 ) {
+      StkFloat value = in[i] < -32768.0 ? -32768.0 : ( in[i] > 32767.0 ? 32767.0 : in[i] );
+      SINT32 sample = (SINT32) value;
+      out[0] = (unsigned char) ( sample >> 8 );
+      out[1] = (unsigned char) sample;
+    }
+  }
+  else {
+    for ( i=0; i<n; i++, out+=2 ) {
+      StkFloat value = in[i] < -32768.0 ? -32768.0 : ( in[i] > 32767.0 ? 32767.0 : in[i] );
+      SINT32 sample = (SINT32) value;
+      out[0] = (unsigned char) sample;
+      out[1] = (unsigned char) ( sample >> 8 );
+    }
   }
+}
 
-  unsigned long nSamples = buffer.size();
-  if ( dataType_ == STK_SINT16 ) {
-    SINT16 sample;
-    for ( unsigned long k=0; k<nSamples; k++ ) {
-      sample = (SINT16) (buffer[k] * 32767.0);
-      //sample = ((SINT16) (( buffer[k] + 1.0 ) * 32767.5 + 0.5)) - 32768;
-      if ( byteswap_ ) swap16( (unsigned char *)&sample );
-      if ( fwrite(&sample, 2, 1, fd_) != 1 ) goto error;
+static void packSint24( const StkFloat *in, unsigned char *out, unsigned long n, bool bigEndian )
+{
+  unsigned long i;
+  if ( bigEndian ) {
+    for ( i=0; i<n; i++, out+=3 ) {
+      StkFloat value = in[i] < -8388608.0 ? -8388608.0 : ( in[i] > 8388607.0 ? 8388607.0 : in[i] );
+      SINT32 sample = (SINT32) value;
+      out[0] = (unsigned char) ( sample >> 16 );
+      out[1] = (unsigned char) ( sample >> 8 );
+      out[2] = (unsigned char) sample;
+    }
+  }
+  else {
+    for ( i=0; i<n; i++, out+=3 ) {
+      StkFloat value = in[i] < -8388608.0 ? -8388608.0 : ( in[i] > 8388607.0 ? 8388607.0 : in[i] );
+      SINT32 sample = (SINT32) value;
+      out[0] = (unsigned char) sample;
+      out[1] = (unsigned char) ( sample >> 8 );
+      out[2] = (unsigned char) ( sample >> 16 );
     }
   }
+}
+
+static inline void storeWord32( unsigned int word, unsigned char *out, bool bigEndian )
+{
+  if ( bigEndian ) {
+    out[0] = (unsigned char) ( word >> 24 );
+    out[1] = (unsigned char) ( word >> 16 );
+    out[2] = (unsigned char) ( word >> 8 );
+    out[3] = (unsigned char) word;
+  }
+  else {
+    out[0] = (unsigned char) word;
+    out[1] = (unsigned char) ( word >> 8 );
+    out[2] = (unsigned char) ( word >> 16 );
+    out[3] = (unsigned char) ( word >> 24 );
+  }
+}
+
+static void packSint32( const StkFloat *in, unsigned char *out, unsigned long n, bool bigEndian )
+{
+  unsigned long i;
+  if ( bigEndian ) {
+    for ( i=0; i<n; i++, out+=4 ) {
+      StkFloat value = in[i] < -2147483648.0 ? -2147483648.0 : ( in[i] > 2147483647.0 ? 2147483647.0 : in[i] );
+      storeWord32( (unsigned int) (SINT32) value, out, true );
+    }
+  }
+  else {
+    for ( i=0; i<n; i++, out+=4 ) {
+      StkFloat value = in[i] < -2147483648.0 ? -2147483648.0 : ( in[i] > 2147483647.0 ? 2147483647.0 : in[i] );
+      storeWord32( (unsigned int) (SINT32) value, out, false );
+    }
+  }
+}
+
+static void packFloat32( const StkFloat *in, unsigned char *out, unsigned long n, bool bigEndian )
+{
+  unsigned long i;
+  unsigned int word;
+  FLOAT32 value;
+  if ( bigEndian ) {
+    for ( i=0; i<n; i++, out+=4 ) {
+      value = (FLOAT32) in[i];
+      memcpy( &word, &value, 4 );
+      storeWord32( word, out, true );
+    }
+  }
+  else {
+    for ( i=0; i<n; i++, out+=4 ) {
+      value = (FLOAT32) in[i];
+      memcpy( &word, &value, 4 );
+      storeWord32( word, out, false );
+    }
+  }
+}
+
+static void packFloat64( const StkFloat *in, unsigned char *out, unsigned long n, bool swap )
+{
+  unsigned long i;
+  unsigned char bytes[8];
+  FLOAT64 value;
+  if ( swap ) {
+    for ( i=0; i<n; i++, out+=8 ) {
+      value = (FLOAT64) in[i];
+      memcpy( bytes, &value, 8 );
+      for ( int j=0; j<8; j++ ) out[j] = bytes[7-j];
+    }
+  }
+  else {
+    for ( i=0; i<n; i++, out+=8 ) {
+      value = (FLOAT64) in[i];
+      memcpy( out, &value, 8 );
+    }
+  }
+}
+
+static inline unsigned long xorshift32( unsigned long& seed )
+{
+  seed ^= ( seed << 13 ) & 0xffffffffUL;
+  seed ^= seed >> 17;
+  seed ^= ( seed << 5 ) & 0xffffffffUL;
+  return seed;
+}
+
+void FileWrite :: scaleBlock( const StkFloat *samples, unsigned long nSamples, StkFloat gain, StkFloat offset )
+{
+  unsigned long i;
+  if ( dither_ ) {
+    // Sum two uniform variates in [0, 1) from a 32-bit xorshift generator.
+    const StkFloat scale = 1.0 / 4294967296.0;
+    unsigned long seed = ditherSeed_;
+    for ( i=0; i<nSamples; i++ ) {
+      StkFloat noise = xorshift32( seed );
+      noise = ( noise - xorshift32( seed ) ) * scale;
+      scaled_[i] = floor( samples[i] * gain + offset + noise + 0.5 );
+    }
+    ditherSeed_ = seed;
+  }
+  else {
+    for ( i=0; i<nSamples; i++ )
+      scaled_[i] = samples[i] * gain + offset;
+  }
+}
+
+bool FileWrite :: writeBlock( const StkFloat *samples, unsigned long nSamples )
+{
+  // The byteswap_ flag is relative to the host, so recover the file byte order.
+#ifdef __LITTLE_ENDIAN__
+  bool bigEndian = byteswap_;
+#else
+  bool bigEndian = !byteswap_;
+#endif
+
+  StkFloat *scaled = &scaled_[0];
+  unsigned char *staging = &staging_[0];
+  unsigned long nBytes = 0;
+  if ( dataType_ == STK_SINT16 ) {
+    this->scaleBlock( samples, nSamples, 32767.0, 0.0 );
+    packSint16( scaled, staging, nSamples, bigEndian );
+    nBytes = nSamples * 2;
+  }
   else if ( dataType_ == STK_SINT8 ) {
     if ( fileType_ == FILE_WAV ) { // 8-bit WAV data is unsigned!
-      unsigned char sample;
-      for ( unsigned long k=0; k<nSamples; k++ ) {
-        sample = (unsigned char) (buffer[k] * 127.0 + 128.0);
-        if ( fwrite(&sample, 1, 1, fd_) != 1 ) goto error;
-      }
+      this->scaleBlock( samples, nSamples, 127.0, 128.0 );
+      packSint8( scaled, staging, nSamples, 0.0, 255.0 );
     }
     else {
-      signed char sample;
-      for ( unsigned long k=0; k<nSamples; k++ ) {
-        sample = (signed char) (buffer[k] * 127.0);
-        //sample = ((signed char) (( buffer[k] + 1.0 ) * 127.5 + 0.5)) - 128;
-        if ( fwrite(&sample, 1, 1, fd_) != 1 ) goto error;
-      }
+      this->scaleBlock( samples, nSamples, 127.0, 0.0 );
+      packSint8( scaled, staging, nSamples, -128.0, 127.0 );
     }
+    nBytes = nSamples;
   }
   else if ( dataType_ == STK_SINT32 ) {
-    SINT32 sample;
-    for ( unsigned long k=0; k<nSamples; k++ ) {
-      sample = (SINT32) (buffer[k] * 2147483647.0);
-      //sample = ((SINT32) (( buffer[k] + 1.0 ) * 2147483647.5 + 0.5)) - 2147483648;
-      if ( byteswap_ ) swap32( (unsigned char *)&sample );
-      if ( fwrite(&sample, 4, 1, fd_) != 1 ) goto error;
-    }
+    this->scaleBlock( samples, nSamples, 2147483647.0, 0.0 );
+    packSint32( scaled, staging, nSamples, bigEndian );
+    nBytes = nSamples * 4;
+  }
+  else if ( dataType_ == STK_SINT24 ) {
+    this->scaleBlock( samples, nSamples, 8388607.0, 0.0 );
+    packSint24( scaled, staging, nSamples, bigEndian );
+    nBytes = nSamples * 3;
   }
   else if ( dataType_ == STK_FLOAT32 ) {
-    FLOAT32 sample;
-    for ( unsigned long k=0; k<nSamples; k++ ) {
-      sample = (FLOAT32) (buffer[k]);
-      if ( byteswap_ ) swap32( (unsigned char *)&sample );
-      if ( fwrite(&sample, 4, 1, fd_) != 1 ) goto error;
-    }
+    packFloat32( samples, staging, nSamples, bigEndian );
+    nBytes = nSamples * 4;
   }
   else if ( dataType_ == STK_FLOAT64 ) {
-    FLOAT64 sample;
-    for ( unsigned long k=0; k<nSamples; k++ ) {
-      sample = (FLOAT64) (buffer[k]);
-      if ( byteswap_ ) swap64( (unsigned char *)&sample );
-      if ( fwrite(&sample, 8, 1, fd_) != 1 ) goto error;
-    }
+    packFloat64( samples, staging, nSamples, byteswap_ );
+    nBytes = nSamples * 8;
   }
-  else if ( dataType_ == STK_SINT24 ) {
-    SINT32 sample;
-    for ( unsigned long k=0; k<nSamples; k++ ) {
-      sample = (SINT32) (buffer[k] * 8388607.0);
-      if ( byteswap_ ) {
-        swap32( (unsigned char *)&sample );
-        unsigned char *ptr = (unsigned char *) &sample;
-        if ( fwrite(ptr+1, 3, 1, fd_) != 1 ) goto error;
-      }
-      else
-        if ( fwrite(&sample, 3, 1, fd_) != 1 ) goto error;
-    }
+
+  return fwrite( staging, nBytes, 1, fd_ ) == 1;
+}
+
+void FileWrite :: write( StkFrames& buffer )
+{
+  if ( fd_ == 0 ) {
+    oStream_ << "FileWrite::write(): a file has not yet been opened!";
+    handleError( StkError::WARNING );
+    return;
+  }
+
+  if ( buffer.channels() != channels_ ) {
+    oStream_ << "FileWrite::write(): number of channels in the StkFrames argument does not match that specified to open() function!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+    return;
+  }
+
+  unsigned long nSamples = buffer.size();
+  for ( unsigned long k=0; k<nSamples; k+=STAGING_SAMPLES ) {
+    unsigned long n = nSamples - k;
+    if ( n > STAGING_SAMPLES ) n = STAGING_SAMPLES;
+    if ( !this->writeBlock( &buffer[k], n ) ) goto error;
   }
 
   frameCounter_ += buffer.frames();
@@ -19,7 +19,11 @@
     This behavior is controlled by the optional constructor arguments
     \e chunkThreshold and \e chunkSize.  File sizes greater than \e
     chunkThreshold (in sample frames) will be read incrementally in
-    chunks of \e chunkSize each (also in sample frames).
+    chunks of \e chunkSize each (also in sample frames).  In realtime
+    builds, chunks are read ahead of the playhead by a background disk
+    thread so that tick() never waits on file access.  If a chunk has
+    not arrived by the time it is needed, silence is output and the
+    event is counted (see getUnderruns()).
 
     When the file end is reached, subsequent calls to the tick()
     functions return zeros and isFinished() returns \e true.
@@ -36,18 +40,35 @@
 
 namespace stk {
 
+#if defined(__STK_REALTIME__)
+
+extern "C" THREAD_RETURN THREAD_TYPE readAheadThread( void * ptr )
+{
+  ((FileWvIn *) ptr)->readAhead();
+  return 0;
+}
+
+#endif
+
 FileWvIn :: FileWvIn( unsigned long chunkThreshold, unsigned long chunkSize )
   : finished_(true), interpolate_(false), time_(0.0), rate_(0.0),
-    chunkThreshold_(chunkThreshold), chunkSize_(chunkSize)
+    chunkThreshold_(chunkThreshold), chunkSize_(chunkSize), missedChunk_(-1), underruns_(0)
 {
+#if defined(__STK_REALTIME__)
+  streaming_ = false;
+#endif
+
   Stk::addSampleRateAlert( this );
 }
 
 FileWvIn :: FileWvIn( std::string fileName, bool raw, bool doNormalize,
                       unsigned long chunkThreshold, unsigned long chunkSize )
   : finished_(true), interpolate_(false), time_(0.0), rate_(0.0),
-    chunkThreshold_(chunkThreshold), chunkSize_(chunkSize)
+    chunkThreshold_(chunkThreshold), chunkSize_(chunkSize), missedChunk_(-1), underruns_(0)
 {
+#if defined(__STK_REALTIME__)
+  streaming_ = false;
+#endif
   openFile( fileName, raw, doNormalize );
   Stk::addSampleRateAlert( this );
 }
@@ -66,6 +87,9 @@ void FileWvIn :: sampleRateChanged( StkFloat newRate, StkFloat oldRate )
 
 void FileWvIn :: closeFile( void )
 {
+#if defined(__STK_REALTIME__)
+  this->stopStream();
+#endif
   if ( file_.isOpen() ) file_.close();
   finished_ = true;
   lastFrame_.resize( 0, 0 );
@@ -104,8 +128,148 @@ void FileWvIn :: openFile( std::string fileName, bool raw, bool doNormalize )
   if ( doNormalize & !chunking_ ) this->normalize();
 
   this->reset();
+  underruns_ = 0;
+  missedChunk_ = -1;
+
+#if defined(__STK_REALTIME__)
+  if ( chunking_ ) this->startStream();
+#endif
+}
+
+long FileWvIn :: nextChunk( long pointer, bool forward ) const
+{
+  if ( forward ) {
+    pointer += chunkSize_ - 1; // overlap chunks by one frame
+    if ( pointer + chunkSize_ > file_.fileSize() ) // at end of file
+      pointer = file_.fileSize() - chunkSize_;
+  }
+  else {
+    pointer -= chunkSize_ - 1; // overlap chunks by one frame
+    if ( pointer < 0 ) pointer = 0;
+  }
+
+  return pointer;
+}
+
+#if defined(__STK_REALTIME__)
+
+void FileWvIn :: startStream( void )
+{
+  for ( unsigned int i=0; i<STREAM_CHUNKS; i++ ) {
+    chunks_[i].data.resize( chunkSize_, file_.channels() );
+    chunks_[i].start = -1;
+    chunks_[i].state = CHUNK_FREE;
+  }
+
+  // From here on, file_ is only accessed by the disk thread.
+  streaming_ = true;
+  if ( !thread_.start( &readAheadThread, this ) ) {
+    streaming_ = false;
+    oStream_ << "FileWvIn::openFile(): unable to start disk thread ... reading chunks synchronously!";
+    handleError( StkError::WARNING );
+    return;
+  }
+
+  this->requestChunks( this->nextChunk( chunkPointer_, rate_ >= 0.0 ) );
+}
+
+void FileWvIn :: stopStream( void )
+{
+  if ( !streaming_ ) return;
+
+  streaming_ = false;
+  thread_.wait();
+}
+
+void FileWvIn :: readAhead( void )
+{
+  while ( streaming_.load( std::memory_order_acquire ) ) {
+    bool loaded = false;
+    for ( unsigned int i=0; i<STREAM_CHUNKS; i++ ) {
+      StreamChunk& chunk = chunks_[i];
+      if ( chunk.state.load( std::memory_order_acquire ) != CHUNK_REQUESTED ) continue;
+      try {
+        file_.read( chunk.data, chunk.start, normalizing_ );
+      }
+      catch ( StkError & ) {
+        // There is no one to report to here ... play the chunk as silence.
+        for ( size_t j=0; j<chunk.data.size(); j++ ) chunk.data[j] = 0.0;
+      }
+      chunk.state.store( CHUNK_READY, std::memory_order_release );
+      loaded = true;
+    }
+
+    if ( !loaded ) Stk::sleep( 1 );
+  }
+}
+
+bool FileWvIn :: swapChunk( long pointer )
+{
+  StreamChunk *chunk = 0;
+  for ( unsigned int i=0; i<STREAM_CHUNKS; i++ ) {
+    if ( chunks_[i].state.load( std::memory_order_acquire ) != CHUNK_READY ) continue;
+    if ( time_ >= (StkFloat) chunks_[i].start &&
+         time_ <= (StkFloat) ( chunks_[i].start + chunkSize_ - 1 ) ) {
+      chunk = &chunks_[i];
+      break;
+    }
+  }
+
+  if ( !chunk ) {
+    this->requestChunks( pointer );
+    return false;
+  }
+
+  // Exchange the buffers rather than copying a chunk of samples.  The
+  // slot is left with the previous data and is free for reuse.
+  data_.swap( chunk->data );
+  chunkPointer_ = chunk->start;
+  chunk->start = -1;
+  chunk->state.store( CHUNK_FREE, std::memory_order_relaxed );
+  missedChunk_ = -1;
+
+  this->requestChunks( this->nextChunk( chunkPointer_, rate_ >= 0.0 ) );
+  return true;
 }
 
+void FileWvIn :: requestChunks( long pointer )
+{
+  // Work out which chunks we want, starting from pointer and moving
+  // in the current direction of play.
+  long wanted[STREAM_CHUNKS];
+  unsigned int i, j;
+  wanted[0] = pointer;
+  for ( i=1; i<STREAM_CHUNKS; i++ )
+    wanted[i] = this->nextChunk( wanted[i-1], rate_ >= 0.0 );
+
+  // Recycle any chunks we own that are no longer wanted.  Requested
+  // chunks belong to the disk thread until it marks them ready.
+  for ( i=0; i<STREAM_CHUNKS; i++ ) {
+    if ( chunks_[i].state.load( std::memory_order_acquire ) == CHUNK_REQUESTED ) continue;
+    for ( j=0; j<STREAM_CHUNKS; j++ )
+      if ( chunks_[i].start == wanted[j] ) break;
+    if ( j == STREAM_CHUNKS ) {
+      chunks_[i].start = -1;
+      chunks_[i].state.store( CHUNK_FREE, std::memory_order_relaxed );
+    }
+  }
+
+  // Hand the missing chunks to the disk thread, nearest first.
+  for ( i=0; i<STREAM_CHUNKS; i++ ) {
+    StreamChunk *spare = 0;
+    for ( j=0; j<STREAM_CHUNKS; j++ ) {
+      if ( chunks_[j].start == wanted[i] ) break;
+      if ( !spare && chunks_[j].state.load( std::memory_order_relaxed ) == CHUNK_FREE )
+        spare = &chunks_[j];
+    }
+    if ( j < STREAM_CHUNKS || !spare ) continue;
+    spare->start = wanted[i];
+    spare->state.store( CHUNK_REQUESTED, std::memory_order_release );
+  }
+}
+
+#endif
+
 void FileWvIn :: reset(void)
 {
   time_ = (StkFloat) 0.0;
@@ -189,18 +353,33 @@ StkFloat FileWvIn :: tick( unsigned int channel )
     if ( ( time_ < (StkFloat) chunkPointer_ ) ||
          ( time_ > (StkFloat) ( chunkPointer_ + chunkSize_ - 1 ) ) ) {
 
-      while ( time_ < (StkFloat) chunkPointer_ ) { // negative rate
-        chunkPointer_ -= chunkSize_ - 1; // overlap chunks by one frame
-        if ( chunkPointer_ < 0 ) chunkPointer_ = 0;
+      long pointer = chunkPointer_;
+      while ( time_ < (StkFloat) pointer ) // negative rate
+        pointer = this->nextChunk( pointer, false );
+      while ( time_ > (StkFloat) ( pointer + chunkSize_ - 1 ) ) // positive rate
+        pointer = this->nextChunk( pointer, true );
+
+#if defined(__STK_REALTIME__)
+      if ( streaming_ ) {
+        // Never wait on the disk thread ... output silence until the chunk arrives.
+        if ( !this->swapChunk( pointer ) ) {
+          // Count each chunk that is missed once, not each silent frame.
+          if ( pointer != missedChunk_ ) {
+            underruns_.fetch_add( 1, std::memory_order_relaxed );
+            missedChunk_ = pointer;
+          }
+          for ( unsigned int i=0; i<lastFrame_.size(); i++ ) lastFrame_[i] = 0.0;
+          time_ += rate_;
+          return lastFrame_[channel];
+        }
       }
-      while ( time_ > (StkFloat) ( chunkPointer_ + chunkSize_ - 1 ) ) { // positive rate
-        chunkPointer_ += chunkSize_ - 1; // overlap chunks by one frame
-        if ( chunkPointer_ + chunkSize_ > file_.fileSize() ) // at end of file
-          chunkPointer_ = file_.fileSize() - chunkSize_;
+      else
+#endif
+      {
+        // Load more data.
+        chunkPointer_ = pointer;
+        file_.read( data_, chunkPointer_, normalizing_ );
       }
-
-      // Load more data.
-      file_.read( data_, chunkPointer_, normalizing_ );
     }
 
     // Adjust index for the current buffer.
@@ -16,6 +16,14 @@
     This structure results in one extra multiply per computed sample,
     but allows easy control of the overall filter gain.
 
+    The input history is kept twice over in a circular buffer, so
+    that each output is a dot product over contiguous memory without
+    shifting the history, and the StkFrames tick() functions filter
+    a whole block at a time.  Filters with more than
+    PARTITION_THRESHOLD coefficients are computed by the Convolver
+    class with partitioned FFT convolution, which gives the same
+    output, up to rounding, at a much lower cost.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -29,8 +37,11 @@ Fir :: Fir()
 {
   // The default constructor should setup for pass-through.
   b_.push_back( 1.0 );
+  taps_.push_back( 1.0 );
+  index_ = 0;
+  partitioned_ = false;
 
-  inputs_.resize( 1, 1, 0.0 );
+  inputs_.resize( 2, 1, 0.0 );
 }
 
 Fir :: Fir( std::vector<StkFloat> &coefficients )
@@ -42,16 +53,21 @@ Fir :: Fir( std::vector<StkFloat> &coefficients )
   }
 
   gain_ = 1.0;
-  b_ = coefficients;
-
-  inputs_.resize( b_.size(), 1, 0.0 );
-  this->clear();
+  index_ = 0;
+  partitioned_ = false;
+  this->setCoefficients( coefficients, true );
 }
 
 Fir :: ~Fir()
 {
 }
 
+void Fir :: clear( void )
+{
+  Filter::clear();
+  if ( partitioned_ ) convolver_.clear();
+}
+
 void Fir :: setCoefficients( std::vector<StkFloat> &coefficients, bool clearState )
 {
   // Check the argument.
@@ -60,15 +76,51 @@ void Fir :: setCoefficients( std::vector<StkFloat> &coefficients, bool clearStat
     handleError( StkError::FUNCTION_ARGUMENT );
   }
 
+  // Long filters are handed to the convolver.  Either path starts
+  // from a cleared state when the filter switches over, since the
+  // other path's history was not kept up to date.
+  if ( coefficients.size() > PARTITION_THRESHOLD ) {
+    b_ = coefficients;
+    convolver_.setCoefficients( coefficients, clearState || !partitioned_ );
+    partitioned_ = true;
+    return;
+  }
+  bool switched = partitioned_;
+  partitioned_ = false;
+
   if ( b_.size() != coefficients.size() ) {
     b_ = coefficients;
-    inputs_.resize( b_.size(), 1, 0.0 );
+    inputs_.resize( 2 * b_.size(), 1, 0.0 );
+    index_ = 0;
   }
   else {
     for ( unsigned int i=0; i<b_.size(); i++ ) b_[i] = coefficients[i];
   }
+  taps_.assign( b_.rbegin(), b_.rend() );
 
-  if ( clearState ) this->clear();
+  if ( clearState || switched ) this->clear();
+}
+
+void Fir :: filterBlock( const StkFloat *iSamples, unsigned int iHop,
+                         StkFloat *oSamples, unsigned int oHop, unsigned int nFrames )
+{
+  // Lay out the last N - 1 inputs and the new ones contiguously, so
+  // that each output is a dot product starting one sample further on.
+  unsigned int i, n = taps_.size();
+  if ( block_.size() < n - 1 + nFrames ) block_.resize( n - 1 + nFrames );
+
+  StkFloat *block = &block_[0];
+  for ( i=0; i<n-1; i++ ) block[i] = inputs_[index_ + 2 + i];
+  for ( i=0; i<nFrames; i++ ) block[n-1+i] = gain_ * iSamples[i * iHop];
+
+  for ( i=0; i<nFrames; i++ )
+    oSamples[i * oHop] = dot( &taps_[0], &block[i], n );
+  lastFrame_[0] = oSamples[(nFrames-1) * oHop];
+
+  // Store the last N inputs back in the history, oldest first.
+  const StkFloat *last = &block[nFrames - 1];
+  for ( i=0; i<n; i++ ) inputs_[i] = inputs_[i + n] = last[i];
+  index_ = n - 1;
 }
 
 } // stk namespace
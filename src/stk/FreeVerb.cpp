@@ -10,6 +10,14 @@
     stereo, and the output signal is stereo.  The delay lengths are
     optimized for a sample rate of 44100 Hz.
 
+    The 16 comb filters of the two channels are independent, so they
+    are computed together, one sample of all of them per loop pass,
+    from arrays that the compiler can vectorize.  The StkFrames tick()
+    functions run each comb and allpass filter over blocks of samples
+    no longer than the shortest delay line.  Values in the feedback
+    loops that decay below 1e-30 are flushed to zero, so that the
+    reverb tail never reaches the slow denormal range.
+
     Ported to STK by Gregory Burlet, 2012.
 */
 /***********************************************************************/
@@ -27,8 +35,8 @@ const StkFloat FreeVerb::scaleDry = 2;
 const StkFloat FreeVerb::scaleDamp = 0.4;
 const StkFloat FreeVerb::scaleRoom = 0.28;
 const StkFloat FreeVerb::offsetRoom = 0.7;
-int FreeVerb::cDelayLengths[] = {1617, 1557, 1491, 1422, 1356, 1277, 1188, 1116};
-int FreeVerb::aDelayLengths[] = {225, 556, 441, 341};
+const int FreeVerb::cDelayLengths[] = {1617, 1557, 1491, 1422, 1356, 1277, 1188, 1116};
+const int FreeVerb::aDelayLengths[] = {225, 556, 441, 341};
 
 FreeVerb::FreeVerb( void )
 {
@@ -48,33 +56,41 @@ FreeVerb::FreeVerb( void )
 
   // Scale delay line lengths according to the current sampling rate
   double fsScale = Stk::sampleRate() / 44100.0;
-  if ( fsScale != 1.0 ) {
-    // scale comb filter delay lines
-    for ( int i = 0; i < nCombs; i++ ) {
-      cDelayLengths[i] = (int) floor(fsScale * cDelayLengths[i]);
-    }
-
-    // Scale allpass filter delay lines
-    for ( int i = 0; i < nAllpasses; i++ ) {
-      aDelayLengths[i] = (int) floor(fsScale * aDelayLengths[i]);
-    }
-  }
-
-  // Initialize delay lines for the LBFC filters
+  unsigned long minDelay = maxBlockSize;
   for ( int i = 0; i < nCombs; i++ ) {
-    combDelayL_[i].setMaximumDelay( cDelayLengths[i] );
-    combDelayL_[i].setDelay( cDelayLengths[i] );
-    combDelayR_[i].setMaximumDelay( cDelayLengths[i] + stereoSpread );
-    combDelayR_[i].setDelay( cDelayLengths[i] + stereoSpread );
+    unsigned long delay = cDelayLengths[i];
+    if ( fsScale != 1.0 ) delay = (unsigned long) floor(fsScale * delay);
+    if ( delay < 1 ) delay = 1;
+    if ( delay < minDelay ) minDelay = delay;
+    combDelays_[i] = delay;
+    combDelays_[nCombs + i] = delay + stereoSpread;
   }
 
-  // initialize delay lines for the allpass filters
-  for (int i = 0; i < nAllpasses; i++) {
-    allPassDelayL_[i].setMaximumDelay( aDelayLengths[i] );
-    allPassDelayL_[i].setDelay( aDelayLengths[i] );
-    allPassDelayR_[i].setMaximumDelay( aDelayLengths[i] + stereoSpread );
-    allPassDelayR_[i].setDelay( aDelayLengths[i] + stereoSpread );
+  for ( int i = 0; i < nAllpasses; i++ ) {
+    unsigned long delay = aDelayLengths[i];
+    if ( fsScale != 1.0 ) delay = (unsigned long) floor(fsScale * delay);
+    if ( delay < 1 ) delay = 1;
+    if ( delay < minDelay ) minDelay = delay;
+    allPassDelays_[i] = delay;
+    allPassDelays_[nAllpasses + i] = delay + stereoSpread;
   }
+
+  // Initialize the delay lines.  Blocks are no longer than the
+  // shortest delay, so that a block of outputs is read from each line
+  // before the block of inputs is written.
+  for ( int i = 0; i < nLanes; i++ )
+    setLine( combLines_[i], combDelays_[i] );
+  for ( int i = 0; i < 2 * nAllpasses; i++ )
+    setLine( allPassLines_[i], allPassDelays_[i] );
+
+  blockSize_ = minDelay;
+  lanes_.resize( blockSize_ * nLanes );
+  combStates_.resize( ( blockSize_ + 1 ) * nLanes );
+  inputL_.resize( blockSize_ );
+  inputR_.resize( blockSize_ );
+  wetL_.resize( blockSize_ );
+  wetR_.resize( blockSize_ );
+  this->clear();
 }
 
 FreeVerb::~FreeVerb()
@@ -156,31 +172,95 @@ void FreeVerb::update()
     gain_ = fixedGain;
   }
 
-  for ( int i=0; i<nCombs; i++ ) {
-    // set low pass filter for delay output
-    combLPL_[i].setCoefficients(1.0 - damp_, -damp_);
-    combLPR_[i].setCoefficients(1.0 - damp_, -damp_);
-  }
 }
 
 void FreeVerb::clear()
 {
   // Clear LBFC delay lines
-  for ( int i = 0; i < nCombs; i++ ) {
-    combDelayL_[i].clear();
-    combDelayR_[i].clear();
+  for ( int i = 0; i < nLanes; i++ ) {
+    combLines_[i].assign( combLines_[i].size(), 0.0 );
+    combStates_[i] = 0.0;
   }
 
   // Clear allpass delay lines
-  for ( int i = 0; i < nAllpasses; i++ ) {
-    allPassDelayL_[i].clear();
-    allPassDelayR_[i].clear();
-  }
+  for ( int i = 0; i < 2 * nAllpasses; i++ )
+    allPassLines_[i].assign( allPassLines_[i].size(), 0.0 );
 
+  time_ = 0;
   lastFrame_[0] = 0.0;
   lastFrame_[1] = 0.0;
 }
 
+void FreeVerb::filterCombs( StkFloat * __restrict lanes, StkFloat * __restrict states, const StkFloat * __restrict inputs,
+                            unsigned int nFrames, StkFloat b0, StkFloat a1, StkFloat roomSize )
+{
+  // The combs are computed one frame at a time, as in tick().  Each
+  // frame writes its states to the next row, so that the lanes have no
+  // dependence within a frame and can be vectorized.
+  for ( unsigned int k = 0; k < nFrames; k++ ) {
+    StkFloat fInput = inputs[k];
+    StkFloat * __restrict x = lanes + k * nLanes;
+    const StkFloat * __restrict last = states + k * nLanes;
+    StkFloat * __restrict next = states + ( k + 1 ) * nLanes;
+    for ( int c = 0; c < nLanes; c++ ) {
+      next[c] = flush( b0 * x[c] - a1 * last[c] );
+      x[c] = fInput + (roomSize * next[c]);
+    }
+  }
+}
+
+void FreeVerb::computeBlock( unsigned int nFrames )
+{
+  unsigned int i, k;
+  int c;
+
+  // The combs read a block of outputs from their lines into
+  // interleaved lanes, one frame of all combs after another.
+  for ( c = 0; c < nLanes; c++ )
+    readLine( combLines_[c], time_ - combDelays_[c], &lanes_[c], nLanes, nFrames );
+
+  // Run the lowpass feedback of all combs, replacing the lanes with
+  // the comb outputs.
+  for ( k = 0; k < nFrames; k++ )
+    wetL_[k] = (inputL_[k] + inputR_[k]) * gain_;
+  filterCombs( &lanes_[0], &combStates_[0], &wetL_[0], nFrames, 1.0 - damp_, -damp_, roomSize_ );
+  for ( c = 0; c < nLanes; c++ )
+    combStates_[c] = combStates_[nFrames * nLanes + c];
+  for ( c = 0; c < nLanes; c++ )
+    writeLine( combLines_[c], time_, &lanes_[c], nLanes, nFrames );
+
+  // Sum the combs of each channel in the same order as tick().
+  for ( k = 0; k < nFrames; k++ ) {
+    const StkFloat *lanes = &lanes_[k * nLanes];
+    StkFloat outL = 0.0;
+    StkFloat outR = 0.0;
+    for ( c = 0; c < nCombs; c++ ) {
+      outL += lanes[c];
+      outR += lanes[nCombs + c];
+    }
+    wetL_[k] = outL;
+    wetR_[k] = outR;
+  }
+
+  // Series allpass filters, each over the whole block.  The lanes
+  // hold the delayed samples and then the new line inputs.
+  StkFloat g = g_;
+  for ( c = 0; c < 2 * nAllpasses; c++ ) {
+    StkFloat * __restrict out = ( c < nAllpasses ) ? &wetL_[0] : &wetR_[0];
+    StkFloat * __restrict delayed = &lanes_[0];
+    readLine( allPassLines_[c], time_ - allPassDelays_[c], delayed, 1, nFrames );
+    for ( i = 0; i < nFrames; i++ ) {
+      StkFloat vn_m = delayed[i];
+      StkFloat vn = flush( out[i] + (g * vn_m) );
+      delayed[i] = vn;
+      out[i] = -vn + (1.0 + g)*vn_m;
+    }
+    writeLine( allPassLines_[c], time_, delayed, 1, nFrames );
+  }
+
+  time_ += nFrames;
+}
+
 StkFrames& FreeVerb::tick( StkFrames& frames, unsigned int channel )
 {
 #if defined(_STK_DEBUG_)
@@ -192,11 +272,29 @@ StkFrames& FreeVerb::tick( StkFrames& frames, unsigned int channel )
 
   StkFloat *samples = &frames[channel];
   unsigned int hop = frames.channels();
-  for ( unsigned int i=0; i<frames.frames(); i++, samples += hop ) {
-    *samples = tick( *samples, *(samples+1) );
-    *(samples+1) = lastFrame_[1];
+  for ( unsigned int done=0; done<frames.frames(); ) {
+    unsigned int i, n = frames.frames() - done;
+    if ( n > blockSize_ ) n = blockSize_;
+    for ( i=0; i<n; i++ ) {
+      inputL_[i] = samples[i * hop];
+      inputR_[i] = samples[i * hop + 1];
+      if ( !inputR_[i] ) inputR_[i] = inputL_[i];
+    }
+
+    this->computeBlock( n );
+
+    // Mix output
+    for ( i=0; i<n; i++, samples += hop ) {
+      samples[0] = wetL_[i]*wet1_ + wetR_[i]*wet2_ + inputL_[i]*dry_;
+      samples[1] = wetR_[i]*wet1_ + wetL_[i]*wet2_ + inputR_[i]*dry_;
+    }
+    done += n;
   }
 
+  if ( frames.frames() ) {
+    lastFrame_[0] = *(samples - hop);
+    lastFrame_[1] = *(samples - hop + 1);
+  }
   return frames;
 }
 
@@ -214,14 +312,28 @@ StkFrames& FreeVerb::tick( StkFrames& iFrames, StkFrames &oFrames, unsigned int
   unsigned int iHop = iFrames.channels();
   unsigned int oHop = oFrames.channels();
   bool stereoInput = ( iFrames.channels() > iChannel+1 ) ? true : false;
-  for ( unsigned int i=0; i<iFrames.frames(); i++, iSamples += iHop, oSamples += oHop) {
-    if ( stereoInput )
-      *oSamples = tick( *iSamples, *(iSamples+1) );
-    else
-      *oSamples = tick( *iSamples );
+  for ( unsigned int done=0; done<iFrames.frames(); ) {
+    unsigned int i, n = iFrames.frames() - done;
+    if ( n > blockSize_ ) n = blockSize_;
+    for ( i=0; i<n; i++, iSamples += iHop ) {
+      inputL_[i] = iSamples[0];
+      inputR_[i] = ( stereoInput ) ? iSamples[1] : 0.0;
+      if ( !inputR_[i] ) inputR_[i] = inputL_[i];
+    }
+
+    this->computeBlock( n );
 
-    *(oSamples+1) = lastFrame_[1];
+    // Mix output
+    for ( i=0; i<n; i++, oSamples += oHop ) {
+      oSamples[0] = wetL_[i]*wet1_ + wetR_[i]*wet2_ + inputL_[i]*dry_;
+      oSamples[1] = wetR_[i]*wet1_ + wetL_[i]*wet2_ + inputR_[i]*dry_;
+    }
+    done += n;
   }
 
+  if ( iFrames.frames() ) {
+    lastFrame_[0] = *(oSamples - oHop);
+    lastFrame_[1] = *(oSamples - oHop + 1);
+  }
   return oFrames;
 }
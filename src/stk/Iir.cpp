@@ -20,15 +20,269 @@
     This structure results in one extra multiply per computed sample,
     but allows easy control of the overall filter gain.
 
+    Filters of order greater than two are factored into a cascade of
+    second-order sections, which are computed in transposed direct
+    form II.  This is faster than the direct form and less sensitive
+    to rounding.  If the roots of the coefficients cannot be found,
+    the direct form is used.  The poles of a high-order filter with
+    poles close together, such as a low crossover at a high sample
+    rate, can already be moved outside the unit circle by rounding
+    its coefficients, so such designs should be set in second-order
+    sections with setSections().
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
 
 #include "Iir.h"
+#include <complex>
+#include <algorithm>
 
 namespace stk {
 
+typedef std::complex<double> Complex;
+
+// Find the n roots of c[0]*z^n + c[1]*z^(n-1) + ... + c[n], where
+// c[0] and c[n] are not zero, as the eigenvalues of the companion
+// matrix.  The matrix is balanced and reduced by the Francis
+// double-shift QR algorithm, as in EISPACK, so complex roots come in
+// exact conjugate pairs.  Returns false if the iteration does not
+// converge.
+static bool findRoots( const std::vector<double> &c, std::vector<Complex> &roots )
+{
+  int i, j, k, m, l, size = c.size() - 1;
+  std::vector<double> matrix( size * size, 0.0 );
+  #define H( row, column ) matrix[(row) * size + (column)]
+  for ( j=0; j<size; j++ ) H( 0, j ) = -c[j+1] / c[0];
+  for ( i=1; i<size; i++ ) H( i, i-1 ) = 1.0;
+
+  // Scale rows and columns by powers of two to make their norms
+  // similar, which improves the accuracy of the eigenvalues.
+  bool done = false;
+  while ( !done ) {
+    done = true;
+    for ( i=0; i<size; i++ ) {
+      double row = 0.0, column = 0.0;
+      for ( j=0; j<size; j++ ) {
+        if ( j == i ) continue;
+        column += std::abs( H( j, i ) );
+        row += std::abs( H( i, j ) );
+      }
+      if ( column == 0.0 || row == 0.0 ) continue;
+
+      double f = 1.0, g = row / 2.0, sum = column + row;
+      while ( column < g ) { f *= 2.0; column *= 4.0; }
+      g = row * 2.0;
+      while ( column >= g ) { f /= 2.0; column /= 4.0; }
+      if ( ( column + row ) / f < 0.95 * sum ) {
+        done = false;
+        for ( j=0; j<size; j++ ) H( i, j ) /= f;
+        for ( j=0; j<size; j++ ) H( j, i ) *= f;
+      }
+    }
+  }
+
+  double norm = 0.0, shift = 0.0, eps = 2.220446049250313e-16;
+  double p = 0.0, q = 0.0, r = 0.0, s = 0.0, t, w, x, y, z;
+  for ( i=0; i<size; i++ )
+    for ( j=std::max( i-1, 0 ); j<size; j++ ) norm += std::abs( H( i, j ) );
+
+  roots.resize( size );
+  int n = size - 1, iteration = 0;
+  while ( n >= 0 ) {
+
+    // Look for a single small subdiagonal element.
+    for ( l=n; l>0; l-- ) {
+      s = std::abs( H( l-1, l-1 ) ) + std::abs( H( l, l ) );
+      if ( s == 0.0 ) s = norm;
+      if ( std::abs( H( l, l-1 ) ) < eps * s ) break;
+    }
+
+    if ( l == n ) {
+      // One real root.
+      roots[n] = H( n, n ) + shift;
+      n--;
+      iteration = 0;
+    }
+    else if ( l == n-1 ) {
+      // Two roots, real or a complex pair.
+      w = H( n, n-1 ) * H( n-1, n );
+      p = ( H( n-1, n-1 ) - H( n, n ) ) / 2.0;
+      q = p * p + w;
+      z = std::sqrt( std::abs( q ) );
+      x = H( n, n ) + shift;
+      if ( q >= 0.0 ) {
+        z = ( p >= 0.0 ) ? p + z : p - z;
+        roots[n-1] = x + z;
+        roots[n] = ( z != 0.0 ) ? x - w / z : x + z;
+      }
+      else {
+        roots[n-1] = Complex( x + p, z );
+        roots[n] = Complex( x + p, -z );
+      }
+      n -= 2;
+      iteration = 0;
+    }
+    else {
+      // Perform a double-shift QR step on rows and columns l to n.
+      if ( ++iteration > 30 * size ) return false;
+      x = H( n, n );
+      y = H( n-1, n-1 );
+      w = H( n, n-1 ) * H( n-1, n );
+
+      // Exceptional shifts, to break cycles.
+      if ( iteration % 10 == 0 ) {
+        shift += x;
+        for ( i=0; i<=n; i++ ) H( i, i ) -= x;
+        s = std::abs( H( n, n-1 ) ) + std::abs( H( n-1, n-2 ) );
+        x = y = 0.75 * s;
+        w = -0.4375 * s * s;
+      }
+
+      // Look for two consecutive small subdiagonal elements.
+      for ( m=n-2; m>=l; m-- ) {
+        z = H( m, m );
+        r = x - z;
+        s = y - z;
+        p = ( r * s - w ) / H( m+1, m ) + H( m, m+1 );
+        q = H( m+1, m+1 ) - z - r - s;
+        r = H( m+2, m+1 );
+        s = std::abs( p ) + std::abs( q ) + std::abs( r );
+        p /= s;
+        q /= s;
+        r /= s;
+        if ( m == l ) break;
+        if ( std::abs( H( m, m-1 ) ) * ( std::abs( q ) + std::abs( r ) ) <
+             eps * ( std::abs( p ) * ( std::abs( H( m-1, m-1 ) ) + std::abs( z ) + std::abs( H( m+1, m+1 ) ) ) ) )
+          break;
+      }
+
+      for ( i=m+2; i<=n; i++ ) {
+        H( i, i-2 ) = 0.0;
+        if ( i > m+2 ) H( i, i-3 ) = 0.0;
+      }
+
+      for ( k=m; k<=n-1; k++ ) {
+        bool notLast = ( k != n-1 );
+        if ( k != m ) {
+          p = H( k, k-1 );
+          q = H( k+1, k-1 );
+          r = notLast ? H( k+2, k-1 ) : 0.0;
+          x = std::abs( p ) + std::abs( q ) + std::abs( r );
+          if ( x == 0.0 ) break;
+          p /= x;
+          q /= x;
+          r /= x;
+        }
+
+        s = std::sqrt( p * p + q * q + r * r );
+        if ( p < 0.0 ) s = -s;
+        if ( s == 0.0 ) continue;
+        if ( k != m ) H( k, k-1 ) = -s * x;
+        else if ( l != m ) H( k, k-1 ) = -H( k, k-1 );
+        p += s;
+        x = p / s;
+        y = q / s;
+        z = r / s;
+        q /= p;
+        r /= p;
+
+        for ( j=k; j<size; j++ ) {
+          t = H( k, j ) + q * H( k+1, j );
+          if ( notLast ) {
+            t += r * H( k+2, j );
+            H( k+2, j ) -= t * z;
+          }
+          H( k, j ) -= t * x;
+          H( k+1, j ) -= t * y;
+        }
+
+        for ( i=0; i<=std::min( n, k+3 ); i++ ) {
+          t = x * H( i, k ) + y * H( i, k+1 );
+          if ( notLast ) {
+            t += z * H( i, k+2 );
+            H( i, k+2 ) -= t * r;
+          }
+          H( i, k ) -= t;
+          H( i, k+1 ) -= t * q;
+        }
+      }
+    }
+  }
+
+  #undef H
+  return true;
+}
+
+// A real factor of up to second order in z^-1 and one of its roots,
+// used to pair numerator and denominator factors.
+struct Factor {
+  StkFloat c[3];
+  Complex root;
+};
+
+// Group roots into real factors: complex roots with their conjugate,
+// and the remaining real roots in pairs of adjacent
+// values.  Roots at infinity, given by their number, give factors of
+// z^-1 and come last.
+static void groupRoots( std::vector<Complex> roots, unsigned int nInfinite, std::vector<Factor> &factors )
+{
+  unsigned int i, j;
+  std::vector<double> reals;
+  factors.clear();
+  while ( roots.size() ) {
+    unsigned int k = 0;
+    for ( i=1; i<roots.size(); i++ )
+      if ( roots[i].imag() > roots[k].imag() ) k = i;
+    Complex z = roots[k];
+    if ( z.imag() <= 0.0 ) break;
+
+    roots.erase( roots.begin() + k );
+    j = 0;
+    for ( i=1; i<roots.size(); i++ )
+      if ( std::abs( roots[i] - std::conj( z ) ) < std::abs( roots[j] - std::conj( z ) ) ) j = i;
+    Complex w = roots[j];
+    roots.erase( roots.begin() + j );
+
+    Factor factor;
+    factor.c[0] = 1.0;
+    factor.c[1] = -( z + w ).real();
+    factor.c[2] = ( z * w ).real();
+    factor.root = z;
+    factors.push_back( factor );
+  }
+
+  for ( i=0; i<roots.size(); i++ ) reals.push_back( roots[i].real() );
+  std::sort( reals.begin(), reals.end() );
+  for ( i=0; i<nInfinite; i++ ) reals.push_back( HUGE_VAL );
+
+  for ( i=0; i<reals.size(); i+=2 ) {
+    // Each real root r gives 1 - r*z^-1, or z^-1 if it is infinite.
+    Factor factor;
+    double r1 = reals[i], r2 = ( i + 1 < reals.size() ) ? reals[i+1] : 0.0;
+    double a0 = 1.0, a1 = -r1, b0 = 1.0, b1 = -r2;
+    if ( r1 == HUGE_VAL ) { a0 = 0.0; a1 = 1.0; }
+    if ( r2 == HUGE_VAL ) { b0 = 0.0; b1 = 1.0; }
+    factor.c[0] = a0 * b0;
+    factor.c[1] = a0 * b1 + a1 * b0;
+    factor.c[2] = a1 * b1;
+    factor.root = ( std::abs( r2 ) > std::abs( r1 ) ) ? r2 : r1;
+    factors.push_back( factor );
+  }
+}
+
+// Multiply the polynomial p by the second-order polynomial q.
+static void multiply( std::vector<StkFloat> &p, const StkFloat *q )
+{
+  std::vector<StkFloat> product( p.size() + 2, 0.0 );
+  for ( unsigned int i=0; i<p.size(); i++ )
+    for ( unsigned int j=0; j<3; j++ )
+      product[i+j] += p[i] * q[j];
+  p = product;
+}
+
 Iir :: Iir()
+  : nSections_( 0 )
 {
   // The default constructor should setup for pass-through.
   b_.push_back( 1.0 );
@@ -39,6 +293,7 @@ Iir :: Iir()
 }
 
 Iir :: Iir( std::vector<StkFloat> &bCoefficients, std::vector<StkFloat> &aCoefficients )
+  : nSections_( 0 )
 {
   // Check the arguments.
   if ( bCoefficients.size() == 0 || aCoefficients.size() == 0 ) {
@@ -57,6 +312,7 @@ Iir :: Iir( std::vector<StkFloat> &bCoefficients, std::vector<StkFloat> &aCoeffi
 
   inputs_.resize( b_.size(), 1, 0.0 );
   outputs_.resize( a_.size(), 1, 0.0 );
+  this->factor();
   this->clear();
 }
 
@@ -64,11 +320,51 @@ Iir :: ~Iir()
 {
 }
 
+void Iir :: clear( void )
+{
+  Filter::clear();
+  for ( unsigned int i=0; i<states_.size(); i++ )
+    states_[i] = 0.0;
+}
+
 void Iir :: setCoefficients( std::vector<StkFloat> &bCoefficients, std::vector<StkFloat> &aCoefficients, bool clearState )
 {
-  this->setNumerator( bCoefficients, false );
-  this->setDenominator( aCoefficients, false );
+  // Check the arguments.
+  if ( bCoefficients.size() == 0 || aCoefficients.size() == 0 ) {
+    oStream_ << "Iir::setCoefficients: a and b coefficient vectors must both have size > 0!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  if ( aCoefficients[0] == 0.0 ) {
+    oStream_ << "Iir::setCoefficients: a[0] coefficient cannot == 0!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  // Both polynomials are set before the filter is factored, once.
+  if ( b_.size() != bCoefficients.size() ) {
+    b_ = bCoefficients;
+    inputs_.resize( b_.size(), 1, 0.0 );
+  }
+  else {
+    for ( unsigned int i=0; i<b_.size(); i++ ) b_[i] = bCoefficients[i];
+  }
 
+  if ( a_.size() != aCoefficients.size() ) {
+    a_ = aCoefficients;
+    outputs_.resize( a_.size(), 1, 0.0 );
+  }
+  else {
+    for ( unsigned int i=0; i<a_.size(); i++ ) a_[i] = aCoefficients[i];
+  }
+
+  // Scale coefficients by a[0] if necessary
+  if ( a_[0] != 1.0 ) {
+    unsigned int i;
+    for ( i=0; i<b_.size(); i++ ) b_[i] /= a_[0];
+    for ( i=1; i<a_.size(); i++ )  a_[i] /= a_[0];
+  }
+
+  this->factor();
   if ( clearState ) this->clear();
 }
 
@@ -88,6 +384,7 @@ void Iir :: setNumerator( std::vector<StkFloat> &bCoefficients, bool clearState
     for ( unsigned int i=0; i<b_.size(); i++ ) b_[i] = bCoefficients[i];
   }
 
+  this->factor();
   if ( clearState ) this->clear();
 }
 
@@ -120,6 +417,174 @@ void Iir :: setDenominator( std::vector<StkFloat> &aCoefficients, bool clearStat
     for ( i=0; i<b_.size(); i++ ) b_[i] /= a_[0];
     for ( i=1; i<a_.size(); i++ )  a_[i] /= a_[0];
   }
+
+  this->factor();
+}
+
+void Iir :: setSections( std::vector<StkFloat> &sections, bool clearState )
+{
+  // Check the argument.
+  unsigned int i, k, nSections = sections.size() / 6;
+  if ( nSections == 0 || sections.size() != 6 * nSections ) {
+    oStream_ << "Iir::setSections: coefficient vector size must be a positive multiple of 6!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  for ( k=0; k<nSections; k++ ) {
+    if ( sections[6*k+3] == 0.0 ) {
+      oStream_ << "Iir::setSections: a[0] coefficient cannot == 0!";
+      handleError( StkError::FUNCTION_ARGUMENT );
+    }
+  }
+
+  if ( nSections != nSections_ ) {
+    states_.assign( 2 * nSections, 0.0 );
+    nSections_ = nSections;
+  }
+  sections_.resize( 5 * nSections );
+
+  StkFloat numerator[3], denominator[3];
+  b_.assign( 1, 1.0 );
+  a_.assign( 1, 1.0 );
+  for ( k=0; k<nSections; k++ ) {
+    const StkFloat *section = &sections[6*k];
+    for ( i=0; i<3; i++ ) {
+      numerator[i] = section[i] / section[3];
+      denominator[i] = section[3+i] / section[3];
+    }
+    sections_[5*k] = numerator[0];
+    sections_[5*k+1] = numerator[1];
+    sections_[5*k+2] = numerator[2];
+    sections_[5*k+3] = denominator[1];
+    sections_[5*k+4] = denominator[2];
+    multiply( b_, numerator );
+    multiply( a_, denominator );
+  }
+  inputs_.resize( b_.size(), 1, 0.0 );
+  outputs_.resize( a_.size(), 1, 0.0 );
+
+  if ( clearState ) this->clear();
+}
+
+void Iir :: factor( void )
+{
+  // The direct form ignores a[0], which is normally 1.0 after scaling.
+  unsigned int i, k, nb = b_.size(), na = a_.size();
+  while ( nb > 1 && b_[nb-1] == 0.0 ) nb--;
+  while ( na > 1 && a_[na-1] == 0.0 ) na--;
+
+  unsigned int nSections = 0;
+  std::vector<StkFloat> sections;
+  if ( nb > 3 || na > 3 ) {
+
+    // Leading zeros of the numerator are roots at infinity.
+    unsigned int nInfinite = 0;
+    while ( b_[nInfinite] == 0.0 && nInfinite < nb - 1 ) nInfinite++;
+    std::vector<double> numerator( b_.begin() + nInfinite, b_.begin() + nb );
+    std::vector<double> denominator( a_.begin(), a_.begin() + na );
+    denominator[0] = 1.0;
+
+    std::vector<Complex> zeros, poles;
+    std::vector<Factor> zeroFactors, poleFactors;
+    bool found = true;
+    if ( numerator.size() > 1 ) found = findRoots( numerator, zeros );
+    if ( found && denominator.size() > 1 ) found = findRoots( denominator, poles );
+
+    if ( found ) {
+      groupRoots( zeros, nInfinite, zeroFactors );
+      groupRoots( poles, 0, poleFactors );
+      nSections = std::max( zeroFactors.size(), poleFactors.size() );
+
+      // Pair each pole factor, starting from those nearest the unit
+      // circle, with the nearest remaining zero factor.  The sections
+      // are run in the opposite order, so that the most resonant
+      // come last.
+      std::vector<unsigned int> order( poleFactors.size() );
+      for ( k=0; k<order.size(); k++ ) order[k] = k;
+      for ( k=1; k<order.size(); k++ )
+        for ( i=k; i>0 && std::abs( poleFactors[order[i]].root ) > std::abs( poleFactors[order[i-1]].root ); i-- )
+          std::swap( order[i], order[i-1] );
+
+      sections.assign( 5 * nSections, 0.0 );
+      for ( k=0; k<nSections; k++ ) {
+        StkFloat *section = &sections[5 * ( nSections - 1 - k )];
+        const Factor *pole = ( k < order.size() ) ? &poleFactors[order[k]] : 0;
+        unsigned int nearest = 0;
+        for ( i=1; i<zeroFactors.size(); i++ ) {
+          if ( !pole ) break;
+          if ( std::abs( zeroFactors[i].root - pole->root ) < std::abs( zeroFactors[nearest].root - pole->root ) )
+            nearest = i;
+        }
+
+        section[0] = 1.0;
+        if ( zeroFactors.size() ) {
+          for ( i=0; i<3; i++ ) section[i] = zeroFactors[nearest].c[i];
+          zeroFactors.erase( zeroFactors.begin() + nearest );
+        }
+        if ( pole ) {
+          section[3] = pole->c[1];
+          section[4] = pole->c[2];
+        }
+      }
+
+      // The numerator gain is applied in the first section.
+      for ( i=0; i<3; i++ ) sections[i] *= numerator[0];
+
+      // Check the factors against the coefficients, in case roots
+      // were paired wrongly.
+      std::vector<StkFloat> bCheck( 1, 1.0 ), aCheck( 1, 1.0 );
+      for ( k=0; k<nSections; k++ ) {
+        StkFloat poles[3] = { 1.0, sections[5*k+3], sections[5*k+4] };
+        multiply( bCheck, &sections[5*k] );
+        multiply( aCheck, poles );
+      }
+      double error = 0.0, scale = 0.0;
+      for ( i=0; i<bCheck.size(); i++ ) {
+        StkFloat b = ( i < nb ) ? b_[i] : 0.0;
+        error = std::max( error, std::abs( bCheck[i] - b ) );
+        scale = std::max( scale, std::abs( b ) );
+      }
+      if ( error > 1e-6 * scale ) nSections = 0;
+      error = 0.0, scale = 1.0;
+      for ( i=1; i<aCheck.size(); i++ ) {
+        StkFloat a = ( i < na ) ? a_[i] : 0.0;
+        error = std::max( error, std::abs( aCheck[i] - a ) );
+        scale = std::max( scale, std::abs( a ) );
+      }
+      if ( error > 1e-6 * scale ) nSections = 0;
+    }
+  }
+
+  // The states are kept if the number of sections is unchanged.
+  if ( nSections != nSections_ ) {
+    states_.assign( 2 * nSections, 0.0 );
+    nSections_ = nSections;
+  }
+  if ( nSections ) sections_ = sections;
+}
+
+void Iir :: filterSections( const StkFloat *iSamples, unsigned int iHop,
+                            StkFloat *oSamples, unsigned int oHop, unsigned int nFrames )
+{
+  // Each sample is run through all of the sections before the next,
+  // so that the processor can overlap the work of successive sections
+  // on successive samples, which do not depend on each other.
+  unsigned int i, k;
+  StkFloat x, y;
+  StkFloat *s = &states_[0];
+  const StkFloat *c = &sections_[0];
+  for ( i=0; i<nFrames; i++ ) {
+    y = gain_ * iSamples[i * iHop];
+    for ( k=0; k<nSections_; k++ ) {
+      x = y;
+      y = c[5*k] * x + s[2*k];
+      s[2*k] = c[5*k+1] * x - c[5*k+3] * y + s[2*k+1];
+      s[2*k+1] = c[5*k+2] * x - c[5*k+4] * y;
+    }
+    oSamples[i * oHop] = y;
+  }
+
+  lastFrame_[0] = oSamples[(nFrames-1) * oHop];
 }
 
 } // stk namespace
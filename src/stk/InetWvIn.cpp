@@ -20,15 +20,35 @@
     data type for the incoming stream is signed 16-bit integers,
     though any of the defined StkFormats are permissible.
 
+    Incoming data is received by a separate thread (using epoll and,
+    for UDP, batched recvmmsg calls under Linux) and passed to the
+    computing thread through a lock-free JitterBuffer.  The tick()
+    functions never block: until enough data has arrived to cover
+    the target latency, and whenever the stream falls behind, they
+    return zeros.  UDP packets that begin with the header described
+    by Socket::PACKET_MAGIC are checked for loss and order (see
+    getLostPackets() and getLatePackets()).  Packets without the
+    header are queued as they arrive.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
 
 #include "InetWvIn.h"
 #include <sstream>
+#include <cstring>
+
+#if defined(__OS_LINUX__)
+  #include <sys/epoll.h>
+  #include <sys/eventfd.h>
+#endif
 
 namespace stk {
 
+// The largest possible UDP packet and the number received per call.
+const unsigned long PACKET_BYTES = 65536;
+const unsigned int RECEIVE_BATCH = 16;
+
 extern "C" THREAD_RETURN THREAD_TYPE inputThread( void * ptr )
 {
   ThreadInfo *info = (ThreadInfo *)ptr;
@@ -41,64 +61,111 @@ extern "C" THREAD_RETURN THREAD_TYPE inputThread( void * ptr )
 }
 
 InetWvIn :: InetWvIn( unsigned long bufferFrames, unsigned int nBuffers )
-  :soket_(0), buffer_(0), bufferFrames_(bufferFrames), bufferBytes_(0), nBuffers_(nBuffers), connected_(false)
+  :soket_(0), packets_(0), bufferFrames_(bufferFrames), nBuffers_(nBuffers), bufferCounter_(0),
+   bufferIndex_(0), connected_(false), receiving_(false), fd_(-1), epoll_(-1), wakeup_(-1),
+   protocol_(Socket::PROTO_TCP)
 {
   threadInfo_.finished = false;
   threadInfo_.object = (void *) this;
 
-  // Start the input thread.
-  if ( !thread_.start( &inputThread, &threadInfo_ ) ) {
-    oStream_ << "InetWvIn(): unable to start input thread in constructor!";
+#if defined(__OS_LINUX__)
+  // The input thread waits on the socket and on an event used to
+  // wake it when it should stop.
+  epoll_ = epoll_create( 2 );
+  wakeup_ = eventfd( 0, 0 );
+  if ( epoll_ < 0 || wakeup_ < 0 ) {
+    oStream_ << "InetWvIn(): unable to create the input thread events!";
     handleError( StkError::PROCESS_THREAD );
   }
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.fd = wakeup_;
+  epoll_ctl( epoll_, EPOLL_CTL_ADD, wakeup_, &event );
+#endif
+
+  // Start the input thread.
+  this->startReceiving();
 }
 
 InetWvIn :: ~InetWvIn()
 {
   // Close down the thread.
+  this->stopReceiving();
   connected_ = false;
-  threadInfo_.finished = true;
 
+  if ( protocol_ == Socket::PROTO_TCP ) Socket::close( fd_ );
   if ( soket_ ) delete soket_;
-  if ( buffer_ ) delete [] buffer_;
+  if ( packets_ ) delete [] packets_;
+
+#if defined(__OS_LINUX__)
+  if ( epoll_ >= 0 ) ::close( epoll_ );
+  if ( wakeup_ >= 0 ) ::close( wakeup_ );
+#endif
+}
+
+void InetWvIn :: startReceiving( void )
+{
+  threadInfo_.finished = false;
+  if ( !thread_.start( &inputThread, &threadInfo_ ) ) {
+    oStream_ << "InetWvIn(): unable to start input thread!";
+    handleError( StkError::PROCESS_THREAD );
+  }
+  receiving_ = true;
+}
+
+void InetWvIn :: stopReceiving( void )
+{
+  if ( !receiving_ ) return;
+
+  threadInfo_.finished = true;
+#if defined(__OS_LINUX__)
+  uint64_t one = 1;
+  if ( ::write( wakeup_, &one, sizeof( one ) ) < 0 ) {}
+#endif
+  thread_.wait();
+  receiving_ = false;
+
+#if defined(__OS_LINUX__)
+  uint64_t count;
+  if ( ::read( wakeup_, &count, sizeof( count ) ) < 0 ) {}
+#endif
 }
 
 void InetWvIn :: listen( int port, unsigned int nChannels,
                          Stk::StkFormat format, Socket::ProtocolType protocol )
 {
-  mutex_.lock();
+  // The input thread is stopped while the connection is replaced.
+  this->stopReceiving();
 
-  if ( connected_ ) delete soket_;
+  if ( soket_ ) {
+#if defined(__OS_LINUX__)
+    epoll_ctl( epoll_, EPOLL_CTL_DEL, fd_, NULL );
+#endif
+    if ( protocol_ == Socket::PROTO_TCP ) Socket::close( fd_ );
+    delete soket_;
+    soket_ = 0;
+    fd_ = -1;
+  }
+  connected_ = false;
 
   if ( nChannels < 1 ) {
     oStream_ << "InetWvIn()::listen(): the channel argument must be greater than zero.";
     handleError( StkError::FUNCTION_ARGUMENT );
   }
 
-  if ( format == STK_SINT16 ) dataBytes_ = 2;
-  else if ( format == STK_SINT32 || format == STK_FLOAT32 ) dataBytes_ = 4;
-  else if ( format == STK_FLOAT64 ) dataBytes_ = 8;
-  else if ( format == STK_SINT8 ) dataBytes_ = 1;
-  else {
+  if ( format != STK_SINT16 && format != STK_SINT32 && format != STK_FLOAT32 &&
+       format != STK_FLOAT64 && format != STK_SINT8 ) {
     oStream_ << "InetWvIn(): unknown data type specified!";
     handleError( StkError::FUNCTION_ARGUMENT );
   } 
-  dataType_ = format;
-
-  unsigned long bufferBytes = bufferFrames_ * nBuffers_ * nChannels * dataBytes_;
-  if ( bufferBytes > bufferBytes_ ) {
-    if ( buffer_) delete [] buffer_;
-    buffer_ = (char *) new char[ bufferBytes ];
-    bufferBytes_ = bufferBytes;
-  }
 
+  jitter_.setFormat( nChannels, format, bufferFrames_ * nBuffers_ );
   data_.resize( bufferFrames_, nChannels );
   lastFrame_.resize( 1, nChannels, 0.0 );
 
   bufferCounter_ = 0;
-  writePoint_ = 0;
-  readPoint_ = 0;
-  bytesFilled_ = 0;
+  bufferIndex_ = 0;
+  protocol_ = protocol;
 
   if ( protocol == Socket::PROTO_TCP ) {
     TcpServer *socket = new TcpServer( port );
@@ -116,11 +183,23 @@ void InetWvIn :: listen( int port, unsigned int nChannels,
   else {
     soket_ = new UdpSocket( port );
     fd_ = soket_->id();
+    if ( !packets_ ) packets_ = new unsigned char[ PACKET_BYTES * RECEIVE_BATCH ];
   }
 
+#if defined(__OS_LINUX__)
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.fd = fd_;
+  epoll_ctl( epoll_, EPOLL_CTL_ADD, fd_, &event );
+#endif
+
   connected_ = true;
+  this->startReceiving();
+}
 
-  mutex_.unlock();
+void InetWvIn :: setLatency( unsigned long frames )
+{
+  jitter_.setLatency( frames );
 }
 
 void InetWvIn :: receive( void )
@@ -130,126 +209,95 @@ void InetWvIn :: receive( void )
     return;
   }
 
+#if defined(__OS_LINUX__)
+
+  // Wait until data is available for reading or the thread is stopped.
+  struct epoll_event events[2];
+  int nEvents = epoll_wait( epoll_, events, 2, -1 );
+  bool ready = false;
+  for ( int i=0; i<nEvents; i++ ) {
+    if ( events[i].data.fd == wakeup_ ) return;
+    if ( events[i].data.fd == fd_ ) ready = true;
+  }
+  if ( !ready ) return;
+
+  if ( protocol_ == Socket::PROTO_UDP ) {
+    // Receive all waiting packets, up to a batch at a time.
+    struct mmsghdr messages[RECEIVE_BATCH];
+    struct iovec vectors[RECEIVE_BATCH];
+    for ( unsigned int i=0; i<RECEIVE_BATCH; i++ ) {
+      vectors[i].iov_base = packets_ + i * PACKET_BYTES;
+      vectors[i].iov_len = PACKET_BYTES;
+      memset( &messages[i].msg_hdr, 0, sizeof( struct msghdr ) );
+      messages[i].msg_hdr.msg_iov = &vectors[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    int nPackets = recvmmsg( fd_, messages, RECEIVE_BATCH, MSG_DONTWAIT, NULL );
+    for ( int i=0; i<nPackets; i++ )
+      jitter_.writeDatagram( packets_ + i * PACKET_BYTES, messages[i].msg_len );
+    return;
+  }
+
+#else
+
   fd_set mask;
   FD_ZERO( &mask );
   FD_SET( fd_, &mask );
 
-  // The select function will block until data is available for reading.
-  select( fd_+1, &mask, (fd_set *)0, (fd_set *)0, NULL );
-
-  if ( FD_ISSET( fd_, &mask ) ) {
-    mutex_.lock();
-    unsigned long unfilled = bufferBytes_ - bytesFilled_;
-    if ( unfilled > 0 ) {
-      // There's room in our buffer for more data.
-      unsigned long endPoint = writePoint_ + unfilled;
-      if ( endPoint > bufferBytes_ ) unfilled -= endPoint - bufferBytes_;
-      int i = soket_->readBuffer( fd_, (void *)&buffer_[writePoint_], unfilled, 0 );
-      //int i = Socket::readBuffer( fd_, (void *)&buffer_[writePoint_], unfilled, 0 );
-      if ( i <= 0 ) {
-        oStream_ << "InetWvIn::receive(): the remote InetWvIn socket has closed.";
-        handleError( StkError::STATUS );
-        connected_ = false;
-        mutex_.unlock();
-        return;
-      }
-      bytesFilled_ += i;
-      writePoint_ += i;
-      if ( writePoint_ == bufferBytes_ )
-        writePoint_ = 0;
-      mutex_.unlock();
-    }
-    else {
-      // Sleep 10 milliseconds AFTER unlocking mutex.
-      mutex_.unlock();
-      Stk::sleep( 10 );
-    }
+  // Wait until data is available for reading, checking periodically
+  // whether the thread should stop.
+  struct timeval timeout;
+  timeout.tv_sec = 0;
+  timeout.tv_usec = 100000;
+  select( fd_+1, &mask, (fd_set *)0, (fd_set *)0, &timeout );
+  if ( !FD_ISSET( fd_, &mask ) ) return;
+
+  if ( protocol_ == Socket::PROTO_UDP ) {
+    int i = Socket::readBuffer( fd_, (void *) packets_, PACKET_BYTES, 0 );
+    if ( i > 0 ) jitter_.writeDatagram( packets_, i );
+    return;
   }
-}
 
-int InetWvIn :: readData( void )
-{
-  // We have two potential courses of action should this method
-  // be called and the input buffer isn't sufficiently filled.
-  // One solution is to fill the data buffer with zeros and return.
-  // The other solution is to wait until the necessary data exists.
-  // I chose the latter, as it works for both streamed files
-  // (non-realtime data transport) and realtime playback (given
-  // adequate network bandwidth and speed).
-
-  // Wait until data is ready.
-  unsigned long bytes = data_.size() * dataBytes_;
-  while ( connected_ && bytesFilled_ < bytes )
-    Stk::sleep( 10 );
-
-  if ( !connected_ && bytesFilled_ == 0 ) return 0;
-  bytes = ( bytesFilled_ < bytes ) ? bytesFilled_ : bytes;
-
-  // Copy samples from buffer to data.
-  StkFloat gain;
-  long samples = bytes / dataBytes_;
-  mutex_.lock();
-  if ( dataType_ == STK_SINT16 ) {
-    gain = 1.0 / 32767.0;
-    SINT16 *buf = (SINT16 *) (buffer_+readPoint_);
-    for (int i=0; i<samples; i++ ) {
-#ifdef __LITTLE_ENDIAN__
-      swap16((unsigned char *) buf);
-#endif
-      data_[i] = (StkFloat) *buf++;
-      data_[i] *= gain;
-    }
-  }
-  else if ( dataType_ == STK_SINT32 ) {
-    gain = 1.0 / 2147483647.0;
-    SINT32 *buf = (SINT32 *) (buffer_+readPoint_);
-    for (int i=0; i<samples; i++ ) {
-#ifdef __LITTLE_ENDIAN__
-      swap32((unsigned char *) buf);
-#endif
-      data_[i] = (StkFloat) *buf++;
-      data_[i] *= gain;
-    }
-  }
-  else if ( dataType_ == STK_FLOAT32 ) {
-    FLOAT32 *buf = (FLOAT32 *) (buffer_+readPoint_);
-    for (int i=0; i<samples; i++ ) {
-#ifdef __LITTLE_ENDIAN__
-      swap32((unsigned char *) buf);
-#endif
-      data_[i] = (StkFloat) *buf++;
-    }
-  }
-  else if ( dataType_ == STK_FLOAT64 ) {
-    FLOAT64 *buf = (FLOAT64 *) (buffer_+readPoint_);
-    for (int i=0; i<samples; i++ ) {
-#ifdef __LITTLE_ENDIAN__
-      swap64((unsigned char *) buf);
 #endif
-      data_[i] = (StkFloat) *buf++;
-    }
+
+  // Receive TCP data directly into the jitter buffer.
+  unsigned long unfilled;
+  char *space = jitter_.writeSpace( &unfilled );
+  if ( unfilled == 0 ) {
+    // The buffer is full, so leave the data waiting in the socket.
+    Stk::sleep( 1 );
+    return;
   }
-  else if ( dataType_ == STK_SINT8 ) {
-    gain = 1.0 / 127.0;
-    signed char *buf = (signed char *) (buffer_+readPoint_);
-    for (int i=0; i<samples; i++ ) {
-      data_[i] = (StkFloat) *buf++;
-      data_[i] *= gain;
-    }
+
+  int i = Socket::readBuffer( fd_, (void *) space, unfilled, 0 );
+  if ( i <= 0 ) {
+    oStream_ << "InetWvIn::receive(): the remote InetWvIn socket has closed.";
+    handleError( StkError::STATUS );
+    connected_ = false;
+    return;
   }
+  jitter_.commit( i );
+}
 
-  readPoint_ += bytes;
-  if ( readPoint_ == bufferBytes_ )
-    readPoint_ = 0;
-  bytesFilled_ -= bytes;
+int InetWvIn :: readData( void )
+{
+  // If this method is called and the input buffer isn't sufficiently
+  // filled, the remainder of the data buffer is filled with zeros.
+  // While the connection exists, a full buffer is always returned so
+  // that the output keeps time.  Once it has closed, the remaining
+  // data is drained.
+  bufferIndex_ = 0;
+  if ( connected_ ) {
+    jitter_.read( data_ );
+    return bufferFrames_;
+  }
 
-  mutex_.unlock();
-  return samples / data_.channels();
+  return jitter_.read( data_, true );
 }
 
 bool InetWvIn :: isConnected( void )
 {
-  if ( bytesFilled_ > 0 || bufferCounter_ > 0 )
+  if ( jitter_.getFillLevel() > 0 || bufferCounter_ > 0 )
     return true;
   else
     return connected_;
@@ -258,7 +306,7 @@ bool InetWvIn :: isConnected( void )
 StkFloat InetWvIn :: tick( unsigned int channel )
 {
   // If no connection and we've output all samples in the queue, return 0.0.
-  if ( !connected_ && bytesFilled_ == 0 && bufferCounter_ == 0 ) {
+  if ( !connected_ && jitter_.getFillLevel() == 0 && bufferCounter_ == 0 ) {
 #if defined(_STK_DEBUG_)
     oStream_ << "InetWvIn::tick(): a valid socket connection does not exist!";
     handleError( StkError::DEBUG_PRINT );
@@ -273,17 +321,20 @@ StkFloat InetWvIn :: tick( unsigned int channel )
   }
 #endif
 
-  if ( bufferCounter_ == 0 )
+  if ( bufferCounter_ == 0 ) {
     bufferCounter_ = readData();
+    if ( bufferCounter_ == 0 ) {
+      for ( unsigned int i=0; i<lastFrame_.size(); i++ ) lastFrame_[i] = 0.0;
+      return 0.0;
+    }
+  }
 
   unsigned int nChannels = lastFrame_.channels();
-  long index = ( bufferFrames_ - bufferCounter_ ) * nChannels;
+  long index = bufferIndex_++ * nChannels;
   for ( unsigned int i=0; i<nChannels; i++ )
     lastFrame_[i] = data_[index++];
 
   bufferCounter_--;
-  if ( bufferCounter_ < 0 )
-    bufferCounter_ = 0;
 
   return lastFrame_[channel];
 }
@@ -298,7 +349,7 @@ StkFrames& InetWvIn :: tick( StkFrames& frames )
 #endif
 
   // If no connection and we've output all samples in the queue, return.
-  if ( !connected_ && bytesFilled_ == 0 && bufferCounter_ == 0 ) {
+  if ( !connected_ && jitter_.getFillLevel() == 0 && bufferCounter_ == 0 ) {
 #if defined(_STK_DEBUG_)
     oStream_ << "InetWvIn::tick(): a valid socket connection does not exist!";
     handleError( StkError::DEBUG_PRINT );
@@ -17,6 +17,14 @@
     data type is signed 16-bit integers but any of the defined
     StkFormats are permissible.
 
+    Samples are converted in blocks, directly into a ring of packet
+    buffers.  All InetWvOut instances share a single I/O thread that
+    sends the queued packets in batches under Linux (a sendmmsg()
+    call for UDP, a single gathered write for TCP), so the calling
+    thread never writes to a socket.  If the ring is full, the tick()
+    functions wait for the I/O thread.  Socket errors are detected by
+    the I/O thread and reported by the next tick() call.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -24,18 +32,113 @@
 #include "InetWvOut.h"
 #include "TcpClient.h"
 #include "UdpSocket.h"
+#include "Thread.h"
+#include "Mutex.h"
 #include <sstream>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#if defined(__OS_LINUX__)
+  #include <sys/uio.h>
+  #include <errno.h>
+#endif
 
 namespace stk {
 
+// The number of packets queued between each instance and the I/O thread.
+const unsigned int PACKET_SLOTS = 16;
+
+// The I/O thread and the instances it serves.  The stream list is
+// only changed by connect() and disconnect(), which also start and
+// stop the thread, serialized by lifeMutex.
+static Mutex lifeMutex;
+static Mutex streamMutex;
+static std::vector<InetWvOut *> streams;
+static Thread ioThread;
+static std::atomic<bool> ioRunning( false );
+static std::atomic<bool> ioFinished( false );
+
+// Wakeups for the I/O thread (packets queued) and for the calling
+// threads (packets sent).  Each wait also times out after a
+// millisecond, which covers any missed wakeup.
+static std::mutex wakeMutex;
+static std::condition_variable wakeCondition;
+static std::mutex spaceMutex;
+static std::condition_variable spaceCondition;
+
+extern "C" THREAD_RETURN THREAD_TYPE outputThread( void * )
+{
+  while ( !ioFinished ) {
+    bool sent = false;
+    streamMutex.lock();
+    for ( unsigned int i=0; i<streams.size(); i++ )
+      if ( streams[i]->sendPackets() ) sent = true;
+    streamMutex.unlock();
+
+    if ( !sent ) {
+      std::unique_lock<std::mutex> lock( wakeMutex );
+      wakeCondition.wait_for( lock, std::chrono::milliseconds( 1 ) );
+    }
+  }
+
+  return 0;
+}
+
+// Register a stream with the I/O thread, starting the thread if
+// necessary.  Returns false, leaving the stream unregistered, if the
+// thread cannot be started.
+static bool addStream( InetWvOut *stream )
+{
+  lifeMutex.lock();
+  streamMutex.lock();
+  streams.push_back( stream );
+  streamMutex.unlock();
+
+  if ( !ioRunning ) {
+    ioFinished = false;
+    ioRunning = ioThread.start( &outputThread, NULL );
+    if ( !ioRunning ) {
+      streamMutex.lock();
+      streams.erase( std::remove( streams.begin(), streams.end(), stream ), streams.end() );
+      streamMutex.unlock();
+    }
+  }
+  bool running = ioRunning;
+  lifeMutex.unlock();
+  return running;
+}
+
+static void removeStream( InetWvOut *stream )
+{
+  lifeMutex.lock();
+  streamMutex.lock();
+  streams.erase( std::remove( streams.begin(), streams.end(), stream ), streams.end() );
+  bool stop = streams.empty() && ioRunning;
+  streamMutex.unlock();
+
+  if ( stop ) {
+    ioFinished = true;
+    wakeCondition.notify_one();
+    ioThread.wait();
+    ioRunning = false;
+  }
+  lifeMutex.unlock();
+}
+
 InetWvOut :: InetWvOut( unsigned long packetFrames )
-  : buffer_(0), soket_(0), bufferFrames_(packetFrames), bufferBytes_(0)
+  : packets_(0), packetLengths_(0), soket_(0), bufferFrames_(packetFrames), bufferBytes_(0),
+    protocol_(Socket::PROTO_TCP), packetHeader_(false), packetsFilled_(0), failed_(false)
 {
 }
 
 InetWvOut :: InetWvOut( int port, Socket::ProtocolType protocol, std::string hostname,
                         unsigned int nChannels, Stk::StkFormat format, unsigned long packetFrames )
-  : buffer_(0), soket_(0), bufferFrames_(packetFrames), bufferBytes_(0)
+  : packets_(0), packetLengths_(0), soket_(0), bufferFrames_(packetFrames), bufferBytes_(0),
+    protocol_(Socket::PROTO_TCP), packetHeader_(false), packetsFilled_(0), failed_(false)
 {
   connect( port, protocol, hostname, nChannels, format );
 }
@@ -44,14 +147,16 @@ InetWvOut :: ~InetWvOut()
 {
   disconnect();
   if ( soket_ ) delete soket_;
-  if ( buffer_ ) delete [] buffer_;
+  if ( packets_ ) delete [] packets_;
+  if ( packetLengths_ ) delete [] packetLengths_;
 }
 
 void InetWvOut :: connect( int port, Socket::ProtocolType protocol, std::string hostname,
                            unsigned int nChannels, Stk::StkFormat format )
 {
-  if ( soket_ && soket_->isValid( soket_->id() ) )
-    disconnect();
+  // Tear down any previous socket, even an invalid one, so that it is
+  // not leaked or registered twice with the I/O thread.
+  if ( soket_ ) disconnect();
 
   if ( nChannels == 0 ) {
     oStream_ << "InetWvOut::connect: the channel argument must be greater than zero!";
@@ -81,90 +186,246 @@ void InetWvOut :: connect( int port, Socket::ProtocolType protocol, std::string
     socket->setDestination( port, hostname );
     soket_ = (Socket *) socket;
   }
+  protocol_ = protocol;
 
-  // Allocate new memory if necessary.
+#if defined(__OS_LINUX__)
+  // The shared I/O thread must not wait on any one socket.
+  Socket::setBlocking( soket_->id(), false );
+#endif
+
+  // Allocate new memory if necessary.  Each packet has room for a header.
   data_.resize( bufferFrames_, nChannels );
   unsigned long bufferBytes = dataBytes_ * bufferFrames_ * nChannels;
   if ( bufferBytes > bufferBytes_ ) {
-    if ( buffer_) delete [] buffer_;
-    buffer_ = (char *) new char[ bufferBytes ];
+    if ( packets_ ) delete [] packets_;
+    packets_ = new unsigned char[ ( Socket::PACKET_HEADER_BYTES + bufferBytes ) * PACKET_SLOTS ];
     bufferBytes_ = bufferBytes;
   }
+  if ( !packetLengths_ ) packetLengths_ = new unsigned long[ PACKET_SLOTS ];
   frameCounter_ = 0;
   bufferIndex_ = 0;
   iData_ = 0;
+  sequence_ = 0;
+  writePacket_ = 0;
+  readPacket_ = 0;
+  sendOffset_ = 0;
+  packetsFilled_ = 0;
+  failed_ = false;
+
+  if ( !addStream( this ) ) {
+    // Nothing would send the packets of this stream.
+    soket_->close( soket_->id() );
+    delete soket_;
+    soket_ = 0;
+    oStream_ << "InetWvOut::connect: unable to start the I/O thread!";
+    handleError( StkError::PROCESS_THREAD );
+  }
 }
 
 void InetWvOut :: disconnect(void)
 {
   if ( soket_ ) {
-    writeData( bufferIndex_ );
+    if ( bufferIndex_ > 0 && !failed_ && ioRunning && soket_->isValid( soket_->id() ) )
+      writeData( bufferIndex_ );
+
+    // Wait for the I/O thread to send the queued packets.
+    std::unique_lock<std::mutex> lock( spaceMutex );
+    while ( packetsFilled_.load( std::memory_order_acquire ) > 0 && !failed_ && ioRunning )
+      spaceCondition.wait_for( lock, std::chrono::milliseconds( 1 ) );
+    lock.unlock();
+
+    removeStream( this );
     soket_->close( soket_->id() );
     delete soket_;
     soket_ = 0;
   }
 }
 
-void InetWvOut :: writeData( unsigned long frames )
+// Block conversion kernels, writing samples in big-endian (network)
+// byte order on any host.  The input has already been clipped.
+static inline void storeWord32( UINT32 word, unsigned char *out )
 {
-  unsigned long samples = frames * data_.channels();
-  if ( dataType_ == STK_SINT8 ) {
-    signed char *ptr = (signed char *) buffer_;
-    for ( unsigned long k=0; k<samples; k++ ) {
-      this->clipTest( data_[k] );
-      *ptr++ = (signed char) (data_[k] * 127.0);
-    }
+  out[0] = (unsigned char) ( word >> 24 );
+  out[1] = (unsigned char) ( word >> 16 );
+  out[2] = (unsigned char) ( word >> 8 );
+  out[3] = (unsigned char) word;
+}
+
+static void packSint8( const StkFloat *in, unsigned char *out, unsigned long n )
+{
+  for ( unsigned long i=0; i<n; i++ )
+    out[i] = (unsigned char) (signed char) ( in[i] * 127.0 );
+}
+
+static void packSint16( const StkFloat *in, unsigned char *out, unsigned long n )
+{
+  for ( unsigned long i=0; i<n; i++, out+=2 ) {
+    SINT16 sample = (SINT16) ( in[i] * 32767.0 );
+    out[0] = (unsigned char) ( sample >> 8 );
+    out[1] = (unsigned char) sample;
   }
-  else if ( dataType_ == STK_SINT16 ) {
-    SINT16 *ptr = (SINT16 *) buffer_;
-    for ( unsigned long k=0; k<samples; k++ ) {
-      this->clipTest( data_[k] );
-      *ptr = (SINT16) (data_[k] * 32767.0);
-#ifdef __LITTLE_ENDIAN__
-      swap16 ((unsigned char *)ptr);
-#endif
-      ptr++;
-    }
+}
+
+static void packSint32( const StkFloat *in, unsigned char *out, unsigned long n )
+{
+  for ( unsigned long i=0; i<n; i++, out+=4 )
+    storeWord32( (UINT32) (SINT32) ( in[i] * 2147483647.0 ), out );
+}
+
+static void packFloat32( const StkFloat *in, unsigned char *out, unsigned long n )
+{
+  UINT32 word;
+  for ( unsigned long i=0; i<n; i++, out+=4 ) {
+    FLOAT32 value = (FLOAT32) in[i];
+    memcpy( &word, &value, 4 );
+    storeWord32( word, out );
   }
-  else if ( dataType_ == STK_SINT32 ) {
-    SINT32 *ptr = (SINT32 *) buffer_;
-    for ( unsigned long k=0; k<samples; k++ ) {
-      this->clipTest( data_[k] );
-      *ptr = (SINT32) (data_[k] * 2147483647.0);
+}
+
+static void packFloat64( const StkFloat *in, unsigned char *out, unsigned long n )
+{
+  UINT32 words[2];
+  for ( unsigned long i=0; i<n; i++, out+=8 ) {
+    FLOAT64 value = (FLOAT64) in[i];
+    memcpy( words, &value, 8 );
 #ifdef __LITTLE_ENDIAN__
-      swap32 ((unsigned char *)ptr);
+    storeWord32( words[1], out );
+    storeWord32( words[0], out + 4 );
+#else
+    storeWord32( words[0], out );
+    storeWord32( words[1], out + 4 );
 #endif
-      ptr++;
-    }
   }
-  else if ( dataType_ == STK_FLOAT32 ) {
-    FLOAT32 *ptr = (FLOAT32 *) buffer_;
-    for ( unsigned long k=0; k<samples; k++ ) {
-      this->clipTest( data_[k] );
-      *ptr = (FLOAT32) data_[k];
-#ifdef __LITTLE_ENDIAN__
-      swap32 ((unsigned char *)ptr);
-#endif
-      ptr++;
+}
+
+void InetWvOut :: writeData( unsigned long frames )
+{
+  // Wait for a free packet if the I/O thread has fallen behind.  The
+  // stream fails if there is no I/O thread to send its packets.
+  if ( packetsFilled_.load( std::memory_order_acquire ) == PACKET_SLOTS && !failed_ ) {
+    std::unique_lock<std::mutex> lock( spaceMutex );
+    while ( packetsFilled_.load( std::memory_order_acquire ) == PACKET_SLOTS && !failed_ && ioRunning )
+      spaceCondition.wait_for( lock, std::chrono::milliseconds( 1 ) );
+  }
+  if ( !ioRunning ) failed_ = true;
+
+  if ( failed_ ) {
+    oStream_ << "InetWvOut: connection to socket server failed!";
+    handleError( StkError::PROCESS_SOCKET );
+  }
+
+  unsigned char *packet = packets_ + writePacket_ * ( Socket::PACKET_HEADER_BYTES + bufferBytes_ );
+  unsigned char *out = packet;
+  if ( protocol_ == Socket::PROTO_UDP && packetHeader_ ) {
+    storeWord32( Socket::PACKET_MAGIC, out );
+    storeWord32( sequence_++, out + 4 );
+    out += Socket::PACKET_HEADER_BYTES;
+  }
+
+  unsigned long samples = frames * data_.channels();
+  if ( dataType_ == STK_SINT8 ) packSint8( &data_[0], out, samples );
+  else if ( dataType_ == STK_SINT16 ) packSint16( &data_[0], out, samples );
+  else if ( dataType_ == STK_SINT32 ) packSint32( &data_[0], out, samples );
+  else if ( dataType_ == STK_FLOAT32 ) packFloat32( &data_[0], out, samples );
+  else if ( dataType_ == STK_FLOAT64 ) packFloat64( &data_[0], out, samples );
+
+  packetLengths_[writePacket_] = ( out - packet ) + dataBytes_ * samples;
+  writePacket_ = ( writePacket_ + 1 ) % PACKET_SLOTS;
+  packetsFilled_.fetch_add( 1, std::memory_order_release );
+  wakeCondition.notify_one();
+}
+
+void InetWvOut :: releasePackets( unsigned int count )
+{
+  if ( count == 0 ) return;
+  readPacket_ = ( readPacket_ + count ) % PACKET_SLOTS;
+  packetsFilled_.fetch_sub( count, std::memory_order_release );
+  spaceCondition.notify_all();
+}
+
+bool InetWvOut :: sendPackets( void )
+{
+  unsigned int count = packetsFilled_.load( std::memory_order_acquire );
+  if ( count == 0 || failed_ ) return false;
+
+  unsigned long packetBytes = Socket::PACKET_HEADER_BYTES + bufferBytes_;
+  unsigned int i, index;
+
+#if defined(__OS_LINUX__)
+
+  int fd = soket_->id();
+  struct iovec vectors[PACKET_SLOTS];
+  for ( i=0; i<count; i++ ) {
+    index = ( readPacket_ + i ) % PACKET_SLOTS;
+    vectors[i].iov_base = packets_ + index * packetBytes;
+    vectors[i].iov_len = packetLengths_[index];
+  }
+
+  if ( protocol_ == Socket::PROTO_UDP ) {
+    // Send each packet as a datagram, all in a single call.
+    const struct sockaddr_in *address = ( (UdpSocket *) soket_ )->destination();
+    if ( !address ) {
+      failed_ = true;
+      return false;
+    }
+    struct mmsghdr messages[PACKET_SLOTS];
+    for ( i=0; i<count; i++ ) {
+      memset( &messages[i].msg_hdr, 0, sizeof( struct msghdr ) );
+      messages[i].msg_hdr.msg_name = (void *) address;
+      messages[i].msg_hdr.msg_namelen = sizeof( struct sockaddr_in );
+      messages[i].msg_hdr.msg_iov = &vectors[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    int sent = sendmmsg( fd, messages, count, 0 );
+    if ( sent < 0 ) {
+      if ( errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS ) failed_ = true;
+      return false;
     }
+    this->releasePackets( sent );
+    return sent > 0;
   }
-  else if ( dataType_ == STK_FLOAT64 ) {
-    FLOAT64 *ptr = (FLOAT64 *) buffer_;
-    for ( unsigned long k=0; k<samples; k++ ) {
-      this->clipTest( data_[k] );
-      *ptr = (FLOAT64) data_[k];
-#ifdef __LITTLE_ENDIAN__
-      swap64 ((unsigned char *)ptr);
-#endif
-      ptr++;
+
+  // Gather the queued packets into a single stream write, resuming
+  // any packet that was partially sent.
+  vectors[0].iov_base = (char *) vectors[0].iov_base + sendOffset_;
+  vectors[0].iov_len -= sendOffset_;
+  struct msghdr message;
+  memset( &message, 0, sizeof( message ) );
+  message.msg_iov = vectors;
+  message.msg_iovlen = count;
+  long bytes = sendmsg( fd, &message, MSG_NOSIGNAL );
+  if ( bytes < 0 ) {
+    if ( errno != EAGAIN && errno != EWOULDBLOCK ) failed_ = true;
+    return false;
+  }
+
+  unsigned int released = 0;
+  unsigned long remaining = (unsigned long) bytes;
+  for ( i=0; i<count && remaining > 0; i++ ) {
+    if ( remaining < vectors[i].iov_len ) {
+      sendOffset_ += remaining;
+      break;
     }
+    remaining -= vectors[i].iov_len;
+    sendOffset_ = 0;
+    released++;
   }
+  this->releasePackets( released );
+  return bytes > 0;
 
-  long bytes = dataBytes_ * samples;
-  if ( soket_->writeBuffer( (const void *)buffer_, bytes, 0 ) < 0 ) {
-    oStream_ << "InetWvOut: connection to socket server failed!";
-    handleError( StkError::PROCESS_SOCKET );
+#else
+
+  for ( i=0; i<count; i++ ) {
+    index = ( readPacket_ + i ) % PACKET_SLOTS;
+    if ( soket_->writeBuffer( (const void *) ( packets_ + index * packetBytes ), packetLengths_[index], 0 ) < 0 ) {
+      failed_ = true;
+      break;
+    }
   }
+  this->releasePackets( i );
+  return i > 0;
+
+#endif
 }
 
 void InetWvOut :: incrementFrame( void )
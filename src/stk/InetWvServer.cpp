@@ -0,0 +1,692 @@
+/***************************************************/
+/*! \class InetWvServer
+    \brief STK multi-client internet streaming input class.
+
+    This WvIn subclass receives streamed audio data from many remote
+    senders at once, such as several InetWvOut instances, on a single
+    TCP or UDP port, and mixes them into one stream.  The data is
+    assumed in big-endian, or network, byte order, and all senders
+    must use the channel count and format given to listen().
+
+    With the TCP protocol, each accepted connection is a client.
+    With the UDP protocol, each sending address is a client, which
+    is dropped after it has been silent for a few seconds.  A single
+    thread (using epoll under Linux) accepts connections and receives
+    the data of all clients into a lock-free JitterBuffer per client.
+    Connections beyond the number of client slots given to the
+    constructor are refused.
+
+    The sample clock of each sender differs slightly from that of
+    the computing thread, so a client's queue would slowly fill up or
+    run dry.  Each client is therefore resampled by linear
+    interpolation at a rate adjusted, by up to 0.5 percent, to hold
+    its queue at the target latency.  The rate follows the average
+    queue level with a proportional-integral controller, so a
+    constant drift is corrected without a standing offset.  The
+    queues do not skip ahead on their own, so the controller is the
+    only correction applied to the queue level.
+
+    The tick() functions return the sum of all clients and never
+    block.  The frame of a single client that went into the last
+    computed frame is available from clientOut(), so the clients can
+    also be used as separate inputs.
+
+    InetWvServer supports multi-channel data.  It is important to
+    distinguish the tick() method that computes a single frame (and
+    returns only the specified sample of a multi-channel frame) from
+    the overloaded one that takes an StkFrames object for
+    multi-channel and/or multi-frame data.
+*/
+/***************************************************/
+
+#include "InetWvServer.h"
+#include "TcpServer.h"
+#include "UdpSocket.h"
+#include <cstring>
+#include <cmath>
+#include <chrono>
+
+#if defined(__OS_LINUX__)
+  #include <sys/epoll.h>
+  #include <sys/eventfd.h>
+#endif
+
+namespace stk {
+
+// The largest possible UDP packet and the number received per call.
+const unsigned long PACKET_BYTES = 65536;
+const unsigned int RECEIVE_BATCH = 16;
+
+// Input thread event tags.  Client events are tagged with the slot index.
+const UINT32 SERVER_EVENT = 0xFFFFFFFE;
+const UINT32 WAKEUP_EVENT = 0xFFFFFFFF;
+
+// UDP clients are dropped after this many milliseconds without a packet.
+const long long CLIENT_TIMEOUT = 2000;
+
+// The largest resampling rate correction used to follow clock drift,
+// and the controller gains per second of queue level error.
+const StkFloat MAX_DRIFT = 0.005;
+const StkFloat DRIFT_PROPORTIONAL = 0.5;
+const StkFloat DRIFT_INTEGRAL = 0.1;
+
+static long long milliseconds( void )
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+extern "C" THREAD_RETURN THREAD_TYPE serverThread( void * ptr )
+{
+  InetWvServer *server = (InetWvServer *) ptr;
+
+  while ( !server->isFinished() ) {
+    server->receive();
+  }
+
+  return 0;
+}
+
+InetWvServer :: InetWvServer( unsigned int maxClients, unsigned long bufferFrames, unsigned int nBuffers )
+  :soket_(0), clients_(0), maxClients_(maxClients), packets_(0), bufferFrames_(bufferFrames),
+   nBuffers_(nBuffers), bufferCounter_(0), bufferIndex_(0), finished_(false), receiving_(false),
+   fd_(-1), epoll_(-1), wakeup_(-1), protocol_(Socket::PROTO_TCP)
+{
+  if ( maxClients == 0 ) {
+    oStream_ << "InetWvServer(): the client argument must be greater than zero.";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  clients_ = new Client[maxClients];
+  for ( unsigned int i=0; i<maxClients; i++ ) {
+    clients_[i].state = CLIENT_FREE;
+    clients_[i].fd = -1;
+    clients_[i].playing = false;
+  }
+
+#if defined(__OS_LINUX__)
+  // The input thread waits on the sockets and on an event used to
+  // wake it when it should stop.
+  epoll_ = epoll_create( maxClients + 2 );
+  wakeup_ = eventfd( 0, 0 );
+  if ( epoll_ < 0 || wakeup_ < 0 ) {
+    oStream_ << "InetWvServer(): unable to create the input thread events!";
+    handleError( StkError::PROCESS_THREAD );
+  }
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.u32 = WAKEUP_EVENT;
+  epoll_ctl( epoll_, EPOLL_CTL_ADD, wakeup_, &event );
+#endif
+}
+
+InetWvServer :: ~InetWvServer()
+{
+  this->stopReceiving();
+
+  for ( unsigned int i=0; i<maxClients_; i++ )
+    if ( clients_[i].fd >= 0 ) Socket::close( clients_[i].fd );
+  delete [] clients_;
+
+  if ( soket_ ) delete soket_;
+  if ( packets_ ) delete [] packets_;
+
+#if defined(__OS_LINUX__)
+  if ( epoll_ >= 0 ) ::close( epoll_ );
+  if ( wakeup_ >= 0 ) ::close( wakeup_ );
+#endif
+}
+
+void InetWvServer :: startReceiving( void )
+{
+  finished_ = false;
+  if ( !thread_.start( &serverThread, this ) ) {
+    oStream_ << "InetWvServer(): unable to start input thread!";
+    handleError( StkError::PROCESS_THREAD );
+  }
+  receiving_ = true;
+}
+
+void InetWvServer :: stopReceiving( void )
+{
+  if ( !receiving_ ) return;
+
+  finished_.store( true, std::memory_order_release );
+#if defined(__OS_LINUX__)
+  uint64_t one = 1;
+  if ( ::write( wakeup_, &one, sizeof( one ) ) < 0 ) {}
+#endif
+  thread_.wait();
+  receiving_ = false;
+
+#if defined(__OS_LINUX__)
+  uint64_t count;
+  if ( ::read( wakeup_, &count, sizeof( count ) ) < 0 ) {}
+#endif
+}
+
+void InetWvServer :: listen( int port, unsigned int nChannels,
+                             Stk::StkFormat format, Socket::ProtocolType protocol )
+{
+  // The input thread is stopped while the clients and socket are replaced.
+  this->stopReceiving();
+
+  for ( unsigned int i=0; i<maxClients_; i++ ) {
+    Client& client = clients_[i];
+    if ( client.fd >= 0 ) {
+#if defined(__OS_LINUX__)
+      epoll_ctl( epoll_, EPOLL_CTL_DEL, client.fd, NULL );
+#endif
+      Socket::close( client.fd );
+      client.fd = -1;
+    }
+    client.state = CLIENT_FREE;
+    client.playing = false;
+  }
+
+  if ( soket_ ) {
+#if defined(__OS_LINUX__)
+    epoll_ctl( epoll_, EPOLL_CTL_DEL, fd_, NULL );
+#endif
+    delete soket_;
+    soket_ = 0;
+    fd_ = -1;
+  }
+
+  if ( nChannels < 1 ) {
+    oStream_ << "InetWvServer::listen(): the channel argument must be greater than zero.";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  if ( format != STK_SINT16 && format != STK_SINT32 && format != STK_FLOAT32 &&
+       format != STK_FLOAT64 && format != STK_SINT8 ) {
+    oStream_ << "InetWvServer::listen(): unknown data type specified!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  // Allocate for the fastest allowed rate so that resampling never
+  // allocates memory.
+  for ( unsigned int i=0; i<maxClients_; i++ ) {
+    Client& client = clients_[i];
+    client.buffer.setFormat( nChannels, format, bufferFrames_ * nBuffers_ );
+    // The rate controller corrects the queue level without the jumps
+    // of skipping, which would also upset its integral term.
+    client.buffer.setSkipping( false );
+    client.input.resize( (size_t) ( bufferFrames_ * ( 1.0 + MAX_DRIFT ) ) + 2, nChannels );
+    client.output.resize( bufferFrames_, nChannels, 0.0 );
+    client.history.resize( 2, nChannels, 0.0 );
+  }
+
+  data_.resize( bufferFrames_, nChannels );
+  lastFrame_.resize( 1, nChannels, 0.0 );
+  bufferCounter_ = 0;
+  bufferIndex_ = 0;
+  protocol_ = protocol;
+
+  if ( protocol == Socket::PROTO_TCP ) {
+    soket_ = new TcpServer( port );
+  }
+  else {
+    soket_ = new UdpSocket( port );
+    if ( !packets_ ) packets_ = new unsigned char[ PACKET_BYTES * RECEIVE_BATCH ];
+  }
+  fd_ = soket_->id();
+
+  oStream_ << "InetWvServer::listen(): accepting clients on port " << soket_->port() << ".";
+  handleError( StkError::STATUS );
+
+#if defined(__OS_LINUX__)
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.u32 = SERVER_EVENT;
+  epoll_ctl( epoll_, EPOLL_CTL_ADD, fd_, &event );
+#endif
+
+  this->startReceiving();
+}
+
+void InetWvServer :: setLatency( unsigned long frames )
+{
+  for ( unsigned int i=0; i<maxClients_; i++ )
+    clients_[i].buffer.setLatency( frames );
+}
+
+unsigned int InetWvServer :: getClientCount( void ) const
+{
+  unsigned int count = 0;
+  for ( unsigned int i=0; i<maxClients_; i++ )
+    if ( clients_[i].state.load( std::memory_order_acquire ) != CLIENT_FREE ) count++;
+  return count;
+}
+
+bool InetWvServer :: isClientConnected( unsigned int client ) const
+{
+  if ( client >= maxClients_ ) return false;
+  return clients_[client].state.load( std::memory_order_acquire ) != CLIENT_FREE;
+}
+
+unsigned long InetWvServer :: getLatency( unsigned int client ) const
+{
+  if ( !this->isClientConnected( client ) ) return 0;
+  return clients_[client].buffer.getLatency();
+}
+
+unsigned long InetWvServer :: getLatePackets( unsigned int client ) const
+{
+  if ( !this->isClientConnected( client ) ) return 0;
+  return clients_[client].buffer.getLatePackets();
+}
+
+unsigned long InetWvServer :: getLostPackets( unsigned int client ) const
+{
+  if ( !this->isClientConnected( client ) ) return 0;
+  return clients_[client].buffer.getLostPackets();
+}
+
+unsigned long InetWvServer :: getUnderruns( unsigned int client ) const
+{
+  if ( !this->isClientConnected( client ) ) return 0;
+  return clients_[client].buffer.getUnderruns();
+}
+
+StkFloat InetWvServer :: getDrift( unsigned int client ) const
+{
+  if ( client >= maxClients_ || !clients_[client].playing ) return 0.0;
+  return clients_[client].rate - 1.0;
+}
+
+int InetWvServer :: openClient( void )
+{
+  for ( unsigned int i=0; i<maxClients_; i++ ) {
+    Client& client = clients_[i];
+    if ( client.state.load( std::memory_order_acquire ) != CLIENT_FREE ) continue;
+
+    // The computing thread does not touch a free slot, so it can be
+    // reset here.  It is handed over by setting it active.
+    client.buffer.reset();
+    client.fd = -1;
+    memset( &client.address, 0, sizeof( client.address ) );
+    client.lastReceived = milliseconds();
+    return (int) i;
+  }
+
+  return -1;
+}
+
+int InetWvServer :: findClient( const struct sockaddr_in& address )
+{
+  for ( unsigned int i=0; i<maxClients_; i++ ) {
+    Client& client = clients_[i];
+    if ( client.state.load( std::memory_order_relaxed ) == CLIENT_ACTIVE &&
+         client.address.sin_addr.s_addr == address.sin_addr.s_addr &&
+         client.address.sin_port == address.sin_port )
+      return (int) i;
+  }
+
+  return -1;
+}
+
+void InetWvServer :: closeClient( unsigned int index )
+{
+  Client& client = clients_[index];
+  if ( client.fd >= 0 ) {
+#if defined(__OS_LINUX__)
+    epoll_ctl( epoll_, EPOLL_CTL_DEL, client.fd, NULL );
+#endif
+    Socket::close( client.fd );
+    client.fd = -1;
+  }
+
+  client.state.store( CLIENT_CLOSED, std::memory_order_release );
+  oStream_ << "InetWvServer: client " << index << " disconnected.";
+  handleError( StkError::STATUS );
+}
+
+void InetWvServer :: checkIdleClients( void )
+{
+  long long now = milliseconds();
+  for ( unsigned int i=0; i<maxClients_; i++ ) {
+    if ( clients_[i].state.load( std::memory_order_relaxed ) == CLIENT_ACTIVE &&
+         now - clients_[i].lastReceived > CLIENT_TIMEOUT )
+      this->closeClient( i );
+  }
+}
+
+void InetWvServer :: acceptClients( void )
+{
+  // The listening socket is readable, so this does not block.
+  int fd = ((TcpServer *) soket_)->accept();
+  if ( fd < 0 ) return;
+
+  int index = this->openClient();
+  if ( index < 0 ) {
+    oStream_ << "InetWvServer: all client slots are in use ... connection refused.";
+    handleError( StkError::WARNING );
+    Socket::close( fd );
+    return;
+  }
+
+  Client& client = clients_[index];
+  client.fd = fd;
+
+#if defined(__OS_LINUX__)
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.u32 = (UINT32) index;
+  epoll_ctl( epoll_, EPOLL_CTL_ADD, fd, &event );
+#endif
+
+  client.state.store( CLIENT_ACTIVE, std::memory_order_release );
+  oStream_ << "InetWvServer: client " << index << " connected.";
+  handleError( StkError::STATUS );
+}
+
+void InetWvServer :: receiveDatagrams( void )
+{
+  struct sockaddr_in addresses[RECEIVE_BATCH];
+  int nPackets;
+  unsigned long lengths[RECEIVE_BATCH];
+
+#if defined(__OS_LINUX__)
+  // Receive all waiting packets, up to a batch at a time.
+  struct mmsghdr messages[RECEIVE_BATCH];
+  struct iovec vectors[RECEIVE_BATCH];
+  for ( unsigned int i=0; i<RECEIVE_BATCH; i++ ) {
+    vectors[i].iov_base = packets_ + i * PACKET_BYTES;
+    vectors[i].iov_len = PACKET_BYTES;
+    memset( &messages[i].msg_hdr, 0, sizeof( struct msghdr ) );
+    messages[i].msg_hdr.msg_name = &addresses[i];
+    messages[i].msg_hdr.msg_namelen = sizeof( struct sockaddr_in );
+    messages[i].msg_hdr.msg_iov = &vectors[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+  nPackets = recvmmsg( fd_, messages, RECEIVE_BATCH, MSG_DONTWAIT, NULL );
+  for ( int i=0; i<nPackets; i++ ) lengths[i] = messages[i].msg_len;
+#else
+#if defined(__OS_WINDOWS__)
+  int length = sizeof( struct sockaddr_in );
+#else
+  socklen_t length = sizeof( struct sockaddr_in );
+#endif
+  nPackets = 0;
+  int bytes = recvfrom( fd_, (char *) packets_, PACKET_BYTES, 0, (struct sockaddr *) &addresses[0], &length );
+  if ( bytes > 0 ) {
+    lengths[0] = bytes;
+    nPackets = 1;
+  }
+#endif
+
+  long long now = milliseconds();
+  for ( int i=0; i<nPackets; i++ ) {
+    int index = this->findClient( addresses[i] );
+    if ( index < 0 ) {
+      index = this->openClient();
+      if ( index < 0 ) continue;
+      clients_[index].address = addresses[i];
+      clients_[index].state.store( CLIENT_ACTIVE, std::memory_order_release );
+      oStream_ << "InetWvServer: client " << index << " connected.";
+      handleError( StkError::STATUS );
+    }
+
+    clients_[index].lastReceived = now;
+    clients_[index].buffer.writeDatagram( packets_ + i * PACKET_BYTES, lengths[i] );
+  }
+}
+
+bool InetWvServer :: receiveStream( unsigned int index )
+{
+  Client& client = clients_[index];
+  if ( client.state.load( std::memory_order_relaxed ) != CLIENT_ACTIVE ) return true;
+
+  // Receive TCP data directly into the client's jitter buffer.
+  unsigned long unfilled;
+  char *space = client.buffer.writeSpace( &unfilled );
+  if ( unfilled == 0 ) return false;
+
+  int i = Socket::readBuffer( client.fd, (void *) space, unfilled, 0 );
+  if ( i <= 0 ) this->closeClient( index );
+  else client.buffer.commit( i );
+  return true;
+}
+
+void InetWvServer :: receive( void )
+{
+  if ( !soket_ ) {
+    Stk::sleep( 100 );
+    return;
+  }
+
+  bool stalled = false, received = false;
+
+#if defined(__OS_LINUX__)
+
+  // Wait until a socket is ready or the thread is stopped, checking
+  // periodically for idle UDP clients.
+  struct epoll_event events[RECEIVE_BATCH];
+  int nEvents = epoll_wait( epoll_, events, RECEIVE_BATCH, 100 );
+  for ( int i=0; i<nEvents; i++ ) {
+    UINT32 tag = events[i].data.u32;
+    if ( tag == WAKEUP_EVENT ) return;
+    if ( tag == SERVER_EVENT ) {
+      if ( protocol_ == Socket::PROTO_TCP ) this->acceptClients();
+      else this->receiveDatagrams();
+      received = true;
+    }
+    else if ( tag < maxClients_ ) {
+      if ( this->receiveStream( tag ) ) received = true;
+      else stalled = true;
+    }
+  }
+
+#else
+
+  fd_set mask;
+  FD_ZERO( &mask );
+  FD_SET( fd_, &mask );
+  int maxFd = fd_;
+  for ( unsigned int i=0; i<maxClients_; i++ ) {
+    int fd = clients_[i].fd;
+    if ( fd >= 0 && clients_[i].state.load( std::memory_order_relaxed ) == CLIENT_ACTIVE ) {
+      FD_SET( fd, &mask );
+      if ( fd > maxFd ) maxFd = fd;
+    }
+  }
+
+  // Wait until a socket is ready, checking periodically whether the
+  // thread should stop.
+  struct timeval timeout;
+  timeout.tv_sec = 0;
+  timeout.tv_usec = 100000;
+  if ( select( maxFd+1, &mask, (fd_set *)0, (fd_set *)0, &timeout ) > 0 ) {
+    if ( FD_ISSET( fd_, &mask ) ) {
+      if ( protocol_ == Socket::PROTO_TCP ) this->acceptClients();
+      else this->receiveDatagrams();
+      received = true;
+    }
+    for ( unsigned int i=0; i<maxClients_; i++ ) {
+      int fd = clients_[i].fd;
+      if ( fd < 0 || !FD_ISSET( fd, &mask ) ) continue;
+      if ( this->receiveStream( i ) ) received = true;
+      else stalled = true;
+    }
+  }
+
+#endif
+
+  if ( protocol_ == Socket::PROTO_UDP ) this->checkIdleClients();
+
+  // A full client buffer leaves its data waiting in the socket.  Give
+  // the computing thread time to read rather than spinning on it.
+  if ( stalled && !received ) Stk::sleep( 1 );
+}
+
+void InetWvServer :: updateRate( Client& client )
+{
+  // Follow the queue level after each read with a one-second time
+  // constant, which smooths over the arrival of individual packets.
+  StkFloat period = bufferFrames_ / Stk::sampleRate();
+  StkFloat fill = (StkFloat) client.buffer.getFillLevel();
+  client.fill += ( ( period < 1.0 ) ? period : 1.0 ) * ( fill - client.fill );
+
+  // Leave the first second, while the queue fills up, uncorrected.
+  if ( client.settle < (unsigned long) Stk::sampleRate() ) {
+    client.settle += bufferFrames_;
+    client.fill = fill;
+    return;
+  }
+
+  // The integral term converges on the clock drift and the
+  // proportional term returns the queue to the target.
+  StkFloat error = ( client.fill - client.buffer.getLatency() ) / Stk::sampleRate();
+  client.drift += DRIFT_INTEGRAL * error * period;
+  if ( client.drift > MAX_DRIFT ) client.drift = MAX_DRIFT;
+  else if ( client.drift < -MAX_DRIFT ) client.drift = -MAX_DRIFT;
+
+  StkFloat correction = client.drift + DRIFT_PROPORTIONAL * error;
+  if ( correction > MAX_DRIFT ) correction = MAX_DRIFT;
+  else if ( correction < -MAX_DRIFT ) correction = -MAX_DRIFT;
+  client.rate = 1.0 + correction;
+}
+
+void InetWvServer :: resampleClient( Client& client, bool drain )
+{
+  // Output frame j is interpolated at position phase + j * rate, where
+  // positions -1 and 0 are the history frames and 1 onwards are new
+  // input frames.  Read just enough input to cover the last position.
+  unsigned int nChannels = client.output.channels();
+  StkFloat rate = client.rate;
+  long nInput = (long) ceil( client.phase + ( bufferFrames_ - 1 ) * rate );
+  if ( nInput > 0 ) {
+    client.input.resize( nInput, nChannels );
+    client.buffer.read( client.input, drain );
+  }
+
+  const StkFloat *history = &client.history[0];
+  const StkFloat *input = &client.input[0];
+  StkFloat *output = &client.output[0];
+  StkFloat time = client.phase;
+  for ( unsigned long j=0; j<bufferFrames_; j++, time += rate ) {
+    long i = (long) floor( time );
+    StkFloat alpha = time - i;
+    if ( i >= nInput ) {
+      // The last position fell exactly on the last input frame.
+      i = nInput - 1;
+      alpha = 1.0;
+    }
+    const StkFloat *a = ( i < 1 ) ? &history[ ( i + 1 ) * nChannels ] : &input[ ( i - 1 ) * nChannels ];
+    const StkFloat *b = ( i < 0 ) ? &history[nChannels] : &input[ i * nChannels ];
+    for ( unsigned int k=0; k<nChannels; k++ )
+      *output++ = a[k] + alpha * ( b[k] - a[k] );
+  }
+
+  // Keep the last two input frames for the next buffer.
+  if ( nInput > 0 ) {
+    if ( nInput > 1 ) {
+      for ( unsigned int k=0; k<nChannels; k++ )
+        client.history[k] = client.input( nInput - 2, k );
+    }
+    else {
+      for ( unsigned int k=0; k<nChannels; k++ )
+        client.history[k] = client.history[nChannels + k];
+    }
+    for ( unsigned int k=0; k<nChannels; k++ )
+      client.history[nChannels + k] = client.input( nInput - 1, k );
+  }
+
+  client.phase += bufferFrames_ * rate - ( nInput > 0 ? nInput : 0 );
+
+  if ( drain ) client.rate = 1.0;
+  else this->updateRate( client );
+}
+
+void InetWvServer :: computeFrames( void )
+{
+  for ( unsigned int i=0; i<data_.size(); i++ ) data_[i] = 0.0;
+
+  for ( unsigned int i=0; i<maxClients_; i++ ) {
+    Client& client = clients_[i];
+    int state = client.state.load( std::memory_order_acquire );
+    if ( state == CLIENT_FREE ) continue;
+
+    if ( !client.playing ) {
+      for ( unsigned int k=0; k<client.history.size(); k++ ) client.history[k] = 0.0;
+      client.phase = 0.0;
+      client.rate = 1.0;
+      client.fill = 0.0;
+      client.drift = 0.0;
+      client.settle = 0;
+      client.playing = true;
+    }
+
+    // Once a closed client has been drained, return its slot to the
+    // input thread.
+    if ( state == CLIENT_CLOSED && client.buffer.getFillLevel() == 0 ) {
+      client.playing = false;
+      client.state.store( CLIENT_FREE, std::memory_order_release );
+      continue;
+    }
+
+    this->resampleClient( client, state == CLIENT_CLOSED );
+    for ( unsigned int k=0; k<data_.size(); k++ ) data_[k] += client.output[k];
+  }
+
+  bufferCounter_ = bufferFrames_;
+  bufferIndex_ = 0;
+}
+
+StkFloat InetWvServer :: tick( unsigned int channel )
+{
+  if ( !soket_ ) {
+#if defined(_STK_DEBUG_)
+    oStream_ << "InetWvServer::tick(): the server is not listening!";
+    handleError( StkError::DEBUG_PRINT );
+#endif
+    return 0.0;
+  }
+
+#if defined(_STK_DEBUG_)
+  if ( channel >= data_.channels() ) {
+    oStream_ << "InetWvServer::tick(): channel argument is incompatible with data stream!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  if ( bufferCounter_ == 0 ) this->computeFrames();
+
+  unsigned int nChannels = lastFrame_.channels();
+  long index = bufferIndex_++ * nChannels;
+  for ( unsigned int i=0; i<nChannels; i++ )
+    lastFrame_[i] = data_[index++];
+
+  bufferCounter_--;
+
+  return lastFrame_[channel];
+}
+
+StkFrames& InetWvServer :: tick( StkFrames& frames )
+{
+#if defined(_STK_DEBUG_)
+  if ( data_.channels() != frames.channels() ) {
+    oStream_ << "InetWvServer::tick(): StkFrames argument is incompatible with streamed channels!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  if ( !soket_ ) {
+#if defined(_STK_DEBUG_)
+    oStream_ << "InetWvServer::tick(): the server is not listening!";
+    handleError( StkError::DEBUG_PRINT );
+#endif
+    return frames;
+  }
+
+  unsigned int j, counter = 0;
+  for ( unsigned int i=0; i<frames.frames(); i++ ) {
+    this->tick();
+    for ( j=0; j<lastFrame_.channels(); j++ )
+      frames[counter++] = lastFrame_[j];
+  }
+
+  return frames;
+}
+
+} // stk namespace
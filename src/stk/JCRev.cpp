@@ -15,6 +15,12 @@
     one-pole lowpass filters have been added inside
     the feedback comb filters.
 
+    The StkFrames tick() functions run each allpass
+    and comb filter over blocks of samples no longer
+    than its delay, with the four combs computed
+    together, and give the same output as the
+    single-sample tick() function.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -47,22 +53,33 @@ JCRev :: JCRev( StkFloat T60 )
     }
   }
 
+  unsigned long minDelay = maxBlockSize;
   for ( i=0; i<3; i++ ) {
-	  allpassDelays_[i].setMaximumDelay( lengths[i+4] );
-	  allpassDelays_[i].setDelay( lengths[i+4] );
+    allpassDelays_[i] = lengths[i+4];
+    setLine( allpassLines_[i], allpassDelays_[i] + 1 );
+    if ( allpassDelays_[i] + 1 < minDelay ) minDelay = allpassDelays_[i] + 1;
+  }
+
+  for ( i=0; i<nCombs; i++ ) {
+    combDelays_[i] = lengths[i];
+    setLine( combLines_[i], combDelays_[i] + 1 );
+    if ( combDelays_[i] + 1 < minDelay ) minDelay = combDelays_[i] + 1;
   }
 
-  for ( i=0; i<4; i++ ) {
-    combDelays_[i].setMaximumDelay( lengths[i] );
-    combDelays_[i].setDelay( lengths[i] );
-    combFilters_[i].setPole( 0.2 );
+  for ( i=0; i<2; i++ ) {
+    outDelays_[i] = lengths[i+7];
+    setLine( outLines_[i], outDelays_[i] + 1 );
+    if ( outDelays_[i] < minDelay ) minDelay = outDelays_[i];
   }
 
+  combFilterB0_ = 1.0 - 0.2;
+  combFilterA1_ = -0.2;
+
+  blockSize_ = minDelay;
+  inputs_.resize( blockSize_ );
+  work_.resize( blockSize_ );
+
   this->setT60( T60 );
-  outLeftDelay_.setMaximumDelay( lengths[7] );
-  outLeftDelay_.setDelay( lengths[7] );
-  outRightDelay_.setMaximumDelay( lengths[8] );
-  outRightDelay_.setDelay( lengths[8] );
   allpassCoefficient_ = 0.7;
   effectMix_ = 0.3;
   this->clear();
@@ -70,15 +87,16 @@ JCRev :: JCRev( StkFloat T60 )
 
 void JCRev :: clear()
 {
-  allpassDelays_[0].clear();
-  allpassDelays_[1].clear();
-  allpassDelays_[2].clear();
-  combDelays_[0].clear();
-  combDelays_[1].clear();
-  combDelays_[2].clear();
-  combDelays_[3].clear();
-  outRightDelay_.clear();
-  outLeftDelay_.clear();
+  int i;
+  for ( i=0; i<3; i++ )
+    allpassLines_[i].assign( allpassLines_[i].size(), 0.0 );
+  for ( i=0; i<nCombs; i++ ) {
+    combLines_[i].assign( combLines_[i].size(), 0.0 );
+    combStates_[i] = 0.0;
+  }
+  outLines_[0].assign( outLines_[0].size(), 0.0 );
+  outLines_[1].assign( outLines_[1].size(), 0.0 );
+  time_ = 0;
   lastFrame_[0] = 0.0;
   lastFrame_[1] = 0.0;
 }
@@ -90,8 +108,87 @@ void JCRev :: setT60( StkFloat T60 )
     handleError( StkError::WARNING ); return;
   }
 
-  for ( int i=0; i<4; i++ )
-    combCoefficient_[i] = pow(10.0, (-3.0 * combDelays_[i].getDelay() / (T60 * Stk::sampleRate())));
+  for ( int i=0; i<nCombs; i++ )
+    combCoefficient_[i] = pow(10.0, (-3.0 * combDelays_[i] / (T60 * Stk::sampleRate())));
+}
+
+void JCRev :: computeBlock( unsigned int nFrames, StkFloat *samples, unsigned int hop )
+{
+  StkFloat *x = &work_[0];
+  const StkFloat *input = &inputs_[0];
+  unsigned int k, done, count;
+  int i;
+
+  for ( k=0; k<nFrames; k++ ) x[k] = input[k];
+  for ( i=0; i<3; i++ )
+    allpassBlock( allpassLines_[i], time_, allpassDelays_[i], allpassCoefficient_, x, nFrames );
+
+  // The combs are computed together, one frame of all combs after
+  // another, over spans in which none of their delay lines wraps.
+  // Their sum replaces the input in x.
+  StkFloat b0 = combFilterB0_, a1 = combFilterA1_;
+  StkFloat coefficients[nCombs], states[nCombs];
+  const StkFloat *delayed[nCombs];
+  StkFloat *lines[nCombs];
+  for ( i=0; i<nCombs; i++ ) {
+    coefficients[i] = combCoefficient_[i];
+    states[i] = combStates_[i];
+  }
+
+  for ( done=0; done<nFrames; done+=count ) {
+    count = nFrames - done;
+    for ( i=0; i<nCombs; i++ ) {
+      std::vector<StkFloat> &line = combLines_[i];
+      unsigned long mask = line.size() - 1;
+      count = lineSpan( line, time_ - combDelays_[i] - 1 + done, count );
+      count = lineSpan( line, time_ + done, count );
+      delayed[i] = &line[( time_ - combDelays_[i] - 1 + done ) & mask];
+      lines[i] = &line[( time_ + done ) & mask];
+    }
+
+    StkFloat *sum = x + done;
+    for ( k=0; k<count; k++ ) {
+      StkFloat temp0 = sum[k], filtout = 0.0;
+      for ( i=0; i<nCombs; i++ ) {
+        states[i] = b0 * ( coefficients[i] * delayed[i][k] ) - a1 * states[i];
+        StkFloat temp1 = temp0 + states[i];
+        lines[i][k] = temp1;
+        filtout = ( i == 0 ) ? temp1 : filtout + temp1;
+      }
+      sum[k] = filtout;
+    }
+  }
+
+  for ( i=0; i<nCombs; i++ )
+    combStates_[i] = states[i];
+
+  // The output delays are all read before they are written, which is
+  // valid for blocks no longer than the delays.
+  StkFloat mix = effectMix_, outLeft = 0.0, outRight = 0.0;
+  for ( done=0; done<nFrames; done+=count ) {
+    count = nFrames - done;
+    for ( i=0; i<2; i++ )
+      count = lineSpan( outLines_[i], time_ - outDelays_[i] + done, count );
+
+    unsigned long leftMask = outLines_[0].size() - 1, rightMask = outLines_[1].size() - 1;
+    const StkFloat *left = &outLines_[0][( time_ - outDelays_[0] + done ) & leftMask];
+    const StkFloat *right = &outLines_[1][( time_ - outDelays_[1] + done ) & rightMask];
+    const StkFloat *dry = input + done;
+    for ( k=0; k<count; k++, samples += hop ) {
+      StkFloat temp = (1.0 - mix) * dry[k];
+      outLeft = mix * left[k] + temp;
+      outRight = mix * right[k] + temp;
+      samples[0] = 0.7 * outLeft;
+      samples[1] = outRight;
+    }
+  }
+
+  writeLine( outLines_[0], time_, x, 1, nFrames );
+  writeLine( outLines_[1], time_, x, 1, nFrames );
+
+  lastFrame_[0] = outLeft;
+  lastFrame_[1] = outRight;
+  time_ += nFrames;
 }
 
 StkFrames& JCRev :: tick( StkFrames& frames, unsigned int channel )
@@ -105,9 +202,15 @@ StkFrames& JCRev :: tick( StkFrames& frames, unsigned int channel )
 
   StkFloat *samples = &frames[channel];
   unsigned int hop = frames.channels();
-  for ( unsigned int i=0; i<frames.frames(); i++, samples += hop ) {
-    *samples = tick( *samples );
-    *(samples+1) = lastFrame_[1];
+  for ( unsigned int done=0; done<frames.frames(); ) {
+    unsigned int i, n = frames.frames() - done;
+    if ( n > blockSize_ ) n = blockSize_;
+    for ( i=0; i<n; i++ )
+      inputs_[i] = samples[i * hop];
+
+    this->computeBlock( n, samples, hop );
+    samples += n * hop;
+    done += n;
   }
 
   return frames;
@@ -125,9 +228,15 @@ StkFrames& JCRev :: tick( StkFrames& iFrames, StkFrames& oFrames, unsigned int i
   StkFloat *iSamples = &iFrames[iChannel];
   StkFloat *oSamples = &oFrames[oChannel];
   unsigned int iHop = iFrames.channels(), oHop = oFrames.channels();
-  for ( unsigned int i=0; i<iFrames.frames(); i++, iSamples += iHop, oSamples += oHop ) {
-    *oSamples = tick( *iSamples );
-    *(oSamples+1) = lastFrame_[1];
+  for ( unsigned int done=0; done<iFrames.frames(); ) {
+    unsigned int i, n = iFrames.frames() - done;
+    if ( n > blockSize_ ) n = blockSize_;
+    for ( i=0; i<n; i++, iSamples += iHop )
+      inputs_[i] = *iSamples;
+
+    this->computeBlock( n, oSamples, oHop );
+    oSamples += n * oHop;
+    done += n;
   }
 
   return iFrames;
@@ -0,0 +1,314 @@
+/***************************************************/
+/*! \class JitterBuffer
+    \brief STK network audio jitter buffer class.
+
+    This class queues streamed audio data between a network receive
+    thread and the thread that computes audio.  Incoming data is
+    stored as received, in big-endian (network) byte order, and is
+    converted to floating-point values as it is read.  One thread
+    may write and another may read at the same time without locks.
+    Neither side ever blocks.
+
+    Reading does not start until the queue holds the target latency
+    in frames.  If the queue then runs dry, the missing frames are
+    read as zeros, the event is counted as an underrun, and the
+    target latency is raised by the size of the read.  After each
+    second without underruns, the target is lowered by the same
+    step, down to the latency set with setLatency().  Any delay
+    above the target that builds up during that time is skipped,
+    unless skipping has been disabled with setSkipping() so that the
+    owner can correct the delay more smoothly, for example by
+    resampling.
+
+    Packets written with a sequence number are checked for order.
+    Missing packets are replaced by silence of the same size and
+    counted as lost.  Packets that arrive after a later one has been
+    written are dropped and counted as late.  Packets that do not
+    fit in the queue are dropped and also counted as lost.
+*/
+/***************************************************/
+
+#include "JitterBuffer.h"
+#include "Socket.h"
+#include <cstring>
+#include <climits>
+
+namespace stk {
+
+// A sequence number this far behind the expected one is taken as a
+// restarted sender rather than a late packet.
+const long SEQUENCE_RESTART = 1024;
+
+JitterBuffer :: JitterBuffer( void )
+  : buffer_( 0 ), bufferBytes_( 0 ), frameBytes_( 0 ), dataBytes_( 0 ), nChannels_( 0 ),
+    format_( STK_SINT16 ), bytesFilled_( 0 ), latency_( 0 ), target_( 0 ),
+    skipping_( true ), latePackets_( 0 ), lostPackets_( 0 ), underruns_( 0 )
+{
+  this->reset();
+}
+
+JitterBuffer :: ~JitterBuffer( void )
+{
+  if ( buffer_ ) delete [] buffer_;
+}
+
+void JitterBuffer :: setFormat( unsigned int nChannels, Stk::StkFormat format, unsigned long bufferFrames )
+{
+  if ( nChannels == 0 || bufferFrames == 0 ) {
+    oStream_ << "JitterBuffer::setFormat: the channel and buffer size arguments must be greater than zero!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  if ( format == STK_SINT8 ) dataBytes_ = 1;
+  else if ( format == STK_SINT16 ) dataBytes_ = 2;
+  else if ( format == STK_SINT32 || format == STK_FLOAT32 ) dataBytes_ = 4;
+  else if ( format == STK_FLOAT64 ) dataBytes_ = 8;
+  else {
+    oStream_ << "JitterBuffer::setFormat: unknown data type specified!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  format_ = format;
+  nChannels_ = nChannels;
+  frameBytes_ = nChannels * dataBytes_;
+  unsigned long bufferBytes = bufferFrames * frameBytes_;
+  if ( bufferBytes != bufferBytes_ ) {
+    if ( buffer_ ) delete [] buffer_;
+    buffer_ = new unsigned char[ bufferBytes ];
+    bufferBytes_ = bufferBytes;
+  }
+
+  this->setLatency( latency_.load() );
+  this->reset();
+}
+
+void JitterBuffer :: reset( void )
+{
+  bytesFilled_.store( 0 );
+  writePoint_ = 0;
+  sequenced_ = false;
+  nextSequence_ = 0;
+  readPoint_ = 0;
+  primed_ = false;
+  target_.store( latency_.load() );
+  windowFrames_ = 0;
+  minFill_ = ULONG_MAX;
+  windowUnderrun_ = false;
+  latePackets_.store( 0 );
+  lostPackets_.store( 0 );
+  underruns_.store( 0 );
+}
+
+void JitterBuffer :: setLatency( unsigned long frames )
+{
+  if ( frameBytes_ > 0 && frames > bufferBytes_ / frameBytes_ / 2 )
+    frames = bufferBytes_ / frameBytes_ / 2;
+  latency_.store( frames, std::memory_order_relaxed );
+}
+
+unsigned long JitterBuffer :: getFillLevel( void ) const
+{
+  if ( frameBytes_ == 0 ) return 0;
+  return bytesFilled_.load( std::memory_order_relaxed ) / frameBytes_;
+}
+
+char *JitterBuffer :: writeSpace( unsigned long *bytes )
+{
+  *bytes = bufferBytes_ - bytesFilled_.load( std::memory_order_acquire );
+  if ( writePoint_ + *bytes > bufferBytes_ )
+    *bytes = bufferBytes_ - writePoint_;
+  return (char *) &buffer_[writePoint_];
+}
+
+void JitterBuffer :: commit( unsigned long bytes )
+{
+  writePoint_ += bytes;
+  if ( writePoint_ >= bufferBytes_ ) writePoint_ -= bufferBytes_;
+  bytesFilled_.fetch_add( bytes, std::memory_order_release );
+}
+
+void JitterBuffer :: write( const void *data, unsigned long bytes )
+{
+  const char *input = (const char *) data;
+  unsigned long space;
+  while ( bytes > 0 ) {
+    char *output = this->writeSpace( &space );
+    if ( space == 0 ) return;
+    if ( space > bytes ) space = bytes;
+    memcpy( output, input, space );
+    this->commit( space );
+    input += space;
+    bytes -= space;
+  }
+}
+
+void JitterBuffer :: writeZeros( unsigned long bytes )
+{
+  unsigned long space;
+  while ( bytes > 0 ) {
+    char *output = this->writeSpace( &space );
+    if ( space == 0 ) return;
+    if ( space > bytes ) space = bytes;
+    memset( output, 0, space );
+    this->commit( space );
+    bytes -= space;
+  }
+}
+
+void JitterBuffer :: writePacket( unsigned long sequence, const void *data, unsigned long bytes )
+{
+  sequence &= 0xFFFFFFFF;
+  if ( !sequenced_ ) {
+    nextSequence_ = sequence;
+    sequenced_ = true;
+  }
+
+  long difference = (long) (SINT32) ( ( sequence - nextSequence_ ) & 0xFFFFFFFF );
+  if ( difference < 0 && difference > -SEQUENCE_RESTART ) {
+    latePackets_.fetch_add( 1, std::memory_order_relaxed );
+    return;
+  }
+
+  if ( difference > 0 ) {
+    // Fill the gap with silence to keep the stream in time.
+    lostPackets_.fetch_add( difference, std::memory_order_relaxed );
+    if ( (unsigned long) difference > bufferBytes_ / ( bytes + 1 ) )
+      difference = bufferBytes_ / ( bytes + 1 );
+    this->writeZeros( difference * bytes );
+  }
+
+  nextSequence_ = ( sequence + 1 ) & 0xFFFFFFFF;
+  if ( bytes > bufferBytes_ - bytesFilled_.load( std::memory_order_acquire ) )
+    lostPackets_.fetch_add( 1, std::memory_order_relaxed );
+  else
+    this->write( data, bytes );
+}
+
+void JitterBuffer :: writeDatagram( const unsigned char *packet, unsigned long bytes )
+{
+  if ( bytes >= Socket::PACKET_HEADER_BYTES ) {
+    UINT32 magic = ( (UINT32) packet[0] << 24 ) | ( packet[1] << 16 ) | ( packet[2] << 8 ) | packet[3];
+    if ( magic == Socket::PACKET_MAGIC ) {
+      unsigned long sequence = ( (unsigned long) packet[4] << 24 ) | ( packet[5] << 16 ) | ( packet[6] << 8 ) | packet[7];
+      this->writePacket( sequence, packet + Socket::PACKET_HEADER_BYTES, bytes - Socket::PACKET_HEADER_BYTES );
+      return;
+    }
+  }
+
+  this->write( packet, bytes );
+}
+
+// Convert big-endian stream samples to floating-point values.
+static void convertSamples( const unsigned char *in, StkFloat *out, unsigned long samples,
+                            Stk::StkFormat format )
+{
+  unsigned long i;
+  if ( format == Stk::STK_SINT16 ) {
+    StkFloat gain = 1.0 / 32767.0;
+    for ( i=0; i<samples; i++, in += 2 )
+      out[i] = (SINT16) ( ( in[0] << 8 ) | in[1] ) * gain;
+  }
+  else if ( format == Stk::STK_SINT32 ) {
+    StkFloat gain = 1.0 / 2147483647.0;
+    for ( i=0; i<samples; i++, in += 4 )
+      out[i] = (SINT32) ( ( (unsigned long) in[0] << 24 ) | ( in[1] << 16 ) | ( in[2] << 8 ) | in[3] ) * gain;
+  }
+  else if ( format == Stk::STK_FLOAT32 ) {
+    for ( i=0; i<samples; i++, in += 4 ) {
+      UINT32 word = ( (UINT32) in[0] << 24 ) | ( in[1] << 16 ) | ( in[2] << 8 ) | in[3];
+      FLOAT32 value;
+      memcpy( &value, &word, 4 );
+      out[i] = value;
+    }
+  }
+  else if ( format == Stk::STK_FLOAT64 ) {
+    for ( i=0; i<samples; i++, in += 8 ) {
+      unsigned long long word = 0;
+      for ( int j=0; j<8; j++ ) word = ( word << 8 ) | in[j];
+      FLOAT64 value;
+      memcpy( &value, &word, 8 );
+      out[i] = value;
+    }
+  }
+  else if ( format == Stk::STK_SINT8 ) {
+    StkFloat gain = 1.0 / 127.0;
+    for ( i=0; i<samples; i++ )
+      out[i] = (signed char) in[i] * gain;
+  }
+}
+
+void JitterBuffer :: convert( StkFloat *samples, unsigned long nFrames )
+{
+  // The read position always falls on a frame boundary, and the queue
+  // holds a whole number of frames, so a frame never wraps around.
+  unsigned long counter = ( bufferBytes_ - readPoint_ ) / frameBytes_;
+  if ( counter > nFrames ) counter = nFrames;
+  convertSamples( &buffer_[readPoint_], samples, counter * nChannels_, format_ );
+  if ( counter < nFrames )
+    convertSamples( &buffer_[0], samples + counter * nChannels_, ( nFrames - counter ) * nChannels_, format_ );
+  this->skip( nFrames );
+}
+
+void JitterBuffer :: skip( unsigned long nFrames )
+{
+  unsigned long bytes = nFrames * frameBytes_;
+  readPoint_ += bytes;
+  if ( readPoint_ >= bufferBytes_ ) readPoint_ -= bufferBytes_;
+  bytesFilled_.fetch_sub( bytes, std::memory_order_release );
+}
+
+unsigned long JitterBuffer :: read( StkFrames& frames, bool drain )
+{
+#if defined(_STK_DEBUG_)
+  if ( frames.channels() != nChannels_ ) {
+    oStream_ << "JitterBuffer::read(): StkFrames argument is incompatible with the stream channels!";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+#endif
+
+  unsigned long nFrames = frames.frames(), nRead = 0;
+  if ( frameBytes_ == 0 || nFrames == 0 ) return 0;
+
+  unsigned long filled = bytesFilled_.load( std::memory_order_acquire ) / frameBytes_;
+  unsigned long latency = latency_.load( std::memory_order_relaxed );
+  unsigned long target = target_.load( std::memory_order_relaxed );
+  unsigned long maxTarget = bufferBytes_ / frameBytes_ / 2;
+  if ( target < latency ) target = latency;
+
+  // Wait for the target latency to build up before reading.
+  if ( !primed_ && filled > 0 && ( drain || filled >= target ) ) primed_ = true;
+
+  if ( primed_ ) {
+    nRead = ( filled < nFrames ) ? filled : nFrames;
+    this->convert( &frames[0], nRead );
+  }
+  for ( unsigned long i=nRead*nChannels_; i<frames.size(); i++ ) frames[i] = 0.0;
+
+  if ( primed_ && nRead < nFrames && !drain ) {
+    // The stream fell behind, so allow for more delay.
+    underruns_.fetch_add( 1, std::memory_order_relaxed );
+    primed_ = false;
+    windowUnderrun_ = true;
+    target += nFrames;
+    if ( target > maxTarget ) target = maxTarget;
+  }
+  else if ( primed_ && filled - nRead < minFill_ ) minFill_ = filled - nRead;
+
+  // Once a second, reduce the target latency if the stream has kept
+  // up and, if enabled, skip any delay that has built up beyond it.
+  windowFrames_ += nFrames;
+  if ( windowFrames_ >= (unsigned long) Stk::sampleRate() ) {
+    if ( !windowUnderrun_ ) {
+      if ( target > latency ) target -= ( target - latency < nFrames ) ? target - latency : nFrames;
+      if ( skipping_ && primed_ && minFill_ != ULONG_MAX && minFill_ > target ) this->skip( minFill_ - target );
+    }
+    windowFrames_ = 0;
+    minFill_ = ULONG_MAX;
+    windowUnderrun_ = false;
+  }
+
+  target_.store( target, std::memory_order_relaxed );
+  return nRead;
+}
+
+} // stk namespace
@@ -5,18 +5,26 @@
     This class implements a pitch shifter using pitch 
     tracking and sample windowing and shifting.
 
+    The difference function of the pitch tracker is computed from
+    the autocorrelation of the input, by FFT, so that each frame of
+    tMax samples costs O(tMax log tMax) operations.
+
     by Francois Germain, 2009.
 */
 /***************************************************/
 
 #include "LentPitShift.h"
+#include <cmath>
+#include <cstring>
 
 namespace stk {
 
 LentPitShift::LentPitShift( StkFloat periodRatio, int tMax )
-  : inputFrames(0.,tMax,1), outputFrames(0.,tMax,1), ptrFrames(0), inputPtr(0), outputPtr(0.), tMax_(tMax), periodRatio_(periodRatio), zeroFrame(0., tMax, 1)
+  : inputFrames(0.,tMax,1), outputFrames(0.,tMax,1), ptrFrames(0), inputPtr(0), outputPtr(0.), tMax_(tMax), periodRatio_(periodRatio)
 {
 	window = new StkFloat[2*tMax_]; // Allocation of the array for the hamming window
+	windowPeriod_ = 0;              // The window is computed for the first period found
+	grain_.resize( 2*tMax_ );
 	threshold_ = 0.1;               // Default threshold for pitch tracking
 
 	dt = new StkFloat[tMax+1]; // Allocation of the euclidian distance coefficient array.  The first one is never used.
@@ -25,11 +33,21 @@ LentPitShift::LentPitShift( StkFloat periodRatio, int tMax )
 	dpt = new StkFloat[tMax+1];    // Allocation of the pitch tracking function coefficient array
 	dpt[0]   = 1.;                 // Initialization of the first coefficient of dpt which is always the same
 
-	// Initialisation of the input and output delay lines
-	inputLine_.setMaximumDelay( 3 * tMax_ );
-	// The delay is choosed such as the coefficients are not read before being finalised.
-	outputLine_.setMaximumDelay( 3 * tMax_ );
-	outputLine_.setDelay( 3 * tMax_ );
+	// Initialisation of the input history and output accumulator.
+	// The output delay is choosed such as the coefficients are not read before being finalised.
+	inputLine_.assign( 3 * tMax_, 0. );
+	outputLine_.assign( 3 * tMax_, 0. );
+
+	// The autocorrelation of a frame with the previous frame and itself
+	// needs a transform of at least twice the frame size.
+	unsigned int size = 2;
+	while ( size < 2 * tMax_ ) size <<= 1;
+	fft_.setSize( size );
+	fftInput_.resize( size );
+	frameReal_.resize( size / 2 + 1 );
+	frameImag_.resize( size / 2 + 1 );
+	historyReal_.resize( size / 2 + 1 );
+	historyImag_.resize( size / 2 + 1 );
 
 	//Initialization of the delay line of pitch tracking coefficients
 	//coeffLine_ = new Delay[512];
@@ -39,8 +57,8 @@ LentPitShift::LentPitShift( StkFloat periodRatio, int tMax )
 
 void LentPitShift :: clear()
 {
-	inputLine_.clear();
-	outputLine_.clear();
+	inputLine_.assign( inputLine_.size(), 0. );
+	outputLine_.assign( outputLine_.size(), 0. );
 }
 
 void LentPitShift :: setShift( StkFloat shift )
@@ -49,4 +67,152 @@ void LentPitShift :: setShift( StkFloat shift )
   periodRatio_ = 1.0 / shift; 
 }
 
+void LentPitShift :: process()
+{
+  int alternativePitch = tMax_;  // Global minimum storage
+  lastPeriod_ = tMax_+1;         // Storage of the lowest local minimum under the threshold
+
+  // Loop variables
+  unsigned long delay_;
+  unsigned int n;
+
+  // Update of the input history with the new frame.
+  StkFloat *history = &inputLine_[0];
+  std::memmove( history, history + tMax_, 2 * tMax_ * sizeof( StkFloat ) );
+  for ( n=0; n<tMax_; n++ )
+    history[2*tMax_ + n] = inputFrames[n];
+
+  // Calculation of the dt coefficients.  Since the frames are of
+  // tMax_ length, there is no overlapping between the successive
+  // windows where pitch tracking is performed.  For a frame x[0..T-1],
+  //
+  //   dt[tau] = sum x[n]^2 + sum x[n-tau]^2 - 2 sum x[n] x[n-tau],
+  //
+  // where the last sum is the correlation of the frame with the last
+  // 2T input samples, computed by FFT.
+  const StkFloat *x = history + tMax_;  // x[-T..T-1] is at x[0..2T-1]
+  unsigned int size = fft_.getSize();
+  unsigned int bins = size / 2 + 1;
+  StkFloat *work = &fftInput_[0];
+  for ( n=0; n<tMax_; n++ ) work[n] = x[tMax_ + n];
+  for ( n=tMax_; n<size; n++ ) work[n] = 0.;
+  fft_.forward( work, &frameReal_[0], &frameImag_[0] );
+  for ( n=0; n<2*tMax_; n++ ) work[n] = x[n];
+  for ( n=2*tMax_; n<size; n++ ) work[n] = 0.;
+  fft_.forward( work, &historyReal_[0], &historyImag_[0] );
+
+  StkFloat *hr = &historyReal_[0], *hi = &historyImag_[0];
+  const StkFloat *fr = &frameReal_[0], *fi = &frameImag_[0];
+  for ( n=0; n<bins; n++ ) {
+    StkFloat real = fr[n] * hr[n] + fi[n] * hi[n];
+    StkFloat imag = fr[n] * hi[n] - fi[n] * hr[n];
+    hr[n] = real;
+    hi[n] = imag;
+  }
+  fft_.inverse( hr, hi, work );  // work[T-tau] = sum x[n] x[n-tau]
+
+  StkFloat energy = 0.;
+  for ( n=0; n<tMax_; n++ ) energy += x[tMax_ + n] * x[tMax_ + n];
+  StkFloat delayedEnergy = energy;
+  for ( delay_=1; delay_<=tMax_; delay_++ ) {
+    delayedEnergy += x[tMax_ - delay_] * x[tMax_ - delay_] - x[2*tMax_ - delay_] * x[2*tMax_ - delay_];
+    dt[delay_] = energy + delayedEnergy - 2. * work[tMax_ - delay_];
+    // Rounding leaves a small nonzero value for a perfect match.
+    if ( dt[delay_] < 1e-12 * ( energy + delayedEnergy ) ) dt[delay_] = 0.;
+  }
+
+  // Calculation of the pitch tracking function and test for the minima.
+  for ( delay_=1; delay_<=tMax_; delay_++ ) {
+    cumDt[delay_] = dt[delay_] + cumDt[delay_-1];
+    dpt[delay_] = dt[delay_] * delay_ / cumDt[delay_];
+
+    // Look for a minimum (dpt[1] is always 1, so there is none at 0)
+    if ( delay_ > 1 && dpt[delay_-1]-dpt[delay_-2] < 0 && dpt[delay_]-dpt[delay_-1] > 0 ) {
+      // Check if the minimum is under the threshold
+      if ( dpt[delay_-1] < threshold_ ){
+        lastPeriod_ = delay_-1;
+        // If a minimum is found, we can stop the loop
+        break;
+      }
+      else if ( dpt[alternativePitch] > dpt[delay_-1] )
+        // Otherwise we store it if it is the current global minimum
+        alternativePitch = delay_-1;
+    }
+  }
+
+  // Test for the last period length, if the loop was not stopped.
+  if ( delay_ > tMax_ ) delay_ = tMax_;
+  if ( lastPeriod_ == tMax_+1 && dpt[delay_]-dpt[delay_-1] < 0 ) {
+    if ( dpt[delay_] < threshold_ )
+      lastPeriod_ = delay_;
+    else if ( dpt[alternativePitch] > dpt[delay_] )
+      alternativePitch = delay_;
+  }
+
+  if ( lastPeriod_ == tMax_+1 )
+    // No period has been under the threshold so we used the global minimum
+    lastPeriod_ = alternativePitch;
+
+  // We get the previous calculated coefficients and shift the output
+  // accumulator by one frame, with new zero coefficients at its end
+  StkFloat *output = &outputLine_[0];
+  for ( n=0; n<tMax_; n++ )
+    outputFrames[n] = output[n];
+  std::memmove( output, output + tMax_, 2 * tMax_ * sizeof( StkFloat ) );
+  for ( n=2*tMax_; n<3*tMax_; n++ )
+    output[n] = 0.;
+
+  // Initialization of the Hamming window used in the algorithm, when
+  // the period has changed
+  if ( lastPeriod_ != windowPeriod_ ) {
+    for ( int n=-(int)lastPeriod_; n<(int)lastPeriod_; n++ )
+      window[n+lastPeriod_] = (1 + cos(PI*n/lastPeriod_)) / 2;
+    windowPeriod_ = lastPeriod_;
+  }
+
+  int M;  // Index of reading in the input history
+  int N;  // Index of writing in the output accumulator
+  unsigned int j, length = 2*lastPeriod_;
+  StkFloat *grain = &grain_[0];
+
+  // We loop for all the frames of length lastPeriod_ presents between inputPtr and tMax_
+  for ( ; inputPtr<(int)(tMax_-lastPeriod_); inputPtr+=lastPeriod_ ) {
+    // Test for the decision of compression/expansion
+    while ( outputPtr < inputPtr ) {
+      // Coefficients for the linear interpolation
+      env[1] = fmod( outputPtr + tMax_, 1.0 );
+      env[0] = 1.0 - env[1];
+      M = 2*tMax_ + inputPtr - lastPeriod_; // New reading pointer
+      N = (int)floor(outputPtr + tMax_) + tMax_ - lastPeriod_; // New writing pointer
+
+      const StkFloat *input = history + M;
+      for ( j=0; j<length; j++ )
+        grain[j] = input[j] * window[j] / 2.;
+
+      // Linear interpolation.  Each output sample is the sum of two
+      // successive windowed samples, added in the order of the
+      // sample-by-sample loop.  Samples that fall before the start of
+      // the accumulator were due in a previous frame and are dropped.
+      StkFloat e0 = env[0], e1 = env[1];
+      if ( N >= 0 ) {
+        output[N] += e0 * grain[0];
+        j = 1;
+      }
+      else j = -N;
+      StkFloat *out = output + N + j;
+      const StkFloat *previous = grain + j - 1;
+      const StkFloat *current = grain + j;
+      unsigned int k, count = length - j;
+      for ( k=0; k<count; k++ )
+        out[k] = ( out[k] + e1 * previous[k] ) + e0 * current[k];
+      out[count] += e1 * previous[count];
+
+      outputPtr = outputPtr + lastPeriod_ * periodRatio_; // new output pointer
+    }
+  }
+  // Shifting of the pointers waiting for the new frame of length tMax_.
+  outputPtr -= tMax_;
+  inputPtr  -= tMax_;
+}
+
 } // stk namespace
@@ -14,10 +14,15 @@
     socket, or stdin) take place asynchronously, filling the message
     queue.  A call to popMessage() will pop the next available control
     message from the queue and return it via the referenced Message
-    structure.  When a \e non-realtime scorefile is set, it is not
-    possible to start reading realtime input messages (from MIDI,
-    socket, or stdin).  Likewise, it is not possible to read from a
-    scorefile when a realtime input mechanism is running.
+    structure.  The queue is a bounded, lock-free ring of preallocated
+    messages that any thread may push to and one thread pops from.
+    When it is full, the stdin and socket threads wait to be woken by
+    popMessage(), while MIDI messages and those pushed with
+    pushMessage() are dropped and counted (see getDroppedMessages()).
+    When a \e non-realtime scorefile is set, it is not possible to
+    start reading realtime input messages (from MIDI, socket, or
+    stdin).  Likewise, it is not possible to read from a scorefile
+    when a realtime input mechanism is running.
 
     When MIDI input is started, input is also automatically read from
     stdin.  This allows for program termination via the terminal
@@ -35,6 +40,7 @@
 #include "Messager.h"
 #include <iostream>
 #include <algorithm>
+#include <chrono>
 #include "SKINI.msg"
 
 namespace stk {
@@ -51,6 +57,65 @@ static const int STK_MIDI   = 0x2;
 static const int STK_STDIN   = 0x4;
 static const int STK_SOCKET = 0x8;
 
+static double queueTime( void )
+{
+  return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+// Copy a message into the next free queue slot.  If the queue is full,
+// either wait for the reader to free a slot or drop the message.
+static bool pushQueue( Messager::MessagerData *data, const Skini::Message& message, bool wait )
+{
+  Messager::MessagerData::Slot *slot;
+#if defined(__STK_REALTIME__)
+  bool overflow = false;
+#else
+  (void) wait;
+#endif
+  unsigned long position = data->writeIndex.load( std::memory_order_relaxed );
+  while ( true ) {
+    slot = &data->slots[ position & data->queueMask ];
+    long difference = (long) ( slot->sequence.load( std::memory_order_acquire ) - position );
+    if ( difference == 0 ) {
+      // The slot is free, so try to claim it.
+      if ( data->writeIndex.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+        break;
+      continue;
+    }
+
+    if ( difference < 0 ) {
+      // The queue is full.
+#if defined(__STK_REALTIME__)
+      if ( wait && !data->closing ) {
+        if ( !overflow ) data->overflows.fetch_add( 1, std::memory_order_relaxed );
+        overflow = true;
+
+        // The reader signals when it frees a slot while a writer is
+        // waiting.  The timeout covers a signal sent just before the wait.
+        data->waiters++;
+        std::unique_lock<std::mutex> lock( data->waitMutex );
+        if ( slot->sequence.load( std::memory_order_acquire ) != position )
+          data->spaceCondition.wait_for( lock, std::chrono::milliseconds( 10 ) );
+        lock.unlock();
+        data->waiters--;
+      }
+      else
+#endif
+      {
+        data->dropped.fetch_add( 1, std::memory_order_relaxed );
+        return false;
+      }
+    }
+
+    position = data->writeIndex.load( std::memory_order_relaxed );
+  }
+
+  slot->message = message;
+  slot->stamp = queueTime();
+  slot->sequence.store( position + 1, std::memory_order_release );
+  return true;
+}
+
 Messager :: Messager()
 {
   data_.sources = 0;
@@ -59,19 +124,24 @@ Messager :: Messager()
   data_.socket = 0;
   data_.midi = 0;
 #endif
+
+  // The queue size is rounded up to a power of two.
+  unsigned long size = 1;
+  while ( size < data_.queueLimit ) size <<= 1;
+  data_.slots = new MessagerData::Slot[size];
+  for ( unsigned long i=0; i<size; i++ )
+    data_.slots[i].sequence = i;
+  data_.queueMask = size - 1;
 }
 
 Messager :: ~Messager()
 {
-  // Clear the queue in case any thread is waiting on its limit.
-#if defined(__STK_REALTIME__)
-  data_.mutex.lock();
-#endif
-  while ( data_.queue.size() ) data_.queue.pop();
+  // Release any thread waiting for space in the queue.
+  data_.closing = true;
   data_.sources = 0;
 
 #if defined(__STK_REALTIME__)
-  data_.mutex.unlock();
+  data_.spaceCondition.notify_all();
   if ( data_.socket ) {
     socketThread_.wait();
     delete data_.socket;
@@ -79,6 +149,8 @@ Messager :: ~Messager()
 
   if ( data_.midi ) delete data_.midi;
 #endif
+
+  delete [] data_.slots;
 }
 
 bool Messager :: setScoreFile( const char* filename )
@@ -108,32 +180,28 @@ void Messager :: popMessage( Skini::Message& message )
     return;
   }
 
-  if ( data_.queue.size() == 0 ) {
+  MessagerData::Slot *slot = &data_.slots[ data_.readIndex & data_.queueMask ];
+  if ( slot->sequence.load( std::memory_order_acquire ) != data_.readIndex + 1 ) {
     // An empty (or invalid) message is indicated by a type = 0.
     message.type = 0;
     return;
   }
 
-  // Copy queued message to the message pointer structure and then "pop" it.
-#if defined(__STK_REALTIME__)
-  data_.mutex.lock();
-#endif
-  message = data_.queue.front();
-  data_.queue.pop();
+  // Copy queued message to the message pointer structure and then
+  // release its slot for writing.
+  message = slot->message;
+  data_.delay = queueTime() - slot->stamp;
+  slot->sequence.store( data_.readIndex + data_.queueMask + 1, std::memory_order_release );
+  data_.readIndex++;
+
 #if defined(__STK_REALTIME__)
-  data_.mutex.unlock();
+  if ( data_.waiters > 0 ) data_.spaceCondition.notify_one();
 #endif
 }
 
-void Messager :: pushMessage( Skini::Message& message )
+bool Messager :: pushMessage( Skini::Message& message )
 {
-#if defined(__STK_REALTIME__)
-  data_.mutex.lock();
-#endif
-  data_.queue.push( message );
-#if defined(__STK_REALTIME__)
-  data_.mutex.unlock();
-#endif
+  return pushQueue( &data_, message, false );
 }
 
 #if defined(__STK_REALTIME__)
@@ -174,17 +242,15 @@ THREAD_RETURN THREAD_TYPE stdinHandler(void *ptr)
       break;
 
     data->mutex.lock();
-    if ( data->skini.parseString( line, message ) )
-      data->queue.push( message );
+    bool parsed = data->skini.parseString( line, message );
     data->mutex.unlock();
-
-    while ( data->queue.size() >= data->queueLimit ) Stk::sleep( 50 );
+    if ( parsed ) pushQueue( data, message, true );
   }
 
   // We assume here that if someone types an "exit" message in the
   // terminal window, all processing should stop.
   message.type = __SK_Exit_;
-  data->queue.push( message );
+  pushQueue( data, message, true );
   data->sources &= ~STK_STDIN;
 
   return NULL;
@@ -217,11 +283,9 @@ void midiHandler( double timeStamp, std::vector<unsigned char> *bytes, void *ptr
       message.floatValues[1] = (StkFloat) message.intValues[1];
   }
 
-  while ( data->queue.size() >= data->queueLimit ) Stk::sleep( 50 );
-
-  data->mutex.lock();
-  data->queue.push( message );
-  data->mutex.unlock();
+  // The MIDI callback must not be held up, so messages that do not
+  // fit in the queue are dropped.
+  pushQueue( data, message, false );
 }
 
 bool Messager :: startMidiInput( int port )
@@ -373,15 +437,16 @@ THREAD_RETURN THREAD_TYPE socketHandler(void *ptr)
         while ( index < bytesRead ) {
           line += buffer[index];
           if ( buffer[index++] == '\n' ) {
+            bool parsed = false;
             data->mutex.lock();
             if ( line.compare(0, 4, "Exit") == 0 || line.compare(0, 4, "exit") == 0 ) {
               // Ignore this line and assume the connection will be
               // closed on a subsequent read call.
               ;
             }
-            else if ( data->skini.parseString( line, message ) )
-              data->queue.push( message );
+            else parsed = data->skini.parseString( line, message );
             data->mutex.unlock();
+            if ( parsed ) pushQueue( data, message, true );
             line.erase();
           }
         }
@@ -415,14 +480,11 @@ THREAD_RETURN THREAD_TYPE socketHandler(void *ptr)
         else if ( !(data->sources & STK_STDIN) ) {
           // No stdin thread running, so quit now.
           message.type = __SK_Exit_;
-          data->queue.push( message );
+          pushQueue( data, message, true );
         }
       }
       fdclose.clear();
     }
-
-    // Wait until we're below the queue limit.
-    while ( data->queue.size() >= data->queueLimit ) Stk::sleep( 50 );
   }
 
   return NULL;
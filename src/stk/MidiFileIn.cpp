@@ -11,6 +11,13 @@
     Tempo changes are internally tracked by the class and reflected in
     the values returned by the function getTickSeconds().
 
+    The file is read into memory and decoded in a single pass when it
+    is opened.  Each track is stored as an array of events with
+    absolute tick and second times, so no file access or parsing
+    occurs while events are read.  The function getNextMergedEvent()
+    returns the events of all tracks in time order, and seekMerged()
+    jumps directly to any time in the file.
+
     by Gary P. Scavone, 2003 - 2010.
 */
 /**********************************************************************/
@@ -18,138 +25,115 @@
 #include "MidiFileIn.h"
 #include <cstring>
 #include <iostream>
+#include <algorithm>
 
 namespace stk {
 
+// Return an unsigned big-endian value from the file data.
+static unsigned long readBigEndian( const std::vector<unsigned char>& data, unsigned long position, int bytes )
+{
+  unsigned long value = 0;
+  for ( int i=0; i<bytes; i++ )
+    value = ( value << 8 ) + data[position+i];
+  return value;
+}
+
+// Order merged events by time.  Used with a stable sort, so events
+// with equal times stay in track order.
+template <class Event, class EventRef>
+struct MergedEventCompare {
+  MergedEventCompare( const std::vector< std::vector<Event> >& tracks ) : tracks_( tracks ) {};
+  bool operator()( const EventRef& a, const EventRef& b ) const {
+    return tracks_[a.track][a.index].seconds < tracks_[b.track][b.index].seconds;
+  }
+  const std::vector< std::vector<Event> >& tracks_;
+};
+
 MidiFileIn :: MidiFileIn( std::string fileName )
+  : mergedIndex_( 0 )
 {
-  // Attempt to open the file.
-  file_.open( fileName.c_str(), std::ios::in | std::ios::binary );
-  if ( !file_ ) {
+  // Attempt to open the file and read it into memory.
+  std::ifstream file( fileName.c_str(), std::ios::in | std::ios::binary );
+  if ( !file ) {
     oStream_ << "MidiFileIn: error opening or finding file (" <<  fileName << ").";
     handleError( StkError::FILE_NOT_FOUND );
   }
 
+  std::vector<unsigned char> data;
+  file.seekg( 0, std::ios_base::end );
+  std::streamoff fileSize = file.tellg();
+  file.seekg( 0, std::ios_base::beg );
+  if ( fileSize > 0 ) {
+    data.resize( (size_t) fileSize );
+    if ( !file.read( (char *) &data[0], fileSize ) ) goto error;
+  }
+  file.close();
+
   // Parse header info.
-  char chunkType[4];
-  char buffer[4];
-  SINT32 *length;
-  if ( !file_.read( chunkType, 4 ) ) goto error;
-  if ( !file_.read( buffer, 4 ) ) goto error;
-#ifdef __LITTLE_ENDIAN__
-  swap32((unsigned char *)&buffer);
-#endif
-  length = (SINT32 *) &buffer;
-  if ( strncmp( chunkType, "MThd", 4 ) || ( *length != 6 ) ) {
+  if ( data.size() < 14 ) goto error;
+  if ( strncmp( (const char *) &data[0], "MThd", 4 ) || ( readBigEndian( data, 4, 4 ) != 6 ) ) {
     oStream_ << "MidiFileIn: file (" <<  fileName << ") does not appear to be a MIDI file!";
     handleError( StkError::FILE_UNKNOWN_FORMAT );
   }
 
   // Read the MIDI file format.
-  SINT16 *data;
-  if ( !file_.read( buffer, 2 ) ) goto error;
-#ifdef __LITTLE_ENDIAN__
-  swap16((unsigned char *)&buffer);
-#endif
-  data = (SINT16 *) &buffer;
-  if ( *data < 0 || *data > 2 ) {
+  format_ = (int) readBigEndian( data, 8, 2 );
+  if ( format_ > 2 ) {
     oStream_ << "MidiFileIn: the file (" <<  fileName << ") format is invalid!";
     handleError( StkError::FILE_ERROR );
   }
-  format_ = *data;
 
   // Read the number of tracks.
-  if ( !file_.read( buffer, 2 ) ) goto error;
-#ifdef __LITTLE_ENDIAN__
-  swap16((unsigned char *)&buffer);
-#endif
-  if ( format_ == 0 && *data != 1 ) {
+  nTracks_ = (unsigned int) readBigEndian( data, 10, 2 );
+  if ( format_ == 0 && nTracks_ != 1 ) {
     oStream_ << "MidiFileIn: invalid number of tracks (>1) for a file format = 0!";
     handleError( StkError::FILE_ERROR );
   }
-  nTracks_ = *data;
 
   // Read the beat division.
-  if ( !file_.read( buffer, 2 ) ) goto error;
-#ifdef __LITTLE_ENDIAN__
-  swap16((unsigned char *)&buffer);
-#endif
-  division_ = (int) *data;
+  SINT16 division;
+  division = (SINT16) readBigEndian( data, 12, 2 );
+  division_ = (int) division;
   double tickrate;
   usingTimeCode_ = false;
-  if ( *data & 0x8000 ) {
+  if ( division & 0x8000 ) {
     // Determine ticks per second from time-code formats.
-    tickrate = (double) -(*data & 0x7F00);
+    tickrate = (double) -(division & 0x7F00);
     // If frames per second value is 29, it really should be 29.97.
     if ( tickrate == 29.0 ) tickrate = 29.97;
-    tickrate *= (*data & 0x00FF);
+    tickrate *= (division & 0x00FF);
     usingTimeCode_ = true;
   }
   else {
-    tickrate = (double) (*data & 0x7FFF); // ticks per quarter note
-  }
-
-  // Now locate the track offsets and lengths.  If not using time
-  // code, we can initialize the "tick time" using a default tempo of
-  // 120 beats per minute.  We will then check for tempo meta-events
-  // afterward.
-  unsigned int i;
-  for ( i=0; i<nTracks_; i++ ) {
-    if ( !file_.read( chunkType, 4 ) ) goto error;
-    if ( strncmp( chunkType, "MTrk", 4 ) ) goto error;
-    if ( !file_.read( buffer, 4 ) ) goto error;
-#ifdef __LITTLE_ENDIAN__
-  swap32((unsigned char *)&buffer);
-#endif
-    length = (SINT32 *) &buffer;
-    trackLengths_.push_back( *length );
-    trackOffsets_.push_back( (long) file_.tellg() );
-    trackPointers_.push_back( (long) file_.tellg() );
-    trackStatus_.push_back( 0 );
-    file_.seekg( *length, std::ios_base::cur );
-    if ( usingTimeCode_ ) tickSeconds_.push_back( (double) (1.0 / tickrate) );
-    else tickSeconds_.push_back( (double) (0.5 / tickrate) );
+    tickrate = (double) (division & 0x7FFF); // ticks per quarter note
   }
 
-  // Save the initial tickSeconds parameter.
+  // Save the initial tickSeconds parameter.  If not using time code,
+  // we use a default tempo of 120 beats per minute until a tempo
+  // meta-event is found.
   TempoChange tempoEvent;
   tempoEvent.count = 0;
-  tempoEvent.tickSeconds = tickSeconds_[0];
+  if ( usingTimeCode_ ) tempoEvent.tickSeconds = (double) (1.0 / tickrate);
+  else tempoEvent.tickSeconds = (double) (0.5 / tickrate);
   tempoEvents_.push_back( tempoEvent );
 
-  // If format 1 and not using time code, parse and save the tempo map
-  // on track 0.
-  if ( format_ == 1 && !usingTimeCode_ ) {
-    std::vector<unsigned char> event;
-    unsigned long value, count;
-
-    // We need to temporarily change the usingTimeCode_ value here so
-    // that the getNextEvent() function doesn't try to check the tempo
-    // map (which we're creating here).
-    usingTimeCode_ = true;
-    count = getNextEvent( &event, 0 );
-    while ( event.size() ) {
-      if ( ( event.size() == 6 ) && ( event[0] == 0xff ) &&
-           ( event[1] == 0x51 ) && ( event[2] == 0x03 ) ) {
-        tempoEvent.count = count;
-        value = ( event[3] << 16 ) + ( event[4] << 8 ) + event[5];
-        tempoEvent.tickSeconds = (double) (0.000001 * value / tickrate);
-        if ( count > tempoEvents_.back().count )
-          tempoEvents_.push_back( tempoEvent );
-        else
-          tempoEvents_.back() = tempoEvent;
-      }
-      count += getNextEvent( &event, 0 );
-    }
-    rewindTrack( 0 );
-    for ( unsigned int i=0; i<nTracks_; i++ ) {
-      trackCounters_.push_back( 0 );
-      trackTempoIndex_.push_back( 0 );
-    }
-    // Change the time code flag back!
-    usingTimeCode_ = false;
+  // Now locate and decode each track.
+  unsigned long position;
+  position = 14;
+  tracks_.resize( nTracks_ );
+  for ( unsigned int i=0; i<nTracks_; i++ ) {
+    if ( data.size() - position < 8 ) goto error;
+    if ( strncmp( (const char *) &data[position], "MTrk", 4 ) ) goto error;
+    unsigned long length = readBigEndian( data, position + 4, 4 );
+    position += 8;
+    if ( length > data.size() - position ) goto error;
+    if ( !decodeTrack( data, position, length, i ) ) goto error;
+    position += length;
+    tickSeconds_.push_back( tempoEvents_[0].tickSeconds );
+    trackIndex_.push_back( 0 );
   }
 
+  computeSeconds();
   return;
 
  error:
@@ -159,9 +143,153 @@ MidiFileIn :: MidiFileIn( std::string fileName )
 
 MidiFileIn :: ~MidiFileIn()
 {
-  // An ifstream object implicitly closes itself during destruction
-  // but we'll make an explicit call to "close" anyway.
-  file_.close(); 
+}
+
+bool MidiFileIn :: decodeTrack( const std::vector<unsigned char>& data, unsigned long offset,
+                                unsigned long length, unsigned int track )
+{
+  // Decode the track events, storing their bytes in the form returned
+  // by getNextEvent(): running status is resolved, and meta and sysex
+  // events keep their variable-length size field.
+  std::vector<Event>& events = tracks_[track];
+  unsigned long position = offset, end = offset + length;
+  unsigned long ticks = 0, delta, bytes, start;
+  unsigned char status = 0, c;
+  Event event;
+  event.seconds = 0.0;
+  event.tickSeconds = 0.0;
+
+  while ( position < end ) {
+
+    // Read the event delta time.
+    if ( !readVariableLength( data, position, end, &delta ) ) return false;
+    ticks += delta;
+    if ( position >= end ) return false;
+    c = data[position];
+    start = position;
+    event.tick = ticks;
+    event.offset = eventBytes_.size();
+
+    switch ( c ) {
+
+    case 0xFF: // A Meta-Event
+      status = 0;
+      position += 2;
+      if ( position > end ) return false;
+      if ( !readVariableLength( data, position, end, &bytes ) ) return false;
+      break;
+
+    case 0xF0:
+    case 0xF7: // The start or continuation of a Sysex event
+      status = 0;
+      position++;
+      if ( !readVariableLength( data, position, end, &bytes ) ) return false;
+      break;
+
+    default: // Should be a MIDI channel event
+      if ( c & 0x80 ) { // MIDI status byte
+        if ( c > 0xF0 ) return false;
+        status = c;
+        position++;
+        c &= 0xF0;
+        if ( (c == 0xC0) || (c == 0xD0) ) bytes = 1;
+        else bytes = 2;
+      }
+      else if ( status & 0x80 ) { // Running status
+        eventBytes_.push_back( status );
+        c = status & 0xF0;
+        if ( (c == 0xC0) || (c == 0xD0) ) bytes = 1;
+        else bytes = 2;
+      }
+      else return false;
+
+    }
+
+    // Copy the event bytes.
+    if ( bytes > end - position ) return false;
+    position += bytes;
+    eventBytes_.insert( eventBytes_.end(), data.begin() + start, data.begin() + position );
+    event.size = eventBytes_.size() - event.offset;
+    events.push_back( event );
+  }
+
+  return true;
+}
+
+void MidiFileIn :: computeSeconds( void )
+{
+  // Determine the time in seconds of each event and the tick duration
+  // in effect after it.  Time-code files have a constant tick
+  // duration.  Otherwise, for format 1 files, a tempo map is built
+  // from the "Set Tempo" meta-events of all tracks and applied to
+  // every track.  For formats 0 and 2, each track follows its own
+  // tempo events.
+  unsigned int i;
+  unsigned long j;
+  double tickrate = (double) (division_ & 0x7FFF);
+
+  if ( format_ == 1 && !usingTimeCode_ ) {
+    TempoChange tempoEvent;
+    for ( i=0; i<nTracks_; i++ ) {
+      for ( j=0; j<tracks_[i].size(); j++ ) {
+        const unsigned char *bytes = &eventBytes_[ tracks_[i][j].offset ];
+        if ( tracks_[i][j].size == 6 && bytes[0] == 0xFF && bytes[1] == 0x51 && bytes[2] == 0x03 ) {
+          unsigned long value = ( bytes[3] << 16 ) + ( bytes[4] << 8 ) + bytes[5];
+          tempoEvent.count = tracks_[i][j].tick;
+          tempoEvent.tickSeconds = (double) (0.000001 * value / tickrate);
+
+          // Keep the map sorted by tick, with the last change at a given tick winning.
+          std::vector<TempoChange>::iterator it = tempoEvents_.end();
+          while ( it != tempoEvents_.begin() && (it-1)->count > tempoEvent.count ) --it;
+          if ( it != tempoEvents_.begin() && (it-1)->count == tempoEvent.count ) *(it-1) = tempoEvent;
+          else tempoEvents_.insert( it, tempoEvent );
+        }
+      }
+    }
+
+    // Find the time in seconds of each tempo change.
+    std::vector<double> tempoSeconds( tempoEvents_.size(), 0.0 );
+    for ( j=1; j<tempoEvents_.size(); j++ )
+      tempoSeconds[j] = tempoSeconds[j-1] +
+        ( tempoEvents_[j].count - tempoEvents_[j-1].count ) * tempoEvents_[j-1].tickSeconds;
+
+    for ( i=0; i<nTracks_; i++ ) {
+      unsigned long index = 0;
+      for ( j=0; j<tracks_[i].size(); j++ ) {
+        Event& event = tracks_[i][j];
+        while ( index < tempoEvents_.size() - 1 && tempoEvents_[index+1].count <= event.tick ) index++;
+        event.tickSeconds = tempoEvents_[index].tickSeconds;
+        event.seconds = tempoSeconds[index] + ( event.tick - tempoEvents_[index].count ) * event.tickSeconds;
+      }
+    }
+  }
+  else {
+    for ( i=0; i<nTracks_; i++ ) {
+      double seconds = 0.0, tickSeconds = tempoEvents_[0].tickSeconds;
+      unsigned long ticks = 0;
+      for ( j=0; j<tracks_[i].size(); j++ ) {
+        Event& event = tracks_[i][j];
+        seconds += ( event.tick - ticks ) * tickSeconds;
+        ticks = event.tick;
+        const unsigned char *bytes = &eventBytes_[ event.offset ];
+        if ( !usingTimeCode_ && event.size == 6 && bytes[0] == 0xFF && bytes[1] == 0x51 ) {
+          unsigned long value = ( bytes[3] << 16 ) + ( bytes[4] << 8 ) + bytes[5];
+          tickSeconds = (double) (0.000001 * value / tickrate);
+        }
+        event.seconds = seconds;
+        event.tickSeconds = tickSeconds;
+      }
+    }
+  }
+
+  // Build the time-ordered index of all events.
+  EventRef ref;
+  for ( i=0; i<nTracks_; i++ ) {
+    ref.track = i;
+    for ( ref.index=0; ref.index<tracks_[i].size(); ref.index++ )
+      merged_.push_back( ref );
+  }
+  std::stable_sort( merged_.begin(), merged_.end(), MergedEventCompare<Event, EventRef>( tracks_ ) );
 }
 
 void MidiFileIn :: rewindTrack( unsigned int track )
@@ -171,8 +299,7 @@ void MidiFileIn :: rewindTrack( unsigned int track )
     handleError( StkError::WARNING ); return;
   }
 
-  trackPointers_[track] = trackOffsets_[track];
-  trackStatus_[track] = 0;
+  trackIndex_[track] = 0;
   tickSeconds_[track] = tempoEvents_[0].tickSeconds;
 }
 
@@ -191,18 +318,10 @@ unsigned long MidiFileIn :: getNextEvent( std::vector<unsigned char> *event, uns
 {
   // Fill the user-provided vector with the next event in the
   // specified track (default = 0) and return the event delta time in
-  // ticks.  This function assumes that the stored track pointer is
-  // positioned at the start of a track event.  If the track has
-  // reached its end, the event vector size will be zero.
-  //
-  // If we have a format 0 or 2 file and we're not using timecode, we
-  // should check every meta-event for tempo changes and make
-  // appropriate updates to the tickSeconds_ parameter if so.
-  //
-  // If we have a format 1 file and we're not using timecode, keep a
-  // running sum of ticks for each track and update the tickSeconds_
-  // parameter as needed based on the stored tempo map.
-
+  // ticks.  If the track has reached its end, the event vector size
+  // will be zero.  The tickSeconds_ parameter of the track is updated
+  // to the value in effect after the event, as determined when the
+  // file was decoded.
   event->clear();
   if ( track >= nTracks_ ) {
     oStream_ << "MidiFileIn::getNextEvent: invalid track argument (" <<  track << ").";
@@ -210,98 +329,16 @@ unsigned long MidiFileIn :: getNextEvent( std::vector<unsigned char> *event, uns
   }
 
   // Check for the end of the track.
-  if ( (trackPointers_[track] - trackOffsets_[track]) >= trackLengths_[track] )
-    return 0;
-
-  unsigned long ticks = 0, bytes = 0;
-  bool isTempoEvent = false;
-
-  // Read the event delta time.
-  file_.seekg( trackPointers_[track], std::ios_base::beg );
-  if ( !readVariableLength( &ticks ) ) goto error;
-
-  // Parse the event stream to determine the event length.
-  unsigned char c;
-  if ( !file_.read( (char *)&c, 1 ) ) goto error;
-  switch ( c ) {
-
-  case 0xFF: // A Meta-Event
-    unsigned long position;
-    trackStatus_[track] = 0;
-    event->push_back( c );
-    if ( !file_.read( (char *)&c, 1 ) ) goto error;
-    event->push_back( c );
-    if ( format_ != 1 && ( c == 0x51 ) ) isTempoEvent = true;
-    position = file_.tellg();
-    if ( !readVariableLength( &bytes ) ) goto error;
-    bytes += ( (unsigned long)file_.tellg() - position );
-    file_.seekg( position, std::ios_base::beg );
-    break;
-
-  case 0xF0:
-  case 0xF7: // The start or continuation of a Sysex event
-    trackStatus_[track] = 0;
-    event->push_back( c );
-    position = file_.tellg();
-    if ( !readVariableLength( &bytes ) ) goto error;
-    bytes += ( (unsigned long)file_.tellg() - position );
-    file_.seekg( position, std::ios_base::beg );
-    break;
-
-  default: // Should be a MIDI channel event
-    if ( c & 0x80 ) { // MIDI status byte
-      if ( c > 0xF0 ) goto error;
-      trackStatus_[track] = c;
-      event->push_back( c );
-      c &= 0xF0;
-      if ( (c == 0xC0) || (c == 0xD0) ) bytes = 1;
-      else bytes = 2;
-    }
-    else if ( trackStatus_[track] & 0x80 ) { // Running status
-      event->push_back( trackStatus_[track] );
-      event->push_back( c );
-      c = trackStatus_[track] & 0xF0;
-      if ( (c != 0xC0) && (c != 0xD0) ) bytes = 1;
-    }
-    else goto error;
+  unsigned long index = trackIndex_[track];
+  if ( index >= tracks_[track].size() ) return 0;
 
-  }
-
-  // Read the rest of the event into the event vector.
-  unsigned long i;
-  for ( i=0; i<bytes; i++ ) {
-    if ( !file_.read( (char *)&c, 1 ) ) goto error;
-    event->push_back( c );
-  }
+  const Event& next = tracks_[track][index];
+  event->assign( eventBytes_.begin() + next.offset, eventBytes_.begin() + next.offset + next.size );
+  tickSeconds_[track] = next.tickSeconds;
+  trackIndex_[track]++;
 
-  if ( !usingTimeCode_ ) {
-    if ( isTempoEvent ) {
-      // Parse the tempo event and update tickSeconds_[track].
-      double tickrate = (double) (division_ & 0x7FFF);
-      unsigned long value = ( event->at(3) << 16 ) + ( event->at(4) << 8 ) + event->at(5);
-      tickSeconds_[track] = (double) (0.000001 * value / tickrate);
-    }
-
-    if ( format_ == 1 ) {
-      // Update track counter and check the tempo map.
-      trackCounters_[track] += ticks;
-      TempoChange tempoEvent = tempoEvents_[ trackTempoIndex_[track] ];
-      if ( trackCounters_[track] >= tempoEvent.count && trackTempoIndex_[track] < tempoEvents_.size() - 1 ) {
-        trackTempoIndex_[track]++;
-        tickSeconds_[track] = tempoEvent.tickSeconds;
-      }
-    }
-  }
-
-  // Save the current track pointer value.
-  trackPointers_[track] = file_.tellg();
-
-  return ticks;
-
- error:
-  oStream_ << "MidiFileIn::getNextEvent: file read error!";
-  handleError( StkError::FILE_ERROR );
-  return 0;
+  if ( index == 0 ) return next.tick;
+  return next.tick - tracks_[track][index-1].tick;
 }
 
 unsigned long MidiFileIn :: getNextMidiEvent( std::vector<unsigned char> *midiEvent, unsigned int track )
@@ -315,38 +352,58 @@ unsigned long MidiFileIn :: getNextMidiEvent( std::vector<unsigned char> *midiEv
   }
 
   unsigned long ticks = getNextEvent( midiEvent, track );
-  while ( midiEvent->size() && ( midiEvent->at(0) >= 0xF0 ) ) {
-    //for ( unsigned int i=0; i<midiEvent->size(); i++ )
-      //std::cout << "event byte = " << i << ", value = " << (int)midiEvent->at(i) << std::endl;
+  while ( midiEvent->size() && ( midiEvent->at(0) >= 0xF0 ) )
     ticks = getNextEvent( midiEvent, track );
-  }
-
-  //for ( unsigned int i=0; i<midiEvent->size(); i++ )
-    //std::cout << "event byte = " << i << ", value = " << (int)midiEvent->at(i) << std::endl;
 
   return ticks;
 }
 
-bool MidiFileIn :: readVariableLength( unsigned long *value )
+double MidiFileIn :: getNextMergedEvent( std::vector<unsigned char> *event, unsigned int *track )
 {
-  // It is assumed that this function is called with the file read
-  // pointer positioned at the start of a variable-length value.  The
-  // function returns "true" if the value is successfully parsed and
-  // "false" otherwise.
-  *value = 0;
-  char c;
-
-  if ( !file_.read( &c, 1 ) ) return false;
-  *value = (unsigned long) c;
-  if ( *value & 0x80 ) {
-    *value &= 0x7f;
-    do {
-      if ( !file_.read( &c, 1 ) ) return false;
-      *value = ( *value << 7 ) + ( c & 0x7f );
-    } while ( c & 0x80 );
+  event->clear();
+  if ( mergedIndex_ >= merged_.size() ) return getDuration();
+
+  const EventRef& ref = merged_[mergedIndex_++];
+  const Event& next = tracks_[ref.track][ref.index];
+  event->assign( eventBytes_.begin() + next.offset, eventBytes_.begin() + next.offset + next.size );
+  if ( track ) *track = ref.track;
+  return next.seconds;
+}
+
+void MidiFileIn :: seekMerged( double seconds )
+{
+  // Binary search for the first event at or after the given time.
+  unsigned long lo = 0, hi = merged_.size();
+  while ( lo < hi ) {
+    unsigned long mid = lo + ( hi - lo ) / 2;
+    if ( tracks_[ merged_[mid].track ][ merged_[mid].index ].seconds < seconds ) lo = mid + 1;
+    else hi = mid;
   }
+  mergedIndex_ = lo;
+}
+
+double MidiFileIn :: getDuration( void ) const
+{
+  if ( merged_.empty() ) return 0.0;
+  const EventRef& last = merged_.back();
+  return tracks_[last.track][last.index].seconds;
+}
+
+bool MidiFileIn :: readVariableLength( const std::vector<unsigned char>& data, unsigned long& position,
+                                       unsigned long end, unsigned long *value )
+{
+  // The function returns "true" if the value is successfully parsed
+  // before the end position and "false" otherwise.
+  *value = 0;
+  unsigned char c;
+
+  do {
+    if ( position >= end ) return false;
+    c = data[position++];
+    *value = ( *value << 7 ) + ( c & 0x7f );
+  } while ( c & 0x80 );
 
   return true;
-} 
+}
 
 } // stk namespace
@@ -10,6 +10,10 @@
     another allpass in series, followed by two allpass filters in
     parallel with corresponding right and left outputs.
 
+    The StkFrames tick() functions run each filter over blocks of
+    samples no longer than its delay and give the same output as the
+    single-sample tick() function.
+
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
 /***************************************************/
@@ -39,17 +43,26 @@ NRev :: NRev( StkFloat T60 )
     lengths[i] = delay;
   }
 
-  for ( i=0; i<6; i++ ) {
-    combDelays_[i].setMaximumDelay( lengths[i] );
-    combDelays_[i].setDelay( lengths[i] );
+  unsigned long minDelay = maxBlockSize;
+  for ( i=0; i<nCombs; i++ ) {
+    combDelays_[i] = lengths[i];
+    setLine( combLines_[i], combDelays_[i] + 1 );
+    if ( combDelays_[i] < minDelay ) minDelay = combDelays_[i];
     combCoefficient_[i] = pow(10.0, (-3 * lengths[i] / (T60 * Stk::sampleRate())));
   }
 
-  for ( i=0; i<8; i++ ) {
-	  allpassDelays_[i].setMaximumDelay( lengths[i+6] );
-	  allpassDelays_[i].setDelay( lengths[i+6] );
+  for ( i=0; i<nAllpasses; i++ ) {
+    allpassDelays_[i] = lengths[i+6];
+    setLine( allpassLines_[i], allpassDelays_[i] + 1 );
+    if ( allpassDelays_[i] + 1 < minDelay ) minDelay = allpassDelays_[i] + 1;
   }
 
+  blockSize_ = minDelay;
+  inputs_.resize( blockSize_ );
+  work_.resize( blockSize_ );
+  outLeft_.resize( blockSize_ );
+  outRight_.resize( blockSize_ );
+
   this->setT60( T60 );
   allpassCoefficient_ = 0.7;
   effectMix_ = 0.3;
@@ -59,8 +72,9 @@ NRev :: NRev( StkFloat T60 )
 void NRev :: clear()
 {
   int i;
-  for (i=0; i<6; i++) combDelays_[i].clear();
-  for (i=0; i<8; i++) allpassDelays_[i].clear();
+  for (i=0; i<nCombs; i++) combLines_[i].assign( combLines_[i].size(), 0.0 );
+  for (i=0; i<nAllpasses; i++) allpassLines_[i].assign( allpassLines_[i].size(), 0.0 );
+  time_ = 0;
   lastFrame_[0] = 0.0;
   lastFrame_[1] = 0.0;
   lowpassState_ = 0.0;
@@ -73,8 +87,68 @@ void NRev :: setT60( StkFloat T60 )
     handleError( StkError::WARNING ); return;
   }
 
-  for ( int i=0; i<6; i++ )
-    combCoefficient_[i] = pow(10.0, (-3.0 * combDelays_[i].getDelay() / (T60 * Stk::sampleRate())));
+  for ( int i=0; i<nCombs; i++ )
+    combCoefficient_[i] = pow(10.0, (-3.0 * combDelays_[i] / (T60 * Stk::sampleRate())));
+}
+
+void NRev :: computeBlock( unsigned int nFrames, StkFloat *samples, unsigned int hop )
+{
+  StkFloat *x = &work_[0];
+  const StkFloat *input = &inputs_[0];
+  unsigned int k, done, count;
+  int i;
+
+  // Each comb is read at its delay for the outputs and one sample
+  // further back for the feedback, over spans in which none of the
+  // positions wraps.  The outputs are summed in x.
+  for ( k=0; k<nFrames; k++ ) x[k] = 0.0;
+  for ( i=0; i<nCombs; i++ ) {
+    std::vector<StkFloat> &line = combLines_[i];
+    unsigned long mask = line.size() - 1;
+    unsigned long delay = combDelays_[i];
+    StkFloat coefficient = combCoefficient_[i];
+    for ( done=0; done<nFrames; done+=count ) {
+      count = lineSpan( line, time_ - delay - 1 + done, nFrames - done );
+      count = lineSpan( line, time_ - delay + done, count );
+      count = lineSpan( line, time_ + done, count );
+      const StkFloat *feedback = &line[( time_ - delay - 1 + done ) & mask];
+      const StkFloat *delayed = &line[( time_ - delay + done ) & mask];
+      StkFloat *in = &line[( time_ + done ) & mask];
+      const StkFloat *combInput = input + done;
+      StkFloat *sum = x + done;
+      for ( k=0; k<count; k++ ) {
+        in[k] = combInput[k] + (coefficient * feedback[k]);
+        sum[k] += delayed[k];
+      }
+    }
+  }
+
+  for ( i=0; i<3; i++ )
+    allpassBlock( allpassLines_[i], time_, allpassDelays_[i], allpassCoefficient_, x, nFrames );
+
+  // One-pole lowpass filter.
+  StkFloat state = lowpassState_;
+  for ( k=0; k<nFrames; k++ ) {
+    state = 0.7 * state + 0.3 * x[k];
+    x[k] = state;
+  }
+  lowpassState_ = state;
+
+  allpassBlock( allpassLines_[3], time_, allpassDelays_[3], allpassCoefficient_, x, nFrames );
+  StkFloat *left = &outLeft_[0], *right = &outRight_[0];
+  for ( k=0; k<nFrames; k++ ) left[k] = right[k] = x[k];
+  allpassBlock( allpassLines_[4], time_, allpassDelays_[4], allpassCoefficient_, left, nFrames );
+  allpassBlock( allpassLines_[5], time_, allpassDelays_[5], allpassCoefficient_, right, nFrames );
+  time_ += nFrames;
+
+  StkFloat mix = effectMix_;
+  for ( k=0; k<nFrames; k++, samples += hop ) {
+    StkFloat temp = ( 1.0 - mix ) * input[k];
+    samples[0] = mix * left[k] + temp;
+    samples[1] = mix * right[k] + temp;
+  }
+  lastFrame_[0] = *(samples - hop);
+  lastFrame_[1] = *(samples - hop + 1);
 }
 
 StkFrames& NRev :: tick( StkFrames& frames, unsigned int channel )
@@ -88,9 +162,15 @@ StkFrames& NRev :: tick( StkFrames& frames, unsigned int channel )
 
   StkFloat *samples = &frames[channel];
   unsigned int hop = frames.channels();
-  for ( unsigned int i=0; i<frames.frames(); i++, samples += hop ) {
-    *samples = tick( *samples );
-    *(samples+1) = lastFrame_[1];
+  for ( unsigned int done=0; done<frames.frames(); ) {
+    unsigned int i, n = frames.frames() - done;
+    if ( n > blockSize_ ) n = blockSize_;
+    for ( i=0; i<n; i++ )
+      inputs_[i] = samples[i * hop];
+
+    this->computeBlock( n, samples, hop );
+    samples += n * hop;
+    done += n;
   }
 
   return frames;
@@ -108,9 +188,15 @@ StkFrames& NRev :: tick( StkFrames& iFrames, StkFrames& oFrames, unsigned int iC
   StkFloat *iSamples = &iFrames[iChannel];
   StkFloat *oSamples = &oFrames[oChannel];
   unsigned int iHop = iFrames.channels(), oHop = oFrames.channels();
-  for ( unsigned int i=0; i<iFrames.frames(); i++, iSamples += iHop, oSamples += oHop ) {
-    *oSamples = tick( *iSamples );
-    *(oSamples+1) = lastFrame_[1];
+  for ( unsigned int done=0; done<iFrames.frames(); ) {
+    unsigned int i, n = iFrames.frames() - done;
+    if ( n > blockSize_ ) n = blockSize_;
+    for ( i=0; i<n; i++, iSamples += iHop )
+      inputs_[i] = *iSamples;
+
+    this->computeBlock( n, oSamples, oHop );
+    oSamples += n * oHop;
+    done += n;
   }
 
   return iFrames;
@@ -2,9 +2,19 @@
 /*! \class Noise
     \brief STK noise generator.
 
-    Generic random number generation using the
-    C rand() function.  The quality of the rand()
-    function varies from one OS to another.
+    Generic random number generation with a
+    generator owned by each instance, so that
+    instances are independent of each other and of
+    the C rand() function.  A seeded instance
+    always produces the same sequence, and
+    instances can be ticked from separate threads.
+
+    The generator is SplitMix64: each output is a
+    mix of the bits of a counter that is advanced
+    by a fixed odd constant.  The outputs for a
+    block of frames can therefore be computed
+    independently, which lets the compiler
+    vectorize the StkFrames tick() function.
 
     by Perry R. Cook and Gary P. Scavone, 1995-2012.
 */
@@ -12,9 +22,14 @@
 
 #include "Noise.h"
 #include <time.h>
+#include <atomic>
 
 namespace stk {
 
+// The number of instances seeded from the system time, which
+// separates instances seeded within the same second.
+static std::atomic<unsigned long> timeSeeds( 0 );
+
 Noise :: Noise( unsigned int seed )
 {
   // Seed the random number generator
@@ -24,9 +39,9 @@ Noise :: Noise( unsigned int seed )
 void Noise :: setSeed( unsigned int seed )
 {
   if ( seed == 0 )
-    srand( (unsigned int) time( NULL ) );
+    state_ = ( (unsigned long long) time( NULL ) << 32 ) + timeSeeds.fetch_add( 1 );
   else
-    srand( seed );
+    state_ = seed;
 }
 
 } // stk namespace
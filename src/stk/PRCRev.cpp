@@ -43,14 +43,21 @@ PRCRev :: PRCRev( StkFloat T60 )
     }
   }
 
-  for ( i=0; i<2; i++ )	{
-	  allpassDelays_[i].setMaximumDelay( lengths[i] );
-	  allpassDelays_[i].setDelay( lengths[i] );
-
-    combDelays_[i].setMaximumDelay( lengths[i+2] );
-    combDelays_[i].setDelay( lengths[i+2] );
+  unsigned long minDelay = maxBlockSize;
+  for ( i=0; i<2; i++ ) {
+    allpassDelays_[i] = lengths[i];
+    setLine( allpassLines_[i], allpassDelays_[i] + 1 );
+    if ( allpassDelays_[i] + 1 < minDelay ) minDelay = allpassDelays_[i] + 1;
+
+    combDelays_[i] = lengths[i+2];
+    setLine( combLines_[i], combDelays_[i] + 1 );
+    if ( combDelays_[i] < minDelay ) minDelay = combDelays_[i];
   }
 
+  blockSize_ = minDelay;
+  inputs_.resize( blockSize_ );
+  work_.resize( blockSize_ );
+
   this->setT60( T60 );
   allpassCoefficient_ = 0.7;
   effectMix_ = 0.5;
@@ -59,10 +66,11 @@ PRCRev :: PRCRev( StkFloat T60 )
 
 void PRCRev :: clear( void )
 {
-  allpassDelays_[0].clear();
-  allpassDelays_[1].clear();
-  combDelays_[0].clear();
-  combDelays_[1].clear();
+  for ( int i=0; i<2; i++ ) {
+    allpassLines_[i].assign( allpassLines_[i].size(), 0.0 );
+    combLines_[i].assign( combLines_[i].size(), 0.0 );
+  }
+  time_ = 0;
   lastFrame_[0] = 0.0;
   lastFrame_[1] = 0.0;
 }
@@ -74,8 +82,55 @@ void PRCRev :: setT60( StkFloat T60 )
     handleError( StkError::WARNING ); return;
   }
 
-  combCoefficient_[0] = pow(10.0, (-3.0 * combDelays_[0].getDelay() / (T60 * Stk::sampleRate())));
-  combCoefficient_[1] = pow(10.0, (-3.0 * combDelays_[1].getDelay() / (T60 * Stk::sampleRate())));
+  combCoefficient_[0] = pow(10.0, (-3.0 * combDelays_[0] / (T60 * Stk::sampleRate())));
+  combCoefficient_[1] = pow(10.0, (-3.0 * combDelays_[1] / (T60 * Stk::sampleRate())));
+}
+
+void PRCRev :: computeBlock( unsigned int nFrames, StkFloat *samples, unsigned int hop )
+{
+  StkFloat *x = &work_[0];
+  const StkFloat *input = &inputs_[0];
+  unsigned int k, done, count;
+  int i;
+
+  for ( k=0; k<nFrames; k++ ) x[k] = input[k];
+  for ( i=0; i<2; i++ )
+    allpassBlock( allpassLines_[i], time_, allpassDelays_[i], allpassCoefficient_, x, nFrames );
+
+  // Both combs are computed in one pass, over spans in which none of
+  // their positions wraps.  Each comb is read at its delay for the
+  // output and one sample further back for the feedback.
+  const StkFloat *feedback[2], *delayed[2];
+  StkFloat *in[2];
+  StkFloat c0 = combCoefficient_[0], c1 = combCoefficient_[1];
+  StkFloat mix = effectMix_;
+  for ( done=0; done<nFrames; done+=count ) {
+    count = nFrames - done;
+    for ( i=0; i<2; i++ ) {
+      std::vector<StkFloat> &line = combLines_[i];
+      unsigned long mask = line.size() - 1;
+      count = lineSpan( line, time_ - combDelays_[i] - 1 + done, count );
+      count = lineSpan( line, time_ - combDelays_[i] + done, count );
+      count = lineSpan( line, time_ + done, count );
+      feedback[i] = &line[( time_ - combDelays_[i] - 1 + done ) & mask];
+      delayed[i] = &line[( time_ - combDelays_[i] + done ) & mask];
+      in[i] = &line[( time_ + done ) & mask];
+    }
+
+    const StkFloat *combInput = x + done, *dry = input + done;
+    for ( k=0; k<count; k++, samples += hop ) {
+      StkFloat temp1 = combInput[k];
+      in[0][k] = temp1 + ( c0 * feedback[0][k] );
+      in[1][k] = temp1 + ( c1 * feedback[1][k] );
+      StkFloat temp = (1.0 - mix) * dry[k];
+      samples[0] = mix * delayed[0][k] + temp;
+      samples[1] = mix * delayed[1][k] + temp;
+    }
+  }
+
+  lastFrame_[0] = *(samples - hop);
+  lastFrame_[1] = *(samples - hop + 1);
+  time_ += nFrames;
 }
 
 StkFrames& PRCRev :: tick( StkFrames& frames, unsigned int channel )
@@ -89,9 +144,15 @@ StkFrames& PRCRev :: tick( StkFrames& frames, unsigned int channel )
 
   StkFloat *samples = &frames[channel];
   unsigned int hop = frames.channels();
-  for ( unsigned int i=0; i<frames.frames(); i++, samples += hop ) {
-    *samples = tick( *samples );
-    *(samples+1) = lastFrame_[1];
+  for ( unsigned int done=0; done<frames.frames(); ) {
+    unsigned int i, n = frames.frames() - done;
+    if ( n > blockSize_ ) n = blockSize_;
+    for ( i=0; i<n; i++ )
+      inputs_[i] = samples[i * hop];
+
+    this->computeBlock( n, samples, hop );
+    samples += n * hop;
+    done += n;
   }
 
   return frames;
@@ -109,9 +170,15 @@ StkFrames& PRCRev :: tick( StkFrames& iFrames, StkFrames& oFrames, unsigned int
   StkFloat *iSamples = &iFrames[iChannel];
   StkFloat *oSamples = &oFrames[oChannel];
   unsigned int iHop = iFrames.channels(), oHop = oFrames.channels();
-  for ( unsigned int i=0; i<iFrames.frames(); i++, iSamples += iHop, oSamples += oHop ) {
-    *oSamples = tick( *iSamples );
-    *(oSamples+1) = lastFrame_[1];
+  for ( unsigned int done=0; done<iFrames.frames(); ) {
+    unsigned int i, n = iFrames.frames() - done;
+    if ( n > blockSize_ ) n = blockSize_;
+    for ( i=0; i<n; i++, iSamples += iHop )
+      inputs_[i] = *iSamples;
+
+    this->computeBlock( n, oSamples, oHop );
+    oSamples += n * oHop;
+    done += n;
   }
 
   return iFrames;
@@ -5091,9 +5091,11 @@ struct AlsaHandle {
   bool xrun[2];
   pthread_cond_t runnable_cv;
   bool runnable;
+  bool mmap[2];
+  snd_pcm_format_t format[2];
 
   AlsaHandle()
-    :synchronized(false), runnable(false) { xrun[0] = false; xrun[1] = false; }
+    :synchronized(false), runnable(false) { xrun[0] = false; xrun[1] = false; mmap[0] = false; mmap[1] = false; }
 };
 
 extern "C" void *alsaCallbackHandler( void * ptr );
@@ -5523,8 +5525,26 @@ bool RtApiAlsa :: probeDeviceOpen( unsigned int device, StreamMode mode, unsigne
   snd_pcm_hw_params_dump( hw_params, out );
 #endif
 
-  // Set access ... check user preference.
-  if ( options && options->flags & RTAUDIO_NONINTERLEAVED ) {
+  // Set access ... check user preference.  Memory-mapped access, if
+  // requested, is tried first in the preferred and then the other
+  // layout before falling back to read/write access.
+  bool useMmap = false;
+  if ( options && options->flags & RTAUDIO_ALSA_USE_MMAP ) {
+    bool interleaved = !( options->flags & RTAUDIO_NONINTERLEAVED );
+    stream_.userInterleaved = interleaved;
+    for ( int i=0; i<2 && !useMmap; i++ ) {
+      stream_.deviceInterleaved[mode] = ( i == 0 ) ? interleaved : !interleaved;
+      if ( stream_.deviceInterleaved[mode] )
+        result = snd_pcm_hw_params_set_access( phandle, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED );
+      else
+        result = snd_pcm_hw_params_set_access( phandle, hw_params, SND_PCM_ACCESS_MMAP_NONINTERLEAVED );
+      if ( result == 0 ) useMmap = true;
+    }
+  }
+
+  if ( useMmap )
+    result = 0;
+  else if ( options && options->flags & RTAUDIO_NONINTERLEAVED ) {
     stream_.userInterleaved = false;
     result = snd_pcm_hw_params_set_access( phandle, hw_params, SND_PCM_ACCESS_RW_NONINTERLEAVED );
     if ( result < 0 ) {
@@ -5797,6 +5817,8 @@ bool RtApiAlsa :: probeDeviceOpen( unsigned int device, StreamMode mode, unsigne
     apiInfo = (AlsaHandle *) stream_.apiHandle;
   }
   apiInfo->handles[mode] = phandle;
+  apiInfo->mmap[mode] = useMmap;
+  apiInfo->format[mode] = deviceFormat;
   phandle = 0;
 
   // Allocate necessary internal buffers.
@@ -5833,6 +5855,7 @@ bool RtApiAlsa :: probeDeviceOpen( unsigned int device, StreamMode mode, unsigne
   stream_.sampleRate = sampleRate;
   stream_.nBuffers = periods;
   stream_.device[mode] = device;
+  stream_.channelOffset[mode] = firstChannel;
   stream_.state = STREAM_STOPPED;
 
   // Setup the buffer conversion information structure.
@@ -6107,6 +6130,129 @@ void RtApiAlsa :: abortStream()
   error( RtError::SYSTEM_ERROR );
 }
 
+// Transfer one buffer of frames between the user buffer and the
+// memory-mapped device buffer, in two parts where the device ring
+// wraps.  When a conversion kernel exists for the format pair and no
+// byte swapping is needed, each user channel is converted directly
+// to or from its place in the device ring.  Otherwise the data is
+// staged and converted in the device buffer as for read/write
+// transfers.  Returns the number of frames transferred or a negative
+// error code.
+int RtApiAlsa :: mmapTransfer( StreamMode mode )
+{
+  AlsaHandle *apiInfo = (AlsaHandle *) stream_.apiHandle;
+  snd_pcm_t *handle = apiInfo->handles[mode];
+  unsigned int nUser = stream_.nUserChannels[mode];
+  unsigned int nDevice = stream_.nDeviceChannels[mode];
+  unsigned int firstChannel = stream_.channelOffset[mode];
+  unsigned int userBytes = formatBytes( stream_.userFormat );
+  unsigned int deviceBytes = formatBytes( stream_.deviceFormat[mode] );
+
+  ConvertKernel kernel = 0;
+  if ( !stream_.doByteSwap[mode] ) {
+    if ( mode == OUTPUT )
+      kernel = getConvertKernel( stream_.userFormat, stream_.deviceFormat[0] );
+    else
+      kernel = getConvertKernel( stream_.deviceFormat[1], stream_.userFormat );
+  }
+
+  // Describe the staging buffer, which holds all device channels in
+  // the device format and layout, for copies with ALSA.
+  char *buffer = stream_.userBuffer[mode];
+  if ( stream_.doConvertBuffer[mode] ) buffer = stream_.deviceBuffer;
+  snd_pcm_channel_area_t bufferAreas[nDevice];
+  for ( unsigned int i=0; i<nDevice; i++ ) {
+    bufferAreas[i].addr = buffer;
+    if ( stream_.deviceInterleaved[mode] ) {
+      bufferAreas[i].first = i * deviceBytes * 8;
+      bufferAreas[i].step = nDevice * deviceBytes * 8;
+    }
+    else {
+      bufferAreas[i].first = i * stream_.bufferSize * deviceBytes * 8;
+      bufferAreas[i].step = deviceBytes * 8;
+    }
+  }
+
+  if ( mode == OUTPUT && !kernel ) {
+    if ( stream_.doConvertBuffer[0] )
+      convertBuffer( buffer, stream_.userBuffer[0], stream_.convertInfo[0] );
+    if ( stream_.doByteSwap[0] )
+      byteSwapBuffer( buffer, stream_.bufferSize * nDevice, stream_.deviceFormat[0] );
+  }
+
+  int result;
+  const snd_pcm_channel_area_t *areas;
+  snd_pcm_uframes_t offset, frames, done = 0;
+  while ( done < stream_.bufferSize ) {
+    snd_pcm_sframes_t avail = snd_pcm_avail_update( handle );
+    if ( avail < 0 ) return avail;
+    if ( avail == 0 ) {
+      // Capture must be started explicitly with mmap access.
+      if ( mode == INPUT && snd_pcm_state( handle ) == SND_PCM_STATE_PREPARED ) {
+        result = snd_pcm_start( handle );
+        if ( result < 0 ) return result;
+      }
+      result = snd_pcm_wait( handle, 1000 );
+      if ( result < 0 ) return result;
+      continue;
+    }
+
+    frames = stream_.bufferSize - done;
+    result = snd_pcm_mmap_begin( handle, &areas, &offset, &frames );
+    if ( result < 0 ) return result;
+
+    if ( kernel ) {
+      for ( unsigned int i=0; i<nDevice; i++ ) {
+        if ( i < firstChannel || i >= firstChannel + nUser ) {
+          if ( mode == OUTPUT ) snd_pcm_area_silence( &areas[i], offset, frames, apiInfo->format[0] );
+          continue;
+        }
+        char *device = (char *) areas[i].addr + ( areas[i].first + offset * areas[i].step ) / 8;
+        int deviceJump = areas[i].step / ( deviceBytes * 8 );
+        char *user = stream_.userBuffer[mode];
+        int userJump = 1;
+        if ( stream_.userInterleaved ) {
+          user += ( done * nUser + i - firstChannel ) * userBytes;
+          userJump = nUser;
+        }
+        else
+          user += ( ( i - firstChannel ) * stream_.bufferSize + done ) * userBytes;
+
+        if ( mode == OUTPUT )
+          kernel( device, user, frames, userJump, deviceJump );
+        else
+          kernel( user, device, frames, deviceJump, userJump );
+      }
+    }
+    else if ( mode == OUTPUT )
+      snd_pcm_areas_copy( areas, offset, bufferAreas, done, nDevice, frames, apiInfo->format[0] );
+    else
+      snd_pcm_areas_copy( bufferAreas, done, areas, offset, nDevice, frames, apiInfo->format[1] );
+
+    snd_pcm_sframes_t committed = snd_pcm_mmap_commit( handle, offset, frames );
+    if ( committed < 0 ) return committed;
+    if ( (snd_pcm_uframes_t) committed != frames ) return -EPIPE;
+    done += frames;
+  }
+
+  if ( mode == OUTPUT ) {
+    // Start playback once a buffer is queued, as the start threshold
+    // does for read/write transfers.
+    if ( snd_pcm_state( handle ) == SND_PCM_STATE_PREPARED ) {
+      result = snd_pcm_start( handle );
+      if ( result < 0 ) return result;
+    }
+  }
+  else if ( !kernel ) {
+    if ( stream_.doByteSwap[1] )
+      byteSwapBuffer( buffer, stream_.bufferSize * nDevice, stream_.deviceFormat[1] );
+    if ( stream_.doConvertBuffer[1] )
+      convertBuffer( stream_.userBuffer[1], buffer, stream_.convertInfo[1] );
+  }
+
+  return (int) done;
+}
+
 void RtApiAlsa :: callbackEvent()
 {
   AlsaHandle *apiInfo = (AlsaHandle *) stream_.apiHandle;
@@ -6175,8 +6321,11 @@ void RtApiAlsa :: callbackEvent()
       format = stream_.userFormat;
     }
 
-    // Read samples from device in interleaved/non-interleaved format.
-    if ( stream_.deviceInterleaved[1] )
+    // Read samples from device in interleaved/non-interleaved format,
+    // or from the memory-mapped device buffer with any conversion done.
+    if ( apiInfo->mmap[1] )
+      result = mmapTransfer( INPUT );
+    else if ( stream_.deviceInterleaved[1] )
       result = snd_pcm_readi( handle[1], buffer, stream_.bufferSize );
     else {
       void *bufs[channels];
@@ -6212,11 +6361,11 @@ void RtApiAlsa :: callbackEvent()
     }
 
     // Do byte swapping if necessary.
-    if ( stream_.doByteSwap[1] )
+    if ( stream_.doByteSwap[1] && !apiInfo->mmap[1] )
       byteSwapBuffer( buffer, stream_.bufferSize * channels, format );
 
     // Do buffer conversion if necessary.
-    if ( stream_.doConvertBuffer[1] )
+    if ( stream_.doConvertBuffer[1] && !apiInfo->mmap[1] )
       convertBuffer( stream_.userBuffer[1], stream_.deviceBuffer, stream_.convertInfo[1] );
 
     // Check stream latency
@@ -6231,7 +6380,8 @@ void RtApiAlsa :: callbackEvent()
     // Setup parameters and do buffer conversion if necessary.
     if ( stream_.doConvertBuffer[0] ) {
       buffer = stream_.deviceBuffer;
-      convertBuffer( buffer, stream_.userBuffer[0], stream_.convertInfo[0] );
+      if ( !apiInfo->mmap[0] )
+        convertBuffer( buffer, stream_.userBuffer[0], stream_.convertInfo[0] );
       channels = stream_.nDeviceChannels[0];
       format = stream_.deviceFormat[0];
     }
@@ -6242,11 +6392,14 @@ void RtApiAlsa :: callbackEvent()
     }
 
     // Do byte swapping if necessary.
-    if ( stream_.doByteSwap[0] )
+    if ( stream_.doByteSwap[0] && !apiInfo->mmap[0] )
       byteSwapBuffer(buffer, stream_.bufferSize * channels, format);
 
-    // Write samples to device in interleaved/non-interleaved format.
-    if ( stream_.deviceInterleaved[0] )
+    // Write samples to device in interleaved/non-interleaved format,
+    // or to the memory-mapped device buffer with any conversion done.
+    if ( apiInfo->mmap[0] )
+      result = mmapTransfer( OUTPUT );
+    else if ( stream_.deviceInterleaved[0] )
       result = snd_pcm_writei( handle[0], buffer, stream_.bufferSize );
     else {
       void *bufs[channels];
@@ -7734,6 +7887,8 @@ void RtApi :: clearStreamInfo()
     stream_.convertInfo[i].outFormat = 0;
     stream_.convertInfo[i].inOffset.clear();
     stream_.convertInfo[i].outOffset.clear();
+    stream_.convertInfo[i].kernel = 0;
+    stream_.convertInfo[i].flat = false;
   }
 }
 
@@ -7833,6 +7988,169 @@ void RtApi :: setConvertInfo( StreamMode mode, unsigned int firstChannel )
       }
     }
   }
+
+  // Choose the conversion kernel.  If every channel is contiguous in
+  // both buffers and the channels follow each other without gaps (all
+  // channels interleaved, or whole channel blocks), the buffer is
+  // converted as a single run of samples.
+  ConvertInfo& info = stream_.convertInfo[mode];
+  info.kernel = getConvertKernel( info.inFormat, info.outFormat );
+  info.flat = ( info.channels > 0 );
+  for ( int k=0; k<info.channels && info.flat; k++ ) {
+    int step = ( info.inJump == 1 ) ? (int) stream_.bufferSize : 1;
+    if ( info.inJump != info.outJump || ( info.inJump != 1 && info.inJump != info.channels ) ||
+         info.inOffset[k] != info.inOffset[0] + k * step ||
+         info.outOffset[k] != info.outOffset[0] + k * step )
+      info.flat = false;
+  }
+}
+
+// Sample conversion operations for the kernels below.  Each one
+// computes exactly what the general loops in convertBuffer() compute,
+// including the rounding of intermediate results, so the output does
+// not depend on which path is taken.  24-bit integers occupy the lower
+// three bytes of a 32-bit integer.
+
+template <typename T>
+struct CopySample {
+  static inline T convert( T x ) { return x; }
+};
+
+struct Sint16ToFloat64 {
+  static inline double convert( signed short x ) { return ( (double) x + 0.5 ) * ( 1.0 / 32767.5 ); }
+};
+
+struct Sint24ToFloat64 {
+  static inline double convert( signed int x ) { return ( (double) ( x & 0x00ffffff ) + 0.5 ) * ( 1.0 / 8388607.5 ); }
+};
+
+struct Sint32ToFloat64 {
+  static inline double convert( signed int x ) { return ( (double) x + 0.5 ) * ( 1.0 / 2147483647.5 ); }
+};
+
+struct Float32ToFloat64 {
+  static inline double convert( float x ) { return (double) x; }
+};
+
+struct Sint16ToFloat32 {
+  static inline float convert( signed short x ) {
+    return (float) ( (float) x + 0.5 ) * (float) ( 1.0 / 32767.5 );
+  }
+};
+
+struct Sint24ToFloat32 {
+  static inline float convert( signed int x ) {
+    return (float) ( (float) ( x & 0x00ffffff ) + 0.5 ) * (float) ( 1.0 / 8388607.5 );
+  }
+};
+
+struct Sint32ToFloat32 {
+  static inline float convert( signed int x ) {
+    return (float) ( (float) x + 0.5 ) * (float) ( 1.0 / 2147483647.5 );
+  }
+};
+
+struct Float64ToFloat32 {
+  static inline float convert( double x ) { return (float) x; }
+};
+
+struct Sint16ToSint32 {
+  static inline signed int convert( signed short x ) { return (signed int) x << 16; }
+};
+
+struct Sint24ToSint32 {
+  static inline signed int convert( signed int x ) { return x << 8; }
+};
+
+template <typename T>
+struct FloatToSint32 {
+  static inline signed int convert( T x ) { return (signed int) ( x * 2147483647.5 - 0.5 ); }
+};
+
+struct Sint16ToSint24 {
+  static inline signed int convert( signed short x ) { return (signed int) x << 8; }
+};
+
+struct Sint32ToSint24 {
+  static inline signed int convert( signed int x ) { return x >> 8; }
+};
+
+template <typename T>
+struct FloatToSint24 {
+  static inline signed int convert( T x ) { return (signed int) ( x * 8388607.5 - 0.5 ); }
+};
+
+struct Sint24ToSint16 {
+  static inline signed short convert( signed int x ) { return (signed short) ( ( x >> 8 ) & 0x0000ffff ); }
+};
+
+struct Sint32ToSint16 {
+  static inline signed short convert( signed int x ) { return (signed short) ( ( x >> 16 ) & 0x0000ffff ); }
+};
+
+template <typename T>
+struct FloatToSint16 {
+  static inline signed short convert( T x ) { return (signed short) ( x * 32767.5 - 0.5 ); }
+};
+
+// A conversion kernel for one format pair.  The contiguous loop has
+// no per-sample branches and is vectorized by the compiler.
+template <typename In, typename Out, typename Op>
+static void convertKernel( char *outBuffer, const char *inBuffer, unsigned int nSamples,
+                           int inJump, int outJump )
+{
+  const In * __restrict in = (const In *) inBuffer;
+  Out * __restrict out = (Out *) outBuffer;
+  if ( inJump == 1 && outJump == 1 ) {
+    for ( unsigned int i=0; i<nSamples; i++ )
+      out[i] = Op::convert( in[i] );
+  }
+  else {
+    for ( unsigned int i=0; i<nSamples; i++, in += inJump, out += outJump )
+      *out = Op::convert( *in );
+  }
+}
+
+RtApi::ConvertKernel RtApi :: getConvertKernel( RtAudioFormat inFormat, RtAudioFormat outFormat )
+{
+  // 8-bit data is left to the general conversion loops.
+  if ( outFormat == RTAUDIO_FLOAT64 ) {
+    if ( inFormat == RTAUDIO_SINT16 ) return &convertKernel<Int16, Float64, Sint16ToFloat64>;
+    if ( inFormat == RTAUDIO_SINT24 ) return &convertKernel<Int32, Float64, Sint24ToFloat64>;
+    if ( inFormat == RTAUDIO_SINT32 ) return &convertKernel<Int32, Float64, Sint32ToFloat64>;
+    if ( inFormat == RTAUDIO_FLOAT32 ) return &convertKernel<Float32, Float64, Float32ToFloat64>;
+    if ( inFormat == RTAUDIO_FLOAT64 ) return &convertKernel<Float64, Float64, CopySample<Float64> >;
+  }
+  else if ( outFormat == RTAUDIO_FLOAT32 ) {
+    if ( inFormat == RTAUDIO_SINT16 ) return &convertKernel<Int16, Float32, Sint16ToFloat32>;
+    if ( inFormat == RTAUDIO_SINT24 ) return &convertKernel<Int32, Float32, Sint24ToFloat32>;
+    if ( inFormat == RTAUDIO_SINT32 ) return &convertKernel<Int32, Float32, Sint32ToFloat32>;
+    if ( inFormat == RTAUDIO_FLOAT32 ) return &convertKernel<Float32, Float32, CopySample<Float32> >;
+    if ( inFormat == RTAUDIO_FLOAT64 ) return &convertKernel<Float64, Float32, Float64ToFloat32>;
+  }
+  else if ( outFormat == RTAUDIO_SINT32 ) {
+    if ( inFormat == RTAUDIO_SINT16 ) return &convertKernel<Int16, Int32, Sint16ToSint32>;
+    if ( inFormat == RTAUDIO_SINT24 ) return &convertKernel<Int32, Int32, Sint24ToSint32>;
+    if ( inFormat == RTAUDIO_SINT32 ) return &convertKernel<Int32, Int32, CopySample<Int32> >;
+    if ( inFormat == RTAUDIO_FLOAT32 ) return &convertKernel<Float32, Int32, FloatToSint32<Float32> >;
+    if ( inFormat == RTAUDIO_FLOAT64 ) return &convertKernel<Float64, Int32, FloatToSint32<Float64> >;
+  }
+  else if ( outFormat == RTAUDIO_SINT24 ) {
+    if ( inFormat == RTAUDIO_SINT16 ) return &convertKernel<Int16, Int32, Sint16ToSint24>;
+    if ( inFormat == RTAUDIO_SINT24 ) return &convertKernel<Int32, Int32, CopySample<Int32> >;
+    if ( inFormat == RTAUDIO_SINT32 ) return &convertKernel<Int32, Int32, Sint32ToSint24>;
+    if ( inFormat == RTAUDIO_FLOAT32 ) return &convertKernel<Float32, Int32, FloatToSint24<Float32> >;
+    if ( inFormat == RTAUDIO_FLOAT64 ) return &convertKernel<Float64, Int32, FloatToSint24<Float64> >;
+  }
+  else if ( outFormat == RTAUDIO_SINT16 ) {
+    if ( inFormat == RTAUDIO_SINT16 ) return &convertKernel<Int16, Int16, CopySample<Int16> >;
+    if ( inFormat == RTAUDIO_SINT24 ) return &convertKernel<Int32, Int16, Sint24ToSint16>;
+    if ( inFormat == RTAUDIO_SINT32 ) return &convertKernel<Int32, Int16, Sint32ToSint16>;
+    if ( inFormat == RTAUDIO_FLOAT32 ) return &convertKernel<Float32, Int16, FloatToSint16<Float32> >;
+    if ( inFormat == RTAUDIO_FLOAT64 ) return &convertKernel<Float64, Int16, FloatToSint16<Float64> >;
+  }
+
+  return 0;
 }
 
 void RtApi :: convertBuffer( char *outBuffer, char *inBuffer, ConvertInfo &info )
@@ -7846,6 +8164,21 @@ void RtApi :: convertBuffer( char *outBuffer, char *inBuffer, ConvertInfo &info
        ( stream_.nDeviceChannels[0] < stream_.nDeviceChannels[1] ) )
     memset( outBuffer, 0, stream_.bufferSize * info.outJump * formatBytes( info.outFormat ) );
 
+  // Use the kernel chosen when the stream was opened, if any.
+  if ( info.kernel ) {
+    unsigned int inBytes = formatBytes( info.inFormat );
+    unsigned int outBytes = formatBytes( info.outFormat );
+    if ( info.flat )
+      info.kernel( outBuffer + info.outOffset[0] * outBytes, inBuffer + info.inOffset[0] * inBytes,
+                   stream_.bufferSize * info.channels, 1, 1 );
+    else {
+      for ( int j=0; j<info.channels; j++ )
+        info.kernel( outBuffer + info.outOffset[j] * outBytes, inBuffer + info.inOffset[j] * inBytes,
+                     stream_.bufferSize, info.inJump, info.outJump );
+    }
+    return;
+  }
+
   int j;
   if (info.outFormat == RTAUDIO_FLOAT64) {
     Float64 scale;
@@ -8268,75 +8601,45 @@ void RtApi :: convertBuffer( char *outBuffer, char *inBuffer, ConvertInfo &info
   }
 }
 
-  //static inline uint16_t bswap_16(uint16_t x) { return (x>>8) | (x<<8); }
-  //static inline uint32_t bswap_32(uint32_t x) { return (bswap_16(x&0xffff)<<16) | (bswap_16(x>>16)); }
-  //static inline uint64_t bswap_64(uint64_t x) { return (((unsigned long long)bswap_32(x&0xffffffffull))<<32) | (bswap_32(x>>32)); }
+// Byte-swap kernels.  The swaps are written as shifts and masks on
+// whole words, which the compiler turns into vector byte shuffles.
+// The buffers are aligned for their sample format, as they are in
+// convertBuffer().
 
-void RtApi :: byteSwapBuffer( char *buffer, unsigned int samples, RtAudioFormat format )
+static void byteSwap16( unsigned short * __restrict ptr, unsigned int samples )
 {
-  register char val;
-  register char *ptr;
+  for ( unsigned int i=0; i<samples; i++ )
+    ptr[i] = (unsigned short) ( ( ptr[i] >> 8 ) | ( ptr[i] << 8 ) );
+}
 
-  ptr = buffer;
-  if ( format == RTAUDIO_SINT16 ) {
-    for ( unsigned int i=0; i<samples; i++ ) {
-      // Swap 1st and 2nd bytes.
-      val = *(ptr);
-      *(ptr) = *(ptr+1);
-      *(ptr+1) = val;
+static void byteSwap32( unsigned int * __restrict ptr, unsigned int samples )
+{
+  for ( unsigned int i=0; i<samples; i++ ) {
+    unsigned int x = ptr[i];
+    ptr[i] = ( x >> 24 ) | ( ( x >> 8 ) & 0x0000ff00 ) | ( ( x << 8 ) & 0x00ff0000 ) | ( x << 24 );
+  }
+}
 
-      // Increment 2 bytes.
-      ptr += 2;
-    }
+static void byteSwap64( unsigned long long * __restrict ptr, unsigned int samples )
+{
+  for ( unsigned int i=0; i<samples; i++ ) {
+    unsigned long long x = ptr[i];
+    x = ( x >> 32 ) | ( x << 32 );
+    x = ( ( x >> 16 ) & 0x0000ffff0000ffffULL ) | ( ( x & 0x0000ffff0000ffffULL ) << 16 );
+    ptr[i] = ( ( x >> 8 ) & 0x00ff00ff00ff00ffULL ) | ( ( x & 0x00ff00ff00ff00ffULL ) << 8 );
   }
+}
+
+void RtApi :: byteSwapBuffer( char *buffer, unsigned int samples, RtAudioFormat format )
+{
+  if ( format == RTAUDIO_SINT16 )
+    byteSwap16( (unsigned short *) buffer, samples );
   else if ( format == RTAUDIO_SINT24 ||
             format == RTAUDIO_SINT32 ||
-            format == RTAUDIO_FLOAT32 ) {
-    for ( unsigned int i=0; i<samples; i++ ) {
-      // Swap 1st and 4th bytes.
-      val = *(ptr);
-      *(ptr) = *(ptr+3);
-      *(ptr+3) = val;
-
-      // Swap 2nd and 3rd bytes.
-      ptr += 1;
-      val = *(ptr);
-      *(ptr) = *(ptr+1);
-      *(ptr+1) = val;
-
-      // Increment 3 more bytes.
-      ptr += 3;
-    }
-  }
-  else if ( format == RTAUDIO_FLOAT64 ) {
-    for ( unsigned int i=0; i<samples; i++ ) {
-      // Swap 1st and 8th bytes
-      val = *(ptr);
-      *(ptr) = *(ptr+7);
-      *(ptr+7) = val;
-
-      // Swap 2nd and 7th bytes
-      ptr += 1;
-      val = *(ptr);
-      *(ptr) = *(ptr+5);
-      *(ptr+5) = val;
-
-      // Swap 3rd and 6th bytes
-      ptr += 1;
-      val = *(ptr);
-      *(ptr) = *(ptr+3);
-      *(ptr+3) = val;
-
-      // Swap 4th and 5th bytes
-      ptr += 1;
-      val = *(ptr);
-      *(ptr) = *(ptr+1);
-      *(ptr+1) = val;
-
-      // Increment 5 more bytes.
-      ptr += 5;
-    }
-  }
+            format == RTAUDIO_FLOAT32 )
+    byteSwap32( (unsigned int *) buffer, samples );
+  else if ( format == RTAUDIO_FLOAT64 )
+    byteSwap64( (unsigned long long *) buffer, samples );
 }
 
   // Indentation settings for Vim and Emacs
@@ -40,6 +40,7 @@
 
 #include "RtMidi.h"
 #include <sstream>
+#include <cstring>
 
 //*********************************************************************//
 //  RtMidi Definitions
@@ -241,16 +242,71 @@ RtMidiOut :: ~RtMidiOut() throw()
 MidiInApi :: MidiInApi( unsigned int queueSizeLimit )
   : apiData_( 0 ), connected_( false )
 {
-  // Allocate the MIDI queue.
-  inputData_.queue.ringSize = queueSizeLimit;
-  if ( inputData_.queue.ringSize > 0 )
-    inputData_.queue.ring = new MidiMessage[ inputData_.queue.ringSize ];
+  // Allocate the MIDI queue.  One ring entry is always left empty to
+  // tell a full queue from an empty one.
+  inputData_.queue.ringSize = queueSizeLimit + 1;
+  inputData_.queue.ring = new MidiQueue::Entry[ inputData_.queue.ringSize ];
+  inputData_.queue.sysex = new unsigned char[ MidiQueue::SYSEX_POOL_BYTES ];
 }
 
 MidiInApi :: ~MidiInApi( void )
 {
   // Delete the MIDI queue.
-  if ( inputData_.queue.ringSize > 0 ) delete [] inputData_.queue.ring;
+  delete [] inputData_.queue.ring;
+  delete [] inputData_.queue.sysex;
+}
+
+bool MidiInApi::MidiQueue :: push( const unsigned char *bytes, unsigned int size, double timeStamp )
+{
+  unsigned int next = back.load( std::memory_order_relaxed ) + 1;
+  if ( next == ringSize ) next = 0;
+  if ( next == front.load( std::memory_order_acquire ) ) return false;
+
+  Entry& entry = ring[ back.load( std::memory_order_relaxed ) ];
+  if ( size <= INLINE_BYTES ) {
+    for ( unsigned int i=0; i<size; i++ ) entry.bytes[i] = bytes[i];
+  }
+  else {
+    // The pool counters only increase, so the used space is their
+    // difference.  A message may wrap around the end of the pool.
+    unsigned long used = sysexBack - sysexFront.load( std::memory_order_acquire );
+    if ( size > SYSEX_POOL_BYTES - used ) return false;
+    unsigned long offset = sysexBack % SYSEX_POOL_BYTES;
+    unsigned long count = SYSEX_POOL_BYTES - offset;
+    if ( count > size ) count = size;
+    memcpy( sysex + offset, bytes, count );
+    memcpy( sysex, bytes + count, size - count );
+    entry.sysexStart = sysexBack;
+    sysexBack += size;
+  }
+  entry.size = size;
+  entry.timeStamp = timeStamp;
+
+  back.store( next, std::memory_order_release );
+  return true;
+}
+
+bool MidiInApi::MidiQueue :: pop( std::vector<unsigned char> *message, double *timeStamp )
+{
+  unsigned int index = front.load( std::memory_order_relaxed );
+  if ( index == back.load( std::memory_order_acquire ) ) return false;
+
+  const Entry& entry = ring[index];
+  if ( entry.size <= INLINE_BYTES )
+    message->assign( entry.bytes, entry.bytes + entry.size );
+  else {
+    unsigned long offset = entry.sysexStart % SYSEX_POOL_BYTES;
+    unsigned long count = SYSEX_POOL_BYTES - offset;
+    if ( count > entry.size ) count = entry.size;
+    message->assign( sysex + offset, sysex + offset + count );
+    message->insert( message->end(), sysex, sysex + entry.size - count );
+    sysexFront.store( entry.sysexStart + entry.size, std::memory_order_release );
+  }
+  *timeStamp = entry.timeStamp;
+
+  if ( ++index == ringSize ) index = 0;
+  front.store( index, std::memory_order_release );
+  return true;
 }
 
 void MidiInApi :: setCallback( RtMidiIn::RtMidiCallback callback, void *userData )
@@ -303,17 +359,8 @@ double MidiInApi :: getMessage( std::vector<unsigned char> *message )
     return 0.0;
   }
 
-  if ( inputData_.queue.size == 0 ) return 0.0;
-
-  // Copy queued message to the vector pointer argument and then "pop" it.
-  std::vector<unsigned char> *bytes = &(inputData_.queue.ring[inputData_.queue.front].bytes);
-  message->assign( bytes->begin(), bytes->end() );
-  double deltaTime = inputData_.queue.ring[inputData_.queue.front].timeStamp;
-  inputData_.queue.size--;
-  inputData_.queue.front++;
-  if ( inputData_.queue.front == inputData_.queue.ringSize )
-    inputData_.queue.front = 0;
-
+  double deltaTime;
+  if ( !inputData_.queue.pop( message, &deltaTime ) ) return 0.0;
   return deltaTime;
 }
 
@@ -429,14 +476,8 @@ void midiInputCallback( const MIDIPacketList *list, void *procRef, void *srcRef
           callback( message.timeStamp, &message.bytes, data->userData );
         }
         else {
-          // As long as we haven't reached our queue size limit, push the message.
-          if ( data->queue.size < data->queue.ringSize ) {
-            data->queue.ring[data->queue.back++] = message;
-            if ( data->queue.back == data->queue.ringSize )
-              data->queue.back = 0;
-            data->queue.size++;
-          }
-          else
+          // Push the message unless the queue is full.
+          if ( !data->queue.push( &message.bytes[0], message.bytes.size(), message.timeStamp ) )
             std::cerr << "\nMidiInCore: message queue limit reached!!\n\n";
         }
         message.bytes.clear();
@@ -493,14 +534,8 @@ void midiInputCallback( const MIDIPacketList *list, void *procRef, void *srcRef
               callback( message.timeStamp, &message.bytes, data->userData );
             }
             else {
-              // As long as we haven't reached our queue size limit, push the message.
-              if ( data->queue.size < data->queue.ringSize ) {
-                data->queue.ring[data->queue.back++] = message;
-                if ( data->queue.back == data->queue.ringSize )
-                  data->queue.back = 0;
-                data->queue.size++;
-              }
-              else
+              // Push the message unless the queue is full.
+              if ( !data->queue.push( &message.bytes[0], message.bytes.size(), message.timeStamp ) )
                 std::cerr << "\nMidiInCore: message queue limit reached!!\n\n";
             }
             message.bytes.clear();
@@ -1043,6 +1078,7 @@ void MidiOutCore :: sendMessage( std::vector<unsigned char> *message )
 
 #include <pthread.h>
 #include <sys/time.h>
+#include <time.h>
 
 // ALSA header file.
 #include <alsa/asoundlib.h>
@@ -1077,6 +1113,38 @@ struct AlsaMidiData {
 
 #define PORT_TYPE( pinfo, bits ) ((snd_seq_port_info_get_capability(pinfo) & (bits)) == (bits))
 
+// Return the time of an incoming event in nanoseconds.  Events are
+// normally stamped with the queue's real time by the sequencer as
+// they are delivered to our port, which is unaffected by any delay in
+// waking up the input thread.  The current queue time is used for
+// events that arrive without such a stamp.  All times come from the
+// one clock, so that the difference between successive events is
+// meaningful: if the queue cannot be read, the time of the previous
+// event is repeated.  Without timestamping, the monotonic system
+// clock is used throughout.
+static unsigned long long alsaEventTime( AlsaMidiData *apiData, const snd_seq_event_t *ev )
+{
+#ifndef AVOID_TIMESTAMPING
+  if ( ( ev->flags & SND_SEQ_TIME_STAMP_MASK ) == SND_SEQ_TIME_STAMP_REAL )
+    return ev->time.time.tv_sec * 1000000000ULL + ev->time.time.tv_nsec;
+
+  snd_seq_queue_status_t *status;
+  snd_seq_queue_status_alloca( &status );
+  if ( snd_seq_get_queue_status( apiData->seq, apiData->queue_id, status ) == 0 ) {
+    const snd_seq_real_time_t *time = snd_seq_queue_status_get_real_time( status );
+    return time->tv_sec * 1000000000ULL + time->tv_nsec;
+  }
+  return apiData->lastTime;
+#else
+  (void) apiData;
+  (void) ev;
+
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  return now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
 snd_seq_t* createSequencer( const std::string& clientName )
 {
   // Set up the ALSA sequencer client.
@@ -1120,10 +1188,14 @@ extern "C" void *alsaMidiHandler( void *ptr )
   AlsaMidiData *apiData = static_cast<AlsaMidiData *> (data->apiData);
 
   long nBytes;
-  unsigned long long time, lastTime;
+  unsigned long long time = 0;
   bool continueSysex = false;
   bool doDecode = false;
   MidiInApi::MidiMessage message;
+
+  // Reserve room for sysex messages up front so that incoming messages
+  // are normally assembled without allocating memory.
+  message.bytes.reserve( 1024 );
   int poll_fd_count;
   struct pollfd *poll_fds;
 
@@ -1239,32 +1311,25 @@ extern "C" void *alsaMidiHandler( void *ptr )
         // events of 256 bytes.  If a device sends sysex messages larger
         // than this, they are segmented into 256 byte chunks.  So,
         // we'll watch for this and concatenate sysex chunks into a
-        // single sysex message if necessary.
-        if ( !continueSysex )
+        // single sysex message if necessary.  A message is stamped with
+        // the time of its first chunk.
+        if ( !continueSysex ) {
           message.bytes.assign( buffer, &buffer[nBytes] );
+          time = alsaEventTime( apiData, ev );
+        }
         else
           message.bytes.insert( message.bytes.end(), buffer, &buffer[nBytes] );
 
         continueSysex = ( ( ev->type == SND_SEQ_EVENT_SYSEX ) && ( message.bytes.back() != 0xF7 ) );
         if ( !continueSysex ) {
 
-          // Calculate the time stamp:
+          // Calculate the delta time from the previous message.
           message.timeStamp = 0.0;
-
-          // Method 1: Use the system time.
-          //(void)gettimeofday(&tv, (struct timezone *)NULL);
-          //time = (tv.tv_sec * 1000000) + tv.tv_usec;
-
-          // Method 2: Use the ALSA sequencer event time data.
-          // (thanks to Pedro Lopez-Cabanillas!).
-          time = ( ev->time.time.tv_sec * 1000000 ) + ( ev->time.time.tv_nsec/1000 );
-          lastTime = time;
-          time -= apiData->lastTime;
-          apiData->lastTime = lastTime;
           if ( data->firstMessage == true )
             data->firstMessage = false;
           else
-            message.timeStamp = time * 0.000001;
+            message.timeStamp = (long long) ( time - apiData->lastTime ) * 0.000000001;
+          apiData->lastTime = time;
         }
         else {
 #if defined(__RTMIDI_DEBUG__)
@@ -1282,14 +1347,8 @@ extern "C" void *alsaMidiHandler( void *ptr )
       callback( message.timeStamp, &message.bytes, data->userData );
     }
     else {
-      // As long as we haven't reached our queue size limit, push the message.
-      if ( data->queue.size < data->queue.ringSize ) {
-        data->queue.ring[data->queue.back++] = message;
-        if ( data->queue.back == data->queue.ringSize )
-          data->queue.back = 0;
-        data->queue.size++;
-      }
-      else
+      // Push the message unless the queue is full.
+      if ( !data->queue.push( &message.bytes[0], message.bytes.size(), message.timeStamp ) )
         std::cerr << "\nMidiInAlsa: message queue limit reached!!\n\n";
     }
   }
@@ -1968,14 +2027,8 @@ static void CALLBACK midiInputCallback( HMIDIIN hmin,
     callback( apiData->message.timeStamp, &apiData->message.bytes, data->userData );
   }
   else {
-    // As long as we haven't reached our queue size limit, push the message.
-    if ( data->queue.size < data->queue.ringSize ) {
-      data->queue.ring[data->queue.back++] = apiData->message;
-      if ( data->queue.back == data->queue.ringSize )
-        data->queue.back = 0;
-      data->queue.size++;
-    }
-    else
+    // Push the message unless the queue is full.
+    if ( !data->queue.push( &apiData->message.bytes[0], apiData->message.bytes.size(), apiData->message.timeStamp ) )
       std::cerr << "\nRtMidiIn: message queue limit reached!!\n\n";
   }
 
@@ -3088,14 +3141,8 @@ DWORD WINAPI midiKsInputThread(VOID* pUser)
           callback(message.timeStamp, &message.bytes, data->userData);
         }
         else {
-          // As long as we haven't reached our queue size limit, push the message.
-          if ( data->queue.size < data->queue.ringSize ) {
-            data->queue.ring[data->queue.back++] = message;
-            if(data->queue.back == data->queue.ringSize)
-              data->queue.back = 0;
-            data->queue.size++;
-          }
-          else
+          // Push the message unless the queue is full.
+          if ( !data->queue.push( &message.bytes[0], message.bytes.size(), message.timeStamp ) )
             std::cerr << "\nRtMidiIn: message queue limit reached!!\n\n";
         }
 
@@ -3441,14 +3488,8 @@ int jackProcessIn( jack_nframes_t nframes, void *arg )
         callback( message.timeStamp, &message.bytes, rtData->userData );
       }
       else {
-        // As long as we haven't reached our queue size limit, push the message.
-        if ( rtData->queue.size < rtData->queue.ringSize ) {
-          rtData->queue.ring[rtData->queue.back++] = message;
-          if ( rtData->queue.back == rtData->queue.ringSize )
-            rtData->queue.back = 0;
-          rtData->queue.size++;
-        }
-        else
+        // Push the message unless the queue is full.
+        if ( !rtData->queue.push( &message.bytes[0], message.bytes.size(), message.timeStamp ) )
           std::cerr << "\nMidiInJack: message queue limit reached!!\n\n";
       }
     }
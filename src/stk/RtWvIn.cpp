@@ -8,6 +8,13 @@
     from which data is read.  This class should not be used when
     low-latency is desired.
 
+    The ring-buffer is shared without locks between the audio
+    callback and the reading thread.  When the buffer is empty, the
+    tick() functions sleep on a condition variable that the callback
+    signals after each write.  If the buffer is too full to take all
+    of the input when the callback runs, the frames that do not fit
+    are discarded and the event is counted (see getOverruns()).
+
     RtWvIn supports multi-channel data in both interleaved and
     non-interleaved formats.  It is important to distinguish the
     tick() method that computes a single frame (and returns only the
@@ -28,50 +35,47 @@ namespace stk {
 int read( void *outputBuffer, void *inputBuffer, unsigned int nBufferFrames,
           double streamTime, RtAudioStreamStatus status, void *dataPointer )
 {
-  ( (RtWvIn *) dataPointer )->fillBuffer( inputBuffer, nBufferFrames );
+  ( (RtWvIn *) dataPointer )->fillBuffer( inputBuffer, nBufferFrames, status );
   return 0;
 }
 
-// This function does not block.  If the user does not read the buffer
-// data fast enough, unread data will be overwritten (data overrun).
-void RtWvIn :: fillBuffer( void *buffer, unsigned int nFrames )
+// This function does not block or lock.  Only the callback moves
+// writeIndex_ and only the reading thread moves readIndex_, while
+// framesFilled_ hands frames from one to the other.  If the user does
+// not read the buffer data fast enough, new input that does not fit
+// is discarded (data overrun).
+void RtWvIn :: fillBuffer( void *buffer, unsigned int nFrames, RtAudioStreamStatus status )
 {
-  StkFloat *samples = (StkFloat *) buffer;
-  unsigned int counter, iStart, nSamples = nFrames * data_.channels();
-
-  while ( nSamples > 0 ) {
-
-    // I'm assuming that both the RtAudio and StkFrames buffers
-    // contain interleaved data.
-    iStart = writeIndex_ * data_.channels();
-    counter = nSamples;
+  if ( status & RTAUDIO_INPUT_OVERFLOW )
+    deviceOverflows_.fetch_add( 1, std::memory_order_relaxed );
 
-    // Pre-increment write pointer and check bounds.
-    writeIndex_ += nSamples / data_.channels();
-    if ( writeIndex_ >= data_.frames() ) {
-      writeIndex_ = 0;
-      counter = data_.size() - iStart;
-    }
-
-    // Copy data to the StkFrames container.
-    for ( unsigned int i=0; i<counter; i++ )
-      data_[iStart++] = *samples++;
-
-    nSamples -= counter;
+  unsigned int framesEmpty = data_.frames() - framesFilled_.load( std::memory_order_acquire );
+  if ( nFrames > framesEmpty ) {
+    nFrames = framesEmpty;
+    overruns_.fetch_add( 1, std::memory_order_relaxed );
   }
 
-  mutex_.lock();
-  framesFilled_ += nFrames;
-  mutex_.unlock();
-  if ( framesFilled_ > data_.frames() ) {
-    framesFilled_ = data_.frames();
-    oStream_ << "RtWvIn: audio buffer overrun!";
-    handleError( StkError::WARNING );
-  }
+  // Copy data to the StkFrames container in up to two pieces.  I'm
+  // assuming that both the RtAudio and StkFrames buffers contain
+  // interleaved data.
+  unsigned int nChannels = data_.channels();
+  StkFloat *samples = (StkFloat *) buffer;
+  unsigned int counter = nFrames;
+  if ( writeIndex_ + counter > data_.frames() )
+    counter = data_.frames() - writeIndex_;
+  memcpy( &data_[writeIndex_ * nChannels], samples, counter * nChannels * sizeof( StkFloat ) );
+  if ( counter < nFrames )
+    memcpy( &data_[0], samples + counter * nChannels, ( nFrames - counter ) * nChannels * sizeof( StkFloat ) );
+
+  writeIndex_ += nFrames;
+  if ( writeIndex_ >= data_.frames() ) writeIndex_ -= data_.frames();
+  framesFilled_.fetch_add( nFrames, std::memory_order_release );
+  dataAvailable_.notify_one();
 }
 
 RtWvIn :: RtWvIn( unsigned int nChannels, StkFloat sampleRate, int device, int bufferFrames, int nBuffers )
-  : stopped_( true ), readIndex_( 0 ), writeIndex_( 0 ), framesFilled_( 0 )
+  : stopped_( true ), readIndex_( 0 ), writeIndex_( 0 ), framesFilled_( 0 ),
+    overruns_( 0 ), deviceOverflows_( 0 ), waitTime_( 0 )
 {
   // We'll let RtAudio deal with channel and sample rate limitations.
   RtAudio::StreamParameters parameters;
@@ -92,6 +96,11 @@ RtWvIn :: RtWvIn( unsigned int nChannels, StkFloat sampleRate, int device, int b
 
   data_.resize( size * nBuffers, nChannels );
   lastFrame_.resize( 1, nChannels );
+
+  // A blocked reader is woken by each callback.  As a safeguard
+  // against a missed wakeup, it also rechecks the buffer once per
+  // callback period.
+  waitTime_ = std::chrono::microseconds( (long) ( 1000000.0 * size / Stk::sampleRate() ) + 1 );
 }
 
 RtWvIn :: ~RtWvIn()
@@ -117,6 +126,15 @@ void RtWvIn :: stop()
   }
 }
 
+void RtWvIn :: waitForData( void )
+{
+  if ( framesFilled_.load( std::memory_order_acquire ) > 0 ) return;
+
+  std::unique_lock<std::mutex> lock( waitMutex_ );
+  while ( framesFilled_.load( std::memory_order_acquire ) == 0 )
+    dataAvailable_.wait_for( lock, waitTime_ );
+}
+
 StkFloat RtWvIn :: tick( unsigned int channel )
 {
 #if defined(_STK_DEBUG_)
@@ -129,18 +147,16 @@ StkFloat RtWvIn :: tick( unsigned int channel )
   if ( stopped_ ) this->start();
 
   // Block until at least one frame is available.
-  while ( framesFilled_ == 0 ) Stk::sleep( 1 );
+  this->waitForData();
 
   unsigned long index = readIndex_ * lastFrame_.channels();
   for ( unsigned int i=0; i<lastFrame_.size(); i++ )
     lastFrame_[i] = data_[index++];
 
-  mutex_.lock();
-  framesFilled_--;
-  mutex_.unlock();
   readIndex_++;
   if ( readIndex_ >= data_.frames() )
     readIndex_ = 0;
+  framesFilled_.fetch_sub( 1, std::memory_order_release );
 
   return lastFrame_[channel];
 }
@@ -163,10 +179,10 @@ StkFrames& RtWvIn :: tick( StkFrames& frames )
   while ( framesRead < frames.frames() ) {
 
     // Block until we have some input data.
-    while ( framesFilled_ == 0 ) Stk::sleep( 1 );
+    this->waitForData();
 
     // Copy data in one chunk up to the end of the data buffer.
-    nFrames = framesFilled_;
+    nFrames = framesFilled_.load( std::memory_order_acquire );
     if ( readIndex_ + nFrames > data_.frames() )
       nFrames = data_.frames() - readIndex_;
     if ( nFrames > frames.frames() - framesRead )
@@ -179,9 +195,7 @@ StkFrames& RtWvIn :: tick( StkFrames& frames )
     if ( readIndex_ == data_.frames() ) readIndex_ = 0;
 
     framesRead += nFrames;
-    mutex_.lock();
-    framesFilled_ -= nFrames;
-    mutex_.unlock();
+    framesFilled_.fetch_sub( nFrames, std::memory_order_release );
   }
 
   unsigned long index = (frames.frames() - 1) * nChannels;
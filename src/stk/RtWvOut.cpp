@@ -8,6 +8,13 @@
     into which data is written.  This class should not be used when
     low-latency is desired.
 
+    The ring-buffer is shared without locks between the writing
+    thread and the audio callback.  When the buffer is full, the
+    tick() functions sleep on a condition variable that the callback
+    signals after each read.  If the buffer holds too few frames when
+    the callback runs, the missing frames are output as silence and
+    the event is counted (see getUnderruns()).
+
     RtWvOut supports multi-channel data in interleaved format.  It is
     important to distinguish the tick() method that outputs a single
     sample to all channels in a sample frame from the overloaded one
@@ -30,60 +37,51 @@ enum { RUNNING, EMPTYING, FINISHED };
 int write( void *outputBuffer, void *inputBuffer, unsigned int nBufferFrames,
            double streamTime, RtAudioStreamStatus status, void *dataPointer )
 {
-  return ( (RtWvOut *) dataPointer )->readBuffer( outputBuffer, nBufferFrames );
+  return ( (RtWvOut *) dataPointer )->readBuffer( outputBuffer, nBufferFrames, status );
 }
 
-// This function does not block.  If the user does not write output
-// data to the buffer fast enough, previous data will be re-output
-// (data underrun).
-int RtWvOut :: readBuffer( void *buffer, unsigned int frameCount )
+// This function does not block or lock.  Only the callback moves
+// readIndex_ and only the writing thread moves writeIndex_, while
+// framesFilled_ hands frames from one to the other.  If the user does
+// not write output data to the buffer fast enough, the missing
+// frames are output as zeros (data underrun).
+int RtWvOut :: readBuffer( void *buffer, unsigned int frameCount, RtAudioStreamStatus status )
 {
-  unsigned int nSamples, nChannels = data_.channels();
+  if ( status & RTAUDIO_OUTPUT_UNDERFLOW )
+    deviceUnderflows_.fetch_add( 1, std::memory_order_relaxed );
+
+  unsigned int nChannels = data_.channels();
+  long framesFilled = framesFilled_.load( std::memory_order_acquire );
+  bool emptying = ( status_.load( std::memory_order_acquire ) == EMPTYING );
   unsigned int nFrames = frameCount;
-  StkFloat *input = (StkFloat *) &data_[ readIndex_ * nChannels ];
+  if ( framesFilled < (long) nFrames ) {
+    nFrames = framesFilled;
+    if ( !emptying ) underruns_.fetch_add( 1, std::memory_order_relaxed );
+  }
+
+  // Copy data from the StkFrames container in up to two pieces.  I'm
+  // assuming that both the RtAudio and StkFrames buffers contain
+  // interleaved data.
   StkFloat *output = (StkFloat *) buffer;
-  long counter;
-
-  while ( nFrames > 0 ) {
-
-    // I'm assuming that both the RtAudio and StkFrames buffers
-    // contain interleaved data.
-    counter = nFrames;
-
-    // Pre-increment read pointer and check bounds.
-    readIndex_ += nFrames;
-    if ( readIndex_ >= data_.frames() ) {
-      counter -= readIndex_ - data_.frames();
-      readIndex_ = 0;
-    }
-
-    // Copy data from the StkFrames container.
-    if ( status_ == EMPTYING && framesFilled_ <= counter ) {
-      nSamples = framesFilled_ * nChannels;
-      unsigned int i;
-      for ( i=0; i<nSamples; i++ ) *output++ = *input++;
-      nSamples = (counter - framesFilled_) * nChannels;
-      for ( i=0; i<nSamples; i++ ) *output++ = 0.0;
-      status_ = FINISHED;
-      return 1;
-    }
-    else {
-      nSamples = counter * nChannels;
-      for ( unsigned int i=0; i<nSamples; i++ )
-        *output++ = *input++;
-    }
-
-    nFrames -= counter;
+  unsigned int counter = nFrames;
+  if ( readIndex_ + counter > data_.frames() )
+    counter = data_.frames() - readIndex_;
+  memcpy( output, &data_[readIndex_ * nChannels], counter * nChannels * sizeof( StkFloat ) );
+  output += counter * nChannels;
+  if ( counter < nFrames ) {
+    memcpy( output, &data_[0], ( nFrames - counter ) * nChannels * sizeof( StkFloat ) );
+    output += ( nFrames - counter ) * nChannels;
   }
+  for ( unsigned int i=0; i<(frameCount - nFrames) * nChannels; i++ ) *output++ = 0.0;
+
+  readIndex_ += nFrames;
+  if ( readIndex_ >= data_.frames() ) readIndex_ -= data_.frames();
+  framesFilled_.fetch_sub( nFrames, std::memory_order_release );
+  spaceAvailable_.notify_one();
 
-  mutex_.lock();
-  framesFilled_ -= frameCount;
-  mutex_.unlock();
-  if ( framesFilled_ < 0 ) {
-    framesFilled_ = 0;
-    //    writeIndex_ = readIndex_;
-    oStream_ << "RtWvOut: audio buffer underrun!";
-    handleError( StkError::WARNING );
+  if ( emptying && framesFilled <= (long) frameCount ) {
+    status_.store( FINISHED, std::memory_order_release );
+    return 1;
   }
 
   return 0;
@@ -91,7 +89,8 @@ int RtWvOut :: readBuffer( void *buffer, unsigned int frameCount )
 
 
 RtWvOut :: RtWvOut( unsigned int nChannels, StkFloat sampleRate, int device, int bufferFrames, int nBuffers )
-  : stopped_( true ), readIndex_( 0 ), writeIndex_( 0 ), framesFilled_( 0 ), status_(0)
+  : stopped_( true ), readIndex_( 0 ), writeIndex_( 0 ), framesFilled_( 0 ), status_( RUNNING ),
+    underruns_( 0 ), deviceUnderflows_( 0 ), waitTime_( 0 )
 {
   // We'll let RtAudio deal with channel and sample rate limitations.
   RtAudio::StreamParameters parameters;
@@ -116,13 +115,19 @@ RtWvOut :: RtWvOut( unsigned int nChannels, StkFloat sampleRate, int device, int
   // Start writing half-way into buffer.
   writeIndex_ = (unsigned int ) (data_.frames() / 2.0);
   framesFilled_ = writeIndex_;
+
+  // A blocked writer is woken by each callback.  As a safeguard
+  // against a missed wakeup, it also rechecks the buffer once per
+  // callback period.
+  waitTime_ = std::chrono::microseconds( (long) ( 1000000.0 * size / Stk::sampleRate() ) + 1 );
 }
 
 RtWvOut :: ~RtWvOut( void )
 {
   // Change status flag to signal callback to clear the buffer and close.
   status_ = EMPTYING;
-  while ( status_ != FINISHED || dac_.isStreamRunning() == true ) Stk::sleep( 100 );
+  if ( !stopped_ )
+    while ( status_ != FINISHED || dac_.isStreamRunning() == true ) Stk::sleep( 100 );
   dac_.closeStream();
 }
 
@@ -142,12 +147,22 @@ void RtWvOut :: stop( void )
   }
 }
 
+void RtWvOut :: waitForSpace( void )
+{
+  long size = (long) data_.frames();
+  if ( framesFilled_.load( std::memory_order_acquire ) < size ) return;
+
+  std::unique_lock<std::mutex> lock( waitMutex_ );
+  while ( framesFilled_.load( std::memory_order_acquire ) == size )
+    spaceAvailable_.wait_for( lock, waitTime_ );
+}
+
 void RtWvOut :: tick( const StkFloat sample )
 {
   if ( stopped_ ) this->start();
 
   // Block until we have room for at least one frame of output data.
-  while ( framesFilled_ == (long) data_.frames() ) Stk::sleep( 1 );
+  this->waitForSpace();
 
   unsigned int nChannels = data_.channels();
   StkFloat input = sample;
@@ -156,13 +171,11 @@ void RtWvOut :: tick( const StkFloat sample )
   for ( unsigned int j=0; j<nChannels; j++ )
     data_[index++] = input;
 
-  mutex_.lock();
-  framesFilled_++;
-  mutex_.unlock();
-  frameCounter_++;
   writeIndex_++;
   if ( writeIndex_ == data_.frames() )
     writeIndex_ = 0;
+  framesFilled_.fetch_add( 1, std::memory_order_release );
+  frameCounter_++;
 }
 
 void RtWvOut :: tick( const StkFrames& frames )
@@ -184,8 +197,8 @@ void RtWvOut :: tick( const StkFrames& frames )
   while ( framesWritten < frames.frames() ) {
 
     // Block until we have some room for output data.
-    while ( framesFilled_ == (long) data_.frames() ) Stk::sleep( 1 );
-    framesEmpty = data_.frames() - framesFilled_;
+    this->waitForSpace();
+    framesEmpty = data_.frames() - framesFilled_.load( std::memory_order_acquire );
 
     // Copy data in one chunk up to the end of the data buffer.
     nFrames = framesEmpty;
@@ -203,9 +216,7 @@ void RtWvOut :: tick( const StkFrames& frames )
     if ( writeIndex_ == data_.frames() ) writeIndex_ = 0;
 
     framesWritten += nFrames;
-    mutex_.lock();
-    framesFilled_ += nFrames;
-    mutex_.unlock();
+    framesFilled_.fetch_add( nFrames, std::memory_order_release );
     frameCounter_ += nFrames;
   }
 }
@@ -0,0 +1,469 @@
+/***************************************************/
+/*! \class ScoreFile
+    \brief STK compiled binary score file class.
+
+    This class reads and writes scores in a compact binary format
+    that holds pre-parsed, time-sorted control events with absolute
+    time stamps in sample frames.  Scores are compiled once from
+    SKINI or standard MIDI files with convertSkini() and
+    convertMidi().  Where the operating system supports it, an
+    opened score is memory-mapped and its events are read straight
+    from the mapped pages, so playing a score involves no text
+    parsing, no file access and no memory allocation.
+
+    A score file holds a 48-byte header, the events and a table of
+    the string fields of SKINI messages, all in little-endian byte
+    order:
+
+    \code
+    offset  size  header field
+         0     4  "STKS"
+         4     4  format version (1)
+         8     4  header size in bytes
+        12     4  event size in bytes
+        16     8  sample rate of the time stamps (FLOAT64)
+        24     8  number of events
+        32     8  string table size in bytes
+        40     8  reserved (0)
+
+    offset  size  event field
+         0     8  time in sample frames
+         8     4  message type, as defined in SKINI.msg
+        12     2  channel (signed)
+        14     2  flags (1 = string in the string table)
+        16    16  two message values (FLOAT64)
+    \endcode
+
+    An event with a string field holds the byte offset of the
+    NUL-terminated string in its second value.  Readers skip any
+    header or event bytes beyond the sizes known to them, so later
+    versions of the format may only append fields.
+
+    Events can be sent to a Voicer as their time comes up with
+    dispatch(), or read as Skini::Message structures, with delta
+    times in seconds, with nextMessage().
+*/
+/***************************************************/
+
+#include "ScoreFile.h"
+#include "MidiFileIn.h"
+#include "SKINI.msg"
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#if !defined(__OS_WINDOWS__) && !defined(_WIN32)
+  #include <sys/mman.h>
+  #define __SCOREFILE_MMAP__
+#endif
+
+namespace stk {
+
+const unsigned int SCORE_VERSION = 1;
+const unsigned long HEADER_BYTES = 48;
+const unsigned long EVENT_BYTES = 32;
+
+// The file fields are assembled from bytes, so the format does not
+// depend on the byte order or alignment rules of the host.
+static void putBytes( unsigned char *ptr, unsigned long long value, unsigned int nBytes )
+{
+  for ( unsigned int i=0; i<nBytes; i++, value >>= 8 )
+    ptr[i] = (unsigned char) ( value & 0xFF );
+}
+
+static unsigned long long getBytes( const unsigned char *ptr, unsigned int nBytes )
+{
+  unsigned long long value = 0;
+  for ( unsigned int i=nBytes; i>0; i-- )
+    value = ( value << 8 ) | ptr[i-1];
+  return value;
+}
+
+static void putFloat64( unsigned char *ptr, FLOAT64 value )
+{
+  unsigned long long bits;
+  memcpy( &bits, &value, 8 );
+  putBytes( ptr, bits, 8 );
+}
+
+static FLOAT64 getFloat64( const unsigned char *ptr )
+{
+  unsigned long long bits = getBytes( ptr, 8 );
+  FLOAT64 value;
+  memcpy( &value, &bits, 8 );
+  return value;
+}
+
+static bool isEarlier( const ScoreFile::Event& a, const ScoreFile::Event& b )
+{
+  return a.time < b.time;
+}
+
+ScoreFile :: ScoreFile( void )
+  : map_(0), mapLength_(0), events_(0), nEvents_(0), strings_(0),
+    stringBytes_(0), fileRate_(0.0), index_(0)
+{
+}
+
+ScoreFile :: ScoreFile( std::string fileName )
+  : map_(0), mapLength_(0), events_(0), nEvents_(0), strings_(0),
+    stringBytes_(0), fileRate_(0.0), index_(0)
+{
+  this->openFile( fileName );
+}
+
+ScoreFile :: ~ScoreFile( void )
+{
+  this->closeFile();
+}
+
+void ScoreFile :: closeFile( void )
+{
+#if defined(__SCOREFILE_MMAP__)
+  if ( map_ ) munmap( map_, mapLength_ );
+#endif
+  map_ = 0;
+  mapLength_ = 0;
+  data_.clear();
+  events_ = 0;
+  nEvents_ = 0;
+  strings_ = 0;
+  stringBytes_ = 0;
+  fileRate_ = 0.0;
+  index_ = 0;
+}
+
+void ScoreFile :: openFile( std::string fileName )
+{
+  // If another file is open, close it.
+  this->closeFile();
+
+  FILE *fd = fopen( fileName.c_str(), "rb" );
+  if ( !fd ) {
+    oStream_ << "ScoreFile::openFile: could not open or find file (" << fileName << ")!";
+    handleError( StkError::FILE_NOT_FOUND );
+  }
+
+  struct stat filestat;
+  unsigned char header[HEADER_BYTES];
+  if ( fstat( fileno( fd ), &filestat ) == -1 ||
+       fread( header, HEADER_BYTES, 1, fd ) != 1 ||
+       strncmp( (const char *) header, "STKS", 4 ) ) {
+    fclose( fd );
+    oStream_ << "ScoreFile::openFile: " << fileName << " is not a score file!";
+    handleError( StkError::FILE_UNKNOWN_FORMAT );
+  }
+
+  unsigned long version = (unsigned long) getBytes( &header[4], 4 );
+  unsigned long headerBytes = (unsigned long) getBytes( &header[8], 4 );
+  unsigned long eventBytes = (unsigned long) getBytes( &header[12], 4 );
+  StkFloat rate = (StkFloat) getFloat64( &header[16] );
+  unsigned long long nEvents = getBytes( &header[24], 8 );
+  unsigned long long stringBytes = getBytes( &header[32], 8 );
+
+  // Check the sizes against the file length before anything is read,
+  // taking care that a corrupt count cannot overflow the total.
+  unsigned long long length = (unsigned long long) filestat.st_size;
+  bool valid = ( version >= SCORE_VERSION && headerBytes >= HEADER_BYTES &&
+                 eventBytes >= EVENT_BYTES && rate > 0.0 && headerBytes <= length );
+  if ( valid ) valid = ( nEvents <= ( length - headerBytes ) / eventBytes );
+  if ( valid ) valid = ( stringBytes <= length - headerBytes - nEvents * eventBytes );
+  if ( valid ) valid = ( nEvents <= (unsigned long) -1 );
+  if ( !valid ) {
+    fclose( fd );
+    oStream_ << "ScoreFile::openFile: invalid header or truncated data in file (" << fileName << ")!";
+    handleError( StkError::FILE_ERROR );
+  }
+
+  nEvents_ = (unsigned long) nEvents;
+  stringBytes_ = stringBytes;
+  fileRate_ = rate;
+  this->loadFile( fd, length, headerBytes, eventBytes );
+  fclose( fd );
+
+  // The string table must end with a terminator so that every offset
+  // into it yields a valid string.
+  if ( !events_ || ( stringBytes_ > 0 && strings_[stringBytes_-1] != '\0' ) ) {
+    this->closeFile();
+    oStream_ << "ScoreFile::openFile: error reading file data (" << fileName << ")!";
+    handleError( StkError::FILE_ERROR );
+  }
+}
+
+void ScoreFile :: loadFile( FILE *fd, unsigned long long length, unsigned long headerBytes,
+                            unsigned long eventBytes )
+{
+  size_t eventsLength = (size_t) nEvents_ * EVENT_BYTES;
+
+#if defined(__SCOREFILE_MMAP__) && defined(__LITTLE_ENDIAN__)
+  // The stored events have the layout of the Event structure on
+  // little-endian hosts, so they can be used in place if they are of
+  // the same size and suitably aligned.  Otherwise they are decoded.
+  if ( eventBytes == EVENT_BYTES && headerBytes % 8 == 0 && sizeof(Event) == EVENT_BYTES ) {
+    void *map = mmap( 0, (size_t) length, PROT_READ, MAP_SHARED, fileno( fd ), 0 );
+    if ( map != MAP_FAILED ) {
+      map_ = (unsigned char *) map;
+      mapLength_ = (size_t) length;
+      events_ = (const Event *) ( map_ + headerBytes );
+      strings_ = (const char *) ( map_ + headerBytes + eventsLength );
+      return;
+    }
+  }
+#else
+  (void) length;
+#endif
+
+  // Read and decode the events into memory, with the string table
+  // appended after them.
+  data_.resize( eventsLength / 8 + (size_t) ( stringBytes_ + 7 ) / 8 + 1 );
+  Event *events = (Event *) &data_[0];
+  char *strings = (char *) &data_[0] + eventsLength;
+  std::vector<unsigned char> buffer( eventBytes );
+  if ( fseek( fd, (long) headerBytes, SEEK_SET ) == -1 ) return;
+  for ( unsigned long i=0; i<nEvents_; i++ ) {
+    if ( fread( &buffer[0], eventBytes, 1, fd ) != 1 ) return;
+    events[i].time = getBytes( &buffer[0], 8 );
+    events[i].type = (SINT32) getBytes( &buffer[8], 4 );
+    events[i].channel = (SINT16) getBytes( &buffer[12], 2 );
+    events[i].flags = (UINT16) getBytes( &buffer[14], 2 );
+    events[i].values[0] = getFloat64( &buffer[16] );
+    events[i].values[1] = getFloat64( &buffer[24] );
+  }
+  if ( stringBytes_ > 0 && fread( strings, (size_t) stringBytes_, 1, fd ) != 1 ) return;
+
+  events_ = events;
+  strings_ = strings;
+}
+
+unsigned long long ScoreFile :: getDuration( void ) const
+{
+  if ( nEvents_ == 0 ) return 0;
+  return events_[nEvents_-1].time;
+}
+
+const char *ScoreFile :: getString( const Event& event ) const
+{
+  if ( !( event.flags & STRING_EVENT ) || !( event.values[1] >= 0.0 ) ||
+       event.values[1] >= (FLOAT64) stringBytes_ )
+    return "";
+  return strings_ + (size_t) event.values[1];
+}
+
+void ScoreFile :: seek( unsigned long long time )
+{
+  unsigned long low = 0, high = nEvents_;
+  while ( low < high ) {
+    unsigned long middle = low + ( high - low ) / 2;
+    if ( events_[middle].time < time ) low = middle + 1;
+    else high = middle;
+  }
+  index_ = low;
+}
+
+long ScoreFile :: nextMessage( Skini::Message& message )
+{
+  message.type = 0;
+  if ( index_ >= nEvents_ ) return message.type;
+
+  const Event& event = events_[index_];
+  unsigned long long previous = ( index_ > 0 ) ? events_[index_-1].time : 0;
+  index_++;
+
+  message.type = event.type;
+  message.channel = event.channel;
+  message.time = (StkFloat) ( event.time - previous ) / fileRate_;
+  message.floatValues[0] = (StkFloat) event.values[0];
+  message.intValues[0] = (long) message.floatValues[0];
+  if ( event.flags & STRING_EVENT ) {
+    message.floatValues[1] = 0.0;
+    message.remainder = getString( event );
+  }
+  else {
+    message.floatValues[1] = (StkFloat) event.values[1];
+    message.remainder.clear();
+  }
+  message.intValues[1] = (long) message.floatValues[1];
+
+  return message.type;
+}
+
+unsigned long ScoreFile :: sendEvents( Voicer *voicer, unsigned long long time, bool channelGroups )
+{
+  unsigned long count = 0;
+  while ( index_ < nEvents_ && events_[index_].time <= time ) {
+    const Event& event = events_[index_++];
+    int group = channelGroups ? event.channel : 0;
+    count++;
+
+    switch( event.type ) {
+
+    case __SK_NoteOn_:
+      if ( event.values[1] > 0.0 )
+        voicer->noteOn( event.values[0], event.values[1], group );
+      else
+        voicer->noteOff( event.values[0], 64.0, group );
+      break;
+
+    case __SK_NoteOff_:
+      voicer->noteOff( event.values[0], event.values[1], group );
+      break;
+
+    case __SK_ControlChange_:
+      voicer->controlChange( (int) event.values[0], event.values[1], group );
+      break;
+
+    case __SK_AfterTouch_:
+      voicer->controlChange( __SK_AfterTouch_Cont_, event.values[0], group );
+      break;
+
+    case __SK_PitchBend_:
+      voicer->pitchBend( event.values[0], group );
+      break;
+
+    case __SK_PitchChange_:
+      voicer->setFrequency( event.values[0], group );
+      break;
+
+    default:
+      count--;
+    }
+  }
+
+  return count;
+}
+
+void ScoreFile :: convertSkini( std::string skiniFile, std::string scoreFile, StkFloat rate )
+{
+  Skini skini;
+  if ( !skini.setFile( skiniFile ) ) {
+    oStream_ << "ScoreFile::convertSkini: could not open or find file (" << skiniFile << ")!";
+    handleError( StkError::FILE_NOT_FOUND );
+  }
+
+  std::vector<Event> events;
+  std::string strings;
+  Skini::Message message;
+  StkFloat seconds = 0.0;
+  while ( true ) {
+
+    // The parser only sets the fields used by a message type.
+    message.floatValues[0] = message.floatValues[1] = 0.0;
+    message.remainder.clear();
+    if ( skini.nextMessage( message ) == 0 ) break;
+
+    // Negative times are absolute, including -0.0 for an absolute time of zero.
+    if ( !std::signbit( message.time ) ) seconds += message.time;
+    else seconds = -message.time;
+
+    if ( message.channel < -32768 || message.channel > 32767 ) {
+      oStream_ << "ScoreFile::convertSkini: channel " << message.channel << " is out of range ... skipping message!";
+      handleError( StkError::WARNING );
+      continue;
+    }
+
+    Event event;
+    event.time = (unsigned long long) floor( seconds * rate + 0.5 );
+    event.type = (SINT32) message.type;
+    event.channel = (SINT16) message.channel;
+    event.flags = 0;
+    event.values[0] = message.floatValues[0];
+    event.values[1] = message.floatValues[1];
+    if ( !message.remainder.empty() ) {
+      event.flags = STRING_EVENT;
+      event.values[1] = (FLOAT64) strings.size();
+      strings.append( message.remainder.c_str(), message.remainder.size() + 1 );
+    }
+    events.push_back( event );
+  }
+
+  this->writeFile( scoreFile, events, strings, rate );
+}
+
+void ScoreFile :: convertMidi( std::string midiFile, std::string scoreFile, StkFloat rate )
+{
+  MidiFileIn midi( midiFile );
+
+  std::vector<Event> events;
+  std::string strings;
+  std::vector<unsigned char> bytes;
+  while ( true ) {
+    double seconds = midi.getNextMergedEvent( &bytes );
+    if ( bytes.size() == 0 ) break;
+
+    // Only keep MIDI channel messages.
+    if ( bytes[0] < 0x80 || bytes[0] > 0xEF || bytes.size() < 2 ) continue;
+
+    Event event;
+    event.time = (unsigned long long) floor( seconds * rate + 0.5 );
+    event.type = bytes[0] & 0xF0;
+    event.channel = bytes[0] & 0x0F;
+    event.flags = 0;
+    event.values[0] = bytes[1];
+    event.values[1] = 0.0;
+    if ( ( event.type != 0xC0 ) && ( event.type != 0xD0 ) ) {
+      if ( bytes.size() < 3 ) continue;
+      if ( event.type == 0xE0 ) // combine pitchbend into a single value
+        event.values[0] = ( bytes[1] + ( bytes[2] << 7 ) ) * ONE_OVER_128;
+      else
+        event.values[1] = bytes[2];
+    }
+    events.push_back( event );
+  }
+
+  this->writeFile( scoreFile, events, strings, rate );
+}
+
+void ScoreFile :: writeFile( std::string fileName, std::vector<Event>& events,
+                             std::string& strings, StkFloat rate )
+{
+  // Events at the same time keep their order in the source.
+  std::stable_sort( events.begin(), events.end(), isEarlier );
+
+  FILE *fd = fopen( fileName.c_str(), "wb" );
+  if ( !fd ) {
+    oStream_ << "ScoreFile::writeFile: could not create file (" << fileName << ")!";
+    handleError( StkError::FILE_ERROR );
+  }
+
+  unsigned char header[HEADER_BYTES];
+  memcpy( header, "STKS", 4 );
+  putBytes( &header[4], SCORE_VERSION, 4 );
+  putBytes( &header[8], HEADER_BYTES, 4 );
+  putBytes( &header[12], EVENT_BYTES, 4 );
+  putFloat64( &header[16], rate );
+  putBytes( &header[24], events.size(), 8 );
+  putBytes( &header[32], strings.size(), 8 );
+  putBytes( &header[40], 0, 8 );
+  bool ok = ( fwrite( header, HEADER_BYTES, 1, fd ) == 1 );
+
+  // Encode the events in blocks to keep the number of writes small.
+  const size_t BLOCK_EVENTS = 256;
+  unsigned char buffer[BLOCK_EVENTS * EVENT_BYTES];
+  for ( size_t i=0; ok && i<events.size(); i+=BLOCK_EVENTS ) {
+    size_t nEvents = std::min( BLOCK_EVENTS, events.size() - i );
+    for ( size_t j=0; j<nEvents; j++ ) {
+      const Event& event = events[i+j];
+      unsigned char *ptr = &buffer[j * EVENT_BYTES];
+      putBytes( ptr, event.time, 8 );
+      putBytes( ptr + 8, (UINT32) event.type, 4 );
+      putBytes( ptr + 12, (UINT16) event.channel, 2 );
+      putBytes( ptr + 14, event.flags, 2 );
+      putFloat64( ptr + 16, event.values[0] );
+      putFloat64( ptr + 24, event.values[1] );
+    }
+    ok = ( fwrite( buffer, EVENT_BYTES, nEvents, fd ) == nEvents );
+  }
+
+  if ( ok && strings.size() > 0 )
+    ok = ( fwrite( strings.data(), strings.size(), 1, fd ) == 1 );
+  if ( fclose( fd ) != 0 ) ok = false;
+
+  if ( !ok ) {
+    oStream_ << "ScoreFile::writeFile: error writing file (" << fileName << ")!";
+    handleError( StkError::FILE_ERROR );
+  }
+}
+
+} // stk namespace
@@ -26,7 +26,9 @@
 #include "Skini.h"
 #include "SKINI.tbl"
 #include <cstdlib>
-#include <sstream>
+#include <cstring>
+#include <cctype>
+#include <climits>
 
 namespace stk {
 
@@ -60,74 +62,192 @@ long Skini :: nextMessage( Message& message )
 {
   if ( !file_.is_open() ) return 0;
 
-  std::string line;
   bool done = false;
   while ( !done ) {
 
-    // Read a line from the file and skip over invalid messages.
-    if ( std::getline( file_, line ).eof() ) {
+    // Read a line from the file and skip over invalid messages.  The
+    // line buffer is kept between calls so that it is not reallocated.
+    if ( std::getline( file_, line_ ).eof() ) {
       oStream_ << "// End of Score.  Thanks for using SKINI!!";
       handleError( StkError::STATUS );
       file_.close();
       message.type = 0;
       done = true;
     }
-    else if ( parseString( line, message ) > 0 ) done = true;
+    else if ( parseString( line_.data(), line_.size(), message ) > 0 ) done = true;
   }
 
   return message.type;  
 }
 
-void Skini :: tokenize( const std::string&        str,
-                        std::vector<std::string>& tokens,
-                        const std::string&        delimiters )
+// The message type strings are found with a perfect hash: a seed is
+// chosen, once, for which every string in the table falls in its own
+// slot, so a lookup takes one hash and one comparison.
+const unsigned int HASH_SLOTS = 1024;
+
+static inline unsigned int hashString( const char *s, size_t length, unsigned int seed )
+{
+  unsigned int hash = 2166136261u ^ seed;
+  for ( size_t i=0; i<length; i++ )
+    hash = ( hash ^ (unsigned char) s[i] ) * 16777619u;
+  return ( hash ^ ( hash >> 15 ) ) & ( HASH_SLOTS - 1 );
+}
+
+struct SkiniHash {
+  unsigned int seed;
+  unsigned char slots[HASH_SLOTS]; // table index + 1, or 0 if empty
+
+  SkiniHash() {
+    for ( seed=0; ; seed++ ) {
+      memset( slots, 0, sizeof( slots ) );
+      bool collision = false;
+      for ( int i=0; i<__SK_MaxMsgTypes_ && !collision; i++ ) {
+        const char *name = skini_msgs[i].messageString;
+        size_t length = strlen( name );
+        if ( length == 0 ) continue;
+        unsigned int slot = hashString( name, length, seed );
+        if ( slots[slot] == 0 ) slots[slot] = (unsigned char) ( i + 1 );
+        else if ( strcmp( skini_msgs[ slots[slot] - 1 ].messageString, name ) != 0 ) collision = true;
+      }
+      if ( !collision ) return;
+    }
+  }
+};
+
+static int findMessageType( const char *token, size_t length )
 {
-  // Skip delimiters at beginning.
-  std::string::size_type lastPos = str.find_first_not_of(delimiters, 0);
-  // Find first "non-delimiter".
-  std::string::size_type pos     = str.find_first_of(delimiters, lastPos);
+  static const SkiniHash table;
+  if ( length >= sizeof( skini_msgs[0].messageString ) ) return -1;
+  int index = table.slots[ hashString( token, length, table.seed ) ] - 1;
+  if ( index < 0 ) return -1;
+  const char *name = skini_msgs[index].messageString;
+  if ( strncmp( name, token, length ) != 0 || name[length] != '\0' ) return -1;
+  return index;
+}
+
+// Convert the leading part of a token to a floating-point value, as
+// atof() would.  Plain decimal numbers of up to 19 significant digits
+// whose power of ten is small are converted exactly with one multiply
+// or divide.  Anything else is passed on to strtod().
+static double parseFloat( const char *s, size_t length )
+{
+  static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+  size_t i = 0;
+  while ( i < length && isspace( (unsigned char) s[i] ) ) i++;
+  bool negative = false;
+  if ( i < length && ( s[i] == '-' || s[i] == '+' ) ) negative = ( s[i++] == '-' );
+
+  unsigned long long mantissa = 0;
+  int digits = 0, exponent = 0;
+  bool any = false;
+  while ( i < length && s[i] >= '0' && s[i] <= '9' ) {
+    if ( digits < 19 ) {
+      mantissa = mantissa * 10 + ( s[i] - '0' );
+      if ( mantissa ) digits++;
+    }
+    else exponent++;
+    any = true;
+    i++;
+  }
+  if ( i < length && s[i] == '.' ) {
+    i++;
+    while ( i < length && s[i] >= '0' && s[i] <= '9' ) {
+      if ( digits < 19 ) {
+        mantissa = mantissa * 10 + ( s[i] - '0' );
+        if ( mantissa ) digits++;
+        exponent--;
+      }
+      any = true;
+      i++;
+    }
+  }
+
+  bool simple = any && ( i == length || ( s[i] != 'e' && s[i] != 'E' && s[i] != 'x' && s[i] != 'X' ) );
+  if ( simple && digits < 19 && mantissa < ( 1ULL << 53 ) && exponent >= -22 && exponent <= 22 ) {
+    double value = (double) mantissa;
+    if ( exponent < 0 ) value /= powers[-exponent];
+    else value *= powers[exponent];
+    return negative ? -value : value;
+  }
+  if ( !any && ( i == length || ( s[i] != 'i' && s[i] != 'I' && s[i] != 'n' && s[i] != 'N' ) ) )
+    return 0.0;
+
+  // Exponents, long mantissas, hexadecimal, "inf" and "nan".
+  char buffer[64];
+  if ( length < sizeof( buffer ) ) {
+    memcpy( buffer, s, length );
+    buffer[length] = '\0';
+    return strtod( buffer, NULL );
+  }
+  return strtod( std::string( s, length ).c_str(), NULL );
+}
 
-  while (std::string::npos != pos || std::string::npos != lastPos) {
-    // Found a token, add it to the vector.
-    tokens.push_back(str.substr(lastPos, pos - lastPos));
-    // Skip delimiters.  Note the "not_of"
-    lastPos = str.find_first_not_of(delimiters, pos);
-    // Find next "non-delimiter"
-    pos = str.find_first_of(delimiters, lastPos);
+// Convert the leading part of a token to an integer, as atoi() would.
+static long parseInt( const char *s, size_t length )
+{
+  size_t i = 0;
+  while ( i < length && isspace( (unsigned char) s[i] ) ) i++;
+  bool negative = false;
+  if ( i < length && ( s[i] == '-' || s[i] == '+' ) ) negative = ( s[i++] == '-' );
+
+  // Out-of-range values saturate, as with strtol().
+  unsigned long limit = negative ? (unsigned long) LONG_MAX + 1 : (unsigned long) LONG_MAX;
+  unsigned long value = 0;
+  while ( i < length && s[i] >= '0' && s[i] <= '9' ) {
+    unsigned long digit = s[i++] - '0';
+    value = ( value > ( limit - digit ) / 10 ) ? limit : value * 10 + digit;
   }
-} 
+  return (int) ( negative ? (long) ( 0UL - value ) : (long) value );
+}
+
+static inline bool isDelimiter( char c )
+{
+  return c == ' ' || c == ',' || c == '\t';
+}
 
 long Skini :: parseString( std::string& line, Message& message )
 {
-  message.type = 0;
-  if ( line.empty() ) return message.type;
+  return this->parseString( line.data(), line.size(), message );
+}
 
-  // Check for comment lines.
-  std::string::size_type lastPos = line.find_first_not_of(" ,\t", 0);
-  std::string::size_type pos     = line.find_first_of("/", lastPos);
-  if ( std::string::npos != pos ) {
-    oStream_ << "// Comment Line: " << line;
+long Skini :: parseString( const char *line, size_t length, Message& message )
+{
+  message.type = 0;
+  if ( length == 0 ) return message.type;
+
+  // Split the line in place into the (at most five) fields that are
+  // used, checking for comment lines along the way.
+  const unsigned int MAX_TOKENS = 5;
+  const char *tokens[MAX_TOKENS];
+  size_t lengths[MAX_TOKENS];
+  unsigned int nTokens = 0;
+  size_t i = 0;
+  while ( i < length && isDelimiter( line[i] ) ) i++;
+  if ( memchr( line + i, '/', length - i ) ) {
+    oStream_ << "// Comment Line: ";
+    oStream_.write( line, length );
     handleError( StkError::STATUS );
     return message.type;
   }
 
-  // Tokenize the string.
-  std::vector<std::string> tokens; 
-  this->tokenize( line, tokens, " ,\t");
+  while ( i < length && nTokens < MAX_TOKENS ) {
+    size_t start = i;
+    while ( i < length && !isDelimiter( line[i] ) ) i++;
+    tokens[nTokens] = line + start;
+    lengths[nTokens++] = i - start;
+    while ( i < length && isDelimiter( line[i] ) ) i++;
+  }
 
   // Valid SKINI messages must have at least three fields (type, time,
   // and channel).
-  if ( tokens.size() < 3 ) return message.type;
+  if ( nTokens < 3 ) return message.type;
 
   // Determine message type.
-  int iSkini = 0;
-  while ( iSkini < __SK_MaxMsgTypes_ ) {
-    if ( tokens[0] == skini_msgs[iSkini].messageString ) break;
-    iSkini++;
-  }
-
-  if ( iSkini >= __SK_MaxMsgTypes_ )  {
-    oStream_ << "Skini::parseString: couldn't parse this line:\n   " << line;
+  int iSkini = findMessageType( tokens[0], lengths[0] );
+  if ( iSkini < 0 )  {
+    oStream_ << "Skini::parseString: couldn't parse this line:\n   ";
+    oStream_.write( line, length );
     handleError( StkError::WARNING );
     return message.type;
   }
@@ -137,27 +257,28 @@ long Skini :: parseString( std::string& line, Message& message )
 
   // Parse time field.
   if ( tokens[1][0] == '=' ) {
-    tokens[1].erase( tokens[1].begin() );
-    if ( tokens[1].empty() ) {
-      oStream_ << "Skini::parseString: couldn't parse time field in line:\n   " << line;
+    if ( lengths[1] == 1 ) {
+      oStream_ << "Skini::parseString: couldn't parse time field in line:\n   ";
+      oStream_.write( line, length );
       handleError( StkError::WARNING );
       return message.type = 0;
     }
-    message.time = (StkFloat) -atof( tokens[1].c_str() );
+    message.time = (StkFloat) -parseFloat( tokens[1] + 1, lengths[1] - 1 );
   }
   else
-    message.time = (StkFloat) atof( tokens[1].c_str() );
+    message.time = (StkFloat) parseFloat( tokens[1], lengths[1] );
 
   // Parse the channel field.
-  message.channel = atoi( tokens[2].c_str() );
+  message.channel = parseInt( tokens[2], lengths[2] );
 
   // Parse the remaining fields (maximum of 2 more).
-  int iValue = 0;
+  unsigned int iValue = 0;
   long dataType = skini_msgs[iSkini].data2;
   while ( dataType != NOPE ) {
 
-    if ( tokens.size() <= (unsigned int) (iValue+3) ) {
-      oStream_ <<  "Skini::parseString: inconsistency between type table and parsed line:\n   " << line;
+    if ( nTokens <= iValue+3 ) {
+      oStream_ <<  "Skini::parseString: inconsistency between type table and parsed line:\n   ";
+      oStream_.write( line, length );
       handleError( StkError::WARNING );
       return message.type = 0;
     }
@@ -165,17 +286,17 @@ long Skini :: parseString( std::string& line, Message& message )
     switch ( dataType ) {
 
     case SK_INT:
-      message.intValues[iValue] = atoi( tokens[iValue+3].c_str() );
+      message.intValues[iValue] = parseInt( tokens[iValue+3], lengths[iValue+3] );
       message.floatValues[iValue] = (StkFloat) message.intValues[iValue];
       break;
 
     case SK_DBL:
-      message.floatValues[iValue] = atof( tokens[iValue+3].c_str() );
+      message.floatValues[iValue] = parseFloat( tokens[iValue+3], lengths[iValue+3] );
       message.intValues[iValue] = (long) message.floatValues[iValue];
       break;
 
     case SK_STR: // Must be the last field.
-      message.remainder = tokens[iValue+3];
+      message.remainder.assign( tokens[iValue+3], lengths[iValue+3] );
       return message.type;
 
     default: // MIDI extension message
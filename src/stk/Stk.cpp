@@ -52,6 +52,7 @@
 
 #include "Stk.h"
 #include <stdlib.h>
+#include <algorithm>
 
 namespace stk {
 
@@ -316,6 +317,16 @@ void StkFrames :: resize( size_t nFrames, unsigned int nChannels, StkFloat value
   for ( size_t i=0; i<size_; i++ ) data_[i] = value;
 }
 
+void StkFrames :: swap( StkFrames& f )
+{
+  std::swap( data_, f.data_ );
+  std::swap( dataRate_, f.dataRate_ );
+  std::swap( nFrames_, f.nFrames_ );
+  std::swap( nChannels_, f.nChannels_ );
+  std::swap( size_, f.size_ );
+  std::swap( bufferSize_, f.bufferSize_ );
+}
+
 StkFloat StkFrames :: interpolate( StkFloat frame, unsigned int channel ) const
 {
 #if defined(_STK_DEBUG_)